@@ -0,0 +1,99 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief Allocation counter for microbenchmarks
+ * @file bench_allocs.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * Replaces global operator new / delete to count allocations,
+ * so it must be included by exactly one translation unit of a benchmark executable.
+ * Requires Google Benchmark.
+ *
+ * Private to benchmarks, not installed. Shared with mavros/bench.
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#pragma once
+#ifndef BENCH_ALLOCS_HPP_
+#define BENCH_ALLOCS_HPP_
+
+#include <mavconn/alloc_tracker.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace mavconn
+{
+namespace bench
+{
+
+static std::atomic<size_t> g_allocs{0};
+static uint64_t g_scope_start[static_cast<size_t>(alloc::Scope::_count)];
+
+//! Snapshot allocation counters, call before the benchmark loop
+static size_t start_allocs()
+{
+  for (size_t s = 0; s < static_cast<size_t>(alloc::Scope::_count); s++) {
+    g_scope_start[s] = alloc::get(static_cast<alloc::Scope>(s)).allocs;
+  }
+
+  return g_allocs.load();
+}
+
+//! Report allocations per iteration, call after the benchmark loop
+//! Per-scope malloc counts added if libmavconn built with MAVCONN_ALLOC_TRACKING
+static void report_allocs(benchmark::State & state, size_t start)
+{
+  state.counters["allocs/op"] = benchmark::Counter(
+    g_allocs.load() - start, benchmark::Counter::kAvgIterations);
+
+  if (!alloc::enabled()) {
+    return;
+  }
+
+  for (size_t s = 1; s < static_cast<size_t>(alloc::Scope::_count); s++) {
+    auto scope = static_cast<alloc::Scope>(s);
+    auto n = alloc::get(scope).allocs - g_scope_start[s];
+    if (n > 0) {
+      state.counters[std::string("malloc/op:") + alloc::to_string(scope)] =
+        benchmark::Counter(n, benchmark::Counter::kAvgIterations);
+    }
+  }
+}
+
+}  // namespace bench
+}  // namespace mavconn
+
+void * operator new(size_t size)
+{
+  mavconn::bench::g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void * p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void * p, size_t size [[maybe_unused]]) noexcept
+{
+  std::free(p);
+}
+
+#endif  // BENCH_ALLOCS_HPP_
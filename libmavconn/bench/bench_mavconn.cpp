@@ -0,0 +1,274 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * libmavconn microbenchmarks
+ *
+ * Message mix is loaded from a tlog if --tlog=<path> is given,
+ * otherwise a typical autopilot telemetry mix is synthesized.
+ */
+
+#include <mavconn/interface.hpp>
+#include <mavconn/msgbuffer.hpp>
+#include <mavconn/tlog.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_allocs.hpp"
+
+using namespace mavconn; // NOLINT
+using mavlink_message_t = mavlink::mavlink_message_t;
+
+// -*- message mix -*-
+
+static std::string g_tlog_path;
+
+struct Mix
+{
+  std::vector<uint8_t> stream;            //!< all frames back to back
+  std::vector<mavlink_message_t> messages;
+};
+
+static Mix make_synthetic_mix()
+{
+  namespace msg = mavlink::common::msg;
+
+  // rates roughly match PX4 telemetry on a fast link
+  struct Entry
+  {
+    std::unique_ptr<mavlink::Message> obj;
+    int count;
+  };
+
+  Entry entries[] = {
+    {std::make_unique<mavlink::minimal::msg::HEARTBEAT>(), 1},
+    {std::make_unique<msg::SYS_STATUS>(), 1},
+    {std::make_unique<msg::ATTITUDE>(), 50},
+    {std::make_unique<msg::ATTITUDE_QUATERNION>(), 50},
+    {std::make_unique<msg::HIGHRES_IMU>(), 50},
+    {std::make_unique<msg::LOCAL_POSITION_NED>(), 30},
+    {std::make_unique<msg::GLOBAL_POSITION_INT>(), 30},
+    {std::make_unique<msg::GPS_RAW_INT>(), 5},
+    {std::make_unique<msg::SERVO_OUTPUT_RAW>(), 10},
+    {std::make_unique<msg::STATUSTEXT>(), 1},
+  };
+
+  Mix mix;
+  mavlink::mavlink_status_t status{};
+
+  for (int round = 0; round < 50; round++) {
+    for (auto & e : entries) {
+      if (round % (50 / e.count) != 0) {
+        continue;
+      }
+
+      MsgBuffer buf(*e.obj, &status, 1, 1);
+      mix.stream.insert(mix.stream.end(), buf.data, buf.data + buf.len);
+    }
+  }
+
+  return mix;
+}
+
+static Mix load_tlog_mix(const std::string & path)
+{
+  TlogReader tlog(path);
+  Mix mix;
+
+  for (auto & rec : tlog) {
+    mix.stream.insert(mix.stream.end(), rec.frame, rec.frame + rec.length);
+  }
+
+  return mix;
+}
+
+static const Mix & get_mix()
+{
+  static Mix mix = [] {
+      Mix m = g_tlog_path.empty() ? make_synthetic_mix() : load_tlog_mix(g_tlog_path);
+
+      mavlink_message_t msg;
+      for (size_t pos = 0; pos < m.stream.size(); ) {
+        TlogRecord rec{0, m.stream.data() + pos, 0};
+        rec.length = TlogReader::frame_length(rec.frame, m.stream.size() - pos);
+        if (rec.length == 0) {
+          break;
+        }
+
+        if (TlogReader::decode(rec, msg) == Framing::ok) {
+          m.messages.push_back(msg);
+        }
+        pos += rec.length;
+      }
+
+      return m;
+    } ();
+
+  return mix;
+}
+
+// -*- parser access -*-
+
+/**
+ * Connection without transport, exposes parse_buffer()
+ */
+class BenchConn : public MAVConnInterface
+{
+public:
+  BenchConn()
+  : MAVConnInterface(1, 240) {}
+
+  void connect(
+    const ReceivedCb & cb_handle_message,
+    const ClosedCb & cb_handle_closed_port = ClosedCb()) override
+  {
+    message_received_cb = cb_handle_message;
+    port_closed_cb = cb_handle_closed_port;
+  }
+
+  void close() override {}
+  void send_message(const mavlink_message_t * message [[maybe_unused]]) override {}
+  void send_message(
+    const mavlink::Message & message [[maybe_unused]],
+    const uint8_t src_compid [[maybe_unused]]) override {}
+  void send_bytes(const uint8_t * bytes [[maybe_unused]], size_t length [[maybe_unused]]) override
+  {}
+  bool is_open() override
+  {
+    return true;
+  }
+
+  inline void parse(uint8_t * buf, size_t len)
+  {
+    parse_buffer("bench: ", buf, len, len);
+  }
+};
+
+// -*- benchmarks -*-
+
+static void BM_parse_buffer(benchmark::State & state)
+{
+  auto & mix = get_mix();
+  std::vector<uint8_t> stream = mix.stream;
+  const size_t chunk = state.range(0);
+
+  BenchConn conn;
+  size_t frames = 0;
+  conn.connect([&](const mavlink_message_t *, const Framing) {frames++;});
+
+  auto allocs = bench::start_allocs();
+  for (auto _ : state) {
+    for (size_t pos = 0; pos < stream.size(); pos += chunk) {
+      conn.parse(stream.data() + pos, std::min(chunk, stream.size() - pos));
+    }
+  }
+  bench::report_allocs(state, allocs);
+
+  state.SetBytesProcessed(state.iterations() * stream.size());
+  state.SetItemsProcessed(frames);
+}
+BENCHMARK(BM_parse_buffer)->Arg(64)->Arg(512)->Arg(4096);
+
+static void BM_msgbuffer_from_message(benchmark::State & state)
+{
+  auto & mix = get_mix();
+  size_t bytes = 0;
+
+  auto allocs = bench::start_allocs();
+  for (auto _ : state) {
+    for (auto & msg : mix.messages) {
+      MsgBuffer buf(&msg);
+      benchmark::DoNotOptimize(buf.data);
+      bytes += buf.len;
+    }
+  }
+  bench::report_allocs(state, allocs);
+
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(state.iterations() * mix.messages.size());
+}
+BENCHMARK(BM_msgbuffer_from_message);
+
+static void BM_msgbuffer_from_object(benchmark::State & state)
+{
+  mavlink::common::msg::ATTITUDE att{};
+  att.time_boot_ms = 1000;
+  att.roll = 0.1;
+  att.pitch = 0.2;
+  att.yaw = 0.3;
+
+  mavlink::mavlink_status_t status{};
+  size_t bytes = 0;
+
+  auto allocs = bench::start_allocs();
+  for (auto _ : state) {
+    MsgBuffer buf(att, &status, 1, 1);
+    benchmark::DoNotOptimize(buf.data);
+    bytes += buf.len;
+  }
+  bench::report_allocs(state, allocs);
+
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_msgbuffer_from_object);
+
+static void BM_finalize_message(benchmark::State & state)
+{
+  auto & mix = get_mix();
+  mavlink::mavlink_status_t status{};
+  size_t bytes = 0;
+
+  auto allocs = bench::start_allocs();
+  for (auto _ : state) {
+    for (auto msg : mix.messages) {
+      auto * entry = mavlink::mavlink_get_msg_entry(msg.msgid);
+      if (!entry) {
+        continue;
+      }
+
+      mavlink::mavlink_finalize_message_buffer(
+        &msg, msg.sysid, msg.compid, &status,
+        entry->min_msg_len, msg.len, entry->crc_extra);
+      benchmark::DoNotOptimize(msg.checksum);
+      bytes += msg.len;
+    }
+  }
+  bench::report_allocs(state, allocs);
+
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(state.iterations() * mix.messages.size());
+}
+BENCHMARK(BM_finalize_message);
+
+int main(int argc, char ** argv)
+{
+  benchmark::Initialize(&argc, argv);
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strncmp(argv[i], "--tlog=", 7) == 0) {
+      g_tlog_path = argv[i] + 7;
+    }
+  }
+
+  if (get_mix().messages.empty()) {
+    std::fprintf(stderr, "empty message mix\n");
+    return 1;
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
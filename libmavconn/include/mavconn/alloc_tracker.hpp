@@ -0,0 +1,97 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn heap allocation tracker
+ * @file alloc_tracker.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#pragma once
+#ifndef MAVCONN__ALLOC_TRACKER_HPP_
+#define MAVCONN__ALLOC_TRACKER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mavconn
+{
+namespace alloc
+{
+
+/**
+ * @brief Code path which allocation is attributed to
+ */
+enum class Scope : uint8_t
+{
+  none = 0,     //!< outside of any tracked scope
+  rx,           //!< transport receive and frame parsing
+  route,        //!< Router::route_message() and endpoint send
+  dispatch,     //!< UAS receive and plugin_route()
+  plugin,       //!< plugin message handler
+  _count
+};
+
+struct Counters
+{
+  uint64_t allocs;      //!< malloc/calloc/realloc and aligned allocation calls
+  uint64_t frees;       //!< free calls
+  uint64_t bytes;       //!< requested bytes
+};
+
+/**
+ * @brief Check that library built with MAVCONN_ALLOC_TRACKING and malloc interposer is active
+ */
+bool enabled();
+
+//! Counters of one scope summed over all threads
+Counters get(Scope scope);
+
+//! Counters of one scope for the calling thread only
+Counters get_this_thread(Scope scope);
+
+//! Zero all counters
+void reset();
+
+const char * to_string(Scope scope);
+
+/**
+ * @brief RAII scope marker, restores previous scope on exit
+ */
+class ScopeGuard
+{
+public:
+  explicit ScopeGuard(Scope scope);
+  ~ScopeGuard();
+
+  ScopeGuard(const ScopeGuard &) = delete;
+  ScopeGuard & operator=(const ScopeGuard &) = delete;
+
+private:
+  Scope prev;
+};
+
+}  // namespace alloc
+}  // namespace mavconn
+
+/**
+ * @brief Attribute allocations until the end of the current block to a scope
+ *
+ * Compiles to nothing unless MAVCONN_ALLOC_TRACKING defined.
+ */
+#ifdef MAVCONN_ALLOC_TRACKING
+#define MAVCONN_ALLOC_SCOPE(scope) \
+  ::mavconn::alloc::ScopeGuard mavconn_alloc_scope_guard_(::mavconn::alloc::Scope::scope)
+#else
+#define MAVCONN_ALLOC_SCOPE(scope) do {} while (0)
+#endif
+
+#endif  // MAVCONN__ALLOC_TRACKER_HPP_
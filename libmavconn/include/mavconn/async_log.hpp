@@ -0,0 +1,196 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn non-blocking logging
+ * @file async_log.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#pragma once
+#ifndef MAVCONN__ASYNC_LOG_HPP_
+#define MAVCONN__ASYNC_LOG_HPP_
+
+#include <console_bridge/console.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace mavconn
+{
+
+/**
+ * @brief Asynchronous console_bridge backend
+ *
+ * Messages are formatted into a fixed-size lock-free ring and written to
+ * console_bridge by a background thread, so io threads never block on console output.
+ * When the ring is full new messages are dropped and counted.
+ *
+ * Use MAVCONN_LOG_* macros: they check log level before evaluating arguments.
+ */
+class AsyncLog
+{
+public:
+  static constexpr size_t RING_SIZE = 256;      //!< must be power of two
+  static constexpr size_t MAX_TEXT = 256;
+
+  using Level = console_bridge::LogLevel;
+
+  static AsyncLog & instance();
+
+  static inline bool enabled(Level level)
+  {
+    return level >= console_bridge::getLogLevel();
+  }
+
+  void log(const char * file, int line, Level level, const char * fmt, ...)
+  __attribute__((format(printf, 5, 6)));
+
+  //! Same as log() but appends count of suppressed repetitions
+  void log_repeated(const char * file, int line, Level level, size_t repeated, const char * fmt, ...)
+  __attribute__((format(printf, 6, 7)));
+
+  //! Wait until all queued messages are written
+  void flush();
+
+  inline size_t get_dropped() const
+  {
+    return dropped_total.load(std::memory_order_relaxed);
+  }
+
+  ~AsyncLog();
+
+private:
+  struct Entry
+  {
+    std::atomic<size_t> seq;
+    const char * file;
+    int line;
+    Level level;
+    char text[MAX_TEXT];
+  };
+
+  std::array<Entry, RING_SIZE> ring;
+  std::atomic<size_t> head;       //!< producers position
+  size_t tail;                    //!< consumer position, writer thread only
+  std::atomic<size_t> written;    //!< messages passed to console_bridge
+  std::atomic<size_t> dropped;
+  std::atomic<size_t> dropped_total;
+
+  std::mutex cond_mutex;
+  std::condition_variable cond;
+  std::condition_variable flush_cond;
+  std::atomic<bool> sleeping;
+  bool stop_request;
+  std::thread writer_thread;
+
+  AsyncLog();
+
+  void vlog(
+    const char * file, int line, Level level, size_t repeated, const char * fmt,
+    va_list args);
+  bool drain();
+  void run();
+};
+
+/**
+ * @brief Rate limit for repeated messages
+ *
+ * Keyed by format string pointer, so each call site is limited separately.
+ * Connections keep their own instance, so one noisy link does not hide others.
+ */
+class LogThrottle
+{
+public:
+  using steady_clock = std::chrono::steady_clock;
+
+  explicit LogThrottle(steady_clock::duration period_ = std::chrono::seconds(1));
+
+  /**
+   * @param[out] suppressed  count of messages dropped since last pass
+   * @return true if message should be logged
+   */
+  bool check(const char * fmt, size_t & suppressed);
+
+private:
+  struct Site
+  {
+    const char * fmt;
+    steady_clock::time_point last;
+    size_t suppressed;
+  };
+
+  std::mutex mutex;
+  const steady_clock::duration period;
+  std::array<Site, 8> sites;
+  size_t next_site;
+};
+
+}  // namespace mavconn
+
+#define MAVCONN_LOG(level, fmt, ...) \
+  do { \
+    if (::mavconn::AsyncLog::enabled(level)) { \
+      ::mavconn::AsyncLog::instance().log(__FILE__, __LINE__, level, fmt, ## __VA_ARGS__); \
+    } \
+  } while (0)
+
+#define MAVCONN_LOG_THROTTLE(throttle, level, fmt, ...) \
+  do { \
+    size_t mavconn_log_suppressed_ = 0; \
+    if (::mavconn::AsyncLog::enabled(level) && \
+      (throttle).check(fmt, mavconn_log_suppressed_)) \
+    { \
+      ::mavconn::AsyncLog::instance().log_repeated( \
+        __FILE__, __LINE__, level, mavconn_log_suppressed_, fmt, ## __VA_ARGS__); \
+    } \
+  } while (0)
+
+// [[[cog:
+// for func in ('debug', 'inform', 'warn', 'error'):
+//     fu = func.upper()
+//     lvl = 'INFO' if func == 'inform' else fu
+//
+//     cog.outl(f'#define MAVCONN_LOG_{fu}(fmt, ...) \\')
+//     cog.outl(f'  MAVCONN_LOG(console_bridge::CONSOLE_BRIDGE_LOG_{lvl}, fmt, ## __VA_ARGS__)')
+//
+// cog.outl()
+// for func in ('warn', 'error'):
+//     fu = func.upper()
+//
+//     cog.outl(f'#define MAVCONN_LOG_{fu}_THROTTLE(throttle, fmt, ...) \\')
+//     cog.outl(f'  MAVCONN_LOG_THROTTLE( \\')
+//     cog.outl(f'    throttle, console_bridge::CONSOLE_BRIDGE_LOG_{fu}, fmt, ## __VA_ARGS__)')
+// ]]]
+#define MAVCONN_LOG_DEBUG(fmt, ...) \
+  MAVCONN_LOG(console_bridge::CONSOLE_BRIDGE_LOG_DEBUG, fmt, ## __VA_ARGS__)
+#define MAVCONN_LOG_INFORM(fmt, ...) \
+  MAVCONN_LOG(console_bridge::CONSOLE_BRIDGE_LOG_INFO, fmt, ## __VA_ARGS__)
+#define MAVCONN_LOG_WARN(fmt, ...) \
+  MAVCONN_LOG(console_bridge::CONSOLE_BRIDGE_LOG_WARN, fmt, ## __VA_ARGS__)
+#define MAVCONN_LOG_ERROR(fmt, ...) \
+  MAVCONN_LOG(console_bridge::CONSOLE_BRIDGE_LOG_ERROR, fmt, ## __VA_ARGS__)
+
+#define MAVCONN_LOG_WARN_THROTTLE(throttle, fmt, ...) \
+  MAVCONN_LOG_THROTTLE( \
+    throttle, console_bridge::CONSOLE_BRIDGE_LOG_WARN, fmt, ## __VA_ARGS__)
+#define MAVCONN_LOG_ERROR_THROTTLE(throttle, fmt, ...) \
+  MAVCONN_LOG_THROTTLE( \
+    throttle, console_bridge::CONSOLE_BRIDGE_LOG_ERROR, fmt, ## __VA_ARGS__)
+// [[[end]]] (checksum: 95f2b0b6c6d5e58cfca8f7857cfc31cf)
+
+#endif  // MAVCONN__ASYNC_LOG_HPP_
@@ -23,7 +23,9 @@
 #ifndef MAVCONN__INTERFACE_HPP_
 #define MAVCONN__INTERFACE_HPP_
 
+#include <mavconn/async_log.hpp>
 #include <mavconn/mavlink_dialect.hpp>
+#include <mavconn/tx_shaper.hpp>
 
 #include <atomic>
 #include <cassert>
@@ -245,6 +247,20 @@ public:
   void set_protocol_version(Protocol pver);
   Protocol get_protocol_version();
 
+  /**
+   * Set transmit shaper, messages it rejects are silently dropped.
+   *
+   * NOTE: should be set before connect(), send path reads it without lock.
+   */
+  inline void set_tx_shaper(TxShaper::Ptr shaper)
+  {
+    tx_shaper = shaper;
+  }
+  inline TxShaper::Ptr get_tx_shaper()
+  {
+    return tx_shaper;
+  }
+
   /**
    * @brief Construct connection from URL
    *
@@ -253,6 +269,8 @@ public:
    * - udp://
    * - tcp://
    * - tcp-l://
+   * - replay://
+   * - capture://
    *
    * Please see user's documentation for details.
    *
@@ -294,6 +312,9 @@ protected:
   //! Channel number used for logging.
   size_t conn_id;
 
+  //! Rate limit of repeated errors of this connection
+  LogThrottle log_throttle;
+
   inline mavlink::mavlink_status_t * get_status_p()
   {
     return &m_parse_status;
@@ -312,6 +333,10 @@ protected:
   void iostat_tx_add(size_t bytes);
   void iostat_rx_add(size_t bytes);
 
+  //! Ask tx shaper if message may be sent
+  bool tx_admit(const char * pfx, const mavlink::mavlink_message_t * msg);
+  bool tx_admit(const char * pfx, const mavlink::Message & msg);
+
   void log_recv(const char * pfx, mavlink::mavlink_message_t & msg, Framing framing);
   void log_send(const char * pfx, const mavlink::mavlink_message_t * msg);
   void log_send_obj(const char * pfx, const mavlink::Message & msg);
@@ -323,6 +348,8 @@ private:
   mavlink::mavlink_message_t m_buffer;
   mavlink::mavlink_status_t m_mavlink_status;
 
+  TxShaper::Ptr tx_shaper;
+
   std::atomic<size_t> tx_total_bytes, rx_total_bytes;
   std::recursive_mutex iostat_mutex;
   size_t last_tx_total_bytes, last_rx_total_bytes;
@@ -0,0 +1,150 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn tlog replay and capture link classes
+ * @file replay.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#pragma once
+#ifndef MAVCONN__REPLAY_HPP_
+#define MAVCONN__REPLAY_HPP_
+
+#include <mavconn/interface.hpp>
+#include <mavconn/tlog.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace mavconn
+{
+
+/**
+ * @brief Replay interface: receives messages from a tlog file
+ *
+ * Frames are emitted with original timing scaled by rate,
+ * or as fast as possible if rate is 0.
+ * Sent messages are dropped.
+ *
+ * URL: replay:///path/to/file.tlog?rate=1.0&start=0&loop=0
+ */
+class MAVConnReplay : public MAVConnInterface,
+  public std::enable_shared_from_this<MAVConnReplay>
+{
+public:
+  static constexpr auto DEFAULT_RATE = 1.0;
+
+  /**
+   * @param[in] path   tlog file path
+   * @param[in] rate   time scale, 2.0 - twice faster, 0 - as fast as possible
+   * @param[in] start  start position [s] from the beginning of the log
+   * @param[in] loop   restart from the beginning at the end of the log
+   */
+  MAVConnReplay(
+    uint8_t system_id = 1, uint8_t component_id = MAV_COMP_ID_UDP_BRIDGE,
+    std::string path = "", double rate = DEFAULT_RATE, double start = 0.0,
+    bool loop = false);
+
+  virtual ~MAVConnReplay();
+
+  void connect(
+    const ReceivedCb & cb_handle_message,
+    const ClosedCb & cb_handle_closed_port = ClosedCb()) override;
+  void close() override;
+
+  void send_message(const mavlink::mavlink_message_t * message) override;
+  void send_message(const mavlink::Message & message, const uint8_t source_compid) override;
+  void send_bytes(const uint8_t * bytes, size_t length) override;
+
+  inline bool is_open() override
+  {
+    return is_running;
+  }
+
+  /**
+   * @brief Move playback position
+   *
+   * Position past the last record ends playback (or restarts it if looped).
+   *
+   * @param[in] position  seconds from the beginning of the log
+   */
+  void seek(double position);
+
+  //! Change time scale, applies from the next frame
+  void set_rate(double rate);
+
+  //! Current position [s] from the beginning of the log
+  double get_position();
+
+  //! Log duration [s]
+  double get_duration();
+
+private:
+  std::unique_ptr<TlogReader> tlog;
+  std::thread replay_thread;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::atomic<bool> is_running;
+
+  double rate;
+  bool loop;
+  size_t cursor;
+  bool rebase;    //!< reset time base on the next frame
+
+  void do_replay();
+};
+
+/**
+ * @brief Capture interface: writes all sent messages to a tlog file
+ *
+ * Nothing is received. File format is the same as replay:// reads.
+ *
+ * URL: capture:///path/to/file.tlog
+ */
+class MAVConnCapture : public MAVConnInterface
+{
+public:
+  /**
+   * @param[in] path   tlog file path, overwritten
+   */
+  MAVConnCapture(
+    uint8_t system_id = 1, uint8_t component_id = MAV_COMP_ID_UDP_BRIDGE,
+    std::string path = "");
+
+  virtual ~MAVConnCapture();
+
+  void connect(
+    const ReceivedCb & cb_handle_message,
+    const ClosedCb & cb_handle_closed_port = ClosedCb()) override;
+  void close() override;
+
+  void send_message(const mavlink::mavlink_message_t * message) override;
+  void send_message(const mavlink::Message & message, const uint8_t source_compid) override;
+  void send_bytes(const uint8_t * bytes, size_t length) override;
+
+  inline bool is_open() override
+  {
+    return is_running;
+  }
+
+private:
+  std::unique_ptr<TlogWriter> tlog;
+  std::atomic<bool> is_running;
+};
+
+}  // namespace mavconn
+
+#endif  // MAVCONN__REPLAY_HPP_
@@ -0,0 +1,316 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn simulated FCU
+ * @file sim_fcu.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#pragma once
+#ifndef MAVCONN__SIM_FCU_HPP_
+#define MAVCONN__SIM_FCU_HPP_
+
+#include <mavconn/interface.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mavconn
+{
+namespace sim
+{
+
+/**
+ * @brief Link impairment settings applied to one direction of the simulated link
+ */
+struct LinkImpairment
+{
+  std::chrono::microseconds latency{0};   //!< constant one-way delay
+  std::chrono::microseconds jitter{0};    //!< uniform random extra delay [0..jitter]
+  float loss = 0.0f;                      //!< frame loss probability [0..1]
+  size_t bandwidth = 0;                   //!< link capacity [B/s], 0 - unlimited
+};
+
+/**
+ * @brief ULog file streamed by SimFCU, like PX4 logger does over MAVLink
+ */
+struct ULogStream
+{
+  std::vector<uint8_t> data;              //!< ULog file
+  size_t acked_size = 0;                  //!< leading bytes (header, definitions) sent acked
+  size_t rate = 0;                        //!< payload rate [B/s], 0 - fill TX link bandwidth
+};
+
+/**
+ * @brief Simulated autopilot built on top of MAVConnInterface
+ *
+ * Emits configurable telemetry streams and implements server side of
+ * parameter, mission, FTP, command, timesync and log streaming microservices.
+ * Everything works offline, so that class is intended to be the base
+ * for benchmarks and performance tests.
+ *
+ * All handlers run on the internal worker thread.
+ */
+class SimFCU : public std::enable_shared_from_this<SimFCU>
+{
+public:
+  using Ptr = std::shared_ptr<SimFCU>;
+  using clock = std::chrono::steady_clock;
+  //! Stream generator. Called with time since boot, should call send_message().
+  using Generator = std::function<void (uint64_t time_boot_us)>;
+  //! Command handler. Returns MAV_RESULT.
+  using CommandHandler = std::function<uint8_t (const mavlink::common::msg::COMMAND_LONG & cmd)>;
+  //! Hook called for every received message after built-in servers.
+  using MessageHook = std::function<void (const mavlink::mavlink_message_t * msg)>;
+
+  struct Stats
+  {
+    size_t tx_frames;     //!< frames passed to the link
+    size_t tx_bytes;      //!< bytes passed to the link
+    size_t tx_lost;       //!< frames dropped by impairment
+    size_t rx_frames;     //!< frames accepted
+    size_t rx_lost;       //!< frames dropped by impairment
+    size_t ulog_packets;      //!< LOGGING_DATA(_ACKED) frames sent
+    size_t ulog_retransmits;  //!< LOGGING_DATA_ACKED sent again after ack timeout
+  };
+
+  /**
+   * @param[in] link       connection to use, should not be connected yet
+   * @param[in] system_id  FCU system id
+   * @param[in] component_id  FCU component id
+   */
+  explicit SimFCU(
+    MAVConnInterface::Ptr link, uint8_t system_id = 1,
+    uint8_t component_id = 1);
+
+  /**
+   * @brief Construct SimFCU with connection made by MAVConnInterface::open_url_no_connect()
+   */
+  static Ptr open_url(std::string url, uint8_t system_id = 1, uint8_t component_id = 1);
+
+  ~SimFCU();
+
+  //! Connect to the link and start worker
+  void start();
+  //! Stop worker and close the link
+  void stop();
+
+  /**
+   * @brief Set stream rate for a message
+   *
+   * Built-in generators exist for HEARTBEAT, SYS_STATUS, SYSTEM_TIME, ATTITUDE,
+   * ATTITUDE_QUATERNION, HIGHRES_IMU, RAW_IMU, LOCAL_POSITION_NED,
+   * GLOBAL_POSITION_INT and GPS_RAW_INT.
+   *
+   * @param[in] msgid    message id
+   * @param[in] rate_hz  rate, 0 - disable stream
+   */
+  void set_stream_rate(mavlink::msgid_t msgid, float rate_hz);
+
+  /**
+   * @brief Add or replace stream generator
+   */
+  void add_stream(mavlink::msgid_t msgid, float rate_hz, Generator gen);
+
+  //! Set impairment for FCU -> remote direction
+  void set_tx_impairment(const LinkImpairment & imp);
+  //! Set impairment for remote -> FCU direction
+  void set_rx_impairment(const LinkImpairment & imp);
+
+  //! Define (or change) parameter. Type is MAV_PARAM_TYPE.
+  void set_param(const std::string & param_id, float value, uint8_t param_type = 9);
+  bool get_param(const std::string & param_id, float & value);
+  size_t param_count();
+
+  //! Replace mission items of given MAV_MISSION_TYPE
+  void set_mission(uint8_t mission_type, std::vector<mavlink::common::msg::MISSION_ITEM_INT> items);
+  std::vector<mavlink::common::msg::MISSION_ITEM_INT> get_mission(uint8_t mission_type);
+
+  //! Put file into FTP server filesystem
+  void set_file(const std::string & path, std::vector<uint8_t> data);
+  bool get_file(const std::string & path, std::vector<uint8_t> & data);
+
+  /**
+   * @brief Set file streamed after MAV_CMD_LOGGING_START
+   *
+   * Acked part is sent one packet at a time and retransmitted until LOGGING_ACK,
+   * the rest is sent once as LOGGING_DATA.
+   * Stream ends at the end of data or on MAV_CMD_LOGGING_STOP.
+   */
+  void set_ulog_stream(ULogStream stream);
+  //! true while log is being streamed
+  bool is_ulog_streaming();
+
+  //! Set custom COMMAND_LONG/COMMAND_INT handler
+  void set_command_handler(uint16_t command, CommandHandler handler);
+
+  //! Set hook for all received messages
+  void set_message_hook(MessageHook hook);
+
+  /**
+   * @brief Send message from FCU
+   *
+   * Message is finalized with FCU ids and passed through TX impairment.
+   * Thread-safe.
+   */
+  void send_message(const mavlink::Message & msg);
+
+  //! Time since start
+  uint64_t get_time_boot_us();
+
+  Stats get_stats();
+
+  inline uint8_t get_system_id()
+  {
+    return sys_id;
+  }
+
+  inline uint8_t get_component_id()
+  {
+    return comp_id;
+  }
+
+private:
+  struct Stream
+  {
+    clock::duration period;
+    clock::time_point next;
+    Generator gen;
+  };
+
+  struct Pending
+  {
+    bool is_rx;
+    mavlink::mavlink_message_t msg;
+  };
+
+  struct Param
+  {
+    float value;
+    uint8_t type;
+  };
+
+  struct MissionUpload
+  {
+    bool active;
+    uint8_t tgt_sys;
+    uint8_t tgt_comp;
+    uint8_t mission_type;
+    uint16_t count;
+    uint16_t next_seq;
+    clock::time_point last_request;
+    std::vector<mavlink::common::msg::MISSION_ITEM_INT> items;
+  };
+
+  struct FTPSession
+  {
+    std::string path;
+    bool writable;
+  };
+
+  struct ULogState
+  {
+    bool active;
+    uint8_t tgt_sys;
+    uint8_t tgt_comp;
+    uint16_t sequence;
+    size_t pos;               //!< offset of next packet in data
+    bool wait_ack;
+    size_t acked_len;         //!< length of packet waiting for ack
+    clock::time_point last_send;
+    clock::time_point next_send;
+    std::vector<size_t> starts;   //!< offsets of header and messages in data
+  };
+
+  MAVConnInterface::Ptr link;
+  uint8_t sys_id;
+  uint8_t comp_id;
+
+  std::recursive_mutex mutex;
+  std::condition_variable_any cond;
+  std::thread worker;
+  bool running;
+
+  clock::time_point boot_time;
+  mavlink::mavlink_status_t tx_status;
+  std::mt19937 rng;
+
+  LinkImpairment tx_imp;
+  LinkImpairment rx_imp;
+  clock::time_point tx_link_free;
+  clock::time_point rx_link_free;
+  std::multimap<clock::time_point, Pending> pending;
+
+  std::unordered_map<mavlink::msgid_t, Stream> streams;
+  std::unordered_map<mavlink::msgid_t, Generator> builtin_gens;
+
+  std::vector<std::string> param_order;
+  std::unordered_map<std::string, Param> params;
+
+  std::unordered_map<uint8_t, std::vector<mavlink::common::msg::MISSION_ITEM_INT>> missions;
+  MissionUpload mission_upload;
+  uint16_t mission_current;
+
+  std::map<std::string, std::vector<uint8_t>> files;
+  std::unordered_map<uint8_t, FTPSession> ftp_sessions;
+  uint8_t ftp_next_session;
+
+  ULogStream ulog;
+  ULogState ulog_state;
+
+  std::unordered_map<uint16_t, CommandHandler> command_handlers;
+  MessageHook message_hook;
+
+  uint8_t base_mode;
+
+  Stats stats;
+
+  void run();
+  void enqueue(bool is_rx, const mavlink::mavlink_message_t & msg);
+  bool apply_impairment(
+    const LinkImpairment & imp, clock::time_point & link_free,
+    size_t frame_len, clock::time_point & release);
+
+  void recv_message(const mavlink::mavlink_message_t * msg, const Framing framing);
+  void handle_message(const mavlink::mavlink_message_t * msg);
+
+  void handle_param(const mavlink::mavlink_message_t * msg);
+  void handle_mission(const mavlink::mavlink_message_t * msg);
+  void handle_ftp(const mavlink::mavlink_message_t * msg);
+  void handle_command(const mavlink::mavlink_message_t * msg);
+  void handle_timesync(const mavlink::mavlink_message_t * msg);
+  void handle_logging_ack(const mavlink::mavlink_message_t * msg);
+
+  void send_param_value(size_t index);
+  void send_mission_request(uint8_t mission_type, uint16_t seq);
+  void send_mission_ack(uint8_t mission_type, uint8_t result, uint8_t tgt_sys, uint8_t tgt_comp);
+  void send_command_ack(uint16_t command, uint8_t result, uint8_t tgt_sys, uint8_t tgt_comp);
+  void send_builtin(mavlink::msgid_t msgid);
+  void send_ulog_packet(bool acked, size_t len);
+  void ulog_step(clock::time_point now, clock::time_point & next_wake);
+
+  void init_builtin_generators();
+};
+
+}  // namespace sim
+}  // namespace mavconn
+
+#endif  // MAVCONN__SIM_FCU_HPP_
@@ -0,0 +1,141 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn telemetry log (tlog) reader and writer
+ * @file tlog.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#pragma once
+#ifndef MAVCONN__TLOG_HPP_
+#define MAVCONN__TLOG_HPP_
+
+#include <mavconn/interface.hpp>
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mavconn
+{
+
+/**
+ * @brief One tlog record: big-endian 64-bit UNIX time [us] followed by a MAVLink frame
+ */
+struct TlogRecord
+{
+  uint64_t time_usec;       //!< record timestamp
+  const uint8_t * frame;    //!< raw frame bytes, points into reader storage
+  size_t length;            //!< frame length
+};
+
+/**
+ * @brief Reader for QGroundControl / MAVProxy .tlog files
+ *
+ * File is memory-mapped and indexed on open, record frames point into the mapping.
+ * Frame length is taken from the frame header,
+ * so records with unknown messages are kept as is.
+ * Truncated tail and garbage between records are skipped.
+ */
+class TlogReader
+{
+public:
+  /**
+   * @brief Map and index whole file
+   * @throws DeviceError if file can not be mapped
+   */
+  explicit TlogReader(const std::string & path);
+  ~TlogReader();
+
+  TlogReader(const TlogReader &) = delete;
+  TlogReader & operator=(const TlogReader &) = delete;
+
+  inline size_t size() const
+  {
+    return records.size();
+  }
+
+  inline const TlogRecord & operator[](size_t idx) const
+  {
+    return records[idx];
+  }
+
+  inline std::vector<TlogRecord>::const_iterator begin() const
+  {
+    return records.begin();
+  }
+
+  inline std::vector<TlogRecord>::const_iterator end() const
+  {
+    return records.end();
+  }
+
+  /**
+   * @brief Index of the first record with time_usec >= given time
+   * @return size() if there no such record
+   */
+  size_t find(uint64_t time_usec) const;
+
+  /**
+   * @brief Decode record frame to mavlink_message_t
+   * @return framing result, Framing::incomplete if frame is broken
+   */
+  static Framing decode(const TlogRecord & rec, mavlink::mavlink_message_t & msg);
+
+  /**
+   * @brief Length of the frame starting at buf, 0 if buf does not start with a frame header
+   */
+  static size_t frame_length(const uint8_t * buf, size_t size);
+
+private:
+  const uint8_t * data;
+  size_t data_size;
+  std::vector<TlogRecord> records;
+};
+
+/**
+ * @brief Writer for .tlog files, same format as read by TlogReader
+ *
+ * Thread-safe.
+ */
+class TlogWriter
+{
+public:
+  /**
+   * @param[in] path    file to write, truncated if exists
+   * @throws DeviceError if file can not be opened
+   */
+  explicit TlogWriter(const std::string & path);
+  ~TlogWriter();
+
+  TlogWriter(const TlogWriter &) = delete;
+  TlogWriter & operator=(const TlogWriter &) = delete;
+
+  //! Write message with current time
+  void write(const mavlink::mavlink_message_t * msg);
+  //! Write already serialized frame
+  void write(uint64_t time_usec, const uint8_t * frame, size_t length);
+
+  void flush();
+
+  //! Current UNIX time [us] as used for record timestamps
+  static uint64_t now_usec();
+
+private:
+  std::mutex mutex;
+  FILE * file;
+};
+
+}  // namespace mavconn
+
+#endif  // MAVCONN__TLOG_HPP_
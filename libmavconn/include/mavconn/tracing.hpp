@@ -0,0 +1,82 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn LTTng tracepoints
+ * @file tracing.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#pragma once
+#ifndef MAVCONN__TRACING_HPP_
+#define MAVCONN__TRACING_HPP_
+
+/**
+ * Static tracepoints along the message path.
+ *
+ * All events belong to the `mavconn` LTTng-UST provider:
+ *
+ *   - transport_read       bytes received by a connection
+ *   - frame_parse          frame parsed by a connection
+ *   - mavlink_send         message passed to a connection for sending
+ *   - route_message        router decision, number of destinations
+ *   - endpoint_send        message forwarded to a router endpoint
+ *   - uas_dispatch         message received by UAS node
+ *   - plugin_handler_entry / plugin_handler_exit
+ *   - uas_send             message sent by UAS node
+ *
+ * Each message event carries msgid, sysid, compid and seq,
+ * so together with ros2_tracing events one trace shows the whole message path.
+ *
+ * Tracepoints compile to nothing unless MAVCONN_TRACING defined.
+ */
+
+#ifdef MAVCONN_TRACING
+
+#include <mavconn/mavlink_dialect.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mavconn
+{
+namespace tracing
+{
+
+using mavlink::mavlink_message_t;
+
+void transport_read(size_t conn_id, size_t bytes);
+void frame_parse(size_t conn_id, const mavlink_message_t * msg, uint8_t framing);
+void mavlink_send(size_t conn_id, const mavlink_message_t * msg);
+void mavlink_send_obj(size_t conn_id, uint32_t msgid, uint8_t sysid, uint8_t compid);
+
+void route_message(
+  uint32_t src_id, const mavlink_message_t * msg, uint16_t target_addr,
+  size_t sent_count);
+void endpoint_send(uint32_t src_id, uint32_t dest_id, const mavlink_message_t * msg);
+
+void uas_dispatch(const mavlink_message_t * msg, size_t handler_count);
+void plugin_handler_entry(const mavlink_message_t * msg, const char * handler, size_t type_hash);
+void plugin_handler_exit(const mavlink_message_t * msg);
+void uas_send(const mavlink_message_t * msg);
+
+}  // namespace tracing
+}  // namespace mavconn
+
+#define MAVCONN_TRACEPOINT(event, ...) (::mavconn::tracing::event(__VA_ARGS__))
+
+#else
+
+#define MAVCONN_TRACEPOINT(event, ...) ((void)(0))
+
+#endif  // MAVCONN_TRACING
+
+#endif  // MAVCONN__TRACING_HPP_
@@ -0,0 +1,135 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn transmit shaper
+ * @file tx_shaper.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#pragma once
+#ifndef MAVCONN__TX_SHAPER_HPP_
+#define MAVCONN__TX_SHAPER_HPP_
+
+#include <mavconn/mavlink_dialect.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace mavconn
+{
+
+/**
+ * @brief Token bucket transmit admission driven by radio link feedback
+ *
+ * Rate follows AIMD: it is halved when the radio reports low free space
+ * in its transmit buffer (RADIO_STATUS.txbuf) and grows slowly while
+ * the buffer is mostly empty and no new receive errors are reported.
+ *
+ * High priority messages (heartbeats, targeted commands and protocol
+ * transfers) are always admitted but consume tokens,
+ * low priority ones (broadcast telemetry) are dropped when the bucket is empty.
+ *
+ * Shaper is inactive (admits everything) until first radio status update.
+ */
+class TxShaper
+{
+public:
+  using Ptr = std::shared_ptr<TxShaper>;
+  using steady_clock = std::chrono::steady_clock;
+
+  enum class Priority
+  {
+    low,
+    high,
+  };
+
+  struct Config
+  {
+    float max_rate = 6000.0f;           //!< upper rate limit [B/s], ~ SiK 64 kbit/s air rate
+    float min_rate = 300.0f;            //!< lower rate limit [B/s]
+    float increase_step = 0.05f;        //!< additive increase, fraction of max_rate per update
+    float decrease_factor = 0.5f;       //!< multiplicative decrease on congestion
+    uint8_t txbuf_low = 40;             //!< free tx buffer [%] below which rate is decreased
+    uint8_t txbuf_high = 80;            //!< free tx buffer [%] above which rate may grow
+    std::chrono::milliseconds burst{250};   //!< bucket depth expressed in time at current rate
+  };
+
+  struct Stats
+  {
+    bool active;
+    float rate;                 //!< current rate limit [B/s]
+    float goodput;              //!< admitted traffic [B/s], smoothed
+    uint8_t txbuf;              //!< last reported free tx buffer [%]
+    float error_rate;           //!< radio rx errors per second
+    size_t admitted;
+    size_t admitted_bytes;
+    size_t dropped;
+    size_t dropped_bytes;
+  };
+
+  TxShaper();
+  explicit TxShaper(const Config & config);
+
+  /**
+   * Decide if message could be sent now. Thread-safe.
+   */
+  bool admit(mavlink::msgid_t msgid, size_t length);
+
+  /**
+   * Feed link feedback, e.g. from RADIO_STATUS
+   */
+  void update_radio_status(uint8_t txbuf, uint16_t rxerrors);
+
+  //! Override default priority of a message
+  void set_priority(mavlink::msgid_t msgid, Priority prio);
+  Priority get_priority(mavlink::msgid_t msgid);
+
+  //! Disable shaping and forget link state
+  void reset();
+
+  Stats get_stats();
+
+private:
+  std::mutex mutex;
+  Config config;
+
+  bool active;
+  float rate;
+  float tokens;
+  steady_clock::time_point last_refill;
+
+  uint8_t last_txbuf;
+  uint16_t last_rxerrors;
+  float error_rate;
+  steady_clock::time_point last_status;
+
+  float goodput;
+  size_t goodput_bytes;
+  steady_clock::time_point goodput_stamp;
+
+  size_t stat_admitted, stat_admitted_bytes;
+  size_t stat_dropped, stat_dropped_bytes;
+
+  std::unordered_map<mavlink::msgid_t, Priority> priority_overrides;
+
+  Priority classify(mavlink::msgid_t msgid);
+  void refill(steady_clock::time_point now);
+  void update_goodput(steady_clock::time_point now);
+};
+
+}  // namespace mavconn
+
+#endif  // MAVCONN__TX_SHAPER_HPP_
@@ -0,0 +1,222 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn heap allocation tracker
+ * @file alloc_tracker.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#include <mavconn/alloc_tracker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+
+namespace mavconn
+{
+namespace alloc
+{
+
+//! Max threads with own counters, rest share the last slot
+static constexpr size_t MAX_THREADS = 256;
+static constexpr size_t NUM_SCOPES = static_cast<size_t>(Scope::_count);
+
+/**
+ * Per-thread counters. Only owner thread writes, so relaxed atomics are enough.
+ *
+ * NOTE: interposer must not allocate, so storage is a fixed global array
+ *       and thread locals are trivial with initial-exec TLS model.
+ */
+struct alignas(64) ThreadSlot
+{
+  std::atomic<uint64_t> allocs[NUM_SCOPES];
+  std::atomic<uint64_t> frees[NUM_SCOPES];
+  std::atomic<uint64_t> bytes[NUM_SCOPES];
+};
+
+static ThreadSlot g_slots[MAX_THREADS];
+static std::atomic<size_t> g_slots_used{0};
+static std::atomic<bool> g_active{false};
+
+#define TLS_IE __attribute__((tls_model("initial-exec")))
+
+static thread_local TLS_IE int t_slot = -1;
+static thread_local TLS_IE Scope t_scope = Scope::none;
+
+static inline ThreadSlot & this_slot()
+{
+  if (t_slot < 0) {
+    size_t idx = g_slots_used.fetch_add(1, std::memory_order_relaxed);
+    t_slot = (idx < MAX_THREADS) ? idx : MAX_THREADS - 1;
+  }
+
+  return g_slots[t_slot];
+}
+
+static inline void count_alloc(size_t size)
+{
+  auto & slot = this_slot();
+  auto s = static_cast<size_t>(t_scope);
+
+  slot.allocs[s].fetch_add(1, std::memory_order_relaxed);
+  slot.bytes[s].fetch_add(size, std::memory_order_relaxed);
+}
+
+static inline void count_free()
+{
+  auto & slot = this_slot();
+  auto s = static_cast<size_t>(t_scope);
+
+  slot.frees[s].fetch_add(1, std::memory_order_relaxed);
+}
+
+bool enabled()
+{
+  return g_active.load();
+}
+
+Counters get(Scope scope)
+{
+  Counters ret{};
+  auto s = static_cast<size_t>(scope);
+  size_t used = std::min(g_slots_used.load(), MAX_THREADS);
+
+  for (size_t i = 0; i < used; i++) {
+    ret.allocs += g_slots[i].allocs[s].load(std::memory_order_relaxed);
+    ret.frees += g_slots[i].frees[s].load(std::memory_order_relaxed);
+    ret.bytes += g_slots[i].bytes[s].load(std::memory_order_relaxed);
+  }
+
+  return ret;
+}
+
+Counters get_this_thread(Scope scope)
+{
+  auto & slot = this_slot();
+  auto s = static_cast<size_t>(scope);
+
+  return {
+    slot.allocs[s].load(std::memory_order_relaxed),
+    slot.frees[s].load(std::memory_order_relaxed),
+    slot.bytes[s].load(std::memory_order_relaxed),
+  };
+}
+
+void reset()
+{
+  for (auto & slot : g_slots) {
+    for (size_t s = 0; s < NUM_SCOPES; s++) {
+      slot.allocs[s].store(0, std::memory_order_relaxed);
+      slot.frees[s].store(0, std::memory_order_relaxed);
+      slot.bytes[s].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+const char * to_string(Scope scope)
+{
+  switch (scope) {
+    case Scope::none: return "none";
+    case Scope::rx: return "rx";
+    case Scope::route: return "route";
+    case Scope::dispatch: return "dispatch";
+    case Scope::plugin: return "plugin";
+    default: return "unknown";
+  }
+}
+
+ScopeGuard::ScopeGuard(Scope scope)
+: prev(t_scope)
+{
+  t_scope = scope;
+}
+
+ScopeGuard::~ScopeGuard()
+{
+  t_scope = prev;
+}
+
+}  // namespace alloc
+}  // namespace mavconn
+
+#ifdef MAVCONN_ALLOC_TRACKING
+
+// -*- glibc malloc interposer -*-
+// NOTE: aligned operator new goes through aligned_alloc (libstdc++), so it is counted too.
+
+extern "C" {
+
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t nmemb, size_t size);
+void * __libc_realloc(void * ptr, size_t size);
+void __libc_free(void * ptr);
+void * __libc_memalign(size_t alignment, size_t size);
+
+void * malloc(size_t size)
+{
+  mavconn::alloc::g_active.store(true, std::memory_order_relaxed);
+  mavconn::alloc::count_alloc(size);
+  return __libc_malloc(size);
+}
+
+void * calloc(size_t nmemb, size_t size)
+{
+  mavconn::alloc::count_alloc(nmemb * size);
+  return __libc_calloc(nmemb, size);
+}
+
+void * realloc(void * ptr, size_t size)
+{
+  mavconn::alloc::count_alloc(size);
+  return __libc_realloc(ptr, size);
+}
+
+void * memalign(size_t alignment, size_t size)
+{
+  mavconn::alloc::count_alloc(size);
+  return __libc_memalign(alignment, size);
+}
+
+void * aligned_alloc(size_t alignment, size_t size)
+{
+  mavconn::alloc::count_alloc(size);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void ** memptr, size_t alignment, size_t size)
+{
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment % sizeof(void *) != 0) {
+    return EINVAL;
+  }
+
+  mavconn::alloc::count_alloc(size);
+  void * ptr = __libc_memalign(alignment, size);
+  if (ptr == nullptr) {
+    return ENOMEM;
+  }
+
+  *memptr = ptr;
+  return 0;
+}
+
+void free(void * ptr)
+{
+  if (ptr) {
+    mavconn::alloc::count_free();
+  }
+  __libc_free(ptr);
+}
+
+}  // extern "C"
+
+#endif  // MAVCONN_ALLOC_TRACKING
@@ -0,0 +1,225 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn non-blocking logging
+ * @file async_log.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#include <mavconn/async_log.hpp>
+#include <mavconn/thread_utils.hpp>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace mavconn
+{
+
+static_assert((AsyncLog::RING_SIZE & (AsyncLog::RING_SIZE - 1)) == 0, "ring size must be 2^n");
+
+//! writer wakes up that often even if nobody notified it
+static constexpr auto WRITER_PERIOD = std::chrono::milliseconds(100);
+
+AsyncLog & AsyncLog::instance()
+{
+  static AsyncLog log;
+  return log;
+}
+
+AsyncLog::AsyncLog()
+: head(0),
+  tail(0),
+  written(0),
+  dropped(0),
+  dropped_total(0),
+  sleeping(false),
+  stop_request(false)
+{
+  for (size_t i = 0; i < ring.size(); i++) {
+    ring[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  writer_thread = std::thread(&AsyncLog::run, this);
+}
+
+AsyncLog::~AsyncLog()
+{
+  {
+    std::lock_guard<std::mutex> lock(cond_mutex);
+    stop_request = true;
+  }
+  cond.notify_all();
+
+  if (writer_thread.joinable()) {
+    writer_thread.join();
+  }
+}
+
+void AsyncLog::log(const char * file, int line, Level level, const char * fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  vlog(file, line, level, 0, fmt, args);
+  va_end(args);
+}
+
+void AsyncLog::log_repeated(
+  const char * file, int line, Level level, size_t repeated, const char * fmt,
+  ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  vlog(file, line, level, repeated, fmt, args);
+  va_end(args);
+}
+
+void AsyncLog::vlog(
+  const char * file, int line, Level level, size_t repeated, const char * fmt,
+  va_list args)
+{
+  // claim a slot, bounded MPMC queue by D. Vyukov, used here as MPSC
+  Entry * entry;
+  size_t pos = head.load(std::memory_order_relaxed);
+  for (;; ) {
+    entry = &ring[pos & (RING_SIZE - 1)];
+    auto seq = entry->seq.load(std::memory_order_acquire);
+    auto dif = static_cast<std::ptrdiff_t>(seq - pos);
+
+    if (dif == 0) {
+      if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (dif < 0) {
+      // full, never block the caller
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      dropped_total.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = head.load(std::memory_order_relaxed);
+    }
+  }
+
+  entry->file = file;
+  entry->line = line;
+  entry->level = level;
+
+  int len = std::vsnprintf(entry->text, MAX_TEXT, fmt, args);
+  if (repeated > 0 && len >= 0 && size_t(len) < MAX_TEXT) {
+    std::snprintf(entry->text + len, MAX_TEXT - len, " (repeated %zu times)", repeated);
+  }
+
+  entry->seq.store(pos + 1, std::memory_order_release);
+
+  if (sleeping.load(std::memory_order_relaxed)) {
+    cond.notify_one();
+  }
+}
+
+bool AsyncLog::drain()
+{
+  bool any = false;
+
+  for (;; ) {
+    auto & entry = ring[tail & (RING_SIZE - 1)];
+    if (entry.seq.load(std::memory_order_acquire) != tail + 1) {
+      break;
+    }
+
+    console_bridge::log(entry.file, entry.line, entry.level, "%s", entry.text);
+
+    entry.seq.store(tail + RING_SIZE, std::memory_order_release);
+    tail++;
+    written.fetch_add(1, std::memory_order_release);
+    any = true;
+  }
+
+  auto n_dropped = dropped.exchange(0, std::memory_order_relaxed);
+  if (n_dropped > 0) {
+    console_bridge::log(
+      __FILE__, __LINE__, console_bridge::CONSOLE_BRIDGE_LOG_WARN,
+      "mavconn: log: ring overflow, %zu messages dropped", n_dropped);
+  }
+
+  return any;
+}
+
+void AsyncLog::flush()
+{
+  const size_t target = head.load(std::memory_order_acquire);
+
+  std::unique_lock<std::mutex> lock(cond_mutex);
+  cond.notify_one();
+  flush_cond.wait_for(
+    lock, std::chrono::seconds(1), [&]() {
+      // dropped messages never claim a slot, so writer position is comparable to head
+      return written.load(std::memory_order_acquire) >= target || stop_request;
+    });
+}
+
+void AsyncLog::run()
+{
+  utils::set_this_thread_name("mavconn-log");
+
+  std::unique_lock<std::mutex> lock(cond_mutex);
+  while (!stop_request) {
+    lock.unlock();
+    drain();
+    lock.lock();
+
+    flush_cond.notify_all();
+
+    sleeping.store(true, std::memory_order_relaxed);
+    cond.wait_for(lock, WRITER_PERIOD);
+    sleeping.store(false, std::memory_order_relaxed);
+  }
+
+  lock.unlock();
+  drain();
+}
+
+LogThrottle::LogThrottle(steady_clock::duration period_)
+: period(period_),
+  sites{},
+  next_site(0)
+{}
+
+bool LogThrottle::check(const char * fmt, size_t & suppressed)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto now = steady_clock::now();
+  suppressed = 0;
+
+  auto it = std::find_if(
+    sites.begin(), sites.end(), [fmt](const Site & s) {
+      return s.fmt == fmt;
+    });
+
+  if (it == sites.end()) {
+    auto & site = sites[next_site];
+    next_site = (next_site + 1) % sites.size();
+
+    site = {fmt, now, 0};
+    return true;
+  }
+
+  if (now - it->last < period) {
+    it->suppressed++;
+    return false;
+  }
+
+  suppressed = it->suppressed;
+  it->last = now;
+  it->suppressed = 0;
+  return true;
+}
+
+}  // namespace mavconn
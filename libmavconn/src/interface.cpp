@@ -15,9 +15,13 @@
  * @{
  */
 
+#include <mavconn/alloc_tracker.hpp>
+#include <mavconn/async_log.hpp>
 #include <mavconn/console_bridge_compat.hpp>
+#include <mavconn/tracing.hpp>
 #include <mavconn/interface.hpp>
 #include <mavconn/msgbuffer.hpp>
+#include <mavconn/replay.hpp>
 #include <mavconn/serial.hpp>
 #include <mavconn/tcp.hpp>
 #include <mavconn/udp.hpp>
@@ -102,10 +106,12 @@ void MAVConnInterface::parse_buffer(
   const char * pfx, uint8_t * buf, const size_t bufsize,
   size_t bytes_received)
 {
+  MAVCONN_ALLOC_SCOPE(rx);
   mavlink::mavlink_message_t message;
 
   assert(bufsize >= bytes_received);
 
+  MAVCONN_TRACEPOINT(transport_read, conn_id, bytes_received);
   iostat_rx_add(bytes_received);
   for (; bytes_received > 0; bytes_received--) {
     auto c = *buf++;
@@ -115,6 +121,7 @@ void MAVConnInterface::parse_buffer(
         &message, &m_mavlink_status));
 
     if (msg_received != Framing::incomplete) {
+      MAVCONN_TRACEPOINT(frame_parse, conn_id, &message, static_cast<uint8_t>(msg_received));
       log_recv(pfx, message, msg_received);
 
       if (message_received_cb) {
@@ -124,8 +131,40 @@ void MAVConnInterface::parse_buffer(
   }
 }
 
+bool MAVConnInterface::tx_admit(const char * pfx, const mavlink_message_t * msg)
+{
+  if (!tx_shaper || tx_shaper->admit(msg->msgid, msg->len + MAVLINK_NUM_NON_PAYLOAD_BYTES)) {
+    return true;
+  }
+
+  MAVCONN_LOG_DEBUG(
+    "%s%zu: shaper: dropped Message-Id: %u [%u bytes] IDs: %u.%u Seq: %u",
+    pfx, conn_id,
+    msg->msgid, msg->len, msg->sysid, msg->compid, msg->seq);
+  return false;
+}
+
+bool MAVConnInterface::tx_admit(const char * pfx, const mavlink::Message & msg)
+{
+  if (!tx_shaper) {
+    return true;
+  }
+
+  auto mi = msg.get_message_info();
+  if (tx_shaper->admit(mi.id, mi.length + MAVLINK_NUM_NON_PAYLOAD_BYTES)) {
+    return true;
+  }
+
+  MAVCONN_LOG_DEBUG("%s%zu: shaper: dropped %s", pfx, conn_id, mi.name);
+  return false;
+}
+
 void MAVConnInterface::log_recv(const char * pfx, mavlink_message_t & msg, Framing framing)
 {
+  if (!AsyncLog::enabled(console_bridge::CONSOLE_BRIDGE_LOG_DEBUG)) {
+    return;
+  }
+
   const char * framing_str =
     (framing == Framing::ok) ? "OK" : (framing == Framing::bad_crc) ? "!CRC" :
     (framing == Framing::bad_signature) ? "!SIG" :
@@ -133,7 +172,7 @@ void MAVConnInterface::log_recv(const char * pfx, mavlink_message_t & msg, Frami
 
   const char * proto_version_str = (msg.magic == MAVLINK_STX) ? "v2.0" : "v1.0";
 
-  CONSOLE_BRIDGE_logDebug(
+  MAVCONN_LOG_DEBUG(
     "%s%zu: recv: %s %4s Message-Id: %u [%u bytes] IDs: %u.%u Seq: %u",
     pfx, conn_id,
     proto_version_str,
@@ -143,9 +182,15 @@ void MAVConnInterface::log_recv(const char * pfx, mavlink_message_t & msg, Frami
 
 void MAVConnInterface::log_send(const char * pfx, const mavlink_message_t * msg)
 {
+  MAVCONN_TRACEPOINT(mavlink_send, conn_id, msg);
+
+  if (!AsyncLog::enabled(console_bridge::CONSOLE_BRIDGE_LOG_DEBUG)) {
+    return;
+  }
+
   const char * proto_version_str = (msg->magic == MAVLINK_STX) ? "v2.0" : "v1.0";
 
-  CONSOLE_BRIDGE_logDebug(
+  MAVCONN_LOG_DEBUG(
     "%s%zu: send: %s Message-Id: %u [%u bytes] IDs: %u.%u Seq: %u",
     pfx, conn_id,
     proto_version_str,
@@ -154,7 +199,9 @@ void MAVConnInterface::log_send(const char * pfx, const mavlink_message_t * msg)
 
 void MAVConnInterface::log_send_obj(const char * pfx, const mavlink::Message & msg)
 {
-  CONSOLE_BRIDGE_logDebug("%s%zu: send: %s", pfx, conn_id, msg.to_yaml().c_str());
+  MAVCONN_TRACEPOINT(mavlink_send_obj, conn_id, msg.get_message_info().id, sys_id, comp_id);
+  // NOTE: to_yaml() is evaluated only if debug level is enabled
+  MAVCONN_LOG_DEBUG("%s%zu: send: %s", pfx, conn_id, msg.to_yaml().c_str());
 }
 
 void MAVConnInterface::send_message_ignore_drop(const mavlink::mavlink_message_t * msg)
@@ -162,8 +209,8 @@ void MAVConnInterface::send_message_ignore_drop(const mavlink::mavlink_message_t
   try {
     send_message(msg);
   } catch (std::length_error & e) {
-    CONSOLE_BRIDGE_logError(
-      PFX "%zu: DROPPED Message-Id %u [%u bytes] IDs: %u.%u Seq: %u: %s",
+    MAVCONN_LOG_ERROR_THROTTLE(
+      log_throttle, PFX "%zu: DROPPED Message-Id %u [%u bytes] IDs: %u.%u Seq: %u: %s",
       conn_id,
       msg->msgid, msg->len, msg->sysid, msg->compid, msg->seq,
       e.what());
@@ -175,8 +222,8 @@ void MAVConnInterface::send_message_ignore_drop(const mavlink::Message & msg, ui
   try {
     send_message(msg, source_compid);
   } catch (std::length_error & e) {
-    CONSOLE_BRIDGE_logError(
-      PFX "%zu: DROPPED Message %s: %s",
+    MAVCONN_LOG_ERROR_THROTTLE(
+      log_throttle, PFX "%zu: DROPPED Message %s: %s",
       conn_id,
       msg.get_name().c_str(),
       e.what());
@@ -272,6 +319,71 @@ static void url_parse_query(const std::string & query, uint8_t & sysid, uint8_t
   CONSOLE_BRIDGE_logDebug(PFX "URL: found system/component id = [%u, %u]", sysid, compid);
 }
 
+/**
+ * Find value of key=value argument in query string
+ */
+static bool url_query_value(const std::string & query, const std::string & key, std::string & value)
+{
+  size_t pos = 0;
+  while (pos < query.size()) {
+    auto amp = query.find('&', pos);
+    if (amp == std::string::npos) {
+      amp = query.size();
+    }
+
+    auto arg = query.substr(pos, amp - pos);
+    auto eq = arg.find('=');
+    if (eq != std::string::npos && arg.compare(0, eq, key) == 0) {
+      value = arg.substr(eq + 1);
+      return true;
+    }
+
+    pos = amp + 1;
+  }
+
+  return false;
+}
+
+static MAVConnInterface::Ptr url_parse_replay(
+  const std::string & path, const std::string & query,
+  uint8_t system_id, uint8_t component_id)
+{
+  double rate = MAVConnReplay::DEFAULT_RATE;
+  double start = 0.0;
+  bool loop = false;
+  std::string value;
+
+  // replay:///path/to/file.tlog?rate=1.0&start=0&loop=0
+  if (url_query_value(query, "rate", value)) {
+    rate = std::stod(value);
+  }
+  if (url_query_value(query, "start", value)) {
+    start = std::stod(value);
+  }
+  if (url_query_value(query, "loop", value)) {
+    loop = std::stoi(value) != 0;
+  }
+  if (url_query_value(query, "ids", value)) {
+    url_parse_query("ids=" + value, system_id, component_id);
+  }
+
+  return std::make_shared<MAVConnReplay>(
+    system_id, component_id,
+    path, rate, start, loop);
+}
+
+static MAVConnInterface::Ptr url_parse_capture(
+  const std::string & path, const std::string & query,
+  uint8_t system_id, uint8_t component_id)
+{
+  // capture:///path/to/file.tlog
+  url_parse_query(query, system_id, component_id);
+
+  return std::make_shared<MAVConnCapture>(
+    system_id, component_id,
+    path);
+}
+
 static MAVConnInterface::Ptr url_parse_serial(
   const std::string & path, const std::string & query,
   uint8_t system_id, uint8_t component_id, bool hwflow)
@@ -426,6 +538,15 @@ MAVConnInterface::Ptr MAVConnInterface::open_url_no_connect(
     interface_ptr = url_parse_serial(path, query, system_id, component_id, false);
   } else if (proto == "serial-hwfc") {
     interface_ptr = url_parse_serial(path, query, system_id, component_id, true);
+  } else if (proto == "replay" || proto == "capture") {
+    // NOTE: file names are case sensitive, host part may be a relative path
+    std::string file_path(proto_it, std::find(proto_it, url.end(), '?'));
+
+    if (proto == "replay") {
+      interface_ptr = url_parse_replay(file_path, query, system_id, component_id);
+    } else {
+      interface_ptr = url_parse_capture(file_path, query, system_id, component_id);
+    }
   } else {
     throw DeviceError("url", "Unknown URL type");
   }
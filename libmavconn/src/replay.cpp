@@ -0,0 +1,283 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn tlog replay and capture link classes
+ * @file replay.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#include <mavconn/console_bridge_compat.hpp>
+#include <mavconn/msgbuffer.hpp>
+#include <mavconn/replay.hpp>
+#include <mavconn/thread_utils.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <string>
+
+namespace mavconn
+{
+
+using mavlink::mavlink_message_t;
+using steady_clock = std::chrono::steady_clock;
+
+#define PFX "mavconn: replay"
+#define PFXd PFX "%zu: "
+#define CPFX "mavconn: capture"
+#define CPFXd CPFX "%zu: "
+
+MAVConnReplay::MAVConnReplay(
+  uint8_t system_id, uint8_t component_id,
+  std::string path, double rate_, double start, bool loop_)
+: MAVConnInterface(system_id, component_id),
+  is_running(false),
+  rate(std::max(0.0, rate_)),
+  loop(loop_),
+  cursor(0),
+  rebase(true)
+{
+  tlog = std::make_unique<TlogReader>(path);
+  if (tlog->size() == 0) {
+    throw DeviceError("replay", "tlog has no records");
+  }
+
+  CONSOLE_BRIDGE_logInform(
+    PFXd "%s: %zu records, %.1f s, rate %.2f", conn_id,
+    path.c_str(), tlog->size(), get_duration(), rate);
+
+  seek(start);
+}
+
+MAVConnReplay::~MAVConnReplay()
+{
+  close();
+}
+
+void MAVConnReplay::connect(
+  const ReceivedCb & cb_handle_message,
+  const ClosedCb & cb_handle_closed_port)
+{
+  message_received_cb = cb_handle_message;
+  port_closed_cb = cb_handle_closed_port;
+
+  is_running = true;
+  replay_thread = std::thread(
+    [this]() {
+      utils::set_this_thread_name("mrpl%zu", conn_id);
+      do_replay();
+    });
+}
+
+void MAVConnReplay::close()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!is_running) {
+      return;
+    }
+
+    is_running = false;
+    cond.notify_all();
+  }
+
+  if (replay_thread.joinable() && replay_thread.get_id() != std::this_thread::get_id()) {
+    replay_thread.join();
+  }
+
+  if (port_closed_cb) {
+    port_closed_cb();
+  }
+}
+
+void MAVConnReplay::send_message(const mavlink_message_t * message)
+{
+  assert(message != nullptr);
+
+  // NOTE: replay link is receive only, but account traffic for diagnostics
+  log_send(PFX, message);
+  iostat_tx_add(message->len + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+}
+
+void MAVConnReplay::send_message(const mavlink::Message & message, const uint8_t source_compid)
+{
+  (void)source_compid;
+
+  log_send_obj(PFX, message);
+}
+
+void MAVConnReplay::send_bytes(const uint8_t * bytes, size_t length)
+{
+  (void)bytes;
+
+  iostat_tx_add(length);
+}
+
+void MAVConnReplay::seek(double position)
+{
+  auto & first = (*tlog)[0];
+  const uint64_t target = first.time_usec + static_cast<uint64_t>(std::max(0.0, position) * 1e6);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  cursor = tlog->find(target);
+  rebase = true;
+  cond.notify_all();
+}
+
+void MAVConnReplay::set_rate(double rate_)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  rate = std::max(0.0, rate_);
+  rebase = true;
+  cond.notify_all();
+}
+
+double MAVConnReplay::get_position()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto idx = std::min(cursor, tlog->size() - 1);
+  return ((*tlog)[idx].time_usec - (*tlog)[0].time_usec) / 1e6;
+}
+
+double MAVConnReplay::get_duration()
+{
+  return ((*tlog)[tlog->size() - 1].time_usec - (*tlog)[0].time_usec) / 1e6;
+}
+
+void MAVConnReplay::do_replay()
+{
+  // NOTE: parse_buffer() wants non-const buffer, mapping is read-only
+  uint8_t rx_buf[MsgBuffer::MAX_SIZE];
+
+  steady_clock::time_point base_wall;
+  uint64_t base_usec = 0;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (is_running) {
+    if (cursor >= tlog->size()) {
+      if (!loop) {
+        CONSOLE_BRIDGE_logInform(PFXd "end of log", conn_id);
+        // keep link open, seek() may restart playback
+        cond.wait(lock, [this] {return !is_running || cursor < tlog->size();});
+        continue;
+      }
+
+      cursor = 0;
+      rebase = true;
+    }
+
+    auto & rec = (*tlog)[cursor];
+    if (rebase) {
+      base_wall = steady_clock::now();
+      base_usec = rec.time_usec;
+      rebase = false;
+    }
+
+    if (rate > 0.0 && rec.time_usec > base_usec) {
+      auto offset = std::chrono::duration<double>((rec.time_usec - base_usec) / 1e6 / rate);
+      auto deadline = base_wall + std::chrono::duration_cast<steady_clock::duration>(offset);
+
+      // wakes up early on seek() or close()
+      if (cond.wait_until(lock, deadline, [this] {return !is_running || rebase;})) {
+        continue;
+      }
+    }
+
+    cursor++;
+    const size_t length = std::min<size_t>(rec.length, sizeof(rx_buf));
+    std::copy(rec.frame, rec.frame + length, rx_buf);
+
+    lock.unlock();
+    parse_buffer(PFX, rx_buf, sizeof(rx_buf), length);
+    lock.lock();
+  }
+}
+
+MAVConnCapture::MAVConnCapture(
+  uint8_t system_id, uint8_t component_id,
+  std::string path)
+: MAVConnInterface(system_id, component_id),
+  is_running(false)
+{
+  tlog = std::make_unique<TlogWriter>(path);
+}
+
+MAVConnCapture::~MAVConnCapture()
+{
+  close();
+}
+
+void MAVConnCapture::connect(
+  const ReceivedCb & cb_handle_message,
+  const ClosedCb & cb_handle_closed_port)
+{
+  message_received_cb = cb_handle_message;
+  port_closed_cb = cb_handle_closed_port;
+
+  is_running = true;
+}
+
+void MAVConnCapture::close()
+{
+  if (!is_running.exchange(false)) {
+    return;
+  }
+
+  tlog->flush();
+
+  if (port_closed_cb) {
+    port_closed_cb();
+  }
+}
+
+void MAVConnCapture::send_message(const mavlink_message_t * message)
+{
+  assert(message != nullptr);
+
+  if (!is_open()) {
+    CONSOLE_BRIDGE_logError(CPFXd "send: channel closed!", conn_id);
+    return;
+  }
+
+  log_send(CPFX, message);
+
+  MsgBuffer buf(message);
+  iostat_tx_add(buf.len);
+  tlog->write(TlogWriter::now_usec(), buf.data, buf.len);
+}
+
+void MAVConnCapture::send_message(const mavlink::Message & message, const uint8_t source_compid)
+{
+  if (!is_open()) {
+    CONSOLE_BRIDGE_logError(CPFXd "send: channel closed!", conn_id);
+    return;
+  }
+
+  log_send_obj(CPFX, message);
+
+  MsgBuffer buf(message, get_status_p(), sys_id, source_compid);
+  iostat_tx_add(buf.len);
+  tlog->write(TlogWriter::now_usec(), buf.data, buf.len);
+}
+
+void MAVConnCapture::send_bytes(const uint8_t * bytes, size_t length)
+{
+  if (!is_open()) {
+    CONSOLE_BRIDGE_logError(CPFXd "send: channel closed!", conn_id);
+    return;
+  }
+
+  iostat_tx_add(length);
+  tlog->write(TlogWriter::now_usec(), bytes, length);
+}
+
+}  // namespace mavconn
@@ -19,6 +19,7 @@
 #include <linux/serial.h>
 #endif
 
+#include <mavconn/async_log.hpp>
 #include <mavconn/console_bridge_compat.hpp>
 #include <mavconn/serial.hpp>
 #include <mavconn/thread_utils.hpp>
@@ -160,7 +161,7 @@ void MAVConnSerial::close()
 void MAVConnSerial::send_bytes(const uint8_t * bytes, size_t length)
 {
   if (!is_open()) {
-    CONSOLE_BRIDGE_logError(PFXd "send: channel closed!", conn_id);
+    MAVCONN_LOG_ERROR_THROTTLE(log_throttle, PFXd "send: channel closed!", conn_id);
     return;
   }
 
@@ -181,7 +182,11 @@ void MAVConnSerial::send_message(const mavlink_message_t * message)
   assert(message != nullptr);
 
   if (!is_open()) {
-    CONSOLE_BRIDGE_logError(PFXd "send: channel closed!", conn_id);
+    MAVCONN_LOG_ERROR_THROTTLE(log_throttle, PFXd "send: channel closed!", conn_id);
+    return;
+  }
+
+  if (!tx_admit(PFX, message)) {
     return;
   }
 
@@ -202,7 +207,11 @@ void MAVConnSerial::send_message(const mavlink_message_t * message)
 void MAVConnSerial::send_message(const mavlink::Message & message, const uint8_t source_compid)
 {
   if (!is_open()) {
-    CONSOLE_BRIDGE_logError(PFXd "send: channel closed!", conn_id);
+    MAVCONN_LOG_ERROR_THROTTLE(log_throttle, PFXd "send: channel closed!", conn_id);
+    return;
+  }
+
+  if (!tx_admit(PFX, message)) {
     return;
   }
 
@@ -227,7 +236,8 @@ void MAVConnSerial::do_read(void)
     buffer(rx_buf),
     [sthis](error_code error, size_t bytes_transferred) {
       if (error) {
-        CONSOLE_BRIDGE_logError(PFXd "receive: %s", sthis->conn_id, error.message().c_str());
+        MAVCONN_LOG_ERROR_THROTTLE(
+          sthis->log_throttle, PFXd "receive: %s", sthis->conn_id, error.message().c_str());
         sthis->close();
         return;
       }
@@ -257,7 +267,8 @@ void MAVConnSerial::do_write(bool check_tx_state)
       assert(ssize_t(bytes_transferred) <= buf_ref.len);
 
       if (error) {
-        CONSOLE_BRIDGE_logError(PFXd "write: %s", sthis->conn_id, error.message().c_str());
+        MAVCONN_LOG_ERROR_THROTTLE(
+          sthis->log_throttle, PFXd "write: %s", sthis->conn_id, error.message().c_str());
         sthis->close();
         return;
       }
@@ -0,0 +1,1468 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn simulated FCU
+ * @file sim_fcu.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#include <mavconn/console_bridge_compat.hpp>
+#include <mavconn/sim_fcu.hpp>
+#include <mavconn/thread_utils.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mavconn
+{
+namespace sim
+{
+
+#define PFX "mavconn: sim: "
+
+using namespace std::chrono_literals;  // NOLINT
+using mavlink::mavlink_message_t;
+using mavlink::msgid_t;
+namespace common = mavlink::common;
+namespace minimal = mavlink::minimal;
+namespace msg = mavlink::common::msg;
+
+template<typename _T>
+static inline uint8_t ev(_T e)
+{
+  return static_cast<uint8_t>(e);
+}
+
+template<typename _T>
+static inline uint16_t ev16(_T e)
+{
+  return static_cast<uint16_t>(e);
+}
+
+template<typename _T>
+static inline void decode(const mavlink_message_t * mmsg, _T & obj)
+{
+  mavlink::MsgMap map(mmsg);
+  obj.deserialize(map);
+}
+
+/**
+ * NuttX crc32part() used by PX4 FTP server
+ */
+static uint32_t crc32_part(const uint8_t * src, size_t len, uint32_t crc32val)
+{
+  static const auto table = []() {
+      std::array<uint32_t, 256> t{};
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+          c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+        }
+        t[i] = c;
+      }
+      return t;
+    } ();
+
+  for (size_t i = 0; i < len; i++) {
+    crc32val = table[(crc32val ^ src[i]) & 0xff] ^ (crc32val >> 8);
+  }
+  return crc32val;
+}
+
+/**
+ * FTP payload header, same layout as in mavros ftp plugin
+ */
+struct FTPHeader
+{
+  uint16_t seq_number;
+  uint8_t session;
+  uint8_t opcode;
+  uint8_t size;
+  uint8_t req_opcode;
+  uint8_t burst_complete;
+  uint8_t padding;
+  uint32_t offset;
+};
+
+static constexpr size_t FTP_DATA_OFFSET = sizeof(FTPHeader);
+static constexpr size_t FTP_DATA_MAXSZ = 251 - FTP_DATA_OFFSET;
+
+enum FTPOpcode : uint8_t
+{
+  kCmdNone,
+  kCmdTerminateSession,
+  kCmdResetSessions,
+  kCmdListDirectory,
+  kCmdOpenFileRO,
+  kCmdReadFile,
+  kCmdCreateFile,
+  kCmdWriteFile,
+  kCmdRemoveFile,
+  kCmdCreateDirectory,
+  kCmdRemoveDirectory,
+  kCmdOpenFileWO,
+  kCmdTruncateFile,
+  kCmdRename,
+  kCmdCalcFileCRC32,
+  kCmdBurstReadFile,
+
+  kRspAck = 128,
+  kRspNak
+};
+
+enum FTPError : uint8_t
+{
+  kErrNone,
+  kErrFail,
+  kErrFailErrno,
+  kErrInvalidDataSize,
+  kErrInvalidSession,
+  kErrNoSessionsAvailable,
+  kErrEOF,
+  kErrUnknownCommand,
+  kErrFailFileExists,
+  kErrFailFileProtected
+};
+
+SimFCU::SimFCU(MAVConnInterface::Ptr link_, uint8_t system_id, uint8_t component_id)
+: link(link_),
+  sys_id(system_id),
+  comp_id(component_id),
+  running(false),
+  boot_time(clock::now()),
+  tx_status{},
+  rng(std::random_device()()),
+  tx_imp{},
+  rx_imp{},
+  tx_link_free{},
+  rx_link_free{},
+  pending{},
+  streams{},
+  builtin_gens{},
+  param_order{},
+  params{},
+  missions{},
+  mission_upload{},
+  mission_current(0),
+  files{},
+  ftp_sessions{},
+  ftp_next_session(0),
+  ulog{},
+  ulog_state{},
+  command_handlers{},
+  message_hook{},
+  base_mode(ev(minimal::MAV_MODE_FLAG::CUSTOM_MODE_ENABLED)),
+  stats{}
+{
+  if (!link) {
+    throw DeviceError("sim", "link not set");
+  }
+
+  init_builtin_generators();
+  set_stream_rate(minimal::msg::HEARTBEAT::MSG_ID, 1.0);
+}
+
+SimFCU::Ptr SimFCU::open_url(std::string url, uint8_t system_id, uint8_t component_id)
+{
+  auto link = MAVConnInterface::open_url_no_connect(url, system_id, component_id);
+  return std::make_shared<SimFCU>(link, system_id, component_id);
+}
+
+SimFCU::~SimFCU()
+{
+  stop();
+}
+
+void SimFCU::start()
+{
+  lock_guard lock(mutex);
+  if (running) {
+    return;
+  }
+
+  boot_time = clock::now();
+  running = true;
+
+  link->connect(
+    std::bind(&SimFCU::recv_message, this, std::placeholders::_1, std::placeholders::_2));
+
+  worker = std::thread(&SimFCU::run, this);
+}
+
+void SimFCU::stop()
+{
+  {
+    lock_guard lock(mutex);
+    if (!running) {
+      return;
+    }
+
+    running = false;
+    cond.notify_all();
+  }
+
+  if (worker.joinable()) {
+    worker.join();
+  }
+
+  link->close();
+}
+
+void SimFCU::set_stream_rate(msgid_t msgid, float rate_hz)
+{
+  lock_guard lock(mutex);
+
+  auto it = builtin_gens.find(msgid);
+  if (it == builtin_gens.end()) {
+    auto sit = streams.find(msgid);
+    if (sit == streams.end()) {
+      CONSOLE_BRIDGE_logWarn(PFX "no generator for Message-Id %u", msgid);
+      return;
+    }
+
+    add_stream(msgid, rate_hz, sit->second.gen);
+    return;
+  }
+
+  add_stream(msgid, rate_hz, it->second);
+}
+
+void SimFCU::add_stream(msgid_t msgid, float rate_hz, Generator gen)
+{
+  lock_guard lock(mutex);
+
+  if (rate_hz <= 0.0f || !gen) {
+    streams.erase(msgid);
+    return;
+  }
+
+  auto period = std::chrono::duration_cast<clock::duration>(
+    std::chrono::duration<double>(1.0 / rate_hz));
+
+  streams[msgid] = Stream{period, clock::now(), gen};
+  cond.notify_all();
+}
+
+void SimFCU::set_tx_impairment(const LinkImpairment & imp)
+{
+  lock_guard lock(mutex);
+  tx_imp = imp;
+}
+
+void SimFCU::set_rx_impairment(const LinkImpairment & imp)
+{
+  lock_guard lock(mutex);
+  rx_imp = imp;
+}
+
+void SimFCU::set_param(const std::string & param_id, float value, uint8_t param_type)
+{
+  lock_guard lock(mutex);
+
+  auto it = params.find(param_id);
+  if (it == params.end()) {
+    param_order.push_back(param_id);
+    params[param_id] = Param{value, param_type};
+  } else {
+    it->second.value = value;
+  }
+}
+
+bool SimFCU::get_param(const std::string & param_id, float & value)
+{
+  lock_guard lock(mutex);
+
+  auto it = params.find(param_id);
+  if (it == params.end()) {
+    return false;
+  }
+
+  value = it->second.value;
+  return true;
+}
+
+size_t SimFCU::param_count()
+{
+  lock_guard lock(mutex);
+  return param_order.size();
+}
+
+void SimFCU::set_mission(uint8_t mission_type, std::vector<msg::MISSION_ITEM_INT> items)
+{
+  lock_guard lock(mutex);
+  missions[mission_type] = std::move(items);
+}
+
+std::vector<msg::MISSION_ITEM_INT> SimFCU::get_mission(uint8_t mission_type)
+{
+  lock_guard lock(mutex);
+  return missions[mission_type];
+}
+
+void SimFCU::set_file(const std::string & path, std::vector<uint8_t> data)
+{
+  lock_guard lock(mutex);
+  files[path] = std::move(data);
+}
+
+bool SimFCU::get_file(const std::string & path, std::vector<uint8_t> & data)
+{
+  lock_guard lock(mutex);
+
+  auto it = files.find(path);
+  if (it == files.end()) {
+    return false;
+  }
+
+  data = it->second;
+  return true;
+}
+
+void SimFCU::set_ulog_stream(ULogStream stream)
+{
+  lock_guard lock(mutex);
+
+  ulog = std::move(stream);
+  ulog.acked_size = std::min(ulog.acked_size, ulog.data.size());
+  ulog_state.active = false;
+
+  // 16 byte file header, then messages: uint16 msg_size, uint8 msg_type, payload
+  auto & starts = ulog_state.starts;
+  starts.assign(1, 0);
+  for (size_t pos = 16; pos + 3 <= ulog.data.size();
+    pos += 3 + (ulog.data[pos] | (ulog.data[pos + 1] << 8)))
+  {
+    starts.push_back(pos);
+  }
+}
+
+bool SimFCU::is_ulog_streaming()
+{
+  lock_guard lock(mutex);
+  return ulog_state.active;
+}
+
+void SimFCU::set_command_handler(uint16_t command, CommandHandler handler)
+{
+  lock_guard lock(mutex);
+  command_handlers[command] = handler;
+}
+
+void SimFCU::set_message_hook(MessageHook hook)
+{
+  lock_guard lock(mutex);
+  message_hook = hook;
+}
+
+uint64_t SimFCU::get_time_boot_us()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - boot_time).count();
+}
+
+SimFCU::Stats SimFCU::get_stats()
+{
+  lock_guard lock(mutex);
+  return stats;
+}
+
+void SimFCU::send_message(const mavlink::Message & obj)
+{
+  mavlink_message_t mmsg;
+  mavlink::MsgMap map(mmsg);
+
+  lock_guard lock(mutex);
+
+  auto mi = obj.get_message_info();
+
+  obj.serialize(map);
+  mavlink::mavlink_finalize_message_buffer(
+    &mmsg, sys_id, comp_id, &tx_status, mi.min_length, mi.length,
+    mi.crc_extra);
+
+  enqueue(false, mmsg);
+}
+
+bool SimFCU::apply_impairment(
+  const LinkImpairment & imp, clock::time_point & link_free,
+  size_t frame_len, clock::time_point & release)
+{
+  std::uniform_real_distribution<float> loss_dist(0.0f, 1.0f);
+
+  if (imp.loss > 0.0f && loss_dist(rng) < imp.loss) {
+    return false;
+  }
+
+  auto now = clock::now();
+  auto start = now;
+
+  if (imp.bandwidth > 0) {
+    start = std::max(now, link_free);
+
+    // emulate radio buffer overflow: do not let backlog grow for more than a second
+    if (start - now > 1s) {
+      return false;
+    }
+
+    link_free = start + std::chrono::microseconds(frame_len * 1000000 / imp.bandwidth);
+    start = link_free;
+  }
+
+  release = start + imp.latency;
+  if (imp.jitter.count() > 0) {
+    std::uniform_int_distribution<int64_t> jitter_dist(0, imp.jitter.count());
+    release += std::chrono::microseconds(jitter_dist(rng));
+  }
+
+  return true;
+}
+
+void SimFCU::enqueue(bool is_rx, const mavlink_message_t & mmsg)
+{
+  auto & imp = is_rx ? rx_imp : tx_imp;
+  auto & link_free = is_rx ? rx_link_free : tx_link_free;
+  const size_t frame_len = MAVLINK_NUM_NON_PAYLOAD_BYTES + mmsg.len;
+
+  clock::time_point release;
+  if (!apply_impairment(imp, link_free, frame_len, release)) {
+    if (is_rx) {
+      stats.rx_lost++;
+    } else {
+      stats.tx_lost++;
+    }
+    return;
+  }
+
+  // fast path: nothing to delay, send right now
+  if (!is_rx && release <= clock::now()) {
+    stats.tx_frames++;
+    stats.tx_bytes += frame_len;
+    link->send_message_ignore_drop(&mmsg);
+    return;
+  }
+
+  pending.emplace(release, Pending{is_rx, mmsg});
+  cond.notify_all();
+}
+
+void SimFCU::recv_message(const mavlink_message_t * mmsg, const Framing framing)
+{
+  if (framing != Framing::ok) {
+    return;
+  }
+
+  lock_guard lock(mutex);
+  enqueue(true, *mmsg);
+}
+
+void SimFCU::run()
+{
+  utils::set_this_thread_name("simfcu%u", sys_id);
+
+  std::unique_lock<std::recursive_mutex> lock(mutex);
+  while (running) {
+    auto now = clock::now();
+    auto next_wake = now + 100ms;
+
+    for (auto & kv : streams) {
+      auto & s = kv.second;
+      if (s.next <= now) {
+        s.gen(get_time_boot_us());
+
+        s.next += s.period;
+        if (s.next < now) {
+          // do not try to catch up after stall
+          s.next = now + s.period;
+        }
+      }
+
+      next_wake = std::min(next_wake, s.next);
+    }
+
+    while (!pending.empty() && pending.begin()->first <= now) {
+      auto p = pending.begin()->second;
+      pending.erase(pending.begin());
+
+      if (p.is_rx) {
+        stats.rx_frames++;
+        handle_message(&p.msg);
+      } else {
+        stats.tx_frames++;
+        stats.tx_bytes += MAVLINK_NUM_NON_PAYLOAD_BYTES + p.msg.len;
+        link->send_message_ignore_drop(&p.msg);
+      }
+    }
+
+    if (mission_upload.active && now - mission_upload.last_request > 250ms) {
+      send_mission_request(mission_upload.mission_type, mission_upload.next_seq);
+    }
+
+    if (ulog_state.active) {
+      ulog_step(now, next_wake);
+    }
+
+    if (!pending.empty()) {
+      next_wake = std::min(next_wake, pending.begin()->first);
+    }
+
+    cond.wait_until(lock, next_wake);
+  }
+}
+
+void SimFCU::handle_message(const mavlink_message_t * mmsg)
+{
+  switch (mmsg->msgid) {
+    case msg::PARAM_REQUEST_LIST::MSG_ID:
+    case msg::PARAM_REQUEST_READ::MSG_ID:
+    case msg::PARAM_SET::MSG_ID:
+      handle_param(mmsg);
+      break;
+
+    case msg::MISSION_REQUEST_LIST::MSG_ID:
+    case msg::MISSION_REQUEST::MSG_ID:
+    case msg::MISSION_REQUEST_INT::MSG_ID:
+    case msg::MISSION_COUNT::MSG_ID:
+    case msg::MISSION_ITEM::MSG_ID:
+    case msg::MISSION_ITEM_INT::MSG_ID:
+    case msg::MISSION_CLEAR_ALL::MSG_ID:
+    case msg::MISSION_SET_CURRENT::MSG_ID:
+      handle_mission(mmsg);
+      break;
+
+    case msg::FILE_TRANSFER_PROTOCOL::MSG_ID:
+      handle_ftp(mmsg);
+      break;
+
+    case msg::COMMAND_LONG::MSG_ID:
+    case msg::COMMAND_INT::MSG_ID:
+      handle_command(mmsg);
+      break;
+
+    case msg::TIMESYNC::MSG_ID:
+      handle_timesync(mmsg);
+      break;
+
+    case msg::LOGGING_ACK::MSG_ID:
+      handle_logging_ack(mmsg);
+      break;
+
+    default:
+      break;
+  }
+
+  if (message_hook) {
+    message_hook(mmsg);
+  }
+}
+
+/* -*- param server -*- */
+
+void SimFCU::send_param_value(size_t index)
+{
+  auto & param_id = param_order.at(index);
+  auto & p = params.at(param_id);
+
+  msg::PARAM_VALUE pv{};
+  mavlink::set_string(pv.param_id, param_id);
+  pv.param_value = p.value;
+  pv.param_type = p.type;
+  pv.param_count = param_order.size();
+  pv.param_index = index;
+
+  send_message(pv);
+}
+
+void SimFCU::handle_param(const mavlink_message_t * mmsg)
+{
+  auto is_for_me = [this](uint8_t tgt_sys, uint8_t tgt_comp) {
+      return (tgt_sys == 0 || tgt_sys == sys_id) && (tgt_comp == 0 || tgt_comp == comp_id);
+    };
+
+  auto find_index = [this](const std::string & param_id) -> ssize_t {
+      auto it = std::find(param_order.begin(), param_order.end(), param_id);
+      if (it == param_order.end()) {
+        return -1;
+      }
+      return std::distance(param_order.begin(), it);
+    };
+
+  if (mmsg->msgid == msg::PARAM_REQUEST_LIST::MSG_ID) {
+    msg::PARAM_REQUEST_LIST req{};
+    decode(mmsg, req);
+    if (!is_for_me(req.target_system, req.target_component)) {
+      return;
+    }
+
+    for (size_t idx = 0; idx < param_order.size(); idx++) {
+      send_param_value(idx);
+    }
+  } else if (mmsg->msgid == msg::PARAM_REQUEST_READ::MSG_ID) {
+    msg::PARAM_REQUEST_READ req{};
+    decode(mmsg, req);
+    if (!is_for_me(req.target_system, req.target_component)) {
+      return;
+    }
+
+    ssize_t idx = req.param_index;
+    if (idx < 0) {
+      idx = find_index(mavlink::to_string(req.param_id));
+    }
+
+    if (idx >= 0 && size_t(idx) < param_order.size()) {
+      send_param_value(idx);
+    }
+  } else if (mmsg->msgid == msg::PARAM_SET::MSG_ID) {
+    msg::PARAM_SET req{};
+    decode(mmsg, req);
+    if (!is_for_me(req.target_system, req.target_component)) {
+      return;
+    }
+
+    auto param_id = mavlink::to_string(req.param_id);
+    set_param(param_id, req.param_value, req.param_type);
+    send_param_value(find_index(param_id));
+  }
+}
+
+/* -*- mission server -*- */
+
+void SimFCU::send_mission_request(uint8_t mission_type, uint16_t seq)
+{
+  msg::MISSION_REQUEST_INT rq{};
+  rq.target_system = mission_upload.tgt_sys;
+  rq.target_component = mission_upload.tgt_comp;
+  rq.seq = seq;
+  rq.mission_type = mission_type;
+
+  mission_upload.last_request = clock::now();
+  send_message(rq);
+}
+
+void SimFCU::send_mission_ack(
+  uint8_t mission_type, uint8_t result, uint8_t tgt_sys,
+  uint8_t tgt_comp)
+{
+  msg::MISSION_ACK ack{};
+  ack.target_system = tgt_sys;
+  ack.target_component = tgt_comp;
+  ack.type = result;
+  ack.mission_type = mission_type;
+
+  send_message(ack);
+}
+
+void SimFCU::handle_mission(const mavlink_message_t * mmsg)
+{
+  using MRES = common::MAV_MISSION_RESULT;
+
+  auto send_item = [&](uint8_t mission_type, uint16_t seq) {
+      auto & items = missions[mission_type];
+      if (seq >= items.size()) {
+        send_mission_ack(mission_type, ev(MRES::INVALID_SEQUENCE), mmsg->sysid, mmsg->compid);
+        return;
+      }
+
+      auto item = items[seq];
+      item.target_system = mmsg->sysid;
+      item.target_component = mmsg->compid;
+      item.seq = seq;
+      item.current = seq == mission_current;
+      item.mission_type = mission_type;
+      send_message(item);
+    };
+
+  auto store_item = [&](msg::MISSION_ITEM_INT & item) {
+      if (item.mission_type != mission_upload.mission_type) {
+        return;
+      }
+
+      if (!mission_upload.active) {
+        // MISSION_ACK lost, client repeats the last item
+        if (mission_upload.count > 0 && item.seq + 1 == mission_upload.count) {
+          send_mission_ack(
+            mission_upload.mission_type, ev(MRES::ACCEPTED), mmsg->sysid,
+            mmsg->compid);
+        }
+        return;
+      }
+
+      if (item.seq != mission_upload.next_seq) {
+        send_mission_request(mission_upload.mission_type, mission_upload.next_seq);
+        return;
+      }
+
+      mission_upload.items.push_back(item);
+      mission_upload.next_seq++;
+
+      if (mission_upload.next_seq < mission_upload.count) {
+        send_mission_request(mission_upload.mission_type, mission_upload.next_seq);
+        return;
+      }
+
+      mission_upload.active = false;
+      missions[mission_upload.mission_type] = std::move(mission_upload.items);
+      mission_upload.items = {};
+      send_mission_ack(mission_upload.mission_type, ev(MRES::ACCEPTED), mmsg->sysid, mmsg->compid);
+    };
+
+  switch (mmsg->msgid) {
+    case msg::MISSION_REQUEST_LIST::MSG_ID: {
+        msg::MISSION_REQUEST_LIST req{};
+        decode(mmsg, req);
+
+        msg::MISSION_COUNT cnt{};
+        cnt.target_system = mmsg->sysid;
+        cnt.target_component = mmsg->compid;
+        cnt.count = missions[req.mission_type].size();
+        cnt.mission_type = req.mission_type;
+        send_message(cnt);
+      }
+      break;
+
+    case msg::MISSION_REQUEST::MSG_ID: {
+        msg::MISSION_REQUEST req{};
+        decode(mmsg, req);
+        send_item(req.mission_type, req.seq);
+      }
+      break;
+
+    case msg::MISSION_REQUEST_INT::MSG_ID: {
+        msg::MISSION_REQUEST_INT req{};
+        decode(mmsg, req);
+        send_item(req.mission_type, req.seq);
+      }
+      break;
+
+    case msg::MISSION_COUNT::MSG_ID: {
+        msg::MISSION_COUNT cnt{};
+        decode(mmsg, cnt);
+
+        mission_upload.active = cnt.count > 0;
+        mission_upload.tgt_sys = mmsg->sysid;
+        mission_upload.tgt_comp = mmsg->compid;
+        mission_upload.mission_type = cnt.mission_type;
+        mission_upload.count = cnt.count;
+        mission_upload.next_seq = 0;
+        mission_upload.items.clear();
+        mission_upload.items.reserve(cnt.count);
+
+        if (cnt.count == 0) {
+          missions[cnt.mission_type].clear();
+          send_mission_ack(cnt.mission_type, ev(MRES::ACCEPTED), mmsg->sysid, mmsg->compid);
+        } else {
+          send_mission_request(cnt.mission_type, 0);
+        }
+      }
+      break;
+
+    case msg::MISSION_ITEM_INT::MSG_ID: {
+        msg::MISSION_ITEM_INT item{};
+        decode(mmsg, item);
+        store_item(item);
+      }
+      break;
+
+    case msg::MISSION_ITEM::MSG_ID: {
+        msg::MISSION_ITEM fitem{};
+        decode(mmsg, fitem);
+
+        msg::MISSION_ITEM_INT item{};
+        item.seq = fitem.seq;
+        item.frame = fitem.frame;
+        item.command = fitem.command;
+        item.current = fitem.current;
+        item.autocontinue = fitem.autocontinue;
+        item.param1 = fitem.param1;
+        item.param2 = fitem.param2;
+        item.param3 = fitem.param3;
+        item.param4 = fitem.param4;
+        item.x = std::lround(fitem.x * 1e7);
+        item.y = std::lround(fitem.y * 1e7);
+        item.z = fitem.z;
+        item.mission_type = fitem.mission_type;
+        store_item(item);
+      }
+      break;
+
+    case msg::MISSION_CLEAR_ALL::MSG_ID: {
+        msg::MISSION_CLEAR_ALL req{};
+        decode(mmsg, req);
+
+        missions[req.mission_type].clear();
+        send_mission_ack(req.mission_type, ev(MRES::ACCEPTED), mmsg->sysid, mmsg->compid);
+      }
+      break;
+
+    case msg::MISSION_SET_CURRENT::MSG_ID: {
+        msg::MISSION_SET_CURRENT req{};
+        decode(mmsg, req);
+
+        mission_current = req.seq;
+
+        msg::MISSION_CURRENT cur{};
+        cur.seq = mission_current;
+        send_message(cur);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/* -*- ftp server -*- */
+
+void SimFCU::handle_ftp(const mavlink_message_t * mmsg)
+{
+  msg::FILE_TRANSFER_PROTOCOL req{};
+  decode(mmsg, req);
+
+  if (req.target_system != sys_id) {
+    return;
+  }
+
+  FTPHeader hdr{};
+  std::memcpy(&hdr, req.payload.data(), sizeof(hdr));
+  const uint8_t * data = req.payload.data() + FTP_DATA_OFFSET;
+  const size_t data_size = std::min<size_t>(hdr.size, FTP_DATA_MAXSZ);
+
+  auto get_path = [&](size_t offset = 0) -> std::string {
+      if (offset >= data_size) {
+        return {};
+      }
+      auto beg = reinterpret_cast<const char *>(data) + offset;
+      return std::string(beg, strnlen(beg, data_size - offset));
+    };
+
+  auto reply = [&](
+    uint8_t opcode, uint8_t session, uint32_t offset, const uint8_t * rdata, size_t rsize,
+    uint8_t burst_complete = 0) {
+      msg::FILE_TRANSFER_PROTOCOL rsp{};
+      rsp.target_network = 0;
+      rsp.target_system = mmsg->sysid;
+      rsp.target_component = mmsg->compid;
+
+      FTPHeader rhdr{};
+      rhdr.seq_number = hdr.seq_number + 1;
+      rhdr.session = session;
+      rhdr.opcode = opcode;
+      rhdr.size = rsize;
+      rhdr.req_opcode = hdr.opcode;
+      rhdr.burst_complete = burst_complete;
+      rhdr.offset = offset;
+
+      std::memcpy(rsp.payload.data(), &rhdr, sizeof(rhdr));
+      if (rsize > 0) {
+        std::memcpy(rsp.payload.data() + FTP_DATA_OFFSET, rdata, rsize);
+      }
+
+      send_message(rsp);
+    };
+
+  auto ack = [&](const uint8_t * rdata = nullptr, size_t rsize = 0, uint32_t offset = 0) {
+      reply(kRspAck, hdr.session, offset, rdata, rsize);
+    };
+
+  auto nak = [&](FTPError err, int err_no = 0) {
+      uint8_t ndata[2] = {err, static_cast<uint8_t>(err_no)};
+      reply(kRspNak, hdr.session, 0, ndata, (err == kErrFailErrno) ? 2 : 1);
+    };
+
+  auto open_session = [&](const std::string & path, bool writable) {
+      if (ftp_sessions.size() >= 4) {
+        nak(kErrNoSessionsAvailable);
+        return;
+      }
+
+      uint8_t session = ftp_next_session++;
+      ftp_sessions[session] = FTPSession{path, writable};
+
+      uint32_t fsize = files[path].size();
+      reply(kRspAck, session, 0, reinterpret_cast<uint8_t *>(&fsize), sizeof(fsize));
+    };
+
+  auto find_session = [&]() -> FTPSession * {
+      auto it = ftp_sessions.find(hdr.session);
+      if (it == ftp_sessions.end()) {
+        nak(kErrInvalidSession);
+        return nullptr;
+      }
+      return &it->second;
+    };
+
+  switch (hdr.opcode) {
+    case kCmdNone:
+      ack();
+      break;
+
+    case kCmdTerminateSession:
+      ftp_sessions.erase(hdr.session);
+      ack();
+      break;
+
+    case kCmdResetSessions:
+      ftp_sessions.clear();
+      ack();
+      break;
+
+    case kCmdListDirectory: {
+        auto dir = get_path();
+        if (!dir.empty() && dir.back() != '/') {
+          dir += '/';
+        }
+
+        // collect direct children of dir
+        std::vector<std::string> entries;
+        std::string last_subdir;
+        for (auto & kv : files) {
+          if (kv.first.compare(0, dir.size(), dir) != 0) {
+            continue;
+          }
+
+          auto rest = kv.first.substr(dir.size());
+          auto slash = rest.find('/');
+          if (slash == std::string::npos) {
+            entries.emplace_back(utils::format("F%s\t%zu", rest.c_str(), kv.second.size()));
+          } else if (rest.substr(0, slash) != last_subdir) {
+            last_subdir = rest.substr(0, slash);
+            entries.emplace_back("D" + last_subdir);
+          }
+        }
+
+        if (hdr.offset >= entries.size()) {
+          nak(kErrEOF);
+          break;
+        }
+
+        std::vector<uint8_t> out;
+        for (size_t idx = hdr.offset; idx < entries.size(); idx++) {
+          auto & e = entries[idx];
+          if (out.size() + e.size() + 1 > FTP_DATA_MAXSZ) {
+            break;
+          }
+          out.insert(out.end(), e.begin(), e.end());
+          out.push_back('\0');
+        }
+
+        ack(out.data(), out.size(), hdr.offset);
+      }
+      break;
+
+    case kCmdOpenFileRO: {
+        auto path = get_path();
+        if (files.find(path) == files.end()) {
+          nak(kErrFailErrno, ENOENT);
+          break;
+        }
+
+        open_session(path, false);
+      }
+      break;
+
+    case kCmdCreateFile:
+    case kCmdOpenFileWO: {
+        auto path = get_path();
+        if (hdr.opcode == kCmdCreateFile) {
+          files[path].clear();
+        }
+
+        open_session(path, true);
+      }
+      break;
+
+    case kCmdReadFile:
+    case kCmdBurstReadFile: {
+        auto session = find_session();
+        if (!session) {
+          break;
+        }
+
+        auto & fdata = files[session->path];
+        uint32_t offset = hdr.offset;
+        if (offset >= fdata.size()) {
+          reply(kRspNak, hdr.session, 0, reinterpret_cast<const uint8_t *>("\x06"), 1, 1);
+          break;
+        }
+
+        do {
+          size_t chunk = std::min(FTP_DATA_MAXSZ, fdata.size() - offset);
+          bool last = offset + chunk >= fdata.size();
+
+          reply(
+            kRspAck, hdr.session, offset, fdata.data() + offset, chunk,
+            (hdr.opcode == kCmdBurstReadFile && last) ? 1 : 0);
+          offset += chunk;
+        } while (hdr.opcode == kCmdBurstReadFile && offset < fdata.size());
+      }
+      break;
+
+    case kCmdWriteFile: {
+        auto session = find_session();
+        if (!session) {
+          break;
+        }
+        if (!session->writable) {
+          nak(kErrFailFileProtected);
+          break;
+        }
+
+        auto & fdata = files[session->path];
+        if (fdata.size() < hdr.offset + data_size) {
+          fdata.resize(hdr.offset + data_size);
+        }
+        std::memcpy(fdata.data() + hdr.offset, data, data_size);
+
+        ack(nullptr, 0, hdr.offset);
+      }
+      break;
+
+    case kCmdRemoveFile: {
+        if (files.erase(get_path()) == 0) {
+          nak(kErrFailErrno, ENOENT);
+        } else {
+          ack();
+        }
+      }
+      break;
+
+    case kCmdTruncateFile: {
+        auto it = files.find(get_path());
+        if (it == files.end()) {
+          nak(kErrFailErrno, ENOENT);
+        } else {
+          it->second.resize(hdr.offset);
+          ack();
+        }
+      }
+      break;
+
+    case kCmdRename: {
+        auto from = get_path();
+        auto to = get_path(from.size() + 1);
+        auto it = files.find(from);
+        if (it == files.end()) {
+          nak(kErrFailErrno, ENOENT);
+        } else {
+          auto fdata = std::move(it->second);
+          files.erase(it);
+          files[to] = std::move(fdata);
+          ack();
+        }
+      }
+      break;
+
+    case kCmdCalcFileCRC32: {
+        auto it = files.find(get_path());
+        if (it == files.end()) {
+          nak(kErrFailErrno, ENOENT);
+        } else {
+          uint32_t crc = crc32_part(it->second.data(), it->second.size(), 0);
+          ack(reinterpret_cast<uint8_t *>(&crc), sizeof(crc));
+        }
+      }
+      break;
+
+    case kCmdCreateDirectory:
+    case kCmdRemoveDirectory:
+      // directories are implicit
+      ack();
+      break;
+
+    default:
+      nak(kErrUnknownCommand);
+      break;
+  }
+}
+
+/* -*- command server -*- */
+
+void SimFCU::send_command_ack(
+  uint16_t command, uint8_t result, uint8_t tgt_sys,
+  uint8_t tgt_comp)
+{
+  msg::COMMAND_ACK ack{};
+  ack.command = command;
+  ack.result = result;
+  ack.target_system = tgt_sys;
+  ack.target_component = tgt_comp;
+
+  send_message(ack);
+}
+
+void SimFCU::handle_command(const mavlink_message_t * mmsg)
+{
+  using MAV_CMD = common::MAV_CMD;
+  using MAV_RESULT = common::MAV_RESULT;
+
+  msg::COMMAND_LONG cmd{};
+
+  if (mmsg->msgid == msg::COMMAND_INT::MSG_ID) {
+    msg::COMMAND_INT cmdi{};
+    decode(mmsg, cmdi);
+
+    cmd.target_system = cmdi.target_system;
+    cmd.target_component = cmdi.target_component;
+    cmd.command = cmdi.command;
+    cmd.param1 = cmdi.param1;
+    cmd.param2 = cmdi.param2;
+    cmd.param3 = cmdi.param3;
+    cmd.param4 = cmdi.param4;
+    cmd.param5 = cmdi.x;
+    cmd.param6 = cmdi.y;
+    cmd.param7 = cmdi.z;
+  } else {
+    decode(mmsg, cmd);
+  }
+
+  if (cmd.target_system != sys_id ||
+    (cmd.target_component != 0 && cmd.target_component != comp_id))
+  {
+    return;
+  }
+
+  uint8_t result = ev(MAV_RESULT::ACCEPTED);
+
+  auto it = command_handlers.find(cmd.command);
+  if (it != command_handlers.end()) {
+    result = it->second(cmd);
+  } else if (cmd.command == ev16(MAV_CMD::SET_MESSAGE_INTERVAL)) {
+    auto interval_us = cmd.param2;
+    msgid_t msgid = cmd.param1;
+
+    if (interval_us < 0) {
+      set_stream_rate(msgid, 0.0);
+    } else if (interval_us > 0) {
+      set_stream_rate(msgid, 1e6 / interval_us);
+    }
+  } else if (cmd.command == ev16(MAV_CMD::REQUEST_MESSAGE)) {
+    send_builtin(cmd.param1);
+  } else if (cmd.command == ev16(MAV_CMD::REQUEST_AUTOPILOT_CAPABILITIES)) {
+    send_builtin(msg::AUTOPILOT_VERSION::MSG_ID);
+  } else if (cmd.command == ev16(MAV_CMD::LOGGING_START)) {
+    // only ULog format exists
+    if (ulog.data.empty() || cmd.param1 != 0.0f) {
+      result = ev(MAV_RESULT::FAILED);
+    } else {
+      auto & st = ulog_state;
+      st.active = true;
+      st.tgt_sys = mmsg->sysid;
+      st.tgt_comp = mmsg->compid;
+      st.sequence = 0;
+      st.pos = 0;
+      st.wait_ack = false;
+      st.next_send = clock::now();
+      cond.notify_all();
+    }
+  } else if (cmd.command == ev16(MAV_CMD::LOGGING_STOP)) {
+    ulog_state.active = false;
+  } else if (cmd.command == ev16(MAV_CMD::COMPONENT_ARM_DISARM)) {
+    const auto armed = ev(minimal::MAV_MODE_FLAG::SAFETY_ARMED);
+    if (cmd.param1 > 0.5f) {
+      base_mode |= armed;
+    } else {
+      base_mode &= ~armed;
+    }
+  }
+
+  send_command_ack(cmd.command, result, mmsg->sysid, mmsg->compid);
+}
+
+/* -*- timesync server -*- */
+
+void SimFCU::handle_timesync(const mavlink_message_t * mmsg)
+{
+  msg::TIMESYNC req{};
+  decode(mmsg, req);
+
+  if (req.tc1 != 0) {
+    return;
+  }
+
+  msg::TIMESYNC rsp{};
+  rsp.tc1 = get_time_boot_us() * 1000;
+  rsp.ts1 = req.ts1;
+
+  send_message(rsp);
+}
+
+/* -*- log streaming -*- */
+
+template<typename _T>
+static void fill_logging_data(
+  _T & obj, uint8_t tgt_sys, uint8_t tgt_comp, uint16_t sequence,
+  const uint8_t * data, size_t len, uint8_t first_message_offset)
+{
+  obj.target_system = tgt_sys;
+  obj.target_component = tgt_comp;
+  obj.sequence = sequence;
+  obj.length = len;
+  obj.first_message_offset = first_message_offset;
+  std::copy(data, data + len, obj.data.begin());
+}
+
+void SimFCU::send_ulog_packet(bool acked, size_t len)
+{
+  auto & st = ulog_state;
+
+  // first header or message start within packet
+  uint8_t first_message_offset = 255;
+  auto it = std::lower_bound(st.starts.begin(), st.starts.end(), st.pos);
+  if (it != st.starts.end() && *it < st.pos + len) {
+    first_message_offset = *it - st.pos;
+  }
+
+  const uint8_t * data = ulog.data.data() + st.pos;
+  if (acked) {
+    msg::LOGGING_DATA_ACKED ld{};
+    fill_logging_data(ld, st.tgt_sys, st.tgt_comp, st.sequence, data, len, first_message_offset);
+    send_message(ld);
+  } else {
+    msg::LOGGING_DATA ld{};
+    fill_logging_data(ld, st.tgt_sys, st.tgt_comp, st.sequence, data, len, first_message_offset);
+    send_message(ld);
+  }
+
+  stats.ulog_packets++;
+}
+
+void SimFCU::ulog_step(clock::time_point now, clock::time_point & next_wake)
+{
+  constexpr size_t max_len = std::tuple_size<decltype(msg::LOGGING_DATA::data)>::value;
+  constexpr size_t default_rate = 100000;
+  constexpr auto ack_timeout = 100ms;
+  constexpr auto max_backlog = 20ms;
+  auto & st = ulog_state;
+
+  // header and definitions: one packet in flight, resent until acked
+  if (st.pos < ulog.acked_size) {
+    if (!st.wait_ack) {
+      st.acked_len = std::min(max_len, ulog.acked_size - st.pos);
+      st.wait_ack = true;
+      st.last_send = now;
+      send_ulog_packet(true, st.acked_len);
+    } else if (now - st.last_send >= ack_timeout) {
+      st.last_send = now;
+      stats.ulog_retransmits++;
+      send_ulog_packet(true, st.acked_len);
+    }
+
+    next_wake = std::min(next_wake, st.last_send + ack_timeout);
+    return;
+  }
+
+  size_t rate = ulog.rate;
+  if (rate == 0 && tx_imp.bandwidth == 0) {
+    rate = default_rate;
+  }
+
+  // do not try to catch up after stall
+  st.next_send = std::max(st.next_send, now - max_backlog);
+
+  while (st.pos < ulog.data.size()) {
+    if (rate > 0 ? st.next_send > now : tx_link_free > now + max_backlog) {
+      break;
+    }
+
+    const size_t len = std::min(max_len, ulog.data.size() - st.pos);
+    send_ulog_packet(false, len);
+    st.sequence++;
+    st.pos += len;
+
+    if (rate > 0) {
+      st.next_send += std::chrono::nanoseconds(len * 1000000000ULL / rate);
+    }
+  }
+
+  if (st.pos >= ulog.data.size()) {
+    st.active = false;
+    return;
+  }
+
+  next_wake = std::min(next_wake, rate > 0 ? st.next_send : tx_link_free - max_backlog);
+}
+
+void SimFCU::handle_logging_ack(const mavlink_message_t * mmsg)
+{
+  msg::LOGGING_ACK ack{};
+  decode(mmsg, ack);
+
+  auto & st = ulog_state;
+  if (!st.active || !st.wait_ack || ack.sequence != st.sequence) {
+    return;
+  }
+
+  st.wait_ack = false;
+  st.pos += st.acked_len;
+  st.sequence++;
+  cond.notify_all();
+}
+
+/* -*- telemetry streams -*- */
+
+void SimFCU::send_builtin(msgid_t msgid)
+{
+  auto it = builtin_gens.find(msgid);
+  if (it != builtin_gens.end()) {
+    it->second(get_time_boot_us());
+  }
+}
+
+void SimFCU::init_builtin_generators()
+{
+  auto ms = [](uint64_t t_us) -> uint32_t {
+      return t_us / 1000;
+    };
+  auto sec = [](uint64_t t_us) -> double {
+      return t_us / 1e6;
+    };
+
+  builtin_gens[minimal::msg::HEARTBEAT::MSG_ID] = [this](uint64_t) {
+      minimal::msg::HEARTBEAT hb{};
+      hb.type = ev(minimal::MAV_TYPE::QUADROTOR);
+      hb.autopilot = ev(minimal::MAV_AUTOPILOT::PX4);
+      hb.base_mode = base_mode;
+      hb.custom_mode = 0;
+      hb.system_status = ev(minimal::MAV_STATE::ACTIVE);
+      hb.mavlink_version = 3;
+      send_message(hb);
+    };
+
+  builtin_gens[msg::SYS_STATUS::MSG_ID] = [this](uint64_t) {
+      msg::SYS_STATUS st{};
+      st.voltage_battery = 12600;
+      st.current_battery = 1000;
+      st.battery_remaining = 90;
+      st.load = 250;
+      send_message(st);
+    };
+
+  builtin_gens[msg::SYSTEM_TIME::MSG_ID] = [this, ms](uint64_t t) {
+      msg::SYSTEM_TIME st{};
+      st.time_unix_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+      st.time_boot_ms = ms(t);
+      send_message(st);
+    };
+
+  builtin_gens[msg::ATTITUDE::MSG_ID] = [this, ms, sec](uint64_t t) {
+      msg::ATTITUDE att{};
+      att.time_boot_ms = ms(t);
+      att.roll = 0.1 * std::sin(sec(t));
+      att.pitch = 0.1 * std::cos(sec(t));
+      att.yaw = std::fmod(sec(t) * 0.1, 2 * M_PI) - M_PI;
+      att.rollspeed = 0.1 * std::cos(sec(t));
+      att.pitchspeed = -0.1 * std::sin(sec(t));
+      att.yawspeed = 0.1;
+      send_message(att);
+    };
+
+  builtin_gens[msg::ATTITUDE_QUATERNION::MSG_ID] = [this, ms, sec](uint64_t t) {
+      const double yaw = std::fmod(sec(t) * 0.1, 2 * M_PI) - M_PI;
+
+      msg::ATTITUDE_QUATERNION att{};
+      att.time_boot_ms = ms(t);
+      att.q1 = std::cos(yaw / 2);
+      att.q2 = 0.0;
+      att.q3 = 0.0;
+      att.q4 = std::sin(yaw / 2);
+      att.yawspeed = 0.1;
+      send_message(att);
+    };
+
+  builtin_gens[msg::HIGHRES_IMU::MSG_ID] = [this, sec](uint64_t t) {
+      msg::HIGHRES_IMU imu{};
+      imu.time_usec = t;
+      imu.xacc = 0.01 * std::sin(sec(t));
+      imu.yacc = 0.01 * std::cos(sec(t));
+      imu.zacc = -9.81;
+      imu.xgyro = 0.001;
+      imu.ygyro = -0.001;
+      imu.zgyro = 0.1;
+      imu.xmag = 0.2;
+      imu.ymag = 0.0;
+      imu.zmag = 0.4;
+      imu.abs_pressure = 1013.25;
+      imu.pressure_alt = 10.0;
+      imu.temperature = 25.0;
+      imu.fields_updated = 0x1fff;
+      send_message(imu);
+    };
+
+  builtin_gens[msg::RAW_IMU::MSG_ID] = [this](uint64_t t) {
+      msg::RAW_IMU imu{};
+      imu.time_usec = t;
+      imu.zacc = -1000;
+      imu.zgyro = 10;
+      imu.xmag = 200;
+      imu.zmag = 400;
+      send_message(imu);
+    };
+
+  builtin_gens[msg::LOCAL_POSITION_NED::MSG_ID] = [this, ms, sec](uint64_t t) {
+      msg::LOCAL_POSITION_NED lp{};
+      lp.time_boot_ms = ms(t);
+      lp.x = 5.0 * std::sin(sec(t) * 0.1);
+      lp.y = 5.0 * std::cos(sec(t) * 0.1);
+      lp.z = -10.0;
+      lp.vx = 0.5 * std::cos(sec(t) * 0.1);
+      lp.vy = -0.5 * std::sin(sec(t) * 0.1);
+      send_message(lp);
+    };
+
+  builtin_gens[msg::GLOBAL_POSITION_INT::MSG_ID] = [this, ms](uint64_t t) {
+      msg::GLOBAL_POSITION_INT gp{};
+      gp.time_boot_ms = ms(t);
+      gp.lat = 473977420;
+      gp.lon = 85455940;
+      gp.alt = 498000;
+      gp.relative_alt = 10000;
+      gp.hdg = UINT16_MAX;
+      send_message(gp);
+    };
+
+  builtin_gens[msg::GPS_RAW_INT::MSG_ID] = [this](uint64_t t) {
+      msg::GPS_RAW_INT gps{};
+      gps.time_usec = t;
+      gps.fix_type = ev(common::GPS_FIX_TYPE::TYPE_3D_FIX);
+      gps.lat = 473977420;
+      gps.lon = 85455940;
+      gps.alt = 498000;
+      gps.eph = 80;
+      gps.epv = 120;
+      gps.vel = 0;
+      gps.cog = UINT16_MAX;
+      gps.satellites_visible = 12;
+      send_message(gps);
+    };
+
+  builtin_gens[msg::AUTOPILOT_VERSION::MSG_ID] = [this](uint64_t) {
+      using MAV_CAP = common::MAV_PROTOCOL_CAPABILITY;
+
+      msg::AUTOPILOT_VERSION ver{};
+      ver.capabilities =
+        static_cast<uint64_t>(MAV_CAP::MISSION_INT) |
+        static_cast<uint64_t>(MAV_CAP::PARAM_FLOAT) |
+        static_cast<uint64_t>(MAV_CAP::COMMAND_INT) |
+        static_cast<uint64_t>(MAV_CAP::FTP) |
+        static_cast<uint64_t>(MAV_CAP::MAVLINK2);
+      ver.uid = 0x53494d46435500ULL | sys_id;
+      send_message(ver);
+    };
+}
+
+}  // namespace sim
+}  // namespace mavconn
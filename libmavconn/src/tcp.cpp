@@ -15,6 +15,7 @@
  * @{
  */
 
+#include <mavconn/async_log.hpp>
 #include <mavconn/console_bridge_compat.hpp>
 #include <mavconn/tcp.hpp>
 #include <mavconn/thread_utils.hpp>
@@ -210,7 +211,7 @@ void MAVConnTCPClient::close()
 void MAVConnTCPClient::send_bytes(const uint8_t * bytes, size_t length)
 {
   if (!is_open()) {
-    CONSOLE_BRIDGE_logError(PFXd "send: channel closed!", conn_id);
+    MAVCONN_LOG_ERROR_THROTTLE(log_throttle, PFXd "send: channel closed!", conn_id);
     return;
   }
 
@@ -231,7 +232,11 @@ void MAVConnTCPClient::send_message(const mavlink_message_t * message)
   assert(message != nullptr);
 
   if (!is_open()) {
-    CONSOLE_BRIDGE_logError(PFXd "send: channel closed!", conn_id);
+    MAVCONN_LOG_ERROR_THROTTLE(log_throttle, PFXd "send: channel closed!", conn_id);
+    return;
+  }
+
+  if (!tx_admit(PFX, message)) {
     return;
   }
 
@@ -252,7 +257,11 @@ void MAVConnTCPClient::send_message(const mavlink_message_t * message)
 void MAVConnTCPClient::send_message(const mavlink::Message & message, const uint8_t source_compid)
 {
   if (!is_open()) {
-    CONSOLE_BRIDGE_logError(PFXd "send: channel closed!", conn_id);
+    MAVCONN_LOG_ERROR_THROTTLE(log_throttle, PFXd "send: channel closed!", conn_id);
+    return;
+  }
+
+  if (!tx_admit(PFX, message)) {
     return;
   }
 
@@ -280,7 +289,8 @@ void MAVConnTCPClient::do_recv()
     buffer(rx_buf),
     [sthis](error_code error, size_t bytes_transferred) {
       if (error) {
-        CONSOLE_BRIDGE_logError(PFXd "receive: %s", sthis->conn_id, error.message().c_str());
+        MAVCONN_LOG_ERROR_THROTTLE(
+          sthis->log_throttle, PFXd "receive: %s", sthis->conn_id, error.message().c_str());
         sthis->close();
         return;
       }
@@ -310,7 +320,8 @@ void MAVConnTCPClient::do_send(bool check_tx_state)
       assert(ssize_t(bytes_transferred) <= buf_ref.len);
 
       if (error) {
-        CONSOLE_BRIDGE_logError(PFXd "send: %s", sthis->conn_id, error.message().c_str());
+        MAVCONN_LOG_ERROR_THROTTLE(
+          sthis->log_throttle, PFXd "send: %s", sthis->conn_id, error.message().c_str());
         sthis->close();
         return;
       }
@@ -468,6 +479,10 @@ void MAVConnTCPServer::send_bytes(const uint8_t * bytes, size_t length)
 
 void MAVConnTCPServer::send_message(const mavlink_message_t * message)
 {
+  if (!tx_admit(PFX, message)) {
+    return;
+  }
+
   lock_guard lock(mutex);
   for (auto & instp : client_list) {
     instp->send_message(message);
@@ -476,6 +491,10 @@ void MAVConnTCPServer::send_message(const mavlink_message_t * message)
 
 void MAVConnTCPServer::send_message(const mavlink::Message & message, const uint8_t source_compid)
 {
+  if (!tx_admit(PFX, message)) {
+    return;
+  }
+
   lock_guard lock(mutex);
   for (auto & instp : client_list) {
     instp->send_message(message, source_compid);
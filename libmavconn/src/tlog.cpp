@@ -0,0 +1,205 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn telemetry log (tlog) reader and writer
+ * @file tlog.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#include <mavconn/console_bridge_compat.hpp>
+#include <mavconn/msgbuffer.hpp>
+#include <mavconn/tlog.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <string>
+
+namespace mavconn
+{
+
+#define PFX "mavconn: tlog: "
+
+static constexpr size_t TIMESTAMP_SIZE = sizeof(uint64_t);
+
+TlogReader::TlogReader(const std::string & path)
+: data(nullptr),
+  data_size(0)
+{
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw DeviceError("tlog", errno);
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    int err = errno;
+    ::close(fd);
+    throw DeviceError("tlog", err);
+  }
+
+  data_size = st.st_size;
+  if (data_size > 0) {
+    void * addr = ::mmap(nullptr, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      int err = errno;
+      ::close(fd);
+      throw DeviceError("tlog", err);
+    }
+
+    ::madvise(addr, data_size, MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t *>(addr);
+  }
+
+  // mapping stays valid after close
+  ::close(fd);
+
+  size_t skipped = 0;
+  size_t pos = 0;
+  while (pos + TIMESTAMP_SIZE < data_size) {
+    const uint8_t * frame = data + pos + TIMESTAMP_SIZE;
+    size_t length = frame_length(frame, data_size - pos - TIMESTAMP_SIZE);
+    if (length == 0) {
+      // resync on the next byte
+      pos++;
+      skipped++;
+      continue;
+    }
+
+    uint64_t time_usec = 0;
+    for (size_t i = 0; i < TIMESTAMP_SIZE; i++) {
+      time_usec = (time_usec << 8) | data[pos + i];
+    }
+
+    records.push_back({time_usec, frame, length});
+    pos += TIMESTAMP_SIZE + length;
+  }
+
+  if (skipped) {
+    CONSOLE_BRIDGE_logWarn(PFX "%s: skipped %zu bytes of garbage", path.c_str(), skipped);
+  }
+
+  CONSOLE_BRIDGE_logInform(PFX "%s: loaded %zu records", path.c_str(), records.size());
+}
+
+TlogReader::~TlogReader()
+{
+  if (data) {
+    ::munmap(const_cast<uint8_t *>(data), data_size);
+  }
+}
+
+size_t TlogReader::find(uint64_t time_usec) const
+{
+  auto it = std::lower_bound(
+    records.begin(), records.end(), time_usec,
+    [](const TlogRecord & rec, uint64_t t) {
+      return rec.time_usec < t;
+    });
+
+  return std::distance(records.begin(), it);
+}
+
+size_t TlogReader::frame_length(const uint8_t * buf, size_t size)
+{
+  if (size < MAVLINK_NUM_HEADER_BYTES) {
+    return 0;
+  }
+
+  const uint8_t payload_len = buf[1];
+  size_t length = 0;
+
+  if (buf[0] == MAVLINK_STX) {
+    length = MAVLINK_NUM_NON_PAYLOAD_BYTES + payload_len;
+    if (size >= 3 && (buf[2] & MAVLINK_IFLAG_SIGNED)) {
+      length += MAVLINK_SIGNATURE_BLOCK_LEN;
+    }
+  } else if (buf[0] == MAVLINK_STX_MAVLINK1) {
+    length = MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + MAVLINK_NUM_CHECKSUM_BYTES + payload_len;
+  } else {
+    return 0;
+  }
+
+  return (length <= size) ? length : 0;
+}
+
+Framing TlogReader::decode(const TlogRecord & rec, mavlink::mavlink_message_t & msg)
+{
+  mavlink::mavlink_message_t buffer{};
+  mavlink::mavlink_status_t parse_status{};
+  mavlink::mavlink_status_t status{};
+
+  for (size_t i = 0; i < rec.length; i++) {
+    auto framing = static_cast<Framing>(mavlink::mavlink_frame_char_buffer(
+        &buffer, &parse_status, rec.frame[i], &msg, &status));
+
+    if (framing != Framing::incomplete) {
+      return framing;
+    }
+  }
+
+  return Framing::incomplete;
+}
+
+TlogWriter::TlogWriter(const std::string & path)
+{
+  file = std::fopen(path.c_str(), "wb");
+  if (!file) {
+    throw DeviceError("tlog", errno);
+  }
+
+  CONSOLE_BRIDGE_logInform(PFX "%s: capture started", path.c_str());
+}
+
+TlogWriter::~TlogWriter()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::fclose(file);
+}
+
+void TlogWriter::write(const mavlink::mavlink_message_t * msg)
+{
+  MsgBuffer buf(msg);
+  write(now_usec(), buf.data, buf.len);
+}
+
+void TlogWriter::write(uint64_t time_usec, const uint8_t * frame, size_t length)
+{
+  uint8_t ts[TIMESTAMP_SIZE];
+  for (ssize_t i = TIMESTAMP_SIZE - 1; i >= 0; i--) {
+    ts[i] = time_usec & 0xff;
+    time_usec >>= 8;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::fwrite(ts, 1, sizeof(ts), file);
+  std::fwrite(frame, 1, length, file);
+}
+
+void TlogWriter::flush()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::fflush(file);
+}
+
+uint64_t TlogWriter::now_usec()
+{
+  using namespace std::chrono;  // NOLINT
+  return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace mavconn
@@ -0,0 +1,189 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn LTTng-UST tracepoint provider
+ * @file tp_call.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+// NOTE: provider header is included several times by lttng, no #pragma once here.
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER mavconn
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "./tp_call.h"
+
+#if !defined(MAVCONN__TP_CALL_H_) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define MAVCONN__TP_CALL_H_
+
+#include <lttng/tracepoint.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  transport_read,
+  TP_ARGS(
+    uint64_t, conn_id,
+    uint64_t, bytes),
+  TP_FIELDS(
+    ctf_integer(uint64_t, conn_id, conn_id)
+    ctf_integer(uint64_t, bytes, bytes))
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  frame_parse,
+  TP_ARGS(
+    uint64_t, conn_id,
+    uint32_t, msgid,
+    uint8_t, sysid,
+    uint8_t, compid,
+    uint8_t, seq,
+    uint8_t, framing),
+  TP_FIELDS(
+    ctf_integer(uint64_t, conn_id, conn_id)
+    ctf_integer(uint32_t, msgid, msgid)
+    ctf_integer(uint8_t, sysid, sysid)
+    ctf_integer(uint8_t, compid, compid)
+    ctf_integer(uint8_t, seq, seq)
+    ctf_integer(uint8_t, framing, framing))
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  mavlink_send,
+  TP_ARGS(
+    uint64_t, conn_id,
+    uint32_t, msgid,
+    uint8_t, sysid,
+    uint8_t, compid,
+    uint8_t, seq),
+  TP_FIELDS(
+    ctf_integer(uint64_t, conn_id, conn_id)
+    ctf_integer(uint32_t, msgid, msgid)
+    ctf_integer(uint8_t, sysid, sysid)
+    ctf_integer(uint8_t, compid, compid)
+    ctf_integer(uint8_t, seq, seq))
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  route_message,
+  TP_ARGS(
+    uint32_t, src_id,
+    uint32_t, msgid,
+    uint8_t, sysid,
+    uint8_t, compid,
+    uint8_t, seq,
+    uint16_t, target_addr,
+    uint32_t, sent_count),
+  TP_FIELDS(
+    ctf_integer(uint32_t, src_id, src_id)
+    ctf_integer(uint32_t, msgid, msgid)
+    ctf_integer(uint8_t, sysid, sysid)
+    ctf_integer(uint8_t, compid, compid)
+    ctf_integer(uint8_t, seq, seq)
+    ctf_integer_hex(uint16_t, target_addr, target_addr)
+    ctf_integer(uint32_t, sent_count, sent_count))
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  endpoint_send,
+  TP_ARGS(
+    uint32_t, src_id,
+    uint32_t, dest_id,
+    uint32_t, msgid,
+    uint8_t, sysid,
+    uint8_t, compid,
+    uint8_t, seq),
+  TP_FIELDS(
+    ctf_integer(uint32_t, src_id, src_id)
+    ctf_integer(uint32_t, dest_id, dest_id)
+    ctf_integer(uint32_t, msgid, msgid)
+    ctf_integer(uint8_t, sysid, sysid)
+    ctf_integer(uint8_t, compid, compid)
+    ctf_integer(uint8_t, seq, seq))
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  uas_dispatch,
+  TP_ARGS(
+    uint32_t, msgid,
+    uint8_t, sysid,
+    uint8_t, compid,
+    uint8_t, seq,
+    uint32_t, handler_count),
+  TP_FIELDS(
+    ctf_integer(uint32_t, msgid, msgid)
+    ctf_integer(uint8_t, sysid, sysid)
+    ctf_integer(uint8_t, compid, compid)
+    ctf_integer(uint8_t, seq, seq)
+    ctf_integer(uint32_t, handler_count, handler_count))
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  plugin_handler_entry,
+  TP_ARGS(
+    uint32_t, msgid,
+    uint8_t, sysid,
+    uint8_t, compid,
+    uint8_t, seq,
+    const char *, handler,
+    uint64_t, type_hash),
+  TP_FIELDS(
+    ctf_integer(uint32_t, msgid, msgid)
+    ctf_integer(uint8_t, sysid, sysid)
+    ctf_integer(uint8_t, compid, compid)
+    ctf_integer(uint8_t, seq, seq)
+    ctf_string(handler, handler)
+    ctf_integer_hex(uint64_t, type_hash, type_hash))
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  plugin_handler_exit,
+  TP_ARGS(
+    uint32_t, msgid,
+    uint8_t, sysid,
+    uint8_t, compid,
+    uint8_t, seq),
+  TP_FIELDS(
+    ctf_integer(uint32_t, msgid, msgid)
+    ctf_integer(uint8_t, sysid, sysid)
+    ctf_integer(uint8_t, compid, compid)
+    ctf_integer(uint8_t, seq, seq))
+)
+
+TRACEPOINT_EVENT(
+  TRACEPOINT_PROVIDER,
+  uas_send,
+  TP_ARGS(
+    uint32_t, msgid,
+    uint8_t, sysid,
+    uint8_t, compid,
+    uint8_t, seq),
+  TP_FIELDS(
+    ctf_integer(uint32_t, msgid, msgid)
+    ctf_integer(uint8_t, sysid, sysid)
+    ctf_integer(uint8_t, compid, compid)
+    ctf_integer(uint8_t, seq, seq))
+)
+
+#endif  // MAVCONN__TP_CALL_H_
+
+#include <lttng/tracepoint-event.h>
@@ -0,0 +1,89 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn LTTng tracepoints
+ * @file tracing.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#include <mavconn/tracing.hpp>
+
+#include "tp_call.h"
+
+namespace mavconn
+{
+namespace tracing
+{
+
+// NOTE: tracepoint() checks that event is enabled before evaluating arguments,
+//       so disabled tracepoints cost only a function call and a branch.
+
+void transport_read(size_t conn_id, size_t bytes)
+{
+  tracepoint(mavconn, transport_read, conn_id, bytes);
+}
+
+void frame_parse(size_t conn_id, const mavlink_message_t * msg, uint8_t framing)
+{
+  tracepoint(mavconn, frame_parse, conn_id, msg->msgid, msg->sysid, msg->compid, msg->seq, framing);
+}
+
+void mavlink_send(size_t conn_id, const mavlink_message_t * msg)
+{
+  tracepoint(mavconn, mavlink_send, conn_id, msg->msgid, msg->sysid, msg->compid, msg->seq);
+}
+
+void mavlink_send_obj(size_t conn_id, uint32_t msgid, uint8_t sysid, uint8_t compid)
+{
+  // sequence number is assigned later, at finalization in the write queue
+  tracepoint(mavconn, mavlink_send, conn_id, msgid, sysid, compid, 0);
+}
+
+void route_message(
+  uint32_t src_id, const mavlink_message_t * msg, uint16_t target_addr,
+  size_t sent_count)
+{
+  tracepoint(
+    mavconn, route_message, src_id, msg->msgid, msg->sysid, msg->compid, msg->seq,
+    target_addr, sent_count);
+}
+
+void endpoint_send(uint32_t src_id, uint32_t dest_id, const mavlink_message_t * msg)
+{
+  tracepoint(
+    mavconn, endpoint_send, src_id, dest_id, msg->msgid, msg->sysid, msg->compid, msg->seq);
+}
+
+void uas_dispatch(const mavlink_message_t * msg, size_t handler_count)
+{
+  tracepoint(mavconn, uas_dispatch, msg->msgid, msg->sysid, msg->compid, msg->seq, handler_count);
+}
+
+void plugin_handler_entry(const mavlink_message_t * msg, const char * handler, size_t type_hash)
+{
+  tracepoint(
+    mavconn, plugin_handler_entry, msg->msgid, msg->sysid, msg->compid, msg->seq,
+    (handler != nullptr) ? handler : "raw", type_hash);
+}
+
+void plugin_handler_exit(const mavlink_message_t * msg)
+{
+  tracepoint(mavconn, plugin_handler_exit, msg->msgid, msg->sysid, msg->compid, msg->seq);
+}
+
+void uas_send(const mavlink_message_t * msg)
+{
+  tracepoint(mavconn, uas_send, msg->msgid, msg->sysid, msg->compid, msg->seq);
+}
+
+}  // namespace tracing
+}  // namespace mavconn
@@ -0,0 +1,212 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+/**
+ * @brief MAVConn transmit shaper
+ * @file tx_shaper.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+
+#include <mavconn/console_bridge_compat.hpp>
+#include <mavconn/tx_shaper.hpp>
+
+#include <algorithm>
+
+namespace mavconn
+{
+
+#define PFX "mavconn: shaper: "
+
+using lock_guard = std::lock_guard<std::mutex>;
+
+//! time constant of goodput smoothing
+static constexpr float GOODPUT_PERIOD = 1.0f;
+
+TxShaper::TxShaper()
+: TxShaper(Config())
+{}
+
+TxShaper::TxShaper(const Config & config_)
+: config(config_),
+  active(false),
+  rate(config_.max_rate),
+  tokens(0.0f),
+  last_refill(steady_clock::now()),
+  last_txbuf(100),
+  last_rxerrors(0),
+  error_rate(0.0f),
+  last_status(),
+  goodput(0.0f),
+  goodput_bytes(0),
+  goodput_stamp(steady_clock::now()),
+  stat_admitted(0),
+  stat_admitted_bytes(0),
+  stat_dropped(0),
+  stat_dropped_bytes(0)
+{}
+
+TxShaper::Priority TxShaper::classify(mavlink::msgid_t msgid)
+{
+  auto it = priority_overrides.find(msgid);
+  if (it != priority_overrides.end()) {
+    return it->second;
+  }
+
+  if (msgid == mavlink::minimal::msg::HEARTBEAT::MSG_ID) {
+    return Priority::high;
+  }
+
+  // targeted messages are commands and protocol transfers
+  auto entry = mavlink::mavlink_get_msg_entry(msgid);
+  if (entry && (entry->flags & MAV_MSG_ENTRY_FLAG_HAVE_TARGET_SYSTEM)) {
+    return Priority::high;
+  }
+
+  return Priority::low;
+}
+
+void TxShaper::refill(steady_clock::time_point now)
+{
+  const float dt = std::chrono::duration<float>(now - last_refill).count();
+  const float depth = std::max(
+    rate * std::chrono::duration<float>(config.burst).count(),
+    static_cast<float>(MAVLINK_MAX_PACKET_LEN));
+
+  last_refill = now;
+  tokens = std::min(tokens + rate * dt, depth);
+}
+
+void TxShaper::update_goodput(steady_clock::time_point now)
+{
+  const float dt = std::chrono::duration<float>(now - goodput_stamp).count();
+  if (dt < GOODPUT_PERIOD) {
+    return;
+  }
+
+  const float current = goodput_bytes / dt;
+  goodput = (goodput == 0.0f) ? current : 0.7f * goodput + 0.3f * current;
+  goodput_bytes = 0;
+  goodput_stamp = now;
+}
+
+bool TxShaper::admit(mavlink::msgid_t msgid, size_t length)
+{
+  lock_guard lock(mutex);
+  auto now = steady_clock::now();
+
+  update_goodput(now);
+
+  bool ok = true;
+  if (active) {
+    refill(now);
+
+    if (classify(msgid) == Priority::high) {
+      // NOTE: high priority may take bucket into debt, so low priority backs off for longer
+      tokens -= length;
+    } else if (tokens >= length) {
+      tokens -= length;
+    } else {
+      ok = false;
+    }
+  }
+
+  if (ok) {
+    stat_admitted++;
+    stat_admitted_bytes += length;
+    goodput_bytes += length;
+  } else {
+    stat_dropped++;
+    stat_dropped_bytes += length;
+  }
+
+  return ok;
+}
+
+void TxShaper::update_radio_status(uint8_t txbuf, uint16_t rxerrors)
+{
+  lock_guard lock(mutex);
+  auto now = steady_clock::now();
+
+  if (!active) {
+    CONSOLE_BRIDGE_logInform(PFX "radio status received, shaping enabled");
+    active = true;
+    last_refill = now;
+    tokens = 0.0f;
+  } else {
+    // rxerrors is 16-bit counter which could wrap
+    const float dt = std::chrono::duration<float>(now - last_status).count();
+    const uint16_t new_errors = rxerrors - last_rxerrors;
+    if (dt > 0.0f) {
+      error_rate = new_errors / dt;
+    }
+  }
+
+  refill(now);
+
+  const float prev_rate = rate;
+  if (txbuf < config.txbuf_low) {
+    rate = std::max(rate * config.decrease_factor, config.min_rate);
+  } else if (txbuf > config.txbuf_high && error_rate == 0.0f) {
+    rate = std::min(rate + config.max_rate * config.increase_step, config.max_rate);
+  }
+
+  if (rate != prev_rate) {
+    CONSOLE_BRIDGE_logDebug(
+      PFX "txbuf %u%%, rate %.0f -> %.0f B/s", txbuf, prev_rate, rate);
+  }
+
+  last_txbuf = txbuf;
+  last_rxerrors = rxerrors;
+  last_status = now;
+}
+
+void TxShaper::set_priority(mavlink::msgid_t msgid, Priority prio)
+{
+  lock_guard lock(mutex);
+  priority_overrides[msgid] = prio;
+}
+
+TxShaper::Priority TxShaper::get_priority(mavlink::msgid_t msgid)
+{
+  lock_guard lock(mutex);
+  return classify(msgid);
+}
+
+void TxShaper::reset()
+{
+  lock_guard lock(mutex);
+
+  active = false;
+  rate = config.max_rate;
+  tokens = 0.0f;
+  last_txbuf = 100;
+  error_rate = 0.0f;
+}
+
+TxShaper::Stats TxShaper::get_stats()
+{
+  lock_guard lock(mutex);
+  update_goodput(steady_clock::now());
+
+  return {
+    active,
+    rate,
+    goodput,
+    last_txbuf,
+    error_rate,
+    stat_admitted,
+    stat_admitted_bytes,
+    stat_dropped,
+    stat_dropped_bytes,
+  };
+}
+
+}  // namespace mavconn
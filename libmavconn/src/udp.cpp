@@ -15,6 +15,7 @@
  * @{
  */
 
+#include <mavconn/async_log.hpp>
 #include <mavconn/console_bridge_compat.hpp>
 #include <mavconn/thread_utils.hpp>
 #include <mavconn/udp.hpp>
@@ -178,12 +179,12 @@ void MAVConnUDP::close()
 void MAVConnUDP::send_bytes(const uint8_t * bytes, size_t length)
 {
   if (!is_open()) {
-    CONSOLE_BRIDGE_logError(PFXd "send: channel closed!", conn_id);
+    MAVCONN_LOG_ERROR_THROTTLE(log_throttle, PFXd "send: channel closed!", conn_id);
     return;
   }
 
   if (!remote_exists) {
-    CONSOLE_BRIDGE_logDebug(PFXd "send: Remote not known, message dropped.", conn_id);
+    MAVCONN_LOG_DEBUG(PFXd "send: Remote not known, message dropped.", conn_id);
     return;
   }
 
@@ -204,12 +205,16 @@ void MAVConnUDP::send_message(const mavlink_message_t * message)
   assert(message != nullptr);
 
   if (!is_open()) {
-    CONSOLE_BRIDGE_logError(PFXd "send: channel closed!", conn_id);
+    MAVCONN_LOG_ERROR_THROTTLE(log_throttle, PFXd "send: channel closed!", conn_id);
     return;
   }
 
   if (!remote_exists) {
-    CONSOLE_BRIDGE_logDebug(PFXd "send: Remote not known, message dropped.", conn_id);
+    MAVCONN_LOG_DEBUG(PFXd "send: Remote not known, message dropped.", conn_id);
+    return;
+  }
+
+  if (!tx_admit(PFX, message)) {
     return;
   }
 
@@ -230,12 +235,16 @@ void MAVConnUDP::send_message(const mavlink_message_t * message)
 void MAVConnUDP::send_message(const mavlink::Message & message, const uint8_t source_compid)
 {
   if (!is_open()) {
-    CONSOLE_BRIDGE_logError(PFXd "send: channel closed!", conn_id);
+    MAVCONN_LOG_ERROR_THROTTLE(log_throttle, PFXd "send: channel closed!", conn_id);
     return;
   }
 
   if (!remote_exists) {
-    CONSOLE_BRIDGE_logDebug(PFXd "send: Remote not known, message dropped.", conn_id);
+    MAVCONN_LOG_DEBUG(PFXd "send: Remote not known, message dropped.", conn_id);
+    return;
+  }
+
+  if (!tx_admit(PFX, message)) {
     return;
   }
 
@@ -261,13 +270,14 @@ void MAVConnUDP::do_recvfrom()
     permanent_broadcast ? recv_ep : remote_ep,
     [sthis](error_code error, size_t bytes_transferred) {
       if (error) {
-        CONSOLE_BRIDGE_logError(PFXd "receive: %s", sthis->conn_id, error.message().c_str());
+        MAVCONN_LOG_ERROR_THROTTLE(
+          sthis->log_throttle, PFXd "receive: %s", sthis->conn_id, error.message().c_str());
         sthis->close();
         return;
       }
 
       if (!sthis->permanent_broadcast && sthis->remote_ep != sthis->last_remote_ep) {
-        CONSOLE_BRIDGE_logInform(
+        MAVCONN_LOG_INFORM(
           PFXd "Remote address: %s", sthis->conn_id,
           to_string_ss(sthis->remote_ep).c_str());
         sthis->remote_exists = true;
@@ -300,12 +310,13 @@ void MAVConnUDP::do_sendto(bool check_tx_state)
       assert(ssize_t(bytes_transferred) <= buf_ref.len);
 
       if (error == asio::error::network_unreachable) {
-        CONSOLE_BRIDGE_logWarn(
-          PFXd "sendto: %s, retrying", sthis->conn_id,
+        MAVCONN_LOG_WARN_THROTTLE(
+          sthis->log_throttle, PFXd "sendto: %s, retrying", sthis->conn_id,
           error.message().c_str());
         // do not return, try to resend
       } else if (error) {
-        CONSOLE_BRIDGE_logError(PFXd "sendto: %s", sthis->conn_id, error.message().c_str());
+        MAVCONN_LOG_ERROR_THROTTLE(
+          sthis->log_throttle, PFXd "sendto: %s", sthis->conn_id, error.message().c_str());
         sthis->close();
         return;
       }
@@ -11,7 +11,9 @@
  * Test mavconn library
  */
 
+#include <mavconn/async_log.hpp>
 #include <mavconn/interface.hpp>
+#include <mavconn/replay.hpp>
 #include <mavconn/serial.hpp>
 #include <mavconn/tcp.hpp>
 #include <mavconn/udp.hpp>
@@ -27,8 +29,13 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <cstdio>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace mavconn; // NOLINT
 using mavlink_message_t = mavlink::mavlink_message_t;
@@ -295,6 +302,128 @@ TEST(URL, open_url_tcp)
   });
 }
 
+TEST(URL, open_url_capture_replay)
+{
+  const std::string path = "/tmp/test_mavconn_capture.tlog";
+  MAVConnInterface::Ptr capture, replay;
+
+  EXPECT_NO_THROW(
+  {
+    capture = MAVConnInterface::open_url("capture://" + path);
+    EXPECT_NE(dynamic_cast<MAVConnCapture *>(capture.get()), nullptr);
+  });
+
+  for (int i = 0; i < 10; i++) {
+    send_heartbeat(capture.get());
+  }
+  capture.reset();
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  size_t received = 0;
+
+  EXPECT_NO_THROW(
+  {
+    replay = MAVConnInterface::open_url(
+      "replay://" + path + "?rate=0", 1, 1,
+      [&](const mavlink_message_t * msg, const Framing framing) {
+        EXPECT_EQ(Framing::ok, framing);
+        EXPECT_EQ(mavlink::common::msg::HEARTBEAT::MSG_ID, msg->msgid);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        received++;
+        cond.notify_all();
+      });
+    EXPECT_NE(dynamic_cast<MAVConnReplay *>(replay.get()), nullptr);
+  });
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    EXPECT_TRUE(cond.wait_for(lock, std::chrono::seconds(2), [&] {return received == 10;}));
+  }
+
+  // rewind
+  std::dynamic_pointer_cast<MAVConnReplay>(replay)->seek(0.0);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    EXPECT_TRUE(cond.wait_for(lock, std::chrono::seconds(2), [&] {return received == 20;}));
+  }
+
+  replay->close();
+  std::remove(path.c_str());
+
+  EXPECT_THROW(
+  {
+    replay = MAVConnInterface::open_url("replay:///nonexistent/file.tlog");
+  },
+    DeviceError);
+}
+
+class CaptureOutputHandler : public console_bridge::OutputHandler
+{
+public:
+  void log(
+    const std::string & text, console_bridge::LogLevel level [[maybe_unused]],
+    const char * filename [[maybe_unused]], int line [[maybe_unused]]) override
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    lines.push_back(text);
+  }
+
+  std::mutex mutex;
+  std::vector<std::string> lines;
+};
+
+TEST(ASYNC_LOG, level_check_skips_arguments)
+{
+  auto prev_level = console_bridge::getLogLevel();
+  console_bridge::setLogLevel(console_bridge::CONSOLE_BRIDGE_LOG_INFO);
+
+  int evaluated = 0;
+  auto arg = [&]() {
+      evaluated++;
+      return "x";
+    };
+
+  MAVCONN_LOG_DEBUG("debug %s", arg());
+  EXPECT_EQ(evaluated, 0);
+
+  CaptureOutputHandler handler;
+  console_bridge::useOutputHandler(&handler);
+
+  MAVCONN_LOG_INFORM("info %s", arg());
+  EXPECT_EQ(evaluated, 1);
+
+  AsyncLog::instance().flush();
+  console_bridge::restorePreviousOutputHandler();
+  console_bridge::setLogLevel(prev_level);
+
+  std::lock_guard<std::mutex> lock(handler.mutex);
+  ASSERT_EQ(handler.lines.size(), 1UL);
+  EXPECT_EQ(handler.lines[0], "info x");
+}
+
+TEST(ASYNC_LOG, throttle)
+{
+  LogThrottle throttle(std::chrono::milliseconds(50));
+  const char * fmt = "error %d";
+  size_t suppressed = 0;
+
+  EXPECT_TRUE(throttle.check(fmt, suppressed));
+  EXPECT_EQ(suppressed, 0UL);
+
+  for (int i = 0; i < 10; i++) {
+    EXPECT_FALSE(throttle.check(fmt, suppressed));
+  }
+
+  // other call site is not affected
+  EXPECT_TRUE(throttle.check("other", suppressed));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  EXPECT_TRUE(throttle.check(fmt, suppressed));
+  EXPECT_EQ(suppressed, 10UL);
+}
+
 int main(int argc, char ** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
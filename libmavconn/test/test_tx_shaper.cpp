@@ -0,0 +1,202 @@
+//
+// libmavconn
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * Test closed-loop transmit shaper
+ */
+
+#include <mavconn/tx_shaper.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace mavconn; // NOLINT
+using namespace std::chrono_literals; // NOLINT
+
+static const auto HEARTBEAT_ID = mavlink::minimal::msg::HEARTBEAT::MSG_ID;
+static const auto ATTITUDE_ID = mavlink::common::msg::ATTITUDE::MSG_ID;
+
+static TxShaper::Config make_config()
+{
+  TxShaper::Config config;
+  config.max_rate = 1000.0f;
+  config.min_rate = 100.0f;
+  config.increase_step = 0.1f;
+  config.decrease_factor = 0.5f;
+  return config;
+}
+
+//! successive status updates must have some time between them for error rate
+static void radio_status(TxShaper & shaper, uint8_t txbuf, uint16_t rxerrors)
+{
+  std::this_thread::sleep_for(2ms);
+  shaper.update_radio_status(txbuf, rxerrors);
+}
+
+TEST(TxShaper, inactive_until_radio_status)
+{
+  TxShaper shaper(make_config());
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(shaper.admit(ATTITUDE_ID, 200));
+  }
+
+  auto st = shaper.get_stats();
+  EXPECT_FALSE(st.active);
+  EXPECT_EQ(st.admitted, 100u);
+  EXPECT_EQ(st.dropped, 0u);
+}
+
+TEST(TxShaper, priority)
+{
+  TxShaper shaper;
+
+  EXPECT_EQ(shaper.get_priority(HEARTBEAT_ID), TxShaper::Priority::high);
+  EXPECT_EQ(
+    shaper.get_priority(mavlink::common::msg::COMMAND_LONG::MSG_ID),
+    TxShaper::Priority::high);
+  EXPECT_EQ(shaper.get_priority(ATTITUDE_ID), TxShaper::Priority::low);
+
+  shaper.set_priority(ATTITUDE_ID, TxShaper::Priority::high);
+  EXPECT_EQ(shaper.get_priority(ATTITUDE_ID), TxShaper::Priority::high);
+}
+
+TEST(TxShaper, aimd)
+{
+  TxShaper shaper(make_config());
+
+  // buffer filling up: multiplicative decrease down to min_rate
+  radio_status(shaper, 30, 0);
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 500.0f);
+  radio_status(shaper, 30, 0);
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 250.0f);
+  radio_status(shaper, 30, 0);
+  radio_status(shaper, 30, 0);
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 100.0f);
+
+  // between thresholds rate holds
+  radio_status(shaper, 60, 0);
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 100.0f);
+
+  // buffer empty: additive increase up to max_rate
+  radio_status(shaper, 90, 0);
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 200.0f);
+  radio_status(shaper, 90, 0);
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 300.0f);
+  for (int i = 0; i < 10; i++) {
+    radio_status(shaper, 90, 0);
+  }
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 1000.0f);
+  EXPECT_EQ(shaper.get_stats().txbuf, 90);
+}
+
+TEST(TxShaper, no_increase_on_rx_errors)
+{
+  TxShaper shaper(make_config());
+
+  radio_status(shaper, 30, 65530);
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 500.0f);
+
+  // errors rising
+  radio_status(shaper, 90, 65532);
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 500.0f);
+  EXPECT_GT(shaper.get_stats().error_rate, 0.0f);
+
+  // 16-bit counter wrap is still new errors, not a huge jump or a decrease
+  radio_status(shaper, 90, 5);
+  auto st = shaper.get_stats();
+  EXPECT_FLOAT_EQ(st.rate, 500.0f);
+  EXPECT_GT(st.error_rate, 0.0f);
+  EXPECT_LE(st.error_rate, 9.0f / 0.002f);
+
+  // errors stopped
+  radio_status(shaper, 90, 5);
+  st = shaper.get_stats();
+  EXPECT_FLOAT_EQ(st.error_rate, 0.0f);
+  EXPECT_FLOAT_EQ(st.rate, 600.0f);
+}
+
+TEST(TxShaper, drop_low_priority_debt_high_priority)
+{
+  TxShaper shaper(make_config());
+
+  // bucket starts empty when shaping is enabled
+  shaper.update_radio_status(60, 0);
+
+  EXPECT_FALSE(shaper.admit(ATTITUDE_ID, 200));
+
+  // high priority always goes, putting the bucket into debt
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(shaper.admit(HEARTBEAT_ID, 100));
+  }
+
+  // 1000 B debt at 1000 B/s: low priority stays blocked for a while
+  std::this_thread::sleep_for(300ms);
+  EXPECT_FALSE(shaper.admit(ATTITUDE_ID, 50));
+
+  // debt repaid
+  std::this_thread::sleep_for(1s);
+  EXPECT_TRUE(shaper.admit(ATTITUDE_ID, 50));
+
+  auto st = shaper.get_stats();
+  EXPECT_EQ(st.admitted, 11u);
+  EXPECT_EQ(st.admitted_bytes, 1050u);
+  EXPECT_EQ(st.dropped, 2u);
+  EXPECT_EQ(st.dropped_bytes, 250u);
+}
+
+TEST(TxShaper, reset)
+{
+  TxShaper shaper(make_config());
+
+  radio_status(shaper, 10, 0);
+  radio_status(shaper, 10, 0);
+  EXPECT_FALSE(shaper.admit(ATTITUDE_ID, 200));
+
+  shaper.reset();
+
+  auto st = shaper.get_stats();
+  EXPECT_FALSE(st.active);
+  EXPECT_FLOAT_EQ(st.rate, 1000.0f);
+  EXPECT_EQ(st.txbuf, 100);
+  EXPECT_FLOAT_EQ(st.error_rate, 0.0f);
+  EXPECT_TRUE(shaper.admit(ATTITUDE_ID, 200));
+
+  // next radio status starts from max rate again
+  radio_status(shaper, 30, 0);
+  EXPECT_TRUE(shaper.get_stats().active);
+  EXPECT_FLOAT_EQ(shaper.get_stats().rate, 500.0f);
+}
+
+TEST(TxShaper, goodput)
+{
+  TxShaper shaper(make_config());
+
+  // 100 B every 10 ms ~ 10 kB/s, only admitted traffic counts
+  auto start = std::chrono::steady_clock::now();
+  size_t sent = 0;
+  while (std::chrono::steady_clock::now() - start < 1100ms) {
+    EXPECT_TRUE(shaper.admit(ATTITUDE_ID, 100));
+    sent += 100;
+    std::this_thread::sleep_for(10ms);
+  }
+
+  auto st = shaper.get_stats();
+  EXPECT_EQ(st.admitted_bytes, sent);
+  EXPECT_GT(st.goodput, 5000.0f);
+  EXPECT_LT(st.goodput, 11000.0f);
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,563 @@
+//
+// mavros
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * mavros microbenchmarks: message conversion, router and uas dispatch,
+ * distance_sensor single topic vs RangeArray publishing
+ *
+ * Message mix is loaded from a tlog if --tlog=<path> is given,
+ * otherwise a typical autopilot telemetry mix is synthesized.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "mavconn/interface.hpp"
+#include "mavconn/msgbuffer.hpp"
+#include "mavconn/tlog.hpp"
+#include "mavros/mavros_router.hpp"
+#include "mavros/mavros_uas.hpp"
+#include "mavros/plugin_filter.hpp"
+#include "mavros_msgs/mavlink_convert.hpp"
+#include "mavros_msgs/msg/range_array.hpp"
+#include "sensor_msgs/msg/range.hpp"
+
+#include "bench_allocs.hpp"
+
+using namespace mavconn; // NOLINT
+using mavlink_message_t = mavlink::mavlink_message_t;
+
+// -*- message mix -*-
+
+static std::string g_tlog_path;
+
+static void push_message(
+  std::vector<mavlink_message_t> & out, const mavlink::Message & obj,
+  uint8_t sysid, uint8_t compid)
+{
+  static mavlink::mavlink_status_t status{};
+
+  MsgBuffer buf(obj, &status, sysid, compid);
+  TlogRecord rec{0, buf.data, static_cast<size_t>(buf.len)};
+
+  mavlink_message_t msg;
+  if (TlogReader::decode(rec, msg) == Framing::ok) {
+    out.push_back(msg);
+  }
+}
+
+static std::vector<mavlink_message_t> make_synthetic_mix()
+{
+  namespace msg = mavlink::common::msg;
+  std::vector<mavlink_message_t> mix;
+
+  msg::COMMAND_LONG cmd{};
+  cmd.target_system = 1;
+  cmd.target_component = 1;
+  cmd.command = static_cast<uint16_t>(mavlink::common::MAV_CMD::REQUEST_MESSAGE);
+
+  // FCU telemetry, rates roughly match PX4 on a fast link
+  for (int round = 0; round < 50; round++) {
+    push_message(mix, msg::ATTITUDE(), 1, 1);
+    push_message(mix, msg::ATTITUDE_QUATERNION(), 1, 1);
+    push_message(mix, msg::HIGHRES_IMU(), 1, 1);
+
+    if (round % 2 == 0) {
+      push_message(mix, msg::LOCAL_POSITION_NED(), 1, 1);
+      push_message(mix, msg::GLOBAL_POSITION_INT(), 1, 1);
+    }
+    if (round % 5 == 0) {
+      push_message(mix, msg::SERVO_OUTPUT_RAW(), 1, 1);
+    }
+    if (round % 10 == 0) {
+      push_message(mix, msg::GPS_RAW_INT(), 1, 1);
+    }
+  }
+
+  push_message(mix, mavlink::minimal::msg::HEARTBEAT(), 1, 1);
+  push_message(mix, msg::SYS_STATUS(), 1, 1);
+  push_message(mix, msg::STATUSTEXT(), 1, 1);
+  // GCS traffic targeted to the FCU
+  push_message(mix, mavlink::minimal::msg::HEARTBEAT(), 255, 190);
+  push_message(mix, cmd, 255, 190);
+
+  return mix;
+}
+
+static std::vector<mavlink_message_t> load_tlog_mix(const std::string & path)
+{
+  TlogReader tlog(path);
+  std::vector<mavlink_message_t> mix;
+
+  mavlink_message_t msg;
+  for (auto & rec : tlog) {
+    if (TlogReader::decode(rec, msg) == Framing::ok) {
+      mix.push_back(msg);
+    }
+  }
+
+  return mix;
+}
+
+static const std::vector<mavlink_message_t> & get_mix()
+{
+  static auto mix = g_tlog_path.empty() ? make_synthetic_mix() : load_tlog_mix(g_tlog_path);
+  return mix;
+}
+
+// -*- mavros_msgs::mavlink::convert -*-
+
+static void BM_convert_to_ros(benchmark::State & state)
+{
+  auto & mix = get_mix();
+  mavros_msgs::msg::Mavlink rmsg;
+  size_t bytes = 0;
+
+  auto allocs = bench::start_allocs();
+  for (auto _ : state) {
+    for (auto & msg : mix) {
+      mavros_msgs::mavlink::convert(msg, rmsg);
+      benchmark::DoNotOptimize(rmsg.payload64.data());
+      bytes += msg.len;
+    }
+  }
+  bench::report_allocs(state, allocs);
+
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(state.iterations() * mix.size());
+}
+BENCHMARK(BM_convert_to_ros);
+
+static void BM_convert_from_ros(benchmark::State & state)
+{
+  auto & mix = get_mix();
+  std::vector<mavros_msgs::msg::Mavlink> rmix(mix.size());
+  for (size_t i = 0; i < mix.size(); i++) {
+    mavros_msgs::mavlink::convert(mix[i], rmix[i]);
+  }
+
+  mavlink_message_t msg;
+  size_t bytes = 0;
+
+  auto allocs = bench::start_allocs();
+  for (auto _ : state) {
+    for (auto & rmsg : rmix) {
+      mavros_msgs::mavlink::convert(rmsg, msg);
+      benchmark::DoNotOptimize(msg.payload64);
+      bytes += msg.len;
+    }
+  }
+  bench::report_allocs(state, allocs);
+
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(state.iterations() * rmix.size());
+}
+BENCHMARK(BM_convert_from_ros);
+
+namespace mavros
+{
+namespace router
+{
+
+/**
+ * Endpoint which only counts messages
+ */
+class NullEndpoint : public Endpoint
+{
+public:
+  size_t sent = 0;
+
+  bool is_open() override
+  {
+    return true;
+  }
+
+  std::pair<bool, std::string> open() override
+  {
+    return {true, ""};
+  }
+
+  void close() override {}
+
+  void send_message(
+    const mavlink_message_t * msg [[maybe_unused]], const Framing framing [[maybe_unused]],
+    id_t src_id [[maybe_unused]]) override
+  {
+    sent++;
+  }
+
+  void diag_run(diagnostic_updater::DiagnosticStatusWrapper & stat [[maybe_unused]]) override {}
+};
+
+class BenchRouter
+{
+public:
+  using LT = Endpoint::Type;
+
+  Router::SharedPtr router;
+  std::vector<Endpoint::SharedPtr> eps;
+
+  BenchRouter()
+  {
+    router = std::make_shared<Router>("bench_mavros_router");
+
+    // same topology as in test_router: two FCUs, two UASes, two GCSes
+    add_endpoint(1000, "null://fcu1", LT::fcu, {0x0000, 0x0100, 0x0101});
+    add_endpoint(1001, "null://fcu2", LT::fcu, {0x0000, 0x0200, 0x0201});
+    add_endpoint(1002, "/uas1", LT::uas, {0x0000, 0x0100, 0x01BF});
+    add_endpoint(1003, "/uas2", LT::uas, {0x0000, 0x0200, 0x02BF});
+    add_endpoint(1004, "null://gcs1", LT::gcs, {0x0000, 0xFF00, 0xFFBE});
+    add_endpoint(1005, "null://gcs2", LT::gcs, {0x0000, 0xFF00, 0xFFBD});
+  }
+
+  ~BenchRouter()
+  {
+    router->endpoints.clear();
+  }
+
+  void add_endpoint(id_t id, const std::string & url, LT type, std::set<addr_t> remotes)
+  {
+    auto ep = std::make_shared<NullEndpoint>();
+    ep->parent = router;
+    ep->id = id;
+    ep->link_type = type;
+    ep->url = url;
+    ep->remote_addrs = remotes;
+
+    router->endpoints[id] = ep;
+    eps.push_back(ep);
+  }
+
+  //! Source endpoint for message: GCS ids come from gcs1, everything else from fcu1
+  Endpoint::SharedPtr source_for(const mavlink_message_t & msg)
+  {
+    return (msg.sysid == 255) ? eps[4] : eps[0];
+  }
+};
+
+}  // namespace router
+
+namespace uas
+{
+
+/**
+ * Plugin subscribed to every message of the synthetic mix
+ */
+class BenchPlugin : public plugin::Plugin
+{
+public:
+  explicit BenchPlugin(UAS::SharedPtr uas_)
+  : Plugin(uas_), handled(0) {}
+
+  Subscriptions get_subscriptions() override
+  {
+    namespace msg = mavlink::common::msg;
+
+    return {
+      make_handler(&BenchPlugin::handle_heartbeat),
+      make_handler(&BenchPlugin::handle_attitude),
+      make_handler(&BenchPlugin::handle_highres_imu),
+      make_handler(&BenchPlugin::handle_local_position),
+      make_handler(msg::ATTITUDE_QUATERNION::MSG_ID, &BenchPlugin::handle_raw),
+      make_handler(msg::GLOBAL_POSITION_INT::MSG_ID, &BenchPlugin::handle_raw),
+      make_handler(msg::GPS_RAW_INT::MSG_ID, &BenchPlugin::handle_raw),
+      make_handler(msg::SERVO_OUTPUT_RAW::MSG_ID, &BenchPlugin::handle_raw),
+      make_handler(msg::SYS_STATUS::MSG_ID, &BenchPlugin::handle_raw),
+      make_handler(msg::STATUSTEXT::MSG_ID, &BenchPlugin::handle_raw),
+    };
+  }
+
+  size_t handled;
+
+private:
+  void handle_heartbeat(
+    const mavlink_message_t * msg [[maybe_unused]],
+    mavlink::minimal::msg::HEARTBEAT & hb, plugin::filter::AnyOk filter [[maybe_unused]])
+  {
+    benchmark::DoNotOptimize(hb.custom_mode);
+    handled++;
+  }
+
+  void handle_attitude(
+    const mavlink_message_t * msg [[maybe_unused]],
+    mavlink::common::msg::ATTITUDE & att, plugin::filter::SystemAndOk filter [[maybe_unused]])
+  {
+    benchmark::DoNotOptimize(att.roll);
+    handled++;
+  }
+
+  void handle_highres_imu(
+    const mavlink_message_t * msg [[maybe_unused]],
+    mavlink::common::msg::HIGHRES_IMU & imu, plugin::filter::SystemAndOk filter [[maybe_unused]])
+  {
+    benchmark::DoNotOptimize(imu.xacc);
+    handled++;
+  }
+
+  void handle_local_position(
+    const mavlink_message_t * msg [[maybe_unused]],
+    mavlink::common::msg::LOCAL_POSITION_NED & pos,
+    plugin::filter::SystemAndOk filter [[maybe_unused]])
+  {
+    benchmark::DoNotOptimize(pos.x);
+    handled++;
+  }
+
+  void handle_raw(const mavlink_message_t * msg, const Framing framing [[maybe_unused]])
+  {
+    benchmark::DoNotOptimize(msg->len);
+    handled++;
+  }
+};
+
+class BenchUASNode : public UAS
+{
+public:
+  explicit BenchUASNode(const std::string & name_)
+  : UAS(name_) {}
+
+  plugin::Plugin::SharedPtr create_plugin_instance(const std::string & pl_name) override
+  {
+    (void)pl_name;
+    return std::make_shared<BenchPlugin>(std::static_pointer_cast<UAS>(shared_from_this()));
+  }
+};
+
+class BenchUAS
+{
+public:
+  std::shared_ptr<BenchUASNode> uas;
+
+  BenchUAS()
+  {
+    uas = std::make_shared<BenchUASNode>("bench_mavros_uas");
+    uas->startup_delay_timer->cancel();
+    uas->add_plugin("bench");
+  }
+
+  ~BenchUAS()
+  {
+    uas->plugin_subscriptions.clear();
+    uas->loaded_plugins.clear();
+  }
+
+  inline void plugin_route(const mavlink_message_t * msg, const Framing framing)
+  {
+    uas->plugin_route(msg, framing);
+  }
+};
+
+}  // namespace uas
+}  // namespace mavros
+
+// -*- Router::route_message -*-
+
+static void BM_route_message(benchmark::State & state)
+{
+  auto & mix = get_mix();
+  mavros::router::BenchRouter bench;
+
+  std::vector<mavros::router::Endpoint::SharedPtr> sources;
+  for (auto & msg : mix) {
+    sources.push_back(bench.source_for(msg));
+  }
+
+  size_t bytes = 0;
+
+  auto allocs = bench::start_allocs();
+  for (auto _ : state) {
+    for (size_t i = 0; i < mix.size(); i++) {
+      bench.router->route_message(sources[i], &mix[i], Framing::ok);
+      bytes += mix[i].len;
+    }
+  }
+  bench::report_allocs(state, allocs);
+
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(state.iterations() * mix.size());
+}
+BENCHMARK(BM_route_message);
+
+// -*- UAS::plugin_route -*-
+
+static void BM_plugin_route(benchmark::State & state)
+{
+  auto & mix = get_mix();
+  mavros::uas::BenchUAS bench;
+  size_t bytes = 0;
+
+  auto allocs = bench::start_allocs();
+  for (auto _ : state) {
+    for (auto & msg : mix) {
+      bench.plugin_route(&msg, Framing::ok);
+      bytes += msg.len;
+    }
+  }
+  bench::report_allocs(state, allocs);
+
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(state.iterations() * mix.size());
+}
+BENCHMARK(BM_plugin_route);
+
+// -*- distance_sensor: Range per sensor vs RangeArray -*-
+
+/**
+ * One iteration is one second of DISTANCE_SENSOR stream:
+ * args are number of sensors and their rate [Hz].
+ * Time per iteration is the CPU cost of publishing one second of ranges.
+ */
+class RangeBench
+{
+public:
+  static constexpr double ARRAY_RATE = 20.0;    //!< distance_sensor array.rate default
+
+  rclcpp::Node::SharedPtr node;
+  rclcpp::Node::SharedPtr sub_node;
+  std::vector<rclcpp::SubscriptionBase::SharedPtr> subs;
+
+  RangeBench()
+  {
+    node = std::make_shared<rclcpp::Node>("bench_distance_sensor");
+    sub_node = std::make_shared<rclcpp::Node>("bench_distance_sensor_sub");
+  }
+
+  //! matched subscriber, so middleware really serializes and delivers
+  template<typename MsgT>
+  typename rclcpp::Publisher<MsgT>::SharedPtr make_publisher(const std::string & topic)
+  {
+    auto qos = rclcpp::SensorDataQoS();
+    subs.push_back(
+      sub_node->create_subscription<MsgT>(
+        topic, qos, [](const typename MsgT::SharedPtr msg [[maybe_unused]]) {}));
+    return node->create_publisher<MsgT>(topic, qos);
+  }
+
+  static sensor_msgs::msg::Range make_range(size_t i)
+  {
+    sensor_msgs::msg::Range range;
+    range.header.frame_id = "distance_sensor_" + std::to_string(i);
+    range.radiation_type = sensor_msgs::msg::Range::INFRARED;
+    range.field_of_view = 0.5;
+    range.min_range = 0.1;
+    range.max_range = 40.0;
+    range.range = 1.0 + i;
+    return range;
+  }
+};
+
+static void BM_range_single(benchmark::State & state)
+{
+  const size_t n_sensors = state.range(0);
+  const size_t rate = state.range(1);
+
+  RangeBench bench;
+  std::vector<rclcpp::Publisher<sensor_msgs::msg::Range>::SharedPtr> pubs;
+  std::vector<sensor_msgs::msg::Range> ranges;
+  for (size_t i = 0; i < n_sensors; i++) {
+    pubs.push_back(
+      bench.make_publisher<sensor_msgs::msg::Range>(
+        "~/distance_sensor_" + std::to_string(i)));
+    ranges.push_back(RangeBench::make_range(i));
+  }
+
+  size_t published = 0;
+  for (auto _ : state) {
+    for (size_t t = 0; t < rate; t++) {
+      for (size_t i = 0; i < n_sensors; i++) {
+        ranges[i].header.stamp = bench.node->now();
+        pubs[i]->publish(ranges[i]);
+        published++;
+      }
+    }
+  }
+
+  state.counters["publish/s"] = benchmark::Counter(published, benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * n_sensors * rate);
+}
+BENCHMARK(BM_range_single)->ArgsProduct({{12, 16}, {20, 50}})->Unit(benchmark::kMicrosecond);
+
+static void BM_range_array(benchmark::State & state)
+{
+  const size_t n_sensors = state.range(0);
+  const size_t rate = state.range(1);
+
+  RangeBench bench;
+  auto pub = bench.make_publisher<mavros_msgs::msg::RangeArray>("~/ranges");
+
+  std::mutex array_mutex;
+  mavros_msgs::msg::RangeArray array_msg;
+  for (size_t i = 0; i < n_sensors; i++) {
+    array_msg.sensor_ids.push_back(i);
+    array_msg.ranges.push_back(RangeBench::make_range(i));
+  }
+
+  // array timer ticks spread over sensor ticks, as wall timer at array.rate would
+  const size_t array_ticks = RangeBench::ARRAY_RATE;
+  size_t published = 0;
+  for (auto _ : state) {
+    size_t next_array = 0;
+    for (size_t t = 0; t < rate; t++) {
+      for (size_t i = 0; i < n_sensors; i++) {
+        std::lock_guard<std::mutex> lock(array_mutex);
+        array_msg.ranges[i].header.stamp = bench.node->now();
+        array_msg.ranges[i].range = 1.0 + t;
+      }
+
+      // publish copies latest values, like array_timer_cb()
+      while (next_array < array_ticks && next_array * rate <= t * array_ticks) {
+        mavros_msgs::msg::RangeArray msg;
+        {
+          std::lock_guard<std::mutex> lock(array_mutex);
+          msg = array_msg;
+        }
+
+        msg.header.stamp = bench.node->now();
+        pub->publish(msg);
+        published++;
+        next_array++;
+      }
+    }
+  }
+
+  state.counters["publish/s"] = benchmark::Counter(published, benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * n_sensors * rate);
+}
+BENCHMARK(BM_range_array)->ArgsProduct({{12, 16}, {20, 50}})->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char ** argv)
+{
+  benchmark::Initialize(&argc, argv);
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strncmp(argv[i], "--tlog=", 7) == 0) {
+      g_tlog_path = argv[i] + 7;
+    }
+  }
+
+  if (get_mix().empty()) {
+    std::fprintf(stderr, "empty message mix\n");
+    return 1;
+  }
+
+  rclcpp::init(0, nullptr);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief End-to-end latency benchmark
+ * @file e2e_latency.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * Runs Router and UAS nodes in one process together with mavconn::sim::SimFCU
+ * connected by local UDP, and measures latency of two paths:
+ *
+ * - rx: wire -> parse_buffer -> Router -> ROSEndpoint -> UAS -> imu plugin -> topic
+ *   (HIGHRES_IMU.temperature carries the sample key);
+ * - tx: manual_control/send topic -> plugin -> UAS -> Router -> wire -> SimFCU
+ *   (MANUAL_CONTROL.x carries the sample key).
+ *
+ * Results are printed as JSON lines, one line per direction and rate.
+ */
+
+#include <time.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mavconn/sim_fcu.hpp"
+#include "mavros/mavros_router.hpp"
+#include "mavros/mavros_uas.hpp"
+#include "mavros/utils.hpp"
+#include "mavros_msgs/msg/manual_control.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/temperature.hpp"
+
+using namespace std::chrono_literals;  // NOLINT
+using clock_type = std::chrono::steady_clock;
+using mavros::utils::format;
+
+namespace
+{
+
+//! Sample key ring. Key is encoded into a message field, so it should fit to int16.
+class SampleRing
+{
+public:
+  static constexpr size_t SIZE = 1 << 15;
+
+  SampleRing()
+  : counter(0), sent_at{}
+  {}
+
+  uint16_t mark()
+  {
+    uint16_t key = counter.fetch_add(1) & (SIZE - 1);
+    sent_at[key].store(now_ns(), std::memory_order_release);
+    return key;
+  }
+
+  void receive(uint16_t key)
+  {
+    // NOTE: written by publisher thread, read by subscription callback thread
+    const int64_t dt = now_ns() - sent_at[key & (SIZE - 1)].load(std::memory_order_acquire);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    latencies_ns.push_back(dt);
+  }
+
+  size_t sent()
+  {
+    return counter.load();
+  }
+
+  std::vector<int64_t> take()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto ret = std::move(latencies_ns);
+    latencies_ns = {};
+    counter = 0;
+    return ret;
+  }
+
+private:
+  static int64_t now_ns()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      clock_type::now().time_since_epoch()).count();
+  }
+
+  std::atomic<size_t> counter;
+  std::array<std::atomic<int64_t>, SIZE> sent_at;      //!< steady clock [ns]
+  std::mutex mutex;
+  std::vector<int64_t> latencies_ns;
+};
+
+int64_t process_cpu_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+double percentile_us(std::vector<int64_t> & sorted_ns, double p)
+{
+  if (sorted_ns.empty()) {
+    return 0.0;
+  }
+
+  size_t idx = std::min(sorted_ns.size() - 1, size_t(p * sorted_ns.size()));
+  return sorted_ns[idx] / 1e3;
+}
+
+struct Options
+{
+  std::vector<double> rates{100, 200, 500, 1000, 2000};
+  double duration = 5.0;
+  int port = 45300;
+  std::string label;
+  std::string output;
+};
+
+Options parse_args(const std::vector<std::string> & args)
+{
+  Options opts;
+
+  for (size_t i = 1; i + 1 < args.size(); i += 2) {
+    auto & key = args[i];
+    auto & value = args[i + 1];
+
+    if (key == "--rates") {
+      opts.rates.clear();
+      std::stringstream ss(value);
+      std::string item;
+      while (std::getline(ss, item, ',')) {
+        opts.rates.push_back(std::stod(item));
+      }
+    } else if (key == "--duration") {
+      opts.duration = std::stod(value);
+    } else if (key == "--port") {
+      opts.port = std::stoi(value);
+    } else if (key == "--label") {
+      opts.label = value;
+    } else if (key == "--output") {
+      opts.output = value;
+    } else {
+      std::cerr << "Unknown argument: " << key << std::endl;
+      std::cerr << "Usage: " << args[0] <<
+        " [--rates 100,500,...] [--duration sec] [--port base] [--label str] [--output file]" <<
+        std::endl;
+      std::exit(1);
+    }
+  }
+
+  return opts;
+}
+
+}  // namespace
+
+int main(int argc, char * argv[])
+{
+  auto args = rclcpp::init_and_remove_ros_arguments(argc, argv);
+  auto opts = parse_args(args);
+
+  std::ofstream out_file;
+  if (!opts.output.empty()) {
+    out_file.open(opts.output, std::ios::app);
+  }
+  std::ostream & out = opts.output.empty() ? std::cout : out_file;
+
+  const auto fcu_url = format("udp://127.0.0.1:%d@127.0.0.1:%d", opts.port, opts.port + 1);
+  const auto sim_url = format("udp://127.0.0.1:%d@127.0.0.1:%d", opts.port + 1, opts.port);
+
+  // -*- simulated FCU -*-
+  SampleRing rx_ring, tx_ring;
+
+  auto fcu = mavconn::sim::SimFCU::open_url(sim_url, 1, 1);
+  fcu->set_message_hook(
+    [&](const mavlink::mavlink_message_t * mmsg) {
+      if (mmsg->msgid != mavlink::common::msg::MANUAL_CONTROL::MSG_ID) {
+        return;
+      }
+
+      mavlink::common::msg::MANUAL_CONTROL mc{};
+      mavlink::MsgMap map(mmsg);
+      mc.deserialize(map);
+      tx_ring.receive(mc.x);
+    });
+  fcu->start();
+
+  // -*- mavros -*-
+  rclcpp::executors::MultiThreadedExecutor exec(rclcpp::ExecutorOptions(), 2);
+
+  auto router = std::make_shared<mavros::router::Router>("mavros_router");
+  exec.add_node(router);
+  router->set_parameters(
+    {
+      rclcpp::Parameter("fcu_urls", std::vector<std::string>{fcu_url}),
+      rclcpp::Parameter("uas_urls", std::vector<std::string>{"/uas1"}),
+    });
+
+  auto uas_options = rclcpp::NodeOptions().parameter_overrides(
+    {
+      {"plugin_allowlist", std::vector<std::string>{"imu", "manual_control"}},
+    });
+  auto uas = std::make_shared<mavros::uas::UAS>(uas_options, "mavros", "/uas1", 1, 1);
+  exec.add_node(uas);
+
+  // -*- probe node -*-
+  auto probe = std::make_shared<rclcpp::Node>("mavros_bench_probe");
+  exec.add_node(probe);
+
+  auto temp_sub = probe->create_subscription<sensor_msgs::msg::Temperature>(
+    "/mavros/imu/temperature_imu", rclcpp::SensorDataQoS(),
+    [&](const sensor_msgs::msg::Temperature::SharedPtr msg) {
+      rx_ring.receive(static_cast<uint16_t>(msg->temperature));
+    });
+  auto mc_pub = probe->create_publisher<mavros_msgs::msg::ManualControl>(
+    "/mavros/manual_control/send", 10);
+
+  std::thread spin_thd([&]() {exec.spin();});
+
+  // wait for plugins to load and link to warm up
+  std::this_thread::sleep_for(3s);
+
+  auto report = [&](const char * direction, double rate, size_t sent,
+      std::vector<int64_t> lat, int64_t cpu_ns) {
+      std::sort(lat.begin(), lat.end());
+
+      out << format(
+        "{\"label\": \"%s\", \"direction\": \"%s\", \"rate_hz\": %.1f, \"sent\": %zu, "
+        "\"received\": %zu, \"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, "
+        "\"max_us\": %.1f, \"cpu_us_per_msg\": %.2f}",
+        opts.label.c_str(), direction, rate, sent, lat.size(),
+        percentile_us(lat, 0.50), percentile_us(lat, 0.99), percentile_us(lat, 0.999),
+        lat.empty() ? 0.0 : lat.back() / 1e3,
+        lat.empty() ? 0.0 : cpu_ns / 1e3 / lat.size()) << std::endl;
+    };
+
+  const auto run_for = std::chrono::duration<double>(opts.duration);
+
+  for (auto rate : opts.rates) {
+    // -*- rx: FCU -> topic -*-
+    rx_ring.take();
+    auto cpu_start = process_cpu_ns();
+    fcu->add_stream(
+      mavlink::common::msg::HIGHRES_IMU::MSG_ID, rate,
+      [&](uint64_t time_boot_us) {
+        mavlink::common::msg::HIGHRES_IMU imu{};
+        imu.time_usec = time_boot_us;
+        imu.zacc = -9.81;
+        imu.fields_updated = 1 << 12;   // temperature only
+        imu.temperature = rx_ring.mark();
+        fcu->send_message(imu);
+      });
+    std::this_thread::sleep_for(run_for);
+    fcu->add_stream(mavlink::common::msg::HIGHRES_IMU::MSG_ID, 0.0, nullptr);
+    std::this_thread::sleep_for(200ms);
+
+    auto rx_sent = rx_ring.sent();
+    report("rx", rate, rx_sent, rx_ring.take(), process_cpu_ns() - cpu_start);
+
+    // -*- tx: topic -> FCU -*-
+    tx_ring.take();
+    cpu_start = process_cpu_ns();
+    const auto period = std::chrono::duration_cast<clock_type::duration>(
+      std::chrono::duration<double>(1.0 / rate));
+    const auto deadline = clock_type::now() + run_for;
+    for (auto next = clock_type::now(); next < deadline; next += period) {
+      std::this_thread::sleep_until(next);
+
+      mavros_msgs::msg::ManualControl mc{};
+      mc.x = tx_ring.mark();
+      mc_pub->publish(mc);
+    }
+    std::this_thread::sleep_for(200ms);
+
+    auto tx_sent = tx_ring.sent();
+    report("tx", rate, tx_sent, tx_ring.take(), process_cpu_ns() - cpu_start);
+  }
+
+  fcu->stop();
+  exec.cancel();
+  spin_thd.join();
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief Buffered asynchronous file writer
+ * @file async_file_writer.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+
+#pragma once
+
+#ifndef MAVROS__ASYNC_FILE_WRITER_HPP_
+#define MAVROS__ASYNC_FILE_WRITER_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mavros
+{
+namespace utils
+{
+
+/**
+ * @brief Append-only file written by a background thread
+ *
+ * write() copies data into the front buffer and returns. Writer thread swaps
+ * buffers when front one reaches @a buffer_size or every @a flush_period,
+ * then writes and flushes the batch, so the caller never waits for disk.
+ *
+ * While a batch is being written the front buffer keeps growing past
+ * @a buffer_size. If the batch in flight plus the front buffer would exceed
+ * @a max_queued bytes, whole write() calls are dropped, so a caller which
+ * passes complete records keeps file parsable.
+ */
+class AsyncFileWriter
+{
+public:
+  struct Stats
+  {
+    size_t bytes_written;
+    size_t bytes_dropped;
+    size_t batches;
+    size_t errors;
+    size_t max_queued;        //!< peak of queued and in flight data [B]
+  };
+
+  explicit AsyncFileWriter(
+    size_t buffer_size_ = 1 << 20,
+    size_t max_queued_ = 64 << 20,
+    std::chrono::milliseconds flush_period_ = std::chrono::milliseconds(100))
+  : buffer_size(buffer_size_),
+    max_queued(max_queued_),
+    flush_period(flush_period_),
+    file(nullptr),
+    in_flight(0),
+    stop_request(false),
+    stats{}
+  {}
+
+  ~AsyncFileWriter()
+  {
+    close();
+  }
+
+  AsyncFileWriter(const AsyncFileWriter &) = delete;
+  AsyncFileWriter & operator=(const AsyncFileWriter &) = delete;
+
+  /**
+   * @brief Create (truncate) file and start writer thread
+   *
+   * Previously opened file is closed first.
+   * @return false if file can not be created
+   */
+  bool open(const std::string & path)
+  {
+    close();
+
+    FILE * f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file = f;
+    file_name = path;
+    stop_request = false;
+    stats = Stats{};
+    front.clear();
+    front.reserve(buffer_size);
+    writer_thread = std::thread(&AsyncFileWriter::run, this);
+    return true;
+  }
+
+  //! Write out everything queued, stop writer thread and close file
+  void close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!writer_thread.joinable()) {
+        return;
+      }
+
+      stop_request = true;
+      cond.notify_all();
+    }
+
+    writer_thread.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fclose(file);
+    file = nullptr;
+  }
+
+  bool is_open()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return file != nullptr;
+  }
+
+  std::string get_file_name()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return file_name;
+  }
+
+  /**
+   * @brief Queue data for writing. Thread-safe, does not block on IO.
+   * @return false if file is not open or data was dropped
+   */
+  bool write(const void * data, size_t size)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file == nullptr || stop_request) {
+      return false;
+    }
+
+    const size_t queued = in_flight + front.size() + size;
+    if (queued > max_queued) {
+      stats.bytes_dropped += size;
+      return false;
+    }
+
+    auto p = static_cast<const uint8_t *>(data);
+    front.insert(front.end(), p, p + size);
+    stats.max_queued = std::max(stats.max_queued, queued);
+
+    // writer sleeps until front buffer is full, so only wake it on that edge
+    if (front.size() >= buffer_size && front.size() - size < buffer_size) {
+      cond.notify_one();
+    }
+
+    return true;
+  }
+
+  Stats get_stats()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+  }
+
+private:
+  const size_t buffer_size;
+  const size_t max_queued;
+  const std::chrono::milliseconds flush_period;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::thread writer_thread;
+
+  FILE * file;
+  std::string file_name;
+  std::vector<uint8_t> front;
+  size_t in_flight;               //!< size of the batch being written
+  bool stop_request;
+  Stats stats;
+
+  void run()
+  {
+    std::vector<uint8_t> back;
+    back.reserve(buffer_size);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      cond.wait_for(
+        lock, flush_period, [this]() {
+          return stop_request || front.size() >= buffer_size;
+        });
+
+      if (front.empty()) {
+        if (stop_request) {
+          break;
+        }
+        continue;
+      }
+
+      back.swap(front);
+      in_flight = back.size();
+      lock.unlock();
+
+      const bool ok = std::fwrite(back.data(), 1, back.size(), file) == back.size() &&
+        std::fflush(file) == 0;
+      const size_t batch_size = back.size();
+      back.clear();
+
+      lock.lock();
+      in_flight = 0;
+      stats.batches++;
+      if (ok) {
+        stats.bytes_written += batch_size;
+      } else {
+        stats.bytes_dropped += batch_size;
+        stats.errors++;
+      }
+    }
+  }
+};
+
+}  // namespace utils
+}  // namespace mavros
+
+#endif  // MAVROS__ASYNC_FILE_WRITER_HPP_
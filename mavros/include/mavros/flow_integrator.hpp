@@ -0,0 +1,182 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief Optical flow integrator
+ * @file flow_integrator.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+
+#pragma once
+
+#ifndef MAVROS__FLOW_INTEGRATOR_HPP_
+#define MAVROS__FLOW_INTEGRATOR_HPP_
+
+#include <cstdint>
+
+#include "mavconn/mavlink_dialect.hpp"
+
+namespace mavros
+{
+namespace utils
+{
+
+/**
+ * @brief Accumulates high rate OPTICAL_FLOW_RAD samples into longer windows
+ *
+ * Flow and gyro integrals are summed only over samples with usable quality,
+ * so their ratio (and integration_time_us) stays consistent.
+ * Output quality is time-weighted over the whole window,
+ * so rejected samples lower it proportionally.
+ * If the whole window is rejected, output has zero quality and only gyro integrals.
+ *
+ * Output time_usec is the end of the last sample, distance is the latest valid one
+ * with time_delta_distance_us referred to the output time.
+ */
+class FlowIntegrator
+{
+public:
+  using OPTICAL_FLOW_RAD = mavlink::common::msg::OPTICAL_FLOW_RAD;
+
+  explicit FlowIntegrator(uint32_t window_us_ = 50000, uint8_t min_quality_ = 1)
+  : window_us(window_us_),
+    min_quality(min_quality_)
+  {
+    reset();
+  }
+
+  void set_window(uint32_t window_us_)
+  {
+    window_us = window_us_;
+  }
+
+  uint32_t get_window() const
+  {
+    return window_us;
+  }
+
+  void set_min_quality(uint8_t min_quality_)
+  {
+    min_quality = min_quality_;
+  }
+
+  //! Drop accumulated data
+  void reset()
+  {
+    n_samples = 0;
+    all_time_us = 0;
+    valid_time_us = 0;
+    quality_sum = 0;
+    flow_x = flow_y = 0.0f;
+    gyro_x = gyro_y = gyro_z = 0.0f;
+    all_gyro_x = all_gyro_y = all_gyro_z = 0.0f;
+    last_time_usec = 0;
+    has_distance = false;
+  }
+
+  /**
+   * @brief Add sample
+   * @param[out] out  integrated sample, valid if true returned
+   * @return true if window is complete
+   */
+  bool add(const OPTICAL_FLOW_RAD & in, OPTICAL_FLOW_RAD & out)
+  {
+    n_samples++;
+    all_time_us += in.integration_time_us;
+    all_gyro_x += in.integrated_xgyro;
+    all_gyro_y += in.integrated_ygyro;
+    all_gyro_z += in.integrated_zgyro;
+
+    if (in.quality >= min_quality && in.integration_time_us > 0) {
+      valid_time_us += in.integration_time_us;
+      quality_sum += uint64_t(in.quality) * in.integration_time_us;
+      flow_x += in.integrated_x;
+      flow_y += in.integrated_y;
+      gyro_x += in.integrated_xgyro;
+      gyro_y += in.integrated_ygyro;
+      gyro_z += in.integrated_zgyro;
+    }
+
+    if (in.distance > 0.0f) {
+      has_distance = true;
+      distance = in.distance;
+      distance_time_usec = in.time_usec - in.time_delta_distance_us;
+    }
+
+    last_time_usec = in.time_usec;
+    sensor_id = in.sensor_id;
+    temperature = in.temperature;
+
+    // close window nearest to the target length
+    if (all_time_us + in.integration_time_us / 2 < window_us) {
+      return false;
+    }
+
+    make_output(out);
+    reset();
+    return true;
+  }
+
+private:
+  uint32_t window_us;
+  uint8_t min_quality;
+
+  size_t n_samples;
+  uint64_t all_time_us;
+  uint64_t valid_time_us;
+  uint64_t quality_sum;         //!< sum of quality * integration time of valid samples
+  float flow_x, flow_y;
+  float gyro_x, gyro_y, gyro_z;
+  float all_gyro_x, all_gyro_y, all_gyro_z;
+
+  uint64_t last_time_usec;
+  uint8_t sensor_id;
+  int16_t temperature;
+
+  bool has_distance;
+  float distance;
+  uint64_t distance_time_usec;
+
+  void make_output(OPTICAL_FLOW_RAD & out) const
+  {
+    out = {};
+    out.time_usec = last_time_usec;
+    out.sensor_id = sensor_id;
+    out.temperature = temperature;
+
+    if (valid_time_us > 0) {
+      out.integration_time_us = valid_time_us;
+      out.integrated_x = flow_x;
+      out.integrated_y = flow_y;
+      out.integrated_xgyro = gyro_x;
+      out.integrated_ygyro = gyro_y;
+      out.integrated_zgyro = gyro_z;
+      out.quality = (quality_sum + all_time_us / 2) / all_time_us;
+    } else {
+      out.integration_time_us = all_time_us;
+      out.integrated_xgyro = all_gyro_x;
+      out.integrated_ygyro = all_gyro_y;
+      out.integrated_zgyro = all_gyro_z;
+      out.quality = 0;
+    }
+
+    if (has_distance) {
+      out.distance = distance;
+      out.time_delta_distance_us = last_time_usec - distance_time_usec;
+    } else {
+      out.distance = -1.0f;     // PX4Flow reports no valid distance as negative
+    }
+  }
+};
+
+}  // namespace utils
+}  // namespace mavros
+
+#endif  // MAVROS__FLOW_INTEGRATOR_HPP_
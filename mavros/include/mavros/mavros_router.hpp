@@ -32,6 +32,8 @@
 
 #include "mavconn/interface.hpp"
 #include "mavconn/mavlink_dialect.hpp"
+#include "mavros/metrics.hpp"
+#include "mavros/recorder.hpp"
 #include "mavros/utils.hpp"
 #include "rclcpp/macros.hpp"
 #include "rclcpp/rclcpp.hpp"
@@ -109,8 +111,18 @@ public:
     id_t src_id = 0) = 0;
   virtual void recv_message(const mavlink_message_t * msg, const Framing framing = Framing::ok);
 
+  //! Link feedback (RADIO_STATUS) received from that endpoint
+  virtual void radio_status(const mavlink_message_t * msg [[maybe_unused]]) {}
+  //! Stop acting on link feedback
+  virtual void radio_status_reset() {}
+
   virtual std::string diag_name();
   virtual void diag_run(diagnostic_updater::DiagnosticStatusWrapper & stat) = 0;
+
+  //! Update endpoint metrics, called on scrape
+  virtual void metrics_run(metrics::Registry & registry [[maybe_unused]]) {}
+  //! Drop endpoint metrics on removal
+  virtual void metrics_remove(metrics::Registry & registry [[maybe_unused]]) {}
 };
 
 /**
@@ -147,15 +159,32 @@ public:
   : rclcpp::Node(node_name,
       options /* rclcpp::NodeOptions(options).use_intra_process_comms(true) */),
     endpoints{}, stat_msg_routed(0), stat_msg_sent(0), stat_msg_dropped(0),
+    radio_shaping(false),
+    metrics_collector_id(0),
     diagnostic_updater(this, 1.0)
   {
     RCLCPP_DEBUG(this->get_logger(), "Start mavros::router::Router initialization...");
 
+    setup_metrics();
+
     set_parameters_handle_ptr =
       this->add_on_set_parameters_callback(std::bind(&Router::on_set_parameters_cb, this, _1));
     this->declare_parameter<StrV>("fcu_urls", StrV());
     this->declare_parameter<StrV>("gcs_urls", StrV());
     this->declare_parameter<StrV>("uas_urls", StrV());
+    this->declare_parameter<bool>("radio_shaping", false);
+
+    // NOTE: recorder.path declared last, so recorder starts once with all options
+    this->declare_parameter<bool>("recorder.compress", false);
+    this->declare_parameter<int>("recorder.chunk_size", 1 << 20);
+    this->declare_parameter<int>("recorder.max_file_size", 0);
+    this->declare_parameter<int>("recorder.max_file_duration", 0);
+    this->declare_parameter<int>("recorder.queue_size", 8192);
+    this->declare_parameter<std::string>("recorder.path", "");
+
+    // NOTE: metrics_address declared before port, exporter starts on port change
+    this->declare_parameter<std::string>("metrics_address", "127.0.0.1");
+    this->declare_parameter<int>("metrics_port", 0);
 
     add_service = this->create_service<mavros_msgs::srv::EndpointAdd>(
       "~/add_endpoint",
@@ -186,11 +215,14 @@ public:
     RCLCPP_INFO(get_logger(), "MAVROS Router started");
   }
 
+  ~Router();
+
   void route_message(Endpoint::SharedPtr src, const mavlink_message_t * msg, const Framing framing);
 
 private:
   friend class Endpoint;
   friend class TestRouter;
+  friend class BenchRouter;
 
   static std::atomic<id_t> id_counter;
 
@@ -203,6 +235,19 @@ private:
   std::atomic<size_t> stat_msg_sent;        //!< amount of messages sent
   std::atomic<size_t> stat_msg_dropped;     //!< amount of messages dropped
 
+  std::atomic<bool> radio_shaping;          //!< feed RADIO_STATUS to endpoint tx shaper
+
+  Recorder::Options recorder_options;
+  Recorder::UniquePtr recorder;             //!< protected by mu
+
+  metrics::Counter::SharedPtr metric_msg_routed;
+  metrics::Counter::SharedPtr metric_msg_sent;
+  metrics::Counter::SharedPtr metric_msg_dropped;
+  metrics::Histogram::SharedPtr metric_route_latency;
+  size_t metrics_collector_id;
+  std::string metrics_address;
+  metrics::Exporter::UniquePtr metrics_exporter;
+
   rclcpp::Service<mavros_msgs::srv::EndpointAdd>::SharedPtr add_service;
   rclcpp::Service<mavros_msgs::srv::EndpointDel>::SharedPtr del_service;
   rclcpp::TimerBase::SharedPtr reconnect_timer;
@@ -219,6 +264,10 @@ private:
 
   void periodic_reconnect_endpoints();
   void periodic_clear_stale_remote_addrs();
+  void restart_recorder();
+  void setup_metrics();
+  void restart_metrics_exporter(int port);
+  void metrics_run(metrics::Registry & registry);
 
   rcl_interfaces::msg::SetParametersResult on_set_parameters_cb(
     const std::vector<rclcpp::Parameter> & parameters);
@@ -240,7 +289,8 @@ class MAVConnEndpoint : public Endpoint
 public:
   MAVConnEndpoint()
   : Endpoint(),
-    stat_last_drop_count(0)
+    stat_last_drop_count(0),
+    shaper(std::make_shared<mavconn::TxShaper>())
   {}
 
   ~MAVConnEndpoint()
@@ -250,6 +300,7 @@ public:
 
   mavconn::MAVConnInterface::Ptr link;       // connection
   size_t stat_last_drop_count;
+  mavconn::TxShaper::Ptr shaper;             // tx admission, inactive until radio_status()
 
   bool is_open() override;
   std::pair<bool, std::string> open() override;
@@ -259,7 +310,12 @@ public:
     const mavlink_message_t * msg, const Framing framing = Framing::ok,
     id_t src_id = 0) override;
 
+  void radio_status(const mavlink_message_t * msg) override;
+  void radio_status_reset() override;
+
   void diag_run(diagnostic_updater::DiagnosticStatusWrapper & stat) override;
+  void metrics_run(metrics::Registry & registry) override;
+  void metrics_remove(metrics::Registry & registry) override;
 };
 
 /**
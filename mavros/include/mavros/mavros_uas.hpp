@@ -30,6 +30,7 @@
 #include <memory>
 #include <type_traits>
 #include <string>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
@@ -42,8 +43,10 @@
 #include "sensor_msgs/msg/nav_sat_fix.hpp"
 
 #include "mavros/utils.hpp"
+#include "mavros/metrics.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/frame_tf.hpp"
+#include "mavros/seqlock.hpp"
 
 namespace mavros
 {
@@ -64,6 +67,60 @@ using MAV_STATE = mavlink::minimal::MAV_STATE;
 using MAV_CAP = mavlink::common::MAV_PROTOCOL_CAPABILITY;
 using timesync_mode = utils::timesync_mode;
 
+/**
+ * @brief Aggregated vehicle state
+ *
+ * Filled by the plugins handling related messages, so clients may get
+ * consistent state from one place. Each group has stamp of its last update
+ * in nanoseconds of ROS time, zero if that group never was received.
+ */
+struct VehicleSnapshot
+{
+  // HEARTBEAT
+  int64_t state_stamp_ns;
+  bool connected;
+  bool armed;
+  bool guided;
+  bool manual_input;
+  uint8_t base_mode;
+  uint32_t custom_mode;
+  uint8_t system_status;
+
+  // EXTENDED_SYS_STATE
+  int64_t extended_state_stamp_ns;
+  uint8_t vtol_state;
+  uint8_t landed_state;
+
+  // SYS_STATUS or BATTERY_STATUS
+  int64_t battery_stamp_ns;
+  float battery_voltage;          //!< [V]
+  float battery_current;          //!< [A], NaN if unknown
+  float battery_percentage;       //!< [0..1], NaN if unknown
+
+  // ESTIMATOR_STATUS
+  int64_t estimator_stamp_ns;
+  uint16_t estimator_flags;
+
+  // GLOBAL_POSITION_INT
+  int64_t global_stamp_ns;
+  double latitude;
+  double longitude;
+  double altitude;                //!< height above ellipsoid [m]
+  float relative_altitude;        //!< [m]
+  float heading;                  //!< compass heading [deg], NaN if unknown
+
+  // LOCAL_POSITION_NED [ENU]
+  int64_t local_stamp_ns;
+  float local_position[3];
+  float local_velocity[3];
+
+  // HOME_POSITION
+  int64_t home_stamp_ns;
+  double home_latitude;
+  double home_longitude;
+  double home_altitude;           //!< height above ellipsoid [m]
+};
+
 
 /**
  * @brief UAS Node data
@@ -73,6 +130,7 @@ using timesync_mode = utils::timesync_mode;
  * Currently it stores:
  * - IMU data (@a mavplugin::IMUPubPlugin)
  * - GPS data (@a mavplugin::GPSPlugin)
+ * - Aggregated vehicle state (@a VehicleSnapshot)
  */
 class Data
 {
@@ -143,6 +201,35 @@ public:
   //! Retunrs last GPS RAW message
   sensor_msgs::msg::NavSatFix get_gps_fix();
 
+  /* -*- Vehicle snapshot -*- */
+
+  /**
+   * @brief Update part of aggregated vehicle state
+   *
+   * @a fn receives current snapshot and should change only its own group.
+   */
+  template<typename Fn>
+  void update_snapshot(Fn && fn)
+  {
+    vehicle_snapshot.update(std::forward<Fn>(fn));
+  }
+
+  /**
+   * @brief Get consistent copy of aggregated vehicle state
+   *
+   * Lock-free, never delays plugins updating it.
+   * @param[out] version  number of updates done, may be used to skip unchanged state
+   */
+  VehicleSnapshot get_snapshot(uint64_t & version) const
+  {
+    return vehicle_snapshot.load(version);
+  }
+
+  VehicleSnapshot get_snapshot() const
+  {
+    return vehicle_snapshot.load();
+  }
+
   /* -*- GograpticLib utils -*- */
 
   /**
@@ -204,6 +291,8 @@ private:
   int gps_fix_type;
   int gps_satellites_visible;
 
+  utils::SeqLock<VehicleSnapshot> vehicle_snapshot;
+
   //! init_geographiclib() once flag
   static std::once_flag init_flag;
 
@@ -560,6 +649,7 @@ public:
 
 private:
   friend class TestUAS;
+  friend class BenchUAS;
 
   // params
   uint8_t source_system;
@@ -586,6 +676,8 @@ private:
 
   //! UAS link -> router -> plugin handler
   std::unordered_map<mavlink::msgid_t, plugin::Plugin::Subscriptions> plugin_subscriptions;
+  //! time spent in all handlers of a message
+  std::unordered_map<mavlink::msgid_t, metrics::Histogram::SharedPtr> plugin_metrics;
 
   std::shared_timed_mutex mu;
 
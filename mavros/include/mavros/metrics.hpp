@@ -0,0 +1,264 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief Typed metrics registry and OpenMetrics exporter
+ * @file metrics.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+
+#pragma once
+
+#ifndef MAVROS__METRICS_HPP_
+#define MAVROS__METRICS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rclcpp/logger.hpp"
+
+namespace mavros
+{
+namespace metrics
+{
+
+//! Label name-value pairs, order is preserved in output
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * Monotonic counter. Hot path is a single relaxed atomic add.
+ */
+class Counter
+{
+public:
+  using SharedPtr = std::shared_ptr<Counter>;
+
+  Counter()
+  : value(0) {}
+
+  inline void inc(uint64_t n = 1)
+  {
+    value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  //! Mirror external monotonic counter, used by collectors
+  inline void set(uint64_t v)
+  {
+    value.store(v, std::memory_order_relaxed);
+  }
+
+  inline uint64_t get() const
+  {
+    return value.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> value;
+};
+
+/**
+ * Value which could go up and down
+ */
+class Gauge
+{
+public:
+  using SharedPtr = std::shared_ptr<Gauge>;
+
+  Gauge()
+  : value(0.0) {}
+
+  inline void set(double v)
+  {
+    value.store(v, std::memory_order_relaxed);
+  }
+
+  void add(double v);
+
+  inline double get() const
+  {
+    return value.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<double> value;
+};
+
+/**
+ * Histogram with fixed upper bucket bounds
+ */
+class Histogram
+{
+public:
+  using SharedPtr = std::shared_ptr<Histogram>;
+
+  //! Bucket upper bounds, must be sorted, +Inf bucket is implicit
+  explicit Histogram(const std::vector<double> & bounds);
+
+  void observe(double v);
+
+  //! Observe duration in seconds
+  template<typename Rep, typename Period>
+  inline void observe(const std::chrono::duration<Rep, Period> & d)
+  {
+    observe(std::chrono::duration<double>(d).count());
+  }
+
+  inline const std::vector<double> & get_bounds() const
+  {
+    return bounds;
+  }
+
+  //! Non-cumulative bucket counts, last one is +Inf
+  std::vector<uint64_t> get_buckets() const;
+
+  inline uint64_t get_count() const
+  {
+    return count.load(std::memory_order_relaxed);
+  }
+
+  inline double get_sum() const
+  {
+    return sum.load(std::memory_order_relaxed);
+  }
+
+  //! Default latency buckets: 1 us .. 100 ms
+  static std::vector<double> latency_bounds();
+
+private:
+  const std::vector<double> bounds;
+  std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+  std::atomic<uint64_t> count;
+  std::atomic<double> sum;
+};
+
+/**
+ * Metrics registry
+ *
+ * Metric objects are created once (get-or-create by name and labels) and then
+ * updated lock-free from any thread. Text is formatted only on scrape.
+ *
+ * Collectors are called before each scrape to refresh values which
+ * are kept elsewhere (e.g. libmavconn link statistics).
+ */
+class Registry
+{
+public:
+  using CollectorCb = std::function<void (Registry &)>;
+
+  Registry();
+
+  Registry(const Registry &) = delete;
+  Registry & operator=(const Registry &) = delete;
+
+  //! Process-wide registry shared by router, UAS and plugins
+  static Registry & global();
+
+  Counter::SharedPtr counter(
+    const std::string & name, const std::string & help,
+    const Labels & labels = {});
+  Gauge::SharedPtr gauge(
+    const std::string & name, const std::string & help,
+    const Labels & labels = {});
+  Histogram::SharedPtr histogram(
+    const std::string & name, const std::string & help,
+    const std::vector<double> & bounds, const Labels & labels = {});
+
+  //! Drop one labeled metric, e.g. of removed endpoint
+  void remove(const std::string & name, const Labels & labels);
+
+  size_t add_collector(CollectorCb cb);
+  /**
+   * Remove collector, waits for its run in progress to finish.
+   * Must not be called from a collector or with a lock that collector takes.
+   */
+  void remove_collector(size_t id);
+
+  //! Run collectors and format all metrics in OpenMetrics text format
+  std::string serialize();
+
+private:
+  enum class Type
+  {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM,
+  };
+
+  struct Family
+  {
+    Type type;
+    std::string help;
+    std::map<Labels, std::shared_ptr<void>> metrics;
+  };
+
+  std::mutex mutex;
+  std::map<std::string, Family> families;
+
+  //! held while collectors run, separate from mutex as collectors create and update metrics
+  std::mutex collectors_mutex;
+  std::map<size_t, CollectorCb> collectors;
+  size_t collector_id;
+
+  template<typename T>
+  std::shared_ptr<T> get_or_create(
+    Type type, const std::string & name, const std::string & help,
+    const Labels & labels, std::function<std::shared_ptr<T>()> factory);
+};
+
+/**
+ * Minimal HTTP server which serves Registry at GET /metrics
+ */
+class Exporter
+{
+public:
+  using UniquePtr = std::unique_ptr<Exporter>;
+
+  /**
+   * Bind and start serving thread
+   * @throws std::system_error if socket can not be bound
+   */
+  Exporter(
+    Registry & registry, uint16_t port, const std::string & bind_address,
+    rclcpp::Logger logger);
+  ~Exporter();
+
+  Exporter(const Exporter &) = delete;
+  Exporter & operator=(const Exporter &) = delete;
+
+  inline uint16_t get_port() const
+  {
+    return port;
+  }
+
+private:
+  Registry & registry;
+  uint16_t port;
+  rclcpp::Logger logger;
+  int listen_fd;
+  std::atomic<bool> stop_request;
+  std::thread server_thread;
+
+  void run();
+  void handle_client(int fd);
+};
+
+}  // namespace metrics
+}  // namespace mavros
+
+#endif  // MAVROS__METRICS_HPP_
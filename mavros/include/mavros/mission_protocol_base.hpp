@@ -30,6 +30,7 @@
 
 #include "rcpputils/asserts.hpp"
 #include "mavros/mavros_uas.hpp"
+#include "mavros/metrics.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/plugin_filter.hpp"
 
@@ -298,6 +299,18 @@ public:
   {
     timeout_timer = node->create_wall_timer(WP_TIMEOUT, std::bind(&MissionBase::timeout_cb, this));
     timeout_timer->cancel();
+
+    auto & registry = metrics::Registry::global();
+    const metrics::Labels labels{
+      {"uas", uas->get_fully_qualified_name()},
+      {"mission", log_prefix},
+    };
+    metric_items_received = registry.counter(
+      "mavros_mission_items_received", "Mission items received", labels);
+    metric_items_sent = registry.counter(
+      "mavros_mission_items_sent", "Mission items sent", labels);
+    metric_timeouts = registry.counter(
+      "mavros_mission_timeouts", "Mission transfer timeouts", labels);
   }
 
   Subscriptions get_subscriptions() override
@@ -361,6 +374,10 @@ protected:
   std::condition_variable list_sending;
 
   rclcpp::TimerBase::SharedPtr timeout_timer;
+
+  metrics::Counter::SharedPtr metric_items_received;
+  metrics::Counter::SharedPtr metric_items_sent;
+  metrics::Counter::SharedPtr metric_timeouts;
   rclcpp::TimerBase::SharedPtr schedule_timer;
 
   bool reschedule_pull;
@@ -583,6 +600,7 @@ protected:
 
       RCLCPP_DEBUG_STREAM(get_logger(), log_prefix << ": send item " << wp_msg);
       mission_send(wpi);
+      metric_items_sent->inc();
     }
   }
 
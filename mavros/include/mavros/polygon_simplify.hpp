@@ -0,0 +1,137 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief Polygon simplification
+ * @file polygon_simplify.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+
+#pragma once
+
+#ifndef MAVROS__POLYGON_SIMPLIFY_HPP_
+#define MAVROS__POLYGON_SIMPLIFY_HPP_
+
+#include <Eigen/Eigen>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace mavros
+{
+namespace utils
+{
+
+/**
+ * @brief Distance from point p to segment ab
+ */
+inline double point_segment_distance(
+  const Eigen::Vector2d & p, const Eigen::Vector2d & a,
+  const Eigen::Vector2d & b)
+{
+  const Eigen::Vector2d ab = b - a;
+  const double len2 = ab.squaredNorm();
+  if (len2 == 0.0) {
+    return (p - a).norm();
+  }
+
+  const double t = std::clamp((p - a).dot(ab) / len2, 0.0, 1.0);
+  return (p - (a + t * ab)).norm();
+}
+
+/**
+ * @brief Simplify closed polygon with Douglas-Peucker algorithm
+ *
+ * Polygon is split at the first vertex and the vertex farthest from it,
+ * then both chains are simplified, so every removed vertex is within tolerance
+ * of the resulting outline. At least 3 vertices are kept.
+ *
+ * @param points     polygon vertices in a metric frame, without closing duplicate
+ * @param tolerance  max allowed deviation
+ * @return indices of kept vertices in original order
+ */
+inline std::vector<size_t> simplify_polygon(
+  const std::vector<Eigen::Vector2d> & points,
+  double tolerance)
+{
+  const size_t n = points.size();
+  std::vector<size_t> kept;
+
+  if (n <= 3 || !(tolerance > 0.0)) {
+    kept.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      kept[i] = i;
+    }
+    return kept;
+  }
+
+  size_t far = 1;
+  for (size_t i = 2; i < n; i++) {
+    if ((points[i] - points[0]).squaredNorm() > (points[far] - points[0]).squaredNorm()) {
+      far = i;
+    }
+  }
+
+  std::vector<bool> keep(n, false);
+  keep[0] = keep[far] = true;
+
+  // iterative to bound stack use on large fences, index n is vertex 0 closing the ring
+  std::vector<std::pair<size_t, size_t>> stack{{0, far}, {far, n}};
+  auto pt = [&](size_t i) -> const Eigen::Vector2d & {return points[i % n];};
+
+  while (!stack.empty()) {
+    auto [first, last] = stack.back();
+    stack.pop_back();
+
+    double max_dist = 0.0;
+    size_t max_idx = first;
+    for (size_t i = first + 1; i < last; i++) {
+      const double d = point_segment_distance(pt(i), pt(first), pt(last));
+      if (d > max_dist) {
+        max_dist = d;
+        max_idx = i;
+      }
+    }
+
+    if (max_dist > tolerance) {
+      keep[max_idx] = true;
+      stack.emplace_back(first, max_idx);
+      stack.emplace_back(max_idx, last);
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    if (keep[i]) {
+      kept.push_back(i);
+    }
+  }
+
+  // degenerate (almost flat) polygon: keep most distant vertex from the base line
+  if (kept.size() < 3) {
+    size_t best = 1;
+    double best_dist = -1.0;
+    for (size_t i = 1; i < n; i++) {
+      const double d = point_segment_distance(points[i], points[0], points[far]);
+      if (i != far && d > best_dist) {
+        best_dist = d;
+        best = i;
+      }
+    }
+    kept.insert(std::upper_bound(kept.begin(), kept.end(), best), best);
+  }
+
+  return kept;
+}
+
+}  // namespace utils
+}  // namespace mavros
+
+#endif  // MAVROS__POLYGON_SIMPLIFY_HPP_
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief Constant velocity pose extrapolator
+ * @file pose_extrapolator.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+
+#pragma once
+
+#ifndef MAVROS__POSE_EXTRAPOLATOR_HPP_
+#define MAVROS__POSE_EXTRAPOLATOR_HPP_
+
+#include <Eigen/Eigen>
+#include <Eigen/Geometry>
+
+#include <algorithm>
+
+#include "rclcpp/time.hpp"
+
+namespace mavros
+{
+namespace utils
+{
+
+/**
+ * @brief Alpha-beta tracker for sparse pose measurements
+ *
+ * Smooths position and estimates velocity from timestamped detections,
+ * then predicts position at arbitrary time assuming constant velocity.
+ * Orientation is held from the last detection.
+ *
+ * Used to resample bursty detector output (e.g. vision at 5-30 Hz) to a
+ * steady rate. Prediction is refused once last detection is older than timeout.
+ */
+class PoseExtrapolator
+{
+public:
+  struct Config
+  {
+    double alpha = 0.85;        //!< position correction gain, (0, 1]
+    double beta = 0.3;          //!< velocity correction gain, (0, 2)
+    double timeout = 0.5;       //!< max age of last detection [s]
+  };
+
+  PoseExtrapolator()
+  : PoseExtrapolator(Config())
+  {}
+
+  explicit PoseExtrapolator(const Config & config_)
+  : config(config_),
+    valid(false),
+    has_velocity(false),
+    stamp(0, 0, RCL_ROS_TIME),
+    position(Eigen::Vector3d::Zero()),
+    velocity(Eigen::Vector3d::Zero()),
+    orientation(Eigen::Quaterniond::Identity())
+  {}
+
+  void set_config(const Config & config_)
+  {
+    config = config_;
+  }
+
+  const Config & get_config() const
+  {
+    return config;
+  }
+
+  /**
+   * @brief Feed new detection
+   * @return false if detection is not newer than previous one and was ignored
+   */
+  bool update(const rclcpp::Time & t, const Eigen::Vector3d & pos, const Eigen::Quaterniond & q)
+  {
+    // stamps of other clock can not be compared, start a new track
+    if (valid && t.get_clock_type() != stamp.get_clock_type()) {
+      reset();
+    }
+
+    if (valid && t <= stamp) {
+      return false;
+    }
+
+    const double dt = valid ? (t - stamp).seconds() : 0.0;
+    if (!valid || dt > config.timeout) {
+      // first detection or track lost: restart
+      position = pos;
+      velocity.setZero();
+      has_velocity = false;
+    } else if (!has_velocity) {
+      velocity = (pos - position) / dt;
+      position = pos;
+      has_velocity = true;
+    } else {
+      const Eigen::Vector3d predicted = position + velocity * dt;
+      const Eigen::Vector3d residual = pos - predicted;
+
+      position = predicted + config.alpha * residual;
+      velocity += (config.beta / dt) * residual;
+    }
+
+    valid = true;
+    stamp = t;
+    orientation = q;
+    return true;
+  }
+
+  /**
+   * @brief Predict pose at time t
+   * @return false if there is no fresh detection
+   */
+  bool predict(const rclcpp::Time & t, Eigen::Vector3d & pos, Eigen::Quaterniond & q) const
+  {
+    if (!valid || t.get_clock_type() != stamp.get_clock_type()) {
+      return false;
+    }
+
+    const double age = (t - stamp).seconds();
+    if (age > config.timeout) {
+      return false;
+    }
+
+    pos = position + velocity * std::max(age, 0.0);
+    q = orientation;
+    return true;
+  }
+
+  //! Forget track
+  void reset()
+  {
+    valid = false;
+    has_velocity = false;
+  }
+
+  bool is_valid() const
+  {
+    return valid;
+  }
+
+  const rclcpp::Time & get_stamp() const
+  {
+    return stamp;
+  }
+
+  const Eigen::Vector3d & get_velocity() const
+  {
+    return velocity;
+  }
+
+private:
+  Config config;
+
+  bool valid;
+  bool has_velocity;
+  rclcpp::Time stamp;             //!< last detection time
+  Eigen::Vector3d position;       //!< filtered position at stamp
+  Eigen::Vector3d velocity;
+  Eigen::Quaterniond orientation;
+};
+
+}  // namespace utils
+}  // namespace mavros
+
+#endif  // MAVROS__POSE_EXTRAPOLATOR_HPP_
@@ -0,0 +1,314 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief MAVLink traffic recorder
+ * @file recorder.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+
+#pragma once
+
+#ifndef MAVROS__RECORDER_HPP_
+#define MAVROS__RECORDER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "mavconn/interface.hpp"
+#include "mavconn/msgbuffer.hpp"
+#include "rclcpp/logger.hpp"
+
+namespace mavros
+{
+namespace router
+{
+
+using mavconn::Framing;
+using ::mavlink::mavlink_message_t;
+using ::mavlink::msgid_t;
+
+/**
+ * Recorder file format.
+ *
+ * All numbers are little-endian.
+ *
+ *     FileHeader
+ *     { ChunkHeader IndexEntry[index_count] data[stored_size] } ...
+ *     FooterHeader { FooterChunk IndexEntry[index_count] } ... Trailer
+ *
+ * Chunk data is a sequence of RecordHeader + raw frame, zlib-compressed if
+ * ChunkHeader::compression == 1.
+ * Footer is written on close, if it is missing chunk headers are scanned.
+ */
+namespace recfmt
+{
+
+constexpr char FILE_MAGIC[8] = {'M', 'A', 'V', 'R', 'E', 'C', '\0', '\1'};
+constexpr char CHUNK_MAGIC[4] = {'C', 'H', 'N', 'K'};
+constexpr char FOOTER_MAGIC[4] = {'F', 'I', 'D', 'X'};
+constexpr char TRAILER_MAGIC[8] = {'M', 'A', 'V', 'R', 'E', 'C', 'I', 'X'};
+constexpr uint32_t VERSION = 1;
+
+enum class Compression : uint32_t
+{
+  NONE = 0,
+  ZLIB = 1,
+};
+
+#pragma pack(push, 1)
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+};
+
+struct ChunkHeader
+{
+  char magic[4];
+  uint32_t compression;
+  uint32_t raw_size;
+  uint32_t stored_size;
+  uint64_t t_start;         //!< first record time [us]
+  uint64_t t_end;           //!< last record time [us]
+  uint32_t record_count;
+  uint32_t index_count;
+};
+
+struct IndexEntry
+{
+  uint32_t msgid;
+  uint32_t count;
+  uint64_t t_first;
+  uint64_t t_last;
+};
+
+struct RecordHeader
+{
+  uint64_t time_usec;
+  uint32_t src_id;          //!< router endpoint id
+  uint8_t framing;          //!< mavconn::Framing
+  uint8_t reserved;
+  uint16_t length;          //!< frame length
+};
+
+struct FooterHeader
+{
+  char magic[4];
+  uint32_t chunk_count;
+};
+
+struct FooterChunk
+{
+  uint64_t offset;          //!< ChunkHeader offset
+  uint64_t t_start;
+  uint64_t t_end;
+  uint32_t index_count;
+  uint32_t reserved;
+};
+
+struct Trailer
+{
+  uint64_t footer_offset;
+  char magic[8];
+};
+#pragma pack(pop)
+
+}  // namespace recfmt
+
+/**
+ * Recorder of all routed MAVLink traffic
+ *
+ * record() copies frame into a bounded ring buffer and returns,
+ * frames are dropped if buffer is full.
+ * Background thread packs frames into chunks and writes them to disk.
+ */
+class Recorder
+{
+public:
+  using SharedPtr = std::shared_ptr<Recorder>;
+  using UniquePtr = std::unique_ptr<Recorder>;
+
+  struct Options
+  {
+    std::string path_prefix;                  //!< file name prefix, may include directory
+    bool compress = false;                    //!< zlib compression of chunks
+    size_t chunk_size = 1 << 20;              //!< uncompressed chunk size [B]
+    std::chrono::milliseconds chunk_duration{1000};   //!< max chunk age before flush
+    size_t max_file_size = 0;                 //!< rotate file after [B], 0 - disabled
+    std::chrono::seconds max_file_duration{0};        //!< rotate file after, 0 - disabled
+    size_t queue_size = 8192;                 //!< ring buffer capacity [frames]
+  };
+
+  struct Stats
+  {
+    size_t recorded;
+    size_t dropped;
+    size_t bytes_written;
+    size_t chunks;
+    size_t files;
+  };
+
+  Recorder(const Options & opts, rclcpp::Logger logger);
+  ~Recorder();
+
+  Recorder(const Recorder &) = delete;
+  Recorder & operator=(const Recorder &) = delete;
+
+  /**
+   * Queue frame for writing. Thread-safe, does not block on IO.
+   */
+  void record(uint32_t src_id, const mavlink_message_t * msg, Framing framing);
+
+  Stats get_stats();
+  std::string get_current_file();
+
+  //! Current UNIX time [us] used for record timestamps
+  static uint64_t now_usec();
+
+private:
+  struct Slot
+  {
+    recfmt::RecordHeader hdr;
+    uint8_t frame[mavconn::MsgBuffer::MAX_SIZE];
+  };
+
+  Options opts;
+  rclcpp::Logger logger;
+
+  // ring buffer, head/tail are monotonic counters
+  std::vector<Slot> ring;
+  std::mutex ring_mutex;
+  std::condition_variable ring_cond;
+  size_t head;
+  size_t tail;
+  bool stop_request;
+
+  std::atomic<size_t> stat_recorded;
+  std::atomic<size_t> stat_dropped;
+  std::atomic<size_t> stat_bytes_written;
+  std::atomic<size_t> stat_chunks;
+  std::atomic<size_t> stat_files;
+
+  std::thread writer_thread;
+
+  // writer thread state
+  std::mutex file_mutex;
+  FILE * file;
+  std::string file_name;
+  size_t file_size;
+  size_t file_index;
+  std::chrono::steady_clock::time_point file_opened;
+
+  std::vector<uint8_t> chunk;
+  recfmt::ChunkHeader chunk_hdr;
+  std::unordered_map<msgid_t, recfmt::IndexEntry> chunk_index;
+  std::chrono::steady_clock::time_point chunk_started;
+
+  struct FooterEntry
+  {
+    recfmt::FooterChunk info;
+    std::vector<recfmt::IndexEntry> index;
+  };
+  std::vector<FooterEntry> footer;
+
+  void run();
+  void append(const Slot & slot);
+  void flush_chunk();
+  void open_file();
+  void close_file();
+  void write(const void * data, size_t size);
+};
+
+/**
+ * Reader for files written by Recorder
+ */
+class RecordReader
+{
+public:
+  struct Record
+  {
+    uint64_t time_usec;
+    uint32_t src_id;
+    Framing framing;
+    mavlink_message_t msg;
+  };
+
+  struct ChunkInfo
+  {
+    uint64_t offset;
+    uint64_t t_start;
+    uint64_t t_end;
+    std::vector<recfmt::IndexEntry> index;
+  };
+
+  using RecordCb = std::function<void (const Record & rec)>;
+
+  /**
+   * Open file and load chunk index
+   * @throws std::runtime_error on bad file
+   */
+  explicit RecordReader(const std::string & path);
+  ~RecordReader();
+
+  RecordReader(const RecordReader &) = delete;
+  RecordReader & operator=(const RecordReader &) = delete;
+
+  inline const std::vector<ChunkInfo> & get_chunks() const
+  {
+    return chunks;
+  }
+
+  //! true if index loaded from footer, false if chunks were scanned
+  inline bool has_footer() const
+  {
+    return footer_found;
+  }
+
+  /**
+   * Iterate records of one message id in time range [t_from, t_to].
+   * Only chunks which contain that message are read.
+   *
+   * @return number of records passed to cb
+   */
+  size_t query(msgid_t msgid, uint64_t t_from, uint64_t t_to, RecordCb cb);
+
+  //! Same as query() but collects everything
+  std::vector<Record> time_series(
+    msgid_t msgid, uint64_t t_from = 0,
+    uint64_t t_to = UINT64_MAX);
+
+  //! Iterate all records
+  size_t read_all(RecordCb cb);
+
+private:
+  FILE * file;
+  bool footer_found;
+  std::vector<ChunkInfo> chunks;
+
+  bool load_footer();
+  void scan_chunks();
+  void read_chunk(const ChunkInfo & info, std::vector<uint8_t> & data);
+};
+
+}  // namespace router
+}  // namespace mavros
+
+#endif  // MAVROS__RECORDER_HPP_
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief Sequence lock
+ * @file seqlock.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+
+#pragma once
+
+#ifndef MAVROS__SEQLOCK_HPP_
+#define MAVROS__SEQLOCK_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+namespace mavros
+{
+namespace utils
+{
+
+/**
+ * @brief Single value protected by a sequence lock
+ *
+ * Readers never take a lock and never delay writers: they copy the value and
+ * retry if a write happened meanwhile. Writers are serialized by a mutex,
+ * which is only contended between writers.
+ *
+ * Value is kept as an array of atomic words, so concurrent copy is well defined.
+ * Suited for small, frequently read state, where a reader must see
+ * all fields from the same update.
+ */
+template<typename T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock value must be trivially copyable");
+
+public:
+  SeqLock()
+  : SeqLock(T{})
+  {}
+
+  explicit SeqLock(const T & init)
+  : seq(0),
+    shadow(init)
+  {
+    store_words(init);
+  }
+
+  SeqLock(const SeqLock &) = delete;
+  SeqLock & operator=(const SeqLock &) = delete;
+
+  //! Replace whole value
+  void store(const T & value)
+  {
+    update([&](T & v) {v = value;});
+  }
+
+  /**
+   * @brief Modify value in place
+   *
+   * @a fn gets writer's copy, so fields not touched keep their last values.
+   * @a fn is called under the writer mutex and must not call into this lock.
+   */
+  template<typename Fn>
+  void update(Fn && fn)
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+
+    fn(shadow);
+
+    const auto s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    store_words(shadow);
+    seq.store(s + 2, std::memory_order_release);
+  }
+
+  //! Consistent copy of the value
+  T load() const
+  {
+    uint64_t s;
+    return load(s);
+  }
+
+  /**
+   * @brief Consistent copy of the value and its version
+   * @param[out] version  number of completed updates
+   */
+  T load(uint64_t & version) const
+  {
+    std::array<uint64_t, N_WORDS> buf;
+
+    for (;;) {
+      const auto s1 = seq.load(std::memory_order_acquire);
+      if (s1 & 1) {
+        continue;         // write in progress
+      }
+
+      for (size_t i = 0; i < N_WORDS; i++) {
+        buf[i] = words[i].load(std::memory_order_relaxed);
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq.load(std::memory_order_relaxed) == s1) {
+        version = s1 / 2;
+        break;
+      }
+    }
+
+    T value;
+    std::memcpy(&value, buf.data(), sizeof(T));
+    return value;
+  }
+
+  //! Number of completed updates
+  uint64_t version() const
+  {
+    return seq.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  static constexpr size_t N_WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<uint64_t> seq;
+  std::array<std::atomic<uint64_t>, N_WORDS> words;
+
+  std::mutex writer_mutex;
+  T shadow;             //!< writer's copy
+
+  void store_words(const T & value)
+  {
+    std::array<uint64_t, N_WORDS> buf{};
+    std::memcpy(buf.data(), &value, sizeof(T));
+
+    for (size_t i = 0; i < N_WORDS; i++) {
+      words[i].store(buf[i], std::memory_order_relaxed);
+    }
+  }
+};
+
+}  // namespace utils
+}  // namespace mavros
+
+#endif  // MAVROS__SEQLOCK_HPP_
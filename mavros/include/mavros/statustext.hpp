@@ -0,0 +1,334 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief STATUSTEXT reassembly and rosout filtering
+ * @file statustext.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+
+#pragma once
+
+#ifndef MAVROS__STATUSTEXT_HPP_
+#define MAVROS__STATUSTEXT_HPP_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mavros
+{
+namespace utils
+{
+
+/**
+ * @brief STATUSTEXT chunk reassembly
+ *
+ * MAVLink 2 splits long texts into 50 char chunks which share same non-zero id,
+ * the last chunk is the one which contains NUL.
+ * Few interleaved texts are kept in a small set of slots, incomplete texts are
+ * emitted as is when evicted or not completed in time.
+ * A slot is evicted only when all of them are in use, the least recently updated goes first.
+ *
+ * expire() should be called periodically, otherwise an incomplete text
+ * waits for the next STATUSTEXT.
+ */
+class StatusTextAssembler
+{
+public:
+  using steady_clock = std::chrono::steady_clock;
+
+  struct Text
+  {
+    uint8_t severity;
+    std::string text;
+  };
+
+  StatusTextAssembler()
+  : timeout(std::chrono::seconds(1)), ring{}
+  {}
+
+  void set_timeout(steady_clock::duration timeout_)
+  {
+    timeout = timeout_;
+  }
+
+  inline steady_clock::duration get_timeout() const
+  {
+    return timeout;
+  }
+
+  void clear()
+  {
+    for (auto & slot : ring) {
+      slot.used = false;
+    }
+  }
+
+  /**
+   * Feed one STATUSTEXT, completed (and expired) texts are appended to out
+   *
+   * @param id         STATUSTEXT.id, 0 - not chunked
+   * @param chunk_seq  STATUSTEXT.chunk_seq
+   * @param chunk      text of that message
+   * @param is_last    text field was NUL terminated
+   */
+  void push(
+    uint8_t sysid, uint8_t compid, uint8_t severity, uint16_t id, uint8_t chunk_seq,
+    std::string chunk, bool is_last, std::vector<Text> & out,
+    steady_clock::time_point now = steady_clock::now())
+  {
+    expire(now, out);
+
+    // not chunked
+    if (id == 0) {
+      out.push_back({severity, std::move(chunk)});
+      return;
+    }
+
+    auto slot = std::find_if(
+      ring.begin(), ring.end(), [&](const Slot & s) {
+        return s.used && s.sysid == sysid && s.compid == compid && s.id == id;
+      });
+
+    if (slot != ring.end() && chunk_seq < slot->next_seq) {
+      if (chunk_seq != 0) {
+        return;         // duplicate chunk
+      }
+
+      // id reused by a new text
+      flush(*slot, out);
+      slot = ring.end();
+    }
+
+    if (slot == ring.end()) {
+      slot = std::find_if(
+        ring.begin(), ring.end(), [](const Slot & s) {
+          return !s.used;
+        });
+    }
+
+    if (slot == ring.end()) {
+      slot = std::min_element(
+        ring.begin(), ring.end(), [](const Slot & a, const Slot & b) {
+          return a.stamp < b.stamp;
+        });
+      flush(*slot, out);
+    }
+
+    if (!slot->used) {
+      slot->used = true;
+      slot->sysid = sysid;
+      slot->compid = compid;
+      slot->id = id;
+      slot->severity = severity;
+      slot->next_seq = 0;
+      slot->text.clear();
+    }
+
+    if (chunk_seq != slot->next_seq) {
+      slot->text += "...";      // lost chunks
+    }
+
+    slot->text += chunk;
+    slot->next_seq = chunk_seq + 1;
+    slot->stamp = now;
+
+    if (is_last) {
+      out.push_back({slot->severity, std::move(slot->text)});
+      slot->used = false;
+    }
+  }
+
+  //! Emit texts not completed within timeout
+  void expire(steady_clock::time_point now, std::vector<Text> & out)
+  {
+    for (auto & slot : ring) {
+      if (slot.used && now - slot.stamp > timeout) {
+        flush(slot, out);
+      }
+    }
+  }
+
+private:
+  struct Slot
+  {
+    bool used;
+    uint8_t sysid;
+    uint8_t compid;
+    uint16_t id;
+    uint8_t severity;
+    uint16_t next_seq;
+    std::string text;
+    steady_clock::time_point stamp;
+  };
+
+  steady_clock::duration timeout;
+  std::array<Slot, 4> ring;
+
+  void flush(Slot & slot, std::vector<Text> & out)
+  {
+    out.push_back({slot.severity, std::move(slot.text) + "..."});
+    slot.used = false;
+  }
+};
+
+
+/**
+ * @brief STATUSTEXT rosout flood protection
+ *
+ * Identical texts repeated within dedup window are suppressed and counted,
+ * the count is reported when that text passes again.
+ * Each log level has its own token bucket rate limit.
+ */
+class StatusTextFilter
+{
+public:
+  using steady_clock = std::chrono::steady_clock;
+
+  //! Log level groups, as used by process_statustext_normal()
+  enum class Level
+  {
+    error,
+    warn,
+    info,
+    debug,
+    _count
+  };
+
+  StatusTextFilter()
+  : dedup_window(std::chrono::seconds(2)), recent{}, recent_head(0), buckets{}
+  {}
+
+  //! Level group of MAV_SEVERITY value
+  static Level level(uint8_t severity)
+  {
+    // MAV_SEVERITY: EMERGENCY..ERROR = 0..3, WARNING = 4, NOTICE = 5, INFO = 6, DEBUG = 7
+    if (severity <= 3) {
+      return Level::error;
+    } else if (severity == 6) {
+      return Level::info;
+    } else if (severity == 7) {
+      return Level::debug;
+    } else {
+      return Level::warn;
+    }
+  }
+
+  void set_dedup_window(steady_clock::duration window)
+  {
+    dedup_window = window;
+  }
+
+  //! Messages per second for the level, 0 disables limit
+  void set_rate_limit(
+    Level lvl, double rate,
+    steady_clock::time_point now = steady_clock::now())
+  {
+    auto & b = buckets[size_t(lvl)];
+    b.rate = rate;
+    b.tokens = std::max(rate, 1.0);
+    b.stamp = now;
+  }
+
+  /**
+   * Decide if text should be logged
+   *
+   * @param[out] repeated  number of suppressed copies of that text
+   * @param[out] limited   number of texts of that level dropped by rate limit
+   */
+  bool check(
+    uint8_t severity, const std::string & text, size_t & repeated, size_t & limited,
+    steady_clock::time_point now = steady_clock::now())
+  {
+    repeated = 0;
+    limited = 0;
+
+    Recent * entry = nullptr;
+    if (dedup_window > steady_clock::duration::zero()) {
+      auto it = std::find_if(
+        recent.begin(), recent.end(), [&](const Recent & r) {
+          return r.used && r.severity == severity && r.text == text;
+        });
+
+      if (it != recent.end()) {
+        if (now - it->stamp < dedup_window) {
+          it->suppressed++;
+          return false;
+        }
+
+        entry = &*it;
+      } else {
+        entry = &recent[recent_head];
+        recent_head = (recent_head + 1) % recent.size();
+
+        entry->used = true;
+        entry->severity = severity;
+        entry->text = text;
+        entry->suppressed = 0;
+      }
+    }
+
+    auto & b = buckets[size_t(level(severity))];
+    if (b.rate > 0.0) {
+      const double dt = std::chrono::duration<double>(now - b.stamp).count();
+      b.tokens = std::min(b.tokens + b.rate * dt, std::max(b.rate, 1.0));
+      b.stamp = now;
+
+      if (b.tokens < 1.0) {
+        b.limited++;
+        return false;
+      }
+
+      b.tokens -= 1.0;
+    }
+
+    if (entry) {
+      repeated = entry->suppressed;
+      entry->suppressed = 0;
+      entry->stamp = now;
+    }
+
+    limited = b.limited;
+    b.limited = 0;
+    return true;
+  }
+
+private:
+  struct Recent
+  {
+    bool used;
+    uint8_t severity;
+    std::string text;
+    size_t suppressed;
+    steady_clock::time_point stamp;
+  };
+
+  struct Bucket
+  {
+    double rate;
+    double tokens;
+    size_t limited;
+    steady_clock::time_point stamp;
+  };
+
+  steady_clock::duration dedup_window;
+  std::array<Recent, 8> recent;
+  size_t recent_head;
+  std::array<Bucket, size_t(Level::_count)> buckets;
+};
+
+}  // namespace utils
+}  // namespace mavros
+
+#endif  // MAVROS__STATUSTEXT_HPP_
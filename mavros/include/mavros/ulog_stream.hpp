@@ -0,0 +1,211 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief ULog stream reassembly
+ * @file ulog_stream.hpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+
+#pragma once
+
+#ifndef MAVROS__ULOG_STREAM_HPP_
+#define MAVROS__ULOG_STREAM_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace mavros
+{
+namespace utils
+{
+
+/**
+ * @brief Reassembles ULog file from LOGGING_DATA / LOGGING_DATA_ACKED packets
+ *
+ * FCU streams the file as packets of up to 249 bytes and ULog messages
+ * freely straddle packet boundaries. Assembler tracks message boundaries and
+ * passes only complete messages to the sink, so a lost packet never leaves
+ * a torn message in the file.
+ *
+ * On a sequence gap the partial message is dropped, a dropout message
+ * is written, and parsing resumes at @a first_message_offset of the first
+ * packet which has a message start.
+ *
+ * File header is expected to come with acked packets, stream which does not
+ * start with ULog magic is ignored until the header is seen.
+ */
+class ULogStreamAssembler
+{
+public:
+  static constexpr size_t HEADER_SIZE = 16;
+  static constexpr size_t MSG_HEADER_SIZE = 3;            //!< uint16 msg_size, uint8 msg_type
+  static constexpr uint8_t NO_MESSAGE_START = 255;
+  static constexpr uint8_t MSG_TYPE_DROPOUT = 'O';
+  static constexpr std::array<uint8_t, 7> MAGIC{0x55, 0x4c, 0x6f, 0x67, 0x01, 0x12, 0x35};
+
+  struct Stats
+  {
+    size_t packets;
+    size_t duplicates;        //!< repeated or reordered packets, ignored
+    size_t gaps;
+    size_t lost_packets;
+    size_t bytes_in;
+    size_t bytes_out;
+    size_t bytes_dropped;     //!< partial messages and data skipped while resyncing
+  };
+
+  ULogStreamAssembler()
+  {
+    reset();
+  }
+
+  //! Prepare for a new stream
+  void reset()
+  {
+    have_sequence = false;
+    expected_sequence = 0;
+    header_done = false;
+    synced = true;
+    last_stamp_ms = 0;
+    pending.clear();
+    stats = Stats{};
+  }
+
+  /**
+   * @brief Process one packet
+   *
+   * @param sequence              packet sequence number
+   * @param data                  packet payload
+   * @param length                payload length
+   * @param first_message_offset  offset of first message start in payload, 255 - none
+   * @param stamp_ms              receive time, used for dropout duration
+   * @param sink                  called as sink(const uint8_t *, size_t) with complete messages
+   * @return false if packet is a duplicate and was ignored
+   */
+  template<typename Sink>
+  bool push(
+    uint16_t sequence, const uint8_t * data, size_t length,
+    uint8_t first_message_offset, uint64_t stamp_ms, Sink && sink)
+  {
+    if (have_sequence) {
+      const uint16_t diff = sequence - expected_sequence;
+      if (diff >= 0x8000) {
+        stats.duplicates++;
+        return false;
+      } else if (diff > 0) {
+        stats.gaps++;
+        stats.lost_packets += diff;
+        stats.bytes_dropped += pending.size();
+        pending.clear();
+        synced = false;
+      }
+    }
+
+    have_sequence = true;
+    expected_sequence = sequence + 1;
+    stats.packets++;
+    stats.bytes_in += length;
+
+    size_t offset = 0;
+    if (!synced) {
+      if (first_message_offset == NO_MESSAGE_START || first_message_offset >= length) {
+        stats.bytes_dropped += length;
+        return true;
+      }
+
+      offset = first_message_offset;
+      stats.bytes_dropped += offset;
+      synced = true;
+
+      if (header_done) {
+        write_dropout(stamp_ms - last_stamp_ms, sink);
+      }
+    }
+
+    last_stamp_ms = stamp_ms;
+    pending.insert(pending.end(), data + offset, data + length);
+
+    size_t pos = 0;
+    if (!header_done) {
+      const size_t n = std::min(pending.size(), MAGIC.size());
+      if (!std::equal(pending.begin(), pending.begin() + n, MAGIC.begin())) {
+        stats.bytes_dropped += pending.size();
+        pending.clear();
+        synced = false;
+        return true;
+      }
+
+      if (pending.size() < HEADER_SIZE) {
+        return true;
+      }
+
+      pos = HEADER_SIZE;
+      header_done = true;
+    }
+
+    while (pending.size() - pos >= MSG_HEADER_SIZE) {
+      const size_t msg_size = MSG_HEADER_SIZE + (pending[pos] | (pending[pos + 1] << 8));
+      if (pending.size() - pos < msg_size) {
+        break;
+      }
+
+      pos += msg_size;
+    }
+
+    if (pos > 0) {
+      sink(pending.data(), pos);
+      stats.bytes_out += pos;
+      pending.erase(pending.begin(), pending.begin() + pos);
+    }
+
+    return true;
+  }
+
+  //! true after file header was written
+  inline bool has_header() const
+  {
+    return header_done;
+  }
+
+  inline const Stats & get_stats() const
+  {
+    return stats;
+  }
+
+private:
+  bool have_sequence;
+  uint16_t expected_sequence;
+  bool header_done;
+  bool synced;                //!< pending starts at a message boundary
+  uint64_t last_stamp_ms;
+  std::vector<uint8_t> pending;   //!< incomplete message (or header)
+  Stats stats;
+
+  template<typename Sink>
+  void write_dropout(uint64_t duration_ms, Sink && sink)
+  {
+    const uint16_t duration = std::min<uint64_t>(duration_ms, UINT16_MAX);
+    const uint8_t msg[] = {
+      2, 0, MSG_TYPE_DROPOUT,
+      uint8_t(duration & 0xff), uint8_t(duration >> 8),
+    };
+
+    sink(msg, sizeof(msg));
+    stats.bytes_out += sizeof(msg);
+  }
+};
+
+}  // namespace utils
+}  // namespace mavros
+
+#endif  // MAVROS__ULOG_STREAM_HPP_
@@ -21,6 +21,7 @@
 #define MAVROS__UTILS_HPP_
 
 #include <string>
+#include <string_view>
 #include <Eigen/Geometry>   // NOLINT
 
 #include "mavconn/thread_utils.hpp"
@@ -96,6 +97,37 @@ std::string to_string_enum(int e)
 
 std::string enum_to_name(mavlink::minimal::MAV_TYPE e);
 
+/**
+ * Zero-allocation variants of to_string().
+ *
+ * Returned view points to a static string literal, so data() is NUL terminated.
+ * Empty view is returned for unknown values.
+ */
+std::string_view to_string_view(timesync_mode e);
+std::string_view to_string_view(mavlink::common::MAV_SENSOR_ORIENTATION e);
+std::string_view to_string_view(mavlink::minimal::MAV_AUTOPILOT e);
+std::string_view to_string_view(mavlink::minimal::MAV_TYPE e);
+std::string_view to_string_view(mavlink::minimal::MAV_STATE e);
+std::string_view to_string_view(mavlink::minimal::MAV_COMPONENT e);
+std::string_view to_string_view(mavlink::common::MAV_ESTIMATOR_TYPE e);
+std::string_view to_string_view(mavlink::common::ADSB_ALTITUDE_TYPE e);
+std::string_view to_string_view(mavlink::common::ADSB_EMITTER_TYPE e);
+std::string_view to_string_view(mavlink::common::GPS_FIX_TYPE e);
+std::string_view to_string_view(mavlink::common::MAV_MISSION_RESULT e);
+std::string_view to_string_view(mavlink::common::MAV_FRAME e);
+std::string_view to_string_view(mavlink::common::MAV_DISTANCE_SENSOR e);
+std::string_view to_string_view(mavlink::common::LANDING_TARGET_TYPE e);
+/**
+ * Helper to call to_string_view() for enum _T
+ */
+template<typename _T>
+std::string_view to_string_view_enum(int e)
+{
+  return to_string_view(static_cast<_T>(e));
+}
+
+std::string_view enum_to_name_view(mavlink::minimal::MAV_TYPE e);
+
 /**
  * @brief Function to match the received orientation received by MAVLink msg
  *        and the rotation of the sensor relative to the FCU.
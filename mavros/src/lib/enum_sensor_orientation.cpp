@@ -15,6 +15,7 @@
  */
 
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include "mavros/utils.hpp"
@@ -29,13 +30,13 @@ namespace utils
 using mavlink::common::MAV_SENSOR_ORIENTATION;
 
 // internal type: name - rotation
-using OrientationPair = std::pair<const std::string, const Eigen::Quaterniond>;
+using OrientationPair = std::pair<const std::string_view, const Eigen::Quaterniond>;
 
 static auto logger = rclcpp::get_logger("uas.enum");
 
 // internal data initializer
 static const OrientationPair make_orientation(
-  const std::string & name,
+  const std::string_view name,
   const double roll,
   const double pitch,
   const double yaw)
@@ -132,17 +133,27 @@ static const std::array<const OrientationPair, 42> sensor_orientations{{
 // [[[end]]] (checksum: 2ed537a9279bb6a3992df43e225bbeb7)
 
 
-std::string to_string(MAV_SENSOR_ORIENTATION orientation)
+std::string_view to_string_view(MAV_SENSOR_ORIENTATION orientation)
 {
   const auto idx = enum_value(orientation);
   if (idx >= sensor_orientations.size()) {
     RCLCPP_ERROR(logger, "SENSOR: wrong orientation index: %d", idx);
-    return std::to_string(idx);
+    return "";
   }
 
   return sensor_orientations[idx].first;
 }
 
+std::string to_string(MAV_SENSOR_ORIENTATION orientation)
+{
+  auto sv = to_string_view(orientation);
+  if (sv.empty()) {
+    return std::to_string(enum_value(orientation));
+  }
+
+  return std::string(sv);
+}
+
 Eigen::Quaterniond sensor_orientation_matching(MAV_SENSOR_ORIENTATION orientation)
 {
   const auto idx = enum_value(orientation);
@@ -16,6 +16,7 @@
 
 #include <array>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "mavros/utils.hpp"
@@ -76,20 +77,30 @@ static auto logger = rclcpp::get_logger("uas.enum");
 //     array = ename_array_name(name, suffix)
 //     cog.outl(f"""
 // //! {name} values
-// static const std::array<const std::string, {len(enum)}> {array}{{{{""")
+// static constexpr std::array<std::string_view, {len(enum)}> {array}{{{{""")
 //
 //
 // def to_string_outl(ename, funcname='to_string', suffix=None):
 //     array = ename_array_name(ename, suffix)
 //     cog.outl(f"""
-// std::string {funcname}({ename} e)
+// std::string_view {funcname}_view({ename} e)
 // {{
 //   size_t idx = enum_value(e);
 //   if (idx >= {array}.size()) {{
-//     return std::to_string(idx);
+//     return "";
 //   }}
 //
 //   return {array}[idx];
+// }}
+//
+// std::string {funcname}({ename} e)
+// {{
+//   auto sv = {funcname}_view(e);
+//   if (sv.empty()) {{
+//     return std::to_string(enum_value(e));
+//   }}
+//
+//   return std::string(sv);
 // }}""")
 //
 //
@@ -134,7 +145,7 @@ static auto logger = rclcpp::get_logger("uas.enum");
 // ]]]
 
 //! MAV_AUTOPILOT values
-static const std::array<const std::string, 20> mav_autopilot_strings{{
+static constexpr std::array<std::string_view, 20> mav_autopilot_strings{{
 /*  0 */ "Generic autopilot",
 /*  1 */ "Reserved for future use",
 /*  2 */ "SLUGS autopilot",
@@ -158,16 +169,26 @@ static const std::array<const std::string, 20> mav_autopilot_strings{{
 }};
 
 
-std::string to_string(MAV_AUTOPILOT e)
+std::string_view to_string_view(MAV_AUTOPILOT e)
 {
   size_t idx = enum_value(e);
   if (idx >= mav_autopilot_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return mav_autopilot_strings[idx];
 }
-// [[[end]]] (checksum: ca6693afe1ced57fa7eb4b5d2f895550)
+
+std::string to_string(MAV_AUTOPILOT e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: f17f05cb5e932370145b6dd42ce76912)
 
 // [[[cog:
 // ename = 'MAV_TYPE'
@@ -175,7 +196,7 @@ std::string to_string(MAV_AUTOPILOT e)
 // ]]]
 
 //! MAV_TYPE values
-static const std::array<const std::string, 38> mav_type_strings{{
+static constexpr std::array<std::string_view, 38> mav_type_strings{{
 /*  0 */ "Generic micro air vehicle",
 /*  1 */ "Fixed wing aircraft",
 /*  2 */ "Quadrotor",
@@ -217,16 +238,26 @@ static const std::array<const std::string, 38> mav_type_strings{{
 }};
 
 
-std::string to_string(MAV_TYPE e)
+std::string_view to_string_view(MAV_TYPE e)
 {
   size_t idx = enum_value(e);
   if (idx >= mav_type_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return mav_type_strings[idx];
 }
-// [[[end]]] (checksum: 376064ea1578250d182ab62a85b06a41)
+
+std::string to_string(MAV_TYPE e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: b15fdef688648a724eccf9eb9a7e4fc0)
 
 // [[[cog:
 // ename = 'MAV_TYPE'
@@ -234,7 +265,7 @@ std::string to_string(MAV_TYPE e)
 // ]]]
 
 //! MAV_TYPE values
-static const std::array<const std::string, 38> mav_type_names{{
+static constexpr std::array<std::string_view, 38> mav_type_names{{
 /*  0 */ "GENERIC",
 /*  1 */ "FIXED_WING",
 /*  2 */ "QUADROTOR",
@@ -275,16 +306,26 @@ static const std::array<const std::string, 38> mav_type_names{{
 /* 37 */ "PARACHUTE",
 }};
 
-std::string enum_to_name(MAV_TYPE e)
+std::string_view enum_to_name_view(MAV_TYPE e)
 {
   size_t idx = enum_value(e);
   if (idx >= mav_type_names.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return mav_type_names[idx];
 }
-// [[[end]]] (checksum: 5e58c6b1f7868c26f570b97fa4389feb)
+
+std::string enum_to_name(MAV_TYPE e)
+{
+  auto sv = enum_to_name_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: e8dabe8357c78ef65a4c8ec224010bc4)
 
 // [[[cog:
 // ename = 'MAV_STATE'
@@ -292,7 +333,7 @@ std::string enum_to_name(MAV_TYPE e)
 // ]]]
 
 //! MAV_STATE values
-static const std::array<const std::string, 9> mav_state_strings{{
+static constexpr std::array<std::string_view, 9> mav_state_strings{{
 /*  0 */ "UNINIT",
 /*  1 */ "BOOT",
 /*  2 */ "CALIBRATING",
@@ -304,16 +345,26 @@ static const std::array<const std::string, 9> mav_state_strings{{
 /*  8 */ "FLIGHT_TERMINATION",
 }};
 
-std::string to_string(MAV_STATE e)
+std::string_view to_string_view(MAV_STATE e)
 {
   size_t idx = enum_value(e);
   if (idx >= mav_state_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return mav_state_strings[idx];
 }
-// [[[end]]] (checksum: e953b14d18e31abb45db4fe72ebb749f)
+
+std::string to_string(MAV_STATE e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: cd19b181160ecffe2a0355aa17fba87d)
 
 // [[[cog:
 // ename = "timesync_mode"
@@ -329,7 +380,7 @@ std::string to_string(MAV_STATE e)
 // ]]]
 
 //! timesync_mode values
-static const std::array<const std::string, 4> timesync_mode_strings{{
+static constexpr std::array<std::string_view, 4> timesync_mode_strings{{
 /*  0 */ "NONE",
 /*  1 */ "MAVLINK",
 /*  2 */ "ONBOARD",
@@ -337,16 +388,26 @@ static const std::array<const std::string, 4> timesync_mode_strings{{
 }};
 
 
-std::string to_string(timesync_mode e)
+std::string_view to_string_view(timesync_mode e)
 {
   size_t idx = enum_value(e);
   if (idx >= timesync_mode_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return timesync_mode_strings[idx];
 }
-// [[[end]]] (checksum: 7a286bcf12006fdeff1bd9fca8ce4176)
+
+std::string to_string(timesync_mode e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: 677d4abd7466185875ade639a598d3b3)
 
 timesync_mode timesync_mode_from_str(const std::string & mode)
 {
@@ -367,21 +428,31 @@ timesync_mode timesync_mode_from_str(const std::string & mode)
 // ]]]
 
 //! ADSB_ALTITUDE_TYPE values
-static const std::array<const std::string, 2> adsb_altitude_type_strings{{
+static constexpr std::array<std::string_view, 2> adsb_altitude_type_strings{{
 /*  0 */ "PRESSURE_QNH",
 /*  1 */ "GEOMETRIC",
 }};
 
-std::string to_string(ADSB_ALTITUDE_TYPE e)
+std::string_view to_string_view(ADSB_ALTITUDE_TYPE e)
 {
   size_t idx = enum_value(e);
   if (idx >= adsb_altitude_type_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return adsb_altitude_type_strings[idx];
 }
-// [[[end]]] (checksum: 2e8d87a6e603b105ded642f34978fd55)
+
+std::string to_string(ADSB_ALTITUDE_TYPE e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: c13e063857cb0ad16fc932ddac8c6c40)
 
 // [[[cog:
 // ename = 'ADSB_EMITTER_TYPE'
@@ -389,7 +460,7 @@ std::string to_string(ADSB_ALTITUDE_TYPE e)
 // ]]]
 
 //! ADSB_EMITTER_TYPE values
-static const std::array<const std::string, 20> adsb_emitter_type_strings{{
+static constexpr std::array<std::string_view, 20> adsb_emitter_type_strings{{
 /*  0 */ "NO_INFO",
 /*  1 */ "LIGHT",
 /*  2 */ "SMALL",
@@ -412,16 +483,26 @@ static const std::array<const std::string, 20> adsb_emitter_type_strings{{
 /* 19 */ "POINT_OBSTACLE",
 }};
 
-std::string to_string(ADSB_EMITTER_TYPE e)
+std::string_view to_string_view(ADSB_EMITTER_TYPE e)
 {
   size_t idx = enum_value(e);
   if (idx >= adsb_emitter_type_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return adsb_emitter_type_strings[idx];
 }
-// [[[end]]] (checksum: 342e71a579408cf35a4dbf8b42bd099a)
+
+std::string to_string(ADSB_EMITTER_TYPE e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: 57d38bd5193fa32a052efe077cef83db)
 
 // [[[cog:
 // ename = 'MAV_ESTIMATOR_TYPE'
@@ -429,7 +510,7 @@ std::string to_string(ADSB_EMITTER_TYPE e)
 // ]]]
 
 //! MAV_ESTIMATOR_TYPE values
-static const std::array<const std::string, 9> mav_estimator_type_strings{{
+static constexpr std::array<std::string_view, 9> mav_estimator_type_strings{{
 /*  0 */ "UNKNOWN",
 /*  1 */ "NAIVE",
 /*  2 */ "VISION",
@@ -441,16 +522,26 @@ static const std::array<const std::string, 9> mav_estimator_type_strings{{
 /*  8 */ "AUTOPILOT",
 }};
 
-std::string to_string(MAV_ESTIMATOR_TYPE e)
+std::string_view to_string_view(MAV_ESTIMATOR_TYPE e)
 {
   size_t idx = enum_value(e);
   if (idx >= mav_estimator_type_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return mav_estimator_type_strings[idx];
 }
-// [[[end]]] (checksum: 451e5fe0a2c760a5c9d4efed0f97553d)
+
+std::string to_string(MAV_ESTIMATOR_TYPE e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: 7e6f05ee5a18f3ddee87815d00f8f677)
 
 // [[[cog:
 // ename = 'GPS_FIX_TYPE'
@@ -458,7 +549,7 @@ std::string to_string(MAV_ESTIMATOR_TYPE e)
 // ]]]
 
 //! GPS_FIX_TYPE values
-static const std::array<const std::string, 9> gps_fix_type_strings{{
+static constexpr std::array<std::string_view, 9> gps_fix_type_strings{{
 /*  0 */ "NO_GPS",
 /*  1 */ "NO_FIX",
 /*  2 */ "2D_FIX",
@@ -470,16 +561,26 @@ static const std::array<const std::string, 9> gps_fix_type_strings{{
 /*  8 */ "PPP",
 }};
 
-std::string to_string(GPS_FIX_TYPE e)
+std::string_view to_string_view(GPS_FIX_TYPE e)
 {
   size_t idx = enum_value(e);
   if (idx >= gps_fix_type_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return gps_fix_type_strings[idx];
 }
-// [[[end]]] (checksum: 260b7022824b9717be95db4e4e28a8d5)
+
+std::string to_string(GPS_FIX_TYPE e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: 0d5a419e443e6e97b7ae284652fe95db)
 
 // [[[cog:
 // ename = 'MAV_MISSION_RESULT'
@@ -487,7 +588,7 @@ std::string to_string(GPS_FIX_TYPE e)
 // ]]]
 
 //! MAV_MISSION_RESULT values
-static const std::array<const std::string, 16> mav_mission_result_strings{{
+static constexpr std::array<std::string_view, 16> mav_mission_result_strings{{
 /*  0 */ "mission accepted OK",
 /*  1 */ "Generic error / not accepting mission commands at all right now.",
 /*  2 */ "Coordinate frame is not supported.",
@@ -507,16 +608,26 @@ static const std::array<const std::string, 16> mav_mission_result_strings{{
 }};
 
 
-std::string to_string(MAV_MISSION_RESULT e)
+std::string_view to_string_view(MAV_MISSION_RESULT e)
 {
   size_t idx = enum_value(e);
   if (idx >= mav_mission_result_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return mav_mission_result_strings[idx];
 }
-// [[[end]]] (checksum: ddddde7cdf04ebd988f019d5b93eadbe)
+
+std::string to_string(MAV_MISSION_RESULT e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: 2b8cfcc5d1a141e49541d70977d39b14)
 
 // [[[cog:
 // ename = 'MAV_FRAME'
@@ -524,7 +635,7 @@ std::string to_string(MAV_MISSION_RESULT e)
 // ]]]
 
 //! MAV_FRAME values
-static const std::array<const std::string, 22> mav_frame_strings{{
+static constexpr std::array<std::string_view, 22> mav_frame_strings{{
 /*  0 */ "GLOBAL",
 /*  1 */ "LOCAL_NED",
 /*  2 */ "MISSION",
@@ -549,16 +660,26 @@ static const std::array<const std::string, 22> mav_frame_strings{{
 /* 21 */ "LOCAL_FLU",
 }};
 
-std::string to_string(MAV_FRAME e)
+std::string_view to_string_view(MAV_FRAME e)
 {
   size_t idx = enum_value(e);
   if (idx >= mav_frame_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return mav_frame_strings[idx];
 }
-// [[[end]]] (checksum: 9e2018e38b2c586263f10adba00d2ca6)
+
+std::string to_string(MAV_FRAME e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: 4e4e2b16f1da23a2ca8ca9a20167a866)
 
 // [[[cog:
 // ename = 'MAV_COMPONENT'
@@ -566,7 +687,7 @@ std::string to_string(MAV_FRAME e)
 // enum = get_enum(ename)
 //
 // cog.outl(
-//     f"static const std::unordered_map<size_t, const std::string> "
+//     f"static const std::unordered_map<size_t, std::string_view> "
 //     f"{suffix.lower()}_strings{{{{")
 // for k, e in enum:
 //     name_short =  e.name[len(suffix) + 1:]
@@ -578,7 +699,7 @@ std::string to_string(MAV_FRAME e)
 //
 // cog.outl("}};")
 // ]]]
-static const std::unordered_map<size_t, const std::string> mav_comp_id_strings{{
+static const std::unordered_map<size_t, std::string_view> mav_comp_id_strings{{
   {0, "ALL"},
   {1, "AUTOPILOT1"},
   {25, "USER1"},
@@ -713,20 +834,30 @@ static const std::unordered_map<size_t, const std::string> mav_comp_id_strings{{
   {242, "TUNNEL_NODE"},
   {250, "SYSTEM_CONTROL"},
 }};
-// [[[end]]] (checksum: bdc7916b48d45154a0b164047b45edf7)
+// [[[end]]] (checksum: 5fc746e8d1593fe0588d0a04652e793c)
 
-std::string to_string(MAV_COMPONENT e)
+std::string_view to_string_view(MAV_COMPONENT e)
 {
   size_t idx = enum_value(e);
   auto it = mav_comp_id_strings.find(idx);
 
   if (it == mav_comp_id_strings.end()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return it->second;
 }
 
+std::string to_string(MAV_COMPONENT e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+
 MAV_FRAME mav_frame_from_str(const std::string & mav_frame)
 {
   for (size_t idx = 0; idx < mav_frame_strings.size(); idx++) {
@@ -758,7 +889,7 @@ MAV_TYPE mav_type_from_str(const std::string & mav_type)
 // ]]]
 
 //! MAV_DISTANCE_SENSOR values
-static const std::array<const std::string, 5> mav_distance_sensor_strings{{
+static constexpr std::array<std::string_view, 5> mav_distance_sensor_strings{{
 /*  0 */ "LASER",
 /*  1 */ "ULTRASOUND",
 /*  2 */ "INFRARED",
@@ -766,16 +897,26 @@ static const std::array<const std::string, 5> mav_distance_sensor_strings{{
 /*  4 */ "UNKNOWN",
 }};
 
-std::string to_string(MAV_DISTANCE_SENSOR e)
+std::string_view to_string_view(MAV_DISTANCE_SENSOR e)
 {
   size_t idx = enum_value(e);
   if (idx >= mav_distance_sensor_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return mav_distance_sensor_strings[idx];
 }
-// [[[end]]] (checksum: dda871f638e51a30d2ecd3b0d063c0de)
+
+std::string to_string(MAV_DISTANCE_SENSOR e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: 083282995652e1bf685a15809543ab58)
 
 // [[[cog:
 // ename = 'LANDING_TARGET_TYPE'
@@ -783,23 +924,33 @@ std::string to_string(MAV_DISTANCE_SENSOR e)
 // ]]]
 
 //! LANDING_TARGET_TYPE values
-static const std::array<const std::string, 4> landing_target_type_strings{{
+static constexpr std::array<std::string_view, 4> landing_target_type_strings{{
 /*  0 */ "LIGHT_BEACON",
 /*  1 */ "RADIO_BEACON",
 /*  2 */ "VISION_FIDUCIAL",
 /*  3 */ "VISION_OTHER",
 }};
 
-std::string to_string(LANDING_TARGET_TYPE e)
+std::string_view to_string_view(LANDING_TARGET_TYPE e)
 {
   size_t idx = enum_value(e);
   if (idx >= landing_target_type_strings.size()) {
-    return std::to_string(idx);
+    return "";
   }
 
   return landing_target_type_strings[idx];
 }
-// [[[end]]] (checksum: f582577481c6b17014ed9925665f7634)
+
+std::string to_string(LANDING_TARGET_TYPE e)
+{
+  auto sv = to_string_view(e);
+  if (sv.empty()) {
+    return std::to_string(enum_value(e));
+  }
+
+  return std::string(sv);
+}
+// [[[end]]] (checksum: c99f740f4f5b3c8a2cef36d54d29666f)
 
 LANDING_TARGET_TYPE landing_target_type_from_str(const std::string & landing_target_type)
 {
@@ -11,12 +11,17 @@
  * @author Vladimir Ermakov <vooon341@gmail.com>
  */
 
+#include <algorithm>
+#include <array>
+#include <cinttypes>
 #include <memory>
 #include <vector>
 #include <string>
 #include <set>
 #include <utility>
 
+#include "mavconn/alloc_tracker.hpp"
+#include "mavconn/tracing.hpp"
 #include "mavros/mavros_router.hpp"
 #include "rcpputils/asserts.hpp"
 
@@ -37,9 +42,21 @@ void Router::route_message(
   Endpoint::SharedPtr src, const mavlink_message_t * msg,
   const Framing framing)
 {
+  MAVCONN_ALLOC_SCOPE(route);
+  const auto t_start = std::chrono::steady_clock::now();
   shared_lock lock(mu);
   this->stat_msg_routed++;
 
+  if (recorder) {
+    recorder->record(src->id, msg, framing);
+  }
+
+  if (msg->msgid == mavlink::common::msg::RADIO_STATUS::MSG_ID && radio_shaping &&
+    framing == Framing::ok)
+  {
+    src->radio_status(msg);
+  }
+
   // find message destination target
   addr_t target_addr = 0;
   auto msg_entry = ::mavlink::mavlink_get_msg_entry(msg->msgid);
@@ -70,6 +87,7 @@ retry:
     bool has_target = dest->remote_addrs.find(target_addr) != dest->remote_addrs.end();
 
     if (has_target) {
+      MAVCONN_TRACEPOINT(endpoint_send, src->id, dest->id, msg);
       dest->send_message(msg, framing, src->id);
       sent_cnt++;
     }
@@ -82,6 +100,9 @@ retry:
     goto retry;
   }
 
+  MAVCONN_TRACEPOINT(route_message, src->id, msg, target_addr, sent_cnt);
+  metric_route_latency->observe(std::chrono::steady_clock::now() - t_start);
+
   // update stats
   this->stat_msg_sent.fetch_add(sent_cnt);
   if (sent_cnt == 0) {
@@ -161,6 +182,7 @@ void Router::del_endpoint(
     auto it = this->endpoints.find(request->id);
     if (it != this->endpoints.end() ) {
       it->second->close();
+      it->second->metrics_remove(metrics::Registry::global());
       this->diagnostic_updater.removeByName(it->second->diag_name());
       this->endpoints.erase(it);
       response->successful = true;
@@ -176,6 +198,7 @@ void Router::del_endpoint(
       it->second->link_type == static_cast<Endpoint::Type>( request->type))
     {
       it->second->close();
+      it->second->metrics_remove(metrics::Registry::global());
       this->diagnostic_updater.removeByName(it->second->diag_name());
       this->endpoints.erase(it);
       response->successful = true;
@@ -246,6 +269,8 @@ rcl_interfaces::msg::SetParametersResult Router::on_set_parameters_cb(
       }
     };
 
+  bool recorder_changed = false;
+
   result.successful = true;
   for (const auto & parameter : parameters) {
     const auto name = parameter.get_name();
@@ -255,15 +280,129 @@ rcl_interfaces::msg::SetParametersResult Router::on_set_parameters_cb(
       update_endpoints(parameter, Type::gcs);
     } else if (name == "uas_urls") {
       update_endpoints(parameter, Type::uas);
+    } else if (name == "radio_shaping") {
+      radio_shaping = parameter.as_bool();
+      if (!radio_shaping) {
+        shared_lock lock(mu);
+        for (auto & kv : endpoints) {
+          kv.second->radio_status_reset();
+        }
+      }
+    } else if (name == "recorder.path") {
+      recorder_options.path_prefix = parameter.as_string();
+      recorder_changed = true;
+    } else if (name == "recorder.compress") {
+      recorder_options.compress = parameter.as_bool();
+      recorder_changed = true;
+    } else if (name == "recorder.chunk_size") {
+      recorder_options.chunk_size = std::max<int64_t>(parameter.as_int(), 1024);
+      recorder_changed = true;
+    } else if (name == "recorder.max_file_size") {
+      recorder_options.max_file_size = std::max<int64_t>(parameter.as_int(), 0) << 20;
+      recorder_changed = true;
+    } else if (name == "recorder.max_file_duration") {
+      recorder_options.max_file_duration = std::chrono::seconds(parameter.as_int());
+      recorder_changed = true;
+    } else if (name == "recorder.queue_size") {
+      recorder_options.queue_size = std::max<int64_t>(parameter.as_int(), 16);
+      recorder_changed = true;
+    } else if (name == "metrics_address") {
+      metrics_address = parameter.as_string();
+    } else if (name == "metrics_port") {
+      restart_metrics_exporter(parameter.as_int());
     } else {
       result.successful = false;
       result.reason = "unknown parameter";
     }
   }
 
+  if (recorder_changed) {
+    restart_recorder();
+  }
+
   return result;
 }
 
+void Router::restart_recorder()
+{
+  auto lg = get_logger();
+  Recorder::UniquePtr new_recorder;
+
+  if (!recorder_options.path_prefix.empty()) {
+    new_recorder = std::make_unique<Recorder>(recorder_options, lg);
+  }
+
+  {
+    unique_lock lock(mu);
+    std::swap(recorder, new_recorder);
+  }
+
+  // NOTE: old recorder flushes its queue and writes index in destructor, do it without lock
+  if (new_recorder) {
+    RCLCPP_INFO(lg, "Stopping recorder");
+    new_recorder.reset();
+  }
+}
+
+Router::~Router()
+{
+  // NOTE: stop serving first, collector uses this
+  metrics_exporter.reset();
+  metrics::Registry::global().remove_collector(metrics_collector_id);
+}
+
+void Router::setup_metrics()
+{
+  auto & registry = metrics::Registry::global();
+
+  metric_msg_routed = registry.counter(
+    "mavros_router_messages_routed", "Messages came to the router");
+  metric_msg_sent = registry.counter(
+    "mavros_router_messages_sent", "Messages sent to endpoints");
+  metric_msg_dropped = registry.counter(
+    "mavros_router_messages_dropped", "Messages without any destination");
+  metric_route_latency = registry.histogram(
+    "mavros_router_route_seconds", "Time spent in route_message()",
+    metrics::Histogram::latency_bounds());
+
+  metrics_collector_id = registry.add_collector(std::bind(&Router::metrics_run, this, _1));
+}
+
+void Router::restart_metrics_exporter(int port)
+{
+  metrics_exporter.reset();
+  if (port <= 0) {
+    return;
+  }
+
+  try {
+    metrics_exporter = std::make_unique<metrics::Exporter>(
+      metrics::Registry::global(), port, metrics_address, get_logger());
+  } catch (std::exception & ex) {
+    RCLCPP_ERROR(get_logger(), "Metrics: exporter failed: %s", ex.what());
+  }
+}
+
+void Router::metrics_run(metrics::Registry & registry)
+{
+  // NOTE: stats are kept in atomics anyway, mirror them only on scrape
+  metric_msg_routed->set(stat_msg_routed.load());
+  metric_msg_sent->set(stat_msg_sent.load());
+  metric_msg_dropped->set(stat_msg_dropped.load());
+
+  std::vector<Endpoint::SharedPtr> eps;
+  {
+    shared_lock lock(mu);
+    for (auto & kv : endpoints) {
+      eps.push_back(kv.second);
+    }
+  }
+
+  for (auto & ep : eps) {
+    ep->metrics_run(registry);
+  }
+}
+
 void Router::periodic_reconnect_endpoints()
 {
   shared_lock lock(mu);
@@ -327,6 +466,26 @@ void Router::diag_run(diagnostic_updater::DiagnosticStatusWrapper & stat)
   stat.addf("Messages sent", "%zu", stat_msg_sent.load());
   stat.addf("Messages dropped", "%zu", stat_msg_dropped.load());
 
+  {
+    shared_lock lock(mu);
+    if (recorder) {
+      auto rs = recorder->get_stats();
+      stat.add("Recorder file", recorder->get_current_file());
+      stat.addf("Recorder messages", "%zu", rs.recorded);
+      stat.addf("Recorder dropped", "%zu", rs.dropped);
+      stat.addf("Recorder bytes written", "%zu", rs.bytes_written);
+    }
+  }
+
+  if (mavconn::alloc::enabled()) {
+    for (auto scope : {mavconn::alloc::Scope::rx, mavconn::alloc::Scope::route}) {
+      auto c = mavconn::alloc::get(scope);
+      stat.addf(
+        utils::format("Allocations %s", mavconn::alloc::to_string(scope)),
+        "%" PRIu64 " (%" PRIu64 " B)", c.allocs, c.bytes);
+    }
+  }
+
   if (endpoints_len < 2) {
     stat.summary(2, "not enough endpoints");
   } else {
@@ -377,10 +536,17 @@ bool MAVConnEndpoint::is_open()
 std::pair<bool, std::string> MAVConnEndpoint::open()
 {
   try {
-    this->link = mavconn::MAVConnInterface::open_url(
-      this->url, 1, mavconn::MAV_COMP_ID_UDP_BRIDGE, std::bind(
+    auto lnk = mavconn::MAVConnInterface::open_url_no_connect(
+      this->url, 1, mavconn::MAV_COMP_ID_UDP_BRIDGE);
+
+    // NOTE: shaper must be set before connect()
+    lnk->set_tx_shaper(this->shaper);
+    lnk->connect(
+      std::bind(
         &MAVConnEndpoint::recv_message,
         shared_from_this(), _1, _2));
+
+    this->link = lnk;
   } catch (mavconn::DeviceError & ex) {
     return {false, ex.what()};
   }
@@ -417,6 +583,20 @@ void MAVConnEndpoint::send_message(
   this->link->send_message_ignore_drop(msg);
 }
 
+void MAVConnEndpoint::radio_status(const mavlink_message_t * msg)
+{
+  mavlink::common::msg::RADIO_STATUS rst{};
+  mavlink::MsgMap map(msg);
+  rst.deserialize(map);
+
+  shaper->update_radio_status(rst.txbuf, rst.rxerrors);
+}
+
+void MAVConnEndpoint::radio_status_reset()
+{
+  shaper->reset();
+}
+
 void MAVConnEndpoint::diag_run(diagnostic_updater::DiagnosticStatusWrapper & stat)
 {
   if (!this->link) {
@@ -439,6 +619,15 @@ void MAVConnEndpoint::diag_run(diagnostic_updater::DiagnosticStatusWrapper & sta
   stat.addf("Rx speed", "%f", iostat.rx_speed);
   stat.addf("Tx speed", "%f", iostat.tx_speed);
 
+  auto ss = shaper->get_stats();
+  if (ss.active) {
+    stat.addf("Shaper rate", "%.0f", ss.rate);
+    stat.addf("Shaper goodput", "%.0f", ss.goodput);
+    stat.addf("Shaper dropped", "%zu", ss.dropped);
+    stat.addf("Radio tx buffer (%)", "%u", ss.txbuf);
+    stat.addf("Radio rx errors rate", "%.1f", ss.error_rate);
+  }
+
   stat.addf("Remotes count", "%zu", this->remote_addrs.size());
   size_t idx = 0;
   for (auto addr : this->remote_addrs) {
@@ -530,6 +719,64 @@ void ROSEndpoint::ros_recv_message(const mavros_msgs::msg::Mavlink::SharedPtr rm
   }
 }
 
+static const std::array<const char *, 11> MAVCONN_ENDPOINT_METRICS{
+  "mavros_link_rx_bytes", "mavros_link_tx_bytes",
+  "mavros_link_rx_speed_bytes", "mavros_link_tx_speed_bytes",
+  "mavros_link_rx_packets", "mavros_link_rx_dropped_packets",
+  "mavros_link_parse_errors", "mavros_link_buffer_overruns",
+  "mavros_link_shaper_rate_bytes", "mavros_link_shaper_goodput_bytes",
+  "mavros_link_shaper_dropped",
+};
+
+void MAVConnEndpoint::metrics_run(metrics::Registry & registry)
+{
+  // NOTE: link may be closed concurrently
+  auto lnk = this->link;
+  if (!lnk) {
+    return;
+  }
+
+  const metrics::Labels labels{{"endpoint", diag_name()}};
+  auto mav_status = lnk->get_status();
+  auto iostat = lnk->get_iostat();
+
+  registry.counter(MAVCONN_ENDPOINT_METRICS[0], "Received bytes", labels)->set(
+    iostat.rx_total_bytes);
+  registry.counter(MAVCONN_ENDPOINT_METRICS[1], "Transmitted bytes", labels)->set(
+    iostat.tx_total_bytes);
+  registry.gauge(MAVCONN_ENDPOINT_METRICS[2], "Receive speed [B/s]", labels)->set(
+    iostat.rx_speed);
+  registry.gauge(MAVCONN_ENDPOINT_METRICS[3], "Transmit speed [B/s]", labels)->set(
+    iostat.tx_speed);
+  registry.counter(MAVCONN_ENDPOINT_METRICS[4], "Received packets", labels)->set(
+    mav_status.packet_rx_success_count);
+  registry.counter(MAVCONN_ENDPOINT_METRICS[5], "Packets lost by sequence", labels)->set(
+    mav_status.packet_rx_drop_count);
+  registry.counter(MAVCONN_ENDPOINT_METRICS[6], "Frame parse errors", labels)->set(
+    mav_status.parse_error);
+  registry.counter(MAVCONN_ENDPOINT_METRICS[7], "Parser buffer overruns", labels)->set(
+    mav_status.buffer_overrun);
+
+  auto ss = shaper->get_stats();
+  if (ss.active) {
+    registry.gauge(MAVCONN_ENDPOINT_METRICS[8], "Tx shaper rate limit [B/s]", labels)->set(
+      ss.rate);
+    registry.gauge(MAVCONN_ENDPOINT_METRICS[9], "Tx admitted by shaper [B/s]", labels)->set(
+      ss.goodput);
+    registry.counter(MAVCONN_ENDPOINT_METRICS[10], "Messages dropped by shaper", labels)->set(
+      ss.dropped);
+  }
+}
+
+void MAVConnEndpoint::metrics_remove(metrics::Registry & registry)
+{
+  const metrics::Labels labels{{"endpoint", diag_name()}};
+
+  for (auto name : MAVCONN_ENDPOINT_METRICS) {
+    registry.remove(name, labels);
+  }
+}
+
 void ROSEndpoint::diag_run(diagnostic_updater::DiagnosticStatusWrapper & stat)
 {
   // TODO(vooon): make some diagnostics
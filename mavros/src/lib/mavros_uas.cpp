@@ -12,11 +12,14 @@
  */
 
 #include <fnmatch.h>
+#include <cinttypes>
 #include <cmath>
 #include <string>
 #include <vector>
 #include <Eigen/Eigen>  // NOLINT
 
+#include "mavconn/alloc_tracker.hpp"
+#include "mavconn/tracing.hpp"
 #include "rcpputils/asserts.hpp"
 #include "mavros/mavros_uas.hpp"
 #include "mavros/utils.hpp"
@@ -51,6 +54,7 @@ UAS::UAS(
   plugin_factory_loader("mavros", "mavros::plugin::PluginFactory"),
   loaded_plugins{},
   plugin_subscriptions{},
+  plugin_metrics{},
   type(enum_value(MAV_TYPE::GENERIC)),
   autopilot(enum_value(MAV_AUTOPILOT::GENERIC)),
   base_mode(0),
@@ -193,8 +197,19 @@ void UAS::plugin_route(const mavlink_message_t * mmsg, const Framing framing)
     return;
   }
 
+  MAVCONN_ALLOC_SCOPE(dispatch);
+  MAVCONN_TRACEPOINT(uas_dispatch, mmsg, it->second.size());
+  const auto t_start = std::chrono::steady_clock::now();
   for (auto & info : it->second) {
+    MAVCONN_ALLOC_SCOPE(plugin);
+    MAVCONN_TRACEPOINT(plugin_handler_entry, mmsg, std::get<1>(info), std::get<2>(info));
     std::get<3>(info)(mmsg, framing);
+    MAVCONN_TRACEPOINT(plugin_handler_exit, mmsg);
+  }
+
+  auto mit = plugin_metrics.find(mmsg->msgid);
+  if (mit != plugin_metrics.end()) {
+    mit->second->observe(std::chrono::steady_clock::now() - t_start);
   }
 }
 
@@ -287,6 +302,13 @@ void UAS::add_plugin(const std::string & pl_name)
 
         RCLCPP_DEBUG_STREAM(lg, log_msgname << " - new element");
         plugin_subscriptions[msgid] = Plugin::Subscriptions{{info}};
+        plugin_metrics[msgid] = metrics::Registry::global().histogram(
+          "mavros_uas_handler_seconds", "Time spent in plugin handlers of a message",
+          metrics::Histogram::latency_bounds(), {
+            {"uas", get_fully_qualified_name()},
+            {"msgid", std::to_string(msgid)},
+            {"msg", is_mavlink_message_t(type_hash_) ? "" : msgname},
+          });
       } else {
         // existing: check handler message type
 
@@ -371,6 +393,7 @@ void UAS::recv_message(const mavros_msgs::msg::Mavlink::SharedPtr rmsg)
 {
   mavlink::mavlink_message_t msg;
 
+  MAVCONN_ALLOC_SCOPE(dispatch);
   auto ok = mavros_msgs::mavlink::convert(*rmsg, msg);
   rcpputils::assert_true(ok, "conversion error");
 
@@ -390,6 +413,7 @@ void UAS::send_message(const mavlink::Message & obj, const uint8_t src_compid)
   mavlink::mavlink_finalize_message_buffer(
     &msg, source_system, src_compid, &mavlink_status, mi.min_length, mi.length,
     mi.crc_extra);
+  MAVCONN_TRACEPOINT(uas_send, &msg);
 
   mavros_msgs::msg::Mavlink rmsg{};
   auto ok = mavros_msgs::mavlink::convert(msg, rmsg);
@@ -413,10 +437,9 @@ void UAS::set_protocol_version(mavconn::Protocol pver)
 
 void UAS::log_connect_change(bool connected)
 {
-  auto ap = utils::to_string(get_autopilot());
-
   /* note: sys_status plugin required */
   if (connected) {
+    auto ap = utils::to_string(get_autopilot());
     RCLCPP_INFO(get_logger(), "CON: Got HEARTBEAT, connected. FCU: %s", ap.c_str());
   } else {
     RCLCPP_WARN(get_logger(), "CON: Lost connection, HEARTBEAT timed out.");
@@ -427,6 +450,15 @@ void UAS::diag_run(diagnostic_updater::DiagnosticStatusWrapper & stat)
 {
   // TODO(vooon): add some fields
 
+  if (mavconn::alloc::enabled()) {
+    for (auto scope : {mavconn::alloc::Scope::dispatch, mavconn::alloc::Scope::plugin}) {
+      auto c = mavconn::alloc::get(scope);
+      stat.addf(
+        utils::format("Allocations %s", mavconn::alloc::to_string(scope)),
+        "%" PRIu64 " (%" PRIu64 " B)", c.allocs, c.bytes);
+    }
+  }
+
   if (connected) {
     stat.summary(0, "connected");
   } else {
@@ -0,0 +1,455 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief Typed metrics registry and OpenMetrics exporter
+ * @file metrics.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "mavros/metrics.hpp"
+#include "rclcpp/logging.hpp"
+
+using namespace mavros::metrics;  // NOLINT
+
+// -*- metric types -*-
+
+void Gauge::add(double v)
+{
+  double cur = value.load(std::memory_order_relaxed);
+  while (!value.compare_exchange_weak(cur, cur + v, std::memory_order_relaxed)) {
+  }
+}
+
+Histogram::Histogram(const std::vector<double> & bounds_)
+: bounds(bounds_),
+  buckets(new std::atomic<uint64_t>[bounds_.size() + 1]),
+  count(0),
+  sum(0.0)
+{
+  if (!std::is_sorted(bounds.begin(), bounds.end())) {
+    throw std::invalid_argument("Histogram: bounds must be sorted");
+  }
+
+  for (size_t i = 0; i <= bounds.size(); i++) {
+    buckets[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::observe(double v)
+{
+  // NOTE: buckets are few, linear search is faster than binary one here
+  size_t idx = 0;
+  while (idx < bounds.size() && v > bounds[idx]) {
+    idx++;
+  }
+
+  buckets[idx].fetch_add(1, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+
+  double cur = sum.load(std::memory_order_relaxed);
+  while (!sum.compare_exchange_weak(cur, cur + v, std::memory_order_relaxed)) {
+  }
+}
+
+std::vector<uint64_t> Histogram::get_buckets() const
+{
+  std::vector<uint64_t> ret(bounds.size() + 1);
+  for (size_t i = 0; i < ret.size(); i++) {
+    ret[i] = buckets[i].load(std::memory_order_relaxed);
+  }
+
+  return ret;
+}
+
+std::vector<double> Histogram::latency_bounds()
+{
+  return {
+    1e-6, 2.5e-6, 5e-6,
+    1e-5, 2.5e-5, 5e-5,
+    1e-4, 2.5e-4, 5e-4,
+    1e-3, 2.5e-3, 5e-3,
+    1e-2, 2.5e-2, 5e-2,
+    1e-1,
+  };
+}
+
+// -*- registry -*-
+
+Registry::Registry()
+: collector_id(0)
+{}
+
+Registry & Registry::global()
+{
+  static Registry registry;
+  return registry;
+}
+
+template<typename T>
+std::shared_ptr<T> Registry::get_or_create(
+  Type type, const std::string & name, const std::string & help,
+  const Labels & labels, std::function<std::shared_ptr<T>()> factory)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto fit = families.find(name);
+  if (fit == families.end()) {
+    fit = families.emplace(name, Family{type, help, {}}).first;
+  } else if (fit->second.type != type) {
+    throw std::invalid_argument("metric " + name + " already registered with other type");
+  }
+
+  auto & metrics = fit->second.metrics;
+  auto mit = metrics.find(labels);
+  if (mit != metrics.end()) {
+    return std::static_pointer_cast<T>(mit->second);
+  }
+
+  auto metric = factory();
+  metrics.emplace(labels, metric);
+  return metric;
+}
+
+Counter::SharedPtr Registry::counter(
+  const std::string & name, const std::string & help,
+  const Labels & labels)
+{
+  return get_or_create<Counter>(
+    Type::COUNTER, name, help, labels, [] {
+      return std::make_shared<Counter>();
+    });
+}
+
+Gauge::SharedPtr Registry::gauge(
+  const std::string & name, const std::string & help,
+  const Labels & labels)
+{
+  return get_or_create<Gauge>(
+    Type::GAUGE, name, help, labels, [] {
+      return std::make_shared<Gauge>();
+    });
+}
+
+Histogram::SharedPtr Registry::histogram(
+  const std::string & name, const std::string & help,
+  const std::vector<double> & bounds, const Labels & labels)
+{
+  return get_or_create<Histogram>(
+    Type::HISTOGRAM, name, help, labels, [&bounds] {
+      return std::make_shared<Histogram>(bounds);
+    });
+}
+
+void Registry::remove(const std::string & name, const Labels & labels)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto fit = families.find(name);
+  if (fit != families.end()) {
+    fit->second.metrics.erase(labels);
+  }
+}
+
+size_t Registry::add_collector(CollectorCb cb)
+{
+  std::lock_guard<std::mutex> lock(collectors_mutex);
+
+  auto id = ++collector_id;
+  collectors.emplace(id, cb);
+  return id;
+}
+
+void Registry::remove_collector(size_t id)
+{
+  std::lock_guard<std::mutex> lock(collectors_mutex);
+  collectors.erase(id);
+}
+
+static void format_value(std::string & out, double v)
+{
+  if (std::isinf(v)) {
+    out += (v > 0) ? "+Inf" : "-Inf";
+  } else if (std::isnan(v)) {
+    out += "NaN";
+  } else {
+    // shortest form which reads back exactly
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.15g", v);
+    if (std::strtod(buf, nullptr) != v) {
+      snprintf(buf, sizeof(buf), "%.17g", v);
+    }
+    out += buf;
+  }
+}
+
+static void format_labels(std::string & out, const Labels & labels, const char * le = nullptr)
+{
+  if (labels.empty() && le == nullptr) {
+    return;
+  }
+
+  out += '{';
+  bool first = true;
+  for (auto & kv : labels) {
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+
+    out += kv.first;
+    out += "=\"";
+    for (auto c : kv.second) {
+      switch (c) {
+        case '\\': out += "\\\\"; break;
+        case '"': out += "\\\""; break;
+        case '\n': out += "\\n"; break;
+        default: out += c; break;
+      }
+    }
+    out += '"';
+  }
+
+  if (le != nullptr) {
+    if (!first) {
+      out += ',';
+    }
+    out += "le=\"";
+    out += le;
+    out += '"';
+  }
+
+  out += '}';
+}
+
+std::string Registry::serialize()
+{
+  // NOTE: collectors run without registry lock, they may take locks of their owners.
+  //       collectors_mutex keeps remove_collector() waiting until the owner is not used.
+  {
+    std::lock_guard<std::mutex> lock(collectors_mutex);
+    for (auto & kv : collectors) {
+      kv.second(*this);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::string out;
+
+  for (auto & fkv : families) {
+    auto & name = fkv.first;
+    auto & family = fkv.second;
+    if (family.metrics.empty()) {
+      continue;
+    }
+
+    const char * type_str =
+      (family.type == Type::COUNTER) ? "counter" :
+      (family.type == Type::GAUGE) ? "gauge" : "histogram";
+
+    out += "# TYPE " + name + " " + type_str + "\n";
+    out += "# HELP " + name + " " + family.help + "\n";
+
+    for (auto & mkv : family.metrics) {
+      auto & labels = mkv.first;
+
+      switch (family.type) {
+        case Type::COUNTER: {
+            auto c = std::static_pointer_cast<Counter>(mkv.second);
+            out += name + "_total";
+            format_labels(out, labels);
+            out += ' ' + std::to_string(c->get()) + '\n';
+          }
+          break;
+
+        case Type::GAUGE: {
+            auto g = std::static_pointer_cast<Gauge>(mkv.second);
+            out += name;
+            format_labels(out, labels);
+            out += ' ';
+            format_value(out, g->get());
+            out += '\n';
+          }
+          break;
+
+        case Type::HISTOGRAM: {
+            auto h = std::static_pointer_cast<Histogram>(mkv.second);
+            auto & bounds = h->get_bounds();
+            auto buckets = h->get_buckets();
+
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < buckets.size(); i++) {
+              std::string le;
+              if (i < bounds.size()) {
+                format_value(le, bounds[i]);
+              } else {
+                le = "+Inf";
+              }
+
+              cumulative += buckets[i];
+              out += name + "_bucket";
+              format_labels(out, labels, le.c_str());
+              out += ' ' + std::to_string(cumulative) + '\n';
+            }
+
+            out += name + "_count";
+            format_labels(out, labels);
+            out += ' ' + std::to_string(cumulative) + '\n';
+
+            out += name + "_sum";
+            format_labels(out, labels);
+            out += ' ';
+            format_value(out, h->get_sum());
+            out += '\n';
+          }
+          break;
+      }
+    }
+  }
+
+  out += "# EOF\n";
+  return out;
+}
+
+// -*- exporter -*-
+
+Exporter::Exporter(
+  Registry & registry_, uint16_t port_, const std::string & bind_address,
+  rclcpp::Logger logger_)
+: registry(registry_),
+  port(port_),
+  logger(logger_),
+  listen_fd(-1),
+  stop_request(false)
+{
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, bind_address.c_str(), &addr.sin_addr) != 1) {
+    throw std::invalid_argument("metrics: bad bind address: " + bind_address);
+  }
+
+  listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0) {
+    throw std::system_error(errno, std::system_category(), "metrics: socket");
+  }
+
+  int one = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+    listen(listen_fd, 4) < 0)
+  {
+    int err = errno;
+    close(listen_fd);
+    throw std::system_error(err, std::system_category(), "metrics: bind");
+  }
+
+  // port may be 0, get one assigned by the kernel
+  socklen_t addrlen = sizeof(addr);
+  getsockname(listen_fd, reinterpret_cast<sockaddr *>(&addr), &addrlen);
+  port = ntohs(addr.sin_port);
+
+  RCLCPP_INFO(
+    logger, "Metrics: serving http://%s:%u/metrics", bind_address.c_str(), port);
+
+  server_thread = std::thread(&Exporter::run, this);
+}
+
+Exporter::~Exporter()
+{
+  stop_request = true;
+  if (server_thread.joinable()) {
+    server_thread.join();
+  }
+
+  close(listen_fd);
+}
+
+void Exporter::run()
+{
+  pollfd pfd{listen_fd, POLLIN, 0};
+
+  while (!stop_request) {
+    // NOTE: poll timeout bounds shutdown latency
+    int ret = poll(&pfd, 1, 200);
+    if (ret <= 0) {
+      continue;
+    }
+
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+
+    handle_client(fd);
+    close(fd);
+  }
+}
+
+void Exporter::handle_client(int fd)
+{
+  timeval tv{1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  // read request head, body is not expected
+  std::string request;
+  char buf[1024];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+    auto n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      return;
+    }
+    request.append(buf, n);
+  }
+
+  std::string status, content_type, body;
+  if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET /metrics?", 0) == 0) {
+    status = "200 OK";
+    content_type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    body = registry.serialize();
+  } else {
+    status = "404 Not Found";
+    content_type = "text/plain";
+    body = "not found\n";
+  }
+
+  std::string response =
+    "HTTP/1.1 " + status + "\r\n"
+    "Content-Type: " + content_type + "\r\n"
+    "Content-Length: " + std::to_string(body.size()) + "\r\n"
+    "Connection: close\r\n\r\n" + body;
+
+  size_t off = 0;
+  while (off < response.size()) {
+    auto n = send(fd, response.data() + off, response.size() - off, MSG_NOSIGNAL);
+    if (n <= 0) {
+      RCLCPP_DEBUG(logger, "Metrics: send: %s", strerror(errno));
+      return;
+    }
+    off += n;
+  }
+}
@@ -0,0 +1,583 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief MAVLink traffic recorder
+ * @file recorder.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef MAVROS_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#include "mavconn/tlog.hpp"
+#include "mavros/recorder.hpp"
+#include "mavros/utils.hpp"
+#include "rclcpp/logging.hpp"
+
+using namespace mavros::router;  // NOLINT
+using namespace mavros::router::recfmt;  // NOLINT
+using mavros::utils::format;
+using steady_clock = std::chrono::steady_clock;
+
+static inline msgid_t frame_msgid(const uint8_t * frame, size_t length)
+{
+  if (frame[0] == MAVLINK_STX && length >= MAVLINK_NUM_HEADER_BYTES) {
+    return frame[7] | (frame[8] << 8) | (frame[9] << 16);
+  } else if (length >= MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1) {
+    return frame[5];
+  }
+
+  return 0;
+}
+
+/* -*- Recorder -*- */
+
+Recorder::Recorder(const Options & opts_, rclcpp::Logger logger_)
+: opts(opts_),
+  logger(logger_),
+  ring(std::max<size_t>(opts_.queue_size, 16)),
+  head(0),
+  tail(0),
+  stop_request(false),
+  stat_recorded(0),
+  stat_dropped(0),
+  stat_bytes_written(0),
+  stat_chunks(0),
+  stat_files(0),
+  file(nullptr),
+  file_size(0),
+  file_index(0),
+  chunk_hdr{}
+{
+#ifndef MAVROS_WITH_ZLIB
+  if (opts.compress) {
+    RCLCPP_WARN(logger, "Recorder: built without zlib, compression disabled");
+    opts.compress = false;
+  }
+#endif
+
+  chunk.reserve(opts.chunk_size + sizeof(Slot));
+  open_file();
+
+  writer_thread = std::thread(
+    [this]() {
+      mavros::utils::set_this_thread_name("recorder");
+      run();
+    });
+}
+
+Recorder::~Recorder()
+{
+  {
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    stop_request = true;
+    ring_cond.notify_all();
+  }
+
+  if (writer_thread.joinable()) {
+    writer_thread.join();
+  }
+
+  close_file();
+}
+
+uint64_t Recorder::now_usec()
+{
+  return mavconn::TlogWriter::now_usec();
+}
+
+void Recorder::record(uint32_t src_id, const mavlink_message_t * msg, Framing framing)
+{
+  {
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    if (tail - head >= ring.size()) {
+      stat_dropped++;
+      return;
+    }
+
+    auto & slot = ring[tail % ring.size()];
+    slot.hdr.time_usec = now_usec();
+    slot.hdr.src_id = src_id;
+    slot.hdr.framing = mavros::utils::enum_value(framing);
+    slot.hdr.reserved = 0;
+    slot.hdr.length = mavlink::mavlink_msg_to_send_buffer(slot.frame, msg);
+    tail++;
+  }
+
+  stat_recorded++;
+  ring_cond.notify_one();
+}
+
+Recorder::Stats Recorder::get_stats()
+{
+  return {
+    stat_recorded.load(),
+    stat_dropped.load(),
+    stat_bytes_written.load(),
+    stat_chunks.load(),
+    stat_files.load(),
+  };
+}
+
+std::string Recorder::get_current_file()
+{
+  std::lock_guard<std::mutex> lock(file_mutex);
+  return file_name;
+}
+
+void Recorder::run()
+{
+  std::unique_lock<std::mutex> lock(ring_mutex);
+
+  while (true) {
+    ring_cond.wait_for(
+      lock, opts.chunk_duration / 4, [this] {
+        return stop_request || tail != head;
+      });
+
+    // NOTE: producers never touch slots in [head, tail), so they could be read unlocked
+    const size_t from = head, to = tail;
+    const bool stop = stop_request;
+    lock.unlock();
+
+    // check size per record, a backlog must not produce oversized chunks
+    for (size_t i = from; i < to; i++) {
+      append(ring[i % ring.size()]);
+      if (chunk.size() >= opts.chunk_size) {
+        flush_chunk();
+      }
+    }
+
+    const bool chunk_old = !chunk.empty() && steady_clock::now() - chunk_started >=
+      opts.chunk_duration;
+    if (chunk_old || stop) {
+      flush_chunk();
+    }
+
+    lock.lock();
+    head = to;
+
+    if (stop && head == tail) {
+      break;
+    }
+  }
+}
+
+void Recorder::append(const Slot & slot)
+{
+  const auto & hdr = slot.hdr;
+
+  if (chunk.empty()) {
+    chunk_hdr = {};
+    chunk_hdr.t_start = hdr.time_usec;
+    chunk_index.clear();
+    chunk_started = steady_clock::now();
+  }
+
+  chunk_hdr.t_end = hdr.time_usec;
+  chunk_hdr.record_count++;
+
+  auto msgid = frame_msgid(slot.frame, hdr.length);
+  auto it = chunk_index.find(msgid);
+  if (it == chunk_index.end()) {
+    chunk_index[msgid] = IndexEntry{msgid, 1, hdr.time_usec, hdr.time_usec};
+  } else {
+    it->second.count++;
+    it->second.t_last = hdr.time_usec;
+  }
+
+  auto hdr_p = reinterpret_cast<const uint8_t *>(&hdr);
+  chunk.insert(chunk.end(), hdr_p, hdr_p + sizeof(hdr));
+  chunk.insert(chunk.end(), slot.frame, slot.frame + hdr.length);
+}
+
+void Recorder::flush_chunk()
+{
+  if (chunk.empty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(file_mutex);
+  if (!file) {
+    chunk.clear();
+    return;
+  }
+
+  const uint8_t * data = chunk.data();
+  size_t stored_size = chunk.size();
+  Compression compression = Compression::NONE;
+
+#ifdef MAVROS_WITH_ZLIB
+  std::vector<uint8_t> compressed;
+  if (opts.compress) {
+    uLongf dest_len = compressBound(chunk.size());
+    compressed.resize(dest_len);
+
+    int ret = compress2(
+      compressed.data(), &dest_len, chunk.data(), chunk.size(),
+      Z_BEST_SPEED);
+    if (ret == Z_OK) {
+      data = compressed.data();
+      stored_size = dest_len;
+      compression = Compression::ZLIB;
+    }
+  }
+#endif
+
+  std::memcpy(chunk_hdr.magic, CHUNK_MAGIC, sizeof(chunk_hdr.magic));
+  chunk_hdr.compression = mavros::utils::enum_value(compression);
+  chunk_hdr.raw_size = chunk.size();
+  chunk_hdr.stored_size = stored_size;
+  chunk_hdr.index_count = chunk_index.size();
+
+  FooterEntry fe{};
+  fe.info.offset = file_size;
+  fe.info.t_start = chunk_hdr.t_start;
+  fe.info.t_end = chunk_hdr.t_end;
+  fe.info.index_count = chunk_hdr.index_count;
+  fe.index.reserve(chunk_index.size());
+  for (auto & kv : chunk_index) {
+    fe.index.push_back(kv.second);
+  }
+
+  write(&chunk_hdr, sizeof(chunk_hdr));
+  write(fe.index.data(), fe.index.size() * sizeof(IndexEntry));
+  write(data, stored_size);
+
+  footer.emplace_back(std::move(fe));
+  chunk.clear();
+  stat_chunks++;
+
+  // rotate
+  const bool too_big = opts.max_file_size > 0 && file_size >= opts.max_file_size;
+  const bool too_old = opts.max_file_duration.count() > 0 &&
+    steady_clock::now() - file_opened >= opts.max_file_duration;
+  if (too_big || too_old) {
+    close_file();
+    open_file();
+  }
+}
+
+void Recorder::open_file()
+{
+  // NOTE: called with file_mutex held, or from constructor
+  std::time_t t = std::time(nullptr);
+  std::tm tm{};
+  localtime_r(&t, &tm);
+
+  char ts[32];
+  std::strftime(ts, sizeof(ts), "%Y%m%d_%H%M%S", &tm);
+  file_name = format("%s_%s_%03zu.mavrec", opts.path_prefix.c_str(), ts, file_index++);
+
+  file = std::fopen(file_name.c_str(), "wb");
+  if (!file) {
+    RCLCPP_ERROR(logger, "Recorder: %s: %s", file_name.c_str(), strerror(errno));
+    return;
+  }
+
+  file_size = 0;
+  file_opened = steady_clock::now();
+  footer.clear();
+  stat_files++;
+
+  FileHeader fh{};
+  std::memcpy(fh.magic, FILE_MAGIC, sizeof(fh.magic));
+  fh.version = VERSION;
+  write(&fh, sizeof(fh));
+
+  RCLCPP_INFO(logger, "Recorder: writing %s", file_name.c_str());
+}
+
+void Recorder::close_file()
+{
+  if (!file) {
+    return;
+  }
+
+  FooterHeader fh{};
+  std::memcpy(fh.magic, FOOTER_MAGIC, sizeof(fh.magic));
+  fh.chunk_count = footer.size();
+
+  Trailer tr{};
+  tr.footer_offset = file_size;
+  std::memcpy(tr.magic, TRAILER_MAGIC, sizeof(tr.magic));
+
+  write(&fh, sizeof(fh));
+  for (auto & fe : footer) {
+    write(&fe.info, sizeof(fe.info));
+    write(fe.index.data(), fe.index.size() * sizeof(IndexEntry));
+  }
+  write(&tr, sizeof(tr));
+
+  std::fclose(file);
+  file = nullptr;
+  footer.clear();
+
+  RCLCPP_INFO(logger, "Recorder: closed %s, %zu bytes", file_name.c_str(), file_size);
+}
+
+void Recorder::write(const void * data, size_t size)
+{
+  if (size == 0) {
+    return;
+  }
+
+  if (std::fwrite(data, 1, size, file) != size) {
+    RCLCPP_ERROR_ONCE(logger, "Recorder: %s: write error: %s", file_name.c_str(), strerror(errno));
+  }
+
+  file_size += size;
+  stat_bytes_written += size;
+}
+
+/* -*- RecordReader -*- */
+
+RecordReader::RecordReader(const std::string & path)
+: file(nullptr),
+  footer_found(false)
+{
+  file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    throw std::runtime_error(format("%s: %s", path.c_str(), strerror(errno)));
+  }
+
+  FileHeader fh{};
+  if (std::fread(&fh, sizeof(fh), 1, file) != 1 ||
+    std::memcmp(fh.magic, FILE_MAGIC, sizeof(fh.magic)) != 0 ||
+    fh.version != VERSION)
+  {
+    std::fclose(file);
+    throw std::runtime_error(format("%s: not a recorder file", path.c_str()));
+  }
+
+  footer_found = load_footer();
+  if (!footer_found) {
+    scan_chunks();
+  }
+}
+
+RecordReader::~RecordReader()
+{
+  std::fclose(file);
+}
+
+bool RecordReader::load_footer()
+{
+  Trailer tr{};
+  if (std::fseek(file, -static_cast<long>(sizeof(tr)), SEEK_END) != 0 ||    // NOLINT
+    std::fread(&tr, sizeof(tr), 1, file) != 1 ||
+    std::memcmp(tr.magic, TRAILER_MAGIC, sizeof(tr.magic)) != 0)
+  {
+    return false;
+  }
+
+  FooterHeader fh{};
+  if (std::fseek(file, tr.footer_offset, SEEK_SET) != 0 ||
+    std::fread(&fh, sizeof(fh), 1, file) != 1 ||
+    std::memcmp(fh.magic, FOOTER_MAGIC, sizeof(fh.magic)) != 0)
+  {
+    return false;
+  }
+
+  chunks.clear();
+  chunks.reserve(fh.chunk_count);
+  for (uint32_t i = 0; i < fh.chunk_count; i++) {
+    FooterChunk fc{};
+    if (std::fread(&fc, sizeof(fc), 1, file) != 1) {
+      return false;
+    }
+
+    ChunkInfo info{fc.offset, fc.t_start, fc.t_end, std::vector<IndexEntry>(fc.index_count)};
+    if (fc.index_count &&
+      std::fread(info.index.data(), sizeof(IndexEntry), fc.index_count, file) != fc.index_count)
+    {
+      return false;
+    }
+
+    chunks.emplace_back(std::move(info));
+  }
+
+  return true;
+}
+
+void RecordReader::scan_chunks()
+{
+  // NOTE: file was not closed properly, walk chunk headers, last one may be truncated
+  chunks.clear();
+
+  uint64_t offset = sizeof(FileHeader);
+  while (std::fseek(file, offset, SEEK_SET) == 0) {
+    ChunkHeader ch{};
+    if (std::fread(&ch, sizeof(ch), 1, file) != 1 ||
+      std::memcmp(ch.magic, CHUNK_MAGIC, sizeof(ch.magic)) != 0)
+    {
+      break;
+    }
+
+    ChunkInfo info{offset, ch.t_start, ch.t_end, std::vector<IndexEntry>(ch.index_count)};
+    if (ch.index_count &&
+      std::fread(info.index.data(), sizeof(IndexEntry), ch.index_count, file) != ch.index_count)
+    {
+      break;
+    }
+
+    const uint64_t next = offset + sizeof(ch) + ch.index_count * sizeof(IndexEntry) +
+      ch.stored_size;
+
+    // check that data is complete
+    if (std::fseek(file, next - 1, SEEK_SET) != 0 || std::fgetc(file) == EOF) {
+      break;
+    }
+
+    chunks.emplace_back(std::move(info));
+    offset = next;
+  }
+}
+
+void RecordReader::read_chunk(const ChunkInfo & info, std::vector<uint8_t> & data)
+{
+  ChunkHeader ch{};
+  if (std::fseek(file, info.offset, SEEK_SET) != 0 ||
+    std::fread(&ch, sizeof(ch), 1, file) != 1 ||
+    std::fseek(file, ch.index_count * sizeof(IndexEntry), SEEK_CUR) != 0)
+  {
+    throw std::runtime_error("chunk read error");
+  }
+
+  std::vector<uint8_t> stored(ch.stored_size);
+  if (std::fread(stored.data(), 1, stored.size(), file) != stored.size()) {
+    throw std::runtime_error("chunk read error");
+  }
+
+  switch (static_cast<Compression>(ch.compression)) {
+    case Compression::NONE:
+      data = std::move(stored);
+      break;
+
+#ifdef MAVROS_WITH_ZLIB
+    case Compression::ZLIB: {
+        uLongf dest_len = ch.raw_size;
+        data.resize(ch.raw_size);
+        if (uncompress(data.data(), &dest_len, stored.data(), stored.size()) != Z_OK) {
+          throw std::runtime_error("chunk decompress error");
+        }
+      }
+      break;
+#endif
+
+    default:
+      throw std::runtime_error("unsupported chunk compression");
+  }
+}
+
+size_t RecordReader::query(msgid_t msgid, uint64_t t_from, uint64_t t_to, RecordCb cb)
+{
+  size_t count = 0;
+  std::vector<uint8_t> data;
+
+  for (auto & info : chunks) {
+    if (info.t_end < t_from || info.t_start > t_to) {
+      continue;
+    }
+
+    auto it = std::find_if(
+      info.index.begin(), info.index.end(), [msgid](const IndexEntry & e) {
+        return e.msgid == msgid;
+      });
+    if (it == info.index.end() || it->t_last < t_from || it->t_first > t_to) {
+      continue;
+    }
+
+    read_chunk(info, data);
+
+    for (size_t pos = 0; pos + sizeof(RecordHeader) <= data.size(); ) {
+      RecordHeader rh;
+      std::memcpy(&rh, data.data() + pos, sizeof(rh));
+      const uint8_t * frame = data.data() + pos + sizeof(rh);
+      pos += sizeof(rh) + rh.length;
+
+      if (pos > data.size()) {
+        break;
+      }
+      if (rh.time_usec < t_from || rh.time_usec > t_to) {
+        continue;
+      }
+      if (frame_msgid(frame, rh.length) != msgid) {
+        continue;
+      }
+
+      Record rec{rh.time_usec, rh.src_id, static_cast<Framing>(rh.framing), {}};
+      if (mavconn::TlogReader::decode({rh.time_usec, frame, rh.length}, rec.msg) ==
+        Framing::incomplete)
+      {
+        continue;
+      }
+
+      cb(rec);
+      count++;
+    }
+  }
+
+  return count;
+}
+
+std::vector<RecordReader::Record> RecordReader::time_series(
+  msgid_t msgid, uint64_t t_from,
+  uint64_t t_to)
+{
+  std::vector<Record> ret;
+  query(
+    msgid, t_from, t_to, [&ret](const Record & rec) {
+      ret.push_back(rec);
+    });
+
+  return ret;
+}
+
+size_t RecordReader::read_all(RecordCb cb)
+{
+  size_t count = 0;
+  std::vector<uint8_t> data;
+
+  for (auto & info : chunks) {
+    read_chunk(info, data);
+
+    for (size_t pos = 0; pos + sizeof(RecordHeader) <= data.size(); ) {
+      RecordHeader rh;
+      std::memcpy(&rh, data.data() + pos, sizeof(rh));
+      const uint8_t * frame = data.data() + pos + sizeof(rh);
+      pos += sizeof(rh) + rh.length;
+
+      if (pos > data.size()) {
+        break;
+      }
+
+      Record rec{rh.time_usec, rh.src_id, static_cast<Framing>(rh.framing), {}};
+      if (mavconn::TlogReader::decode({rh.time_usec, frame, rh.length}, rec.msg) ==
+        Framing::incomplete)
+      {
+        continue;
+      }
+
+      cb(rec);
+      count++;
+    }
+  }
+
+  return count;
+}
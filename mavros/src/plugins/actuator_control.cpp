@@ -15,8 +15,17 @@
  * @{
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "rcpputils/asserts.hpp"
 #include "mavros/mavros_uas.hpp"
+#include "mavros/metrics.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/plugin_filter.hpp"
 
@@ -33,13 +42,70 @@ using namespace std::placeholders;      // NOLINT
  * @plugin actuator_control
  *
  * Sends actuator controls to FCU controller.
+ *
+ * With send_rate > 0 the latest controls of each group are kept in a buffer
+ * and sent by a dedicated thread at that rate, so faster input is coalesced.
+ * Group without input for input_timeout is sent with safe_controls instead,
+ * for SAFE_CONTROLS_COUNT periods, then it is not sent until the next input.
  */
 class ActuatorControlPlugin : public plugin::Plugin
 {
 public:
+  using steady_clock = std::chrono::steady_clock;
+
   explicit ActuatorControlPlugin(plugin::UASPtr uas_)
-  : Plugin(uas_, "actuator_control")
+  : Plugin(uas_, "actuator_control"),
+    groups{},
+    send_period(0),
+    input_timeout(std::chrono::milliseconds(100)),
+    safe_controls{},
+    stop_request(false),
+    stat_sent(0),
+    stat_coalesced(0),
+    stat_timeouts(0),
+    stat_staleness_max(0.0),
+    stat_staleness_sum(0.0)
   {
+    staleness_hist = metrics::Registry::global().histogram(
+      "mavros_actuator_control_staleness_seconds",
+      "Age of actuator controls at the time they are sent",
+      metrics::Histogram::latency_bounds(),
+      {{"uas", uas->get_fully_qualified_name()}});
+
+    enable_node_watch_parameters();
+
+    node_declate_and_watch_parameter(
+      "send_rate", 0.0, [&](const rclcpp::Parameter & p) {
+        auto rate = p.as_double();
+        {
+          lock_guard lock(mutex);
+          send_period = (rate > 0.0) ? to_steady(1.0 / rate) : steady_clock::duration::zero();
+        }
+        cond.notify_all();
+
+        // pass-through does not need the thread
+        if (rate > 0.0 && !sender_thread.joinable()) {
+          sender_thread = std::thread(&ActuatorControlPlugin::sender_run, this);
+        }
+      });
+
+    node_declate_and_watch_parameter(
+      "input_timeout", 0.1, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(mutex);
+        input_timeout = to_steady(p.as_double());
+      });
+
+    node_declate_and_watch_parameter(
+      "safe_controls", std::vector<double>(8, 0.0), [&](const rclcpp::Parameter & p) {
+        auto v = p.as_double_array();
+
+        lock_guard lock(mutex);
+        safe_controls.fill(0.0f);
+        std::copy_n(v.begin(), std::min(v.size(), safe_controls.size()), safe_controls.begin());
+      });
+
+    uas->diagnostic_updater.add("Actuator control", this, &ActuatorControlPlugin::diag_run);
+
     auto sensor_qos = rclcpp::SensorDataQoS();
 
     target_actuator_control_pub = node->create_publisher<mavros_msgs::msg::ActuatorControl>(
@@ -47,6 +113,8 @@ public:
     actuator_control_sub = node->create_subscription<mavros_msgs::msg::ActuatorControl>(
       "actuator_control", sensor_qos, std::bind(
         &ActuatorControlPlugin::actuator_control_cb, this, _1));
+
+    enable_connection_cb();
   }
 
   Subscriptions get_subscriptions() override
@@ -56,10 +124,204 @@ public:
     };
   }
 
+  ~ActuatorControlPlugin() override
+  {
+    {
+      lock_guard lock(mutex);
+      stop_request = true;
+    }
+    cond.notify_all();
+
+    if (sender_thread.joinable()) {
+      sender_thread.join();
+    }
+  }
+
 private:
+  using lock_guard = std::lock_guard<std::mutex>;
+  using Controls = std::array<float, 8>;
+
+  //! Number of safe_controls sends after input timeout
+  static constexpr size_t SAFE_CONTROLS_COUNT = 10;
+
+  //! Latest value of one control group
+  struct Group
+  {
+    bool active;          //!< got input, not yet timed out for good
+    bool dirty;           //!< not sent since last update
+    size_t safe_sent;     //!< safe_controls sent since input timeout
+    Controls controls;
+    rclcpp::Time stamp;   //!< input header stamp, zero if not set
+    steady_clock::time_point received;
+  };
+
+  //! Group value copied for sending
+  struct Pending
+  {
+    uint8_t group;
+    bool timed_out;
+    Controls controls;
+    rclcpp::Time stamp;
+    steady_clock::time_point received;
+  };
+
   rclcpp::Publisher<mavros_msgs::msg::ActuatorControl>::SharedPtr target_actuator_control_pub;
   rclcpp::Subscription<mavros_msgs::msg::ActuatorControl>::SharedPtr actuator_control_sub;
 
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::array<Group, 8> groups;
+  steady_clock::duration send_period;
+  steady_clock::duration input_timeout;
+  Controls safe_controls;
+  bool stop_request;
+  std::thread sender_thread;
+
+  metrics::Histogram::SharedPtr staleness_hist;
+  size_t stat_sent;
+  size_t stat_coalesced;
+  size_t stat_timeouts;
+  double stat_staleness_max;
+  double stat_staleness_sum;
+
+  static steady_clock::duration to_steady(double seconds)
+  {
+    return std::chrono::duration_cast<steady_clock::duration>(
+      std::chrono::duration<double>(seconds));
+  }
+
+  void send_controls(uint8_t group, const Controls & controls, uint64_t time_usec)
+  {
+    //! about groups, mixing and channels: @p https://pixhawk.org/dev/mixing
+    //! message definiton here: @p https://mavlink.io/en/messages/common.html#SET_ACTUATOR_CONTROL_TARGET
+    mavlink::common::msg::SET_ACTUATOR_CONTROL_TARGET act{};
+
+    act.time_usec = time_usec;
+    act.group_mlx = group;
+    uas->msg_set_target(act);
+    act.controls = controls;
+
+    uas->send_message(act);
+  }
+
+  //! Sender thread: flush latest group values every send_period
+  void sender_run()
+  {
+    utils::set_this_thread_name("actuator-ctl");
+
+    std::vector<Pending> pending;
+    pending.reserve(groups.size());
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto next = steady_clock::now();
+    while (!stop_request) {
+      if (send_period == steady_clock::duration::zero()) {
+        cond.wait(lock);
+        next = steady_clock::now();
+        continue;
+      }
+
+      next += send_period;
+      auto now = steady_clock::now();
+      if (next < now) {
+        next = now;             // we are late, do not burst
+      }
+
+      if (cond.wait_until(lock, next, [&] {return stop_request;})) {
+        break;
+      }
+
+      now = steady_clock::now();
+      pending.clear();
+      for (size_t i = 0; i < groups.size(); i++) {
+        auto & g = groups[i];
+        if (!g.active) {
+          continue;
+        }
+
+        const bool timed_out = now - g.received > input_timeout;
+        if (timed_out && ++g.safe_sent > SAFE_CONTROLS_COUNT) {
+          g.active = false;     // producer is gone, stop spamming FCU
+          continue;
+        }
+
+        pending.push_back(
+          {uint8_t(i), timed_out, timed_out ? safe_controls : g.controls, g.stamp, g.received});
+        g.dirty = false;
+      }
+
+      lock.unlock();
+      send_pending(pending, now);
+      lock.lock();
+    }
+  }
+
+  //! Send collected values, called without mutex
+  void send_pending(const std::vector<Pending> & pending, steady_clock::time_point now)
+  {
+    auto ros_now = node->now();
+    size_t n_timeouts = 0;
+    double max_age = 0.0, sum_age = 0.0;
+
+    for (auto & p : pending) {
+      if (p.timed_out) {
+        n_timeouts++;
+        send_controls(p.group, p.controls, get_time_usec(ros_now));
+        continue;
+      }
+
+      // end-to-end if producer stamped the message, otherwise since reception
+      const bool stamped = p.stamp.nanoseconds() != 0 &&
+        p.stamp.get_clock_type() == ros_now.get_clock_type();
+      const double age = stamped ?
+        (ros_now - p.stamp).seconds() :
+        std::chrono::duration<double>(now - p.received).count();
+
+      staleness_hist->observe(age);
+      max_age = std::max(max_age, age);
+      sum_age += age;
+
+      send_controls(p.group, p.controls, get_time_usec(p.stamp));
+    }
+
+    lock_guard lock(mutex);
+    stat_sent += pending.size() - n_timeouts;
+    stat_timeouts += n_timeouts;
+    stat_staleness_max = std::max(stat_staleness_max, max_age);
+    stat_staleness_sum += sum_age;
+  }
+
+  void diag_run(diagnostic_updater::DiagnosticStatusWrapper & stat)
+  {
+    lock_guard lock(mutex);
+
+    if (send_period == steady_clock::duration::zero()) {
+      stat.summary(0, "Pass-through");
+      return;
+    }
+
+    if (stat_timeouts > 0) {
+      stat.summary(1, "Input timeout, sending safe controls");
+    } else {
+      stat.summary(0, "Normal");
+    }
+
+    stat.addf("Sent", "%zu", stat_sent);
+    stat.addf("Coalesced", "%zu", stat_coalesced);
+    stat.addf("Timeouts", "%zu", stat_timeouts);
+    stat.addf("Staleness max (ms)", "%.3f", stat_staleness_max * 1e3);
+    stat.addf(
+      "Staleness avg (ms)", "%.3f",
+      (stat_sent > 0) ? stat_staleness_sum / stat_sent * 1e3 : 0.0);
+
+    // window statistics
+    stat_sent = 0;
+    stat_coalesced = 0;
+    stat_timeouts = 0;
+    stat_staleness_max = 0.0;
+    stat_staleness_sum = 0.0;
+  }
+
   /* -*- rx handlers -*- */
 
   void handle_actuator_control_target(
@@ -77,18 +339,42 @@ private:
 
   /* -*- callbacks -*- */
 
+  void connection_cb(bool connected) override
+  {
+    if (connected) {
+      return;
+    }
+
+    // do not resume old values on reconnect
+    lock_guard lock(mutex);
+    for (auto & g : groups) {
+      g.active = false;
+      g.dirty = false;
+    }
+  }
+
   void actuator_control_cb(const mavros_msgs::msg::ActuatorControl::SharedPtr req)
   {
-    //! about groups, mixing and channels: @p https://pixhawk.org/dev/mixing
-    //! message definiton here: @p https://mavlink.io/en/messages/common.html#SET_ACTUATOR_CONTROL_TARGET
-    mavlink::common::msg::SET_ACTUATOR_CONTROL_TARGET act{};
+    {
+      lock_guard lock(mutex);
 
-    act.time_usec = get_time_usec(req->header.stamp);
-    act.group_mlx = req->group_mix;
-    uas->msg_set_target(act);
-    act.controls = req->controls;
+      if (send_period != steady_clock::duration::zero() && req->group_mix < groups.size()) {
+        auto & g = groups[req->group_mix];
+        if (g.dirty) {
+          stat_coalesced++;
+        }
 
-    uas->send_message(act);
+        g.active = true;
+        g.dirty = true;
+        g.safe_sent = 0;
+        g.controls = req->controls;
+        g.stamp = req->header.stamp;
+        g.received = steady_clock::now();
+        return;
+      }
+    }
+
+    send_controls(req->group_mix, req->controls, get_time_usec(req->header.stamp));
   }
 };
 
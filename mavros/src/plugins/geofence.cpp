@@ -14,7 +14,12 @@
  * @{
  */
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "mavros/mission_protocol_base.hpp"
+#include "mavros/polygon_simplify.hpp"
 
 namespace mavros
 {
@@ -27,12 +32,19 @@ using namespace std::chrono_literals;   // NOLINT
 /**
  * @brief Geofence manipulation plugin
  * @plugin geofence
+ *
+ * Before push polygon vertices may be simplified within simplify_tolerance.
+ * Push of a fence equal to the one known on FCU (after a successful pull,
+ * push or clear call) is skipped,
+ * and with enable_partial_push only the changed range of items is written.
  */
 class GeofencePlugin : public plugin::MissionBase
 {
 public:
   explicit GeofencePlugin(plugin::UASPtr uas_)
-  : MissionBase(uas_, "geofence", plugin::MTYPE::FENCE, "GF", 25s)
+  : MissionBase(uas_, "geofence", plugin::MTYPE::FENCE, "GF", 25s),
+    simplify_tolerance(0.0),
+    fence_synced(false)
   {
     enable_node_watch_parameters();
 
@@ -47,6 +59,23 @@ public:
         use_mission_item_int = p.as_bool();
       });
 
+    node_declate_and_watch_parameter(
+      "simplify_tolerance", 0.0, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(mutex);
+        simplify_tolerance = p.as_double();     // [m], 0 - disabled
+      });
+
+    node_declate_and_watch_parameter(
+      "enable_partial_push", false, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(mutex);
+        enable_partial_push = p.as_bool();
+      });
+
+    metric_push_time = metrics::Registry::global().histogram(
+      "mavros_geofence_push_seconds", "Geofence upload duration",
+      {0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 25.0, 50.0},
+      {{"uas", uas->get_fully_qualified_name()}});
+
     auto gf_qos = rclcpp::QoS(10).transient_local();
 
     gf_list_pub = node->create_publisher<mavros_msgs::msg::WaypointList>("~/fences", gf_qos);
@@ -75,8 +104,96 @@ private:
   rclcpp::Service<mavros_msgs::srv::WaypointPush>::SharedPtr push_srv;
   rclcpp::Service<mavros_msgs::srv::WaypointClear>::SharedPtr clear_srv;
 
+  double simplify_tolerance;
+  bool fence_synced;          //!< waypoints match FCU after successful pull, push or clear
+  metrics::Histogram::SharedPtr metric_push_time;
+
   /* -*- mid-level helpers -*- */
 
+  static bool is_polygon_vertex(const MissionItem & it)
+  {
+    return it.command == enum_value(MAV_CMD::NAV_FENCE_POLYGON_VERTEX_INCLUSION) ||
+           it.command == enum_value(MAV_CMD::NAV_FENCE_POLYGON_VERTEX_EXCLUSION);
+  }
+
+  //! Compare items as they are encoded in MISSION_ITEM_INT
+  static bool same_item(const MissionItem & a, const MissionItem & b)
+  {
+    const double f = MissionItem::encode_factor(a.frame);
+
+    return a.frame == b.frame && a.command == b.command &&
+           a.autocontinue == b.autocontinue &&
+           a.param1 == b.param1 && a.param2 == b.param2 &&
+           a.param3 == b.param3 && a.param4 == b.param4 &&
+           int32_t(a.x_lat * f) == int32_t(b.x_lat * f) &&
+           int32_t(a.y_long * f) == int32_t(b.y_long * f) &&
+           float(a.z_alt) == float(b.z_alt);
+  }
+
+  /**
+   * @brief Simplify polygons, vertex count (param1) of each polygon is updated
+   */
+  void simplify_fence(std::vector<MissionItem> & items)
+  {
+    if (!(simplify_tolerance > 0.0)) {
+      return;
+    }
+
+    std::vector<MissionItem> out;
+    std::vector<Eigen::Vector2d> points;
+    out.reserve(items.size());
+
+    for (size_t i = 0; i < items.size(); ) {
+      auto & first = items[i];
+      const size_t count = first.param1;
+      const bool is_polygon = is_polygon_vertex(first) && count >= 3 && i + count <= items.size() &&
+        std::all_of(
+        items.begin() + i, items.begin() + i + count, [&](const MissionItem & it) {
+          return it.command == first.command && it.frame == first.frame;
+        });
+
+      if (!is_polygon) {
+        out.push_back(first);
+        i++;
+        continue;
+      }
+
+      // global frames: degrees to local meters around first vertex
+      const bool is_global = MissionItem::encode_factor(first.frame) == 1e7;
+      const double lat0 = first.x_lat, lon0 = first.y_long;
+      const double m_per_deg = M_PI / 180.0 * 6378137.0;
+      const double cos_lat0 = std::cos(lat0 * M_PI / 180.0);
+
+      points.clear();
+      for (size_t j = i; j < i + count; j++) {
+        auto & it = items[j];
+        if (is_global) {
+          points.emplace_back(
+            (it.x_lat - lat0) * m_per_deg,
+            (it.y_long - lon0) * m_per_deg * cos_lat0);
+        } else {
+          points.emplace_back(it.x_lat, it.y_long);
+        }
+      }
+
+      auto kept = utils::simplify_polygon(points, simplify_tolerance);
+      for (auto k : kept) {
+        out.push_back(items[i + k]);
+        out.back().param1 = kept.size();
+      }
+
+      i += count;
+    }
+
+    if (out.size() != items.size()) {
+      RCLCPP_INFO(
+        get_logger(), "%s: simplified fence %zu -> %zu items", log_prefix,
+        items.size(), out.size());
+    }
+
+    items = std::move(out);
+  }
+
   // Acts when capabilities of the fcu are changed
   void capabilities_cb(uas::MAV_CAP capabilities [[maybe_unused]]) override
   {
@@ -98,6 +215,7 @@ private:
   {
     lock_guard lock(mutex);
 
+    fence_synced = false;
     if (connected) {
       schedule_pull(BOOTUP_TIME);
     } else if (schedule_timer) {
@@ -139,6 +257,7 @@ private:
 
     wp_state = WP::RXLIST;
     wp_count = 0;
+    fence_synced = false;
     restart_timeout_timer();
 
     lock.unlock();
@@ -147,6 +266,7 @@ private:
     lock.lock();
 
     res->wp_received = waypoints.size();
+    fence_synced = res->success;
     go_idle();  // not nessessary, but prevents from blocking
   }
 
@@ -168,8 +288,7 @@ private:
       return;
     }
 
-    // Full waypoint update
-    wp_state = WP::TXLIST;
+    auto push_start = std::chrono::steady_clock::now();
 
     send_waypoints.clear();
     send_waypoints.reserve(req->waypoints.size());
@@ -177,17 +296,71 @@ private:
       send_waypoints.emplace_back(wp);
     }
 
-    wp_count = send_waypoints.size();
-    wp_end_id = wp_count;
-    wp_cur_id = 0;
-    restart_timeout_timer();
+    simplify_fence(send_waypoints);
+
+    // find changed range against the fence on FCU
+    size_t first_diff = 0, last_diff = 0;
+    const bool same_size = fence_synced && send_waypoints.size() == waypoints.size();
+    if (same_size) {
+      first_diff = send_waypoints.size();
+      for (size_t i = 0; i < send_waypoints.size(); i++) {
+        if (!same_item(send_waypoints[i], waypoints[i])) {
+          first_diff = std::min(first_diff, i);
+          last_diff = i;
+        }
+      }
+
+      if (first_diff == send_waypoints.size()) {
+        RCLCPP_INFO(get_logger(), "%s: fence not changed, push skipped", log_prefix);
+        send_waypoints.clear();
+        res->success = true;
+        res->wp_transfered = 0;
+        return;
+      }
+    }
 
-    lock.unlock();
-    mission_count(wp_count);
-    res->success = wait_push_all();
-    lock.lock();
+    fence_synced = false;
+    if (same_size && enable_partial_push) {
+      // Partial update of changed items
+      wp_state = WP::TXPARTIAL;
+      wp_count = last_diff - first_diff + 1;
+      wp_start_id = first_diff;
+      wp_end_id = last_diff + 1;
+      wp_cur_id = first_diff;
+      restart_timeout_timer();
+
+      lock.unlock();
+      mission_write_partial_list(wp_start_id, wp_end_id);
+      res->success = wait_push_all();
+      lock.lock();
+
+      res->wp_transfered = wp_cur_id - wp_start_id + 1;
+    } else {
+      // Full waypoint update
+      wp_state = WP::TXLIST;
+
+      wp_count = send_waypoints.size();
+      wp_end_id = wp_count;
+      wp_cur_id = 0;
+      restart_timeout_timer();
+
+      lock.unlock();
+      mission_count(wp_count);
+      res->success = wait_push_all();
+      lock.lock();
+
+      res->wp_transfered = wp_cur_id + 1;
+    }
+
+    std::chrono::duration<double> push_time = std::chrono::steady_clock::now() - push_start;
+    if (res->success) {
+      metric_push_time->observe(push_time);
+    }
+    fence_synced = res->success;
+    RCLCPP_INFO(
+      get_logger(), "%s: push of %u items %s in %.2f s", log_prefix, res->wp_transfered,
+      res->success ? "done" : "failed", push_time.count());
 
-    res->wp_transfered = wp_cur_id + 1;
     go_idle();  // same as in pull_cb
   }
 
@@ -209,6 +382,7 @@ private:
     res->success = wait_push_all();
 
     lock.lock();
+    fence_synced = res->success;
     go_idle();  // same as in pull_cb
   }
 };
@@ -336,6 +336,16 @@ private:
     relative_alt.data = gpos.relative_alt / 1E3;                                // in meters
     compass_heading.data = (gpos.hdg != UINT16_MAX) ? gpos.hdg / 1E2 : NAN;     // in degrees
 
+    uas->data.update_snapshot(
+      [&](uas::VehicleSnapshot & vs) {
+        vs.global_stamp_ns = rclcpp::Time(header.stamp).nanoseconds();
+        vs.latitude = fix.latitude;
+        vs.longitude = fix.longitude;
+        vs.altitude = fix.altitude;
+        vs.relative_altitude = relative_alt.data;
+        vs.heading = compass_heading.data;
+      });
+
     /**
      * @brief Global position odometry:
      *
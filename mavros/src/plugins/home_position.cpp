@@ -140,6 +140,14 @@ private:
       get_logger(), "HP: Home lat %f, long %f, alt %f", hp.geo.latitude,
       hp.geo.longitude, hp.geo.altitude);
 
+    uas->data.update_snapshot(
+      [&](uas::VehicleSnapshot & vs) {
+        vs.home_stamp_ns = rclcpp::Time(hp.header.stamp).nanoseconds();
+        vs.home_latitude = hp.geo.latitude;
+        vs.home_longitude = hp.geo.longitude;
+        vs.home_altitude = hp.geo.altitude;
+      });
+
     hp_pub->publish(hp);
   }
 
@@ -16,7 +16,9 @@
 
 #include <tf2_eigen/tf2_eigen.h>
 
+#include <algorithm>
 #include <cmath>
+#include <mutex>
 #include <string>
 
 #include "rcpputils/asserts.hpp"
@@ -29,6 +31,7 @@
 #include "sensor_msgs/msg/temperature.hpp"
 #include "sensor_msgs/msg/fluid_pressure.hpp"
 #include "geometry_msgs/msg/vector3.hpp"
+#include "mavros_msgs/msg/imu_batch.hpp"
 
 namespace mavros
 {
@@ -55,6 +58,10 @@ static constexpr double RAD_TO_DEG = 180.0 / M_PI;
 /**
  * @brief IMU and attitude data publication plugin
  * @plugin imu
+ *
+ * With batch.size > 0 raw samples are not published one by one on ~/data_raw,
+ * but collected into mavros_msgs/ImuBatch on ~/data_raw_batch,
+ * each holding up to batch.size samples spanning at most batch.period.
  */
 class IMUPlugin : public plugin::Plugin
 {
@@ -69,7 +76,9 @@ public:
     has_att_quat(false),
     received_linear_accel(false),
     linear_accel_vec_flu(Eigen::Vector3d::Zero()),
-    linear_accel_vec_frd(Eigen::Vector3d::Zero())
+    linear_accel_vec_frd(Eigen::Vector3d::Zero()),
+    batch_size(0),
+    batch_period_ns(0)
   {
     enable_node_watch_parameters();
 
@@ -105,12 +114,27 @@ public:
         setup_covariance(magnetic_cov, mag_stdev);
       });
 
+    node_declate_and_watch_parameter(
+      "batch.size", 0, [&](const rclcpp::Parameter & p) {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        batch_size = std::max<int64_t>(p.as_int(), 0);
+        reset_batch();
+      });
+    node_declate_and_watch_parameter(
+      "batch.period", 0.01, [&](const rclcpp::Parameter & p) {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        batch_period_ns = static_cast<int64_t>(p.as_double() * 1e9);
+      });
+
     setup_covariance(unk_orientation_cov, 0.0);
 
     auto sensor_qos = rclcpp::SensorDataQoS();
 
     imu_pub = node->create_publisher<sensor_msgs::msg::Imu>("~/data", sensor_qos);
     imu_raw_pub = node->create_publisher<sensor_msgs::msg::Imu>("~/data_raw", sensor_qos);
+    imu_batch_pub = node->create_publisher<mavros_msgs::msg::ImuBatch>(
+      "~/data_raw_batch",
+      sensor_qos);
     magn_pub = node->create_publisher<sensor_msgs::msg::MagneticField>("~/mag", sensor_qos);
     temp_imu_pub = node->create_publisher<sensor_msgs::msg::Temperature>(
       "~/temperature_imu",
@@ -146,6 +170,7 @@ private:
 
   rclcpp::Publisher<sensor_msgs::msg::Imu>::SharedPtr imu_pub;
   rclcpp::Publisher<sensor_msgs::msg::Imu>::SharedPtr imu_raw_pub;
+  rclcpp::Publisher<mavros_msgs::msg::ImuBatch>::SharedPtr imu_batch_pub;
   rclcpp::Publisher<sensor_msgs::msg::MagneticField>::SharedPtr magn_pub;
   rclcpp::Publisher<sensor_msgs::msg::Temperature>::SharedPtr temp_imu_pub;
   rclcpp::Publisher<sensor_msgs::msg::Temperature>::SharedPtr temp_baro_pub;
@@ -165,6 +190,11 @@ private:
   ftf::Covariance3d unk_orientation_cov;
   ftf::Covariance3d magnetic_cov;
 
+  std::mutex batch_mutex;
+  std::atomic<size_t> batch_size;       //!< samples per batch, 0 - batching disabled
+  int64_t batch_period_ns;              //!< max time span of a batch
+  mavros_msgs::msg::ImuBatch imu_batch;
+
   /* -*- helpers -*- */
 
   /**
@@ -280,6 +310,11 @@ private:
     linear_accel_vec_frd = accel_frd;
     received_linear_accel = true;
 
+    if (batch_size > 0) {
+      add_imu_batch_sample(header, gyro_flu, accel_flu);
+      return;
+    }
+
     imu_msg.orientation_covariance = unk_orientation_cov;
     imu_msg.angular_velocity_covariance = angular_velocity_cov;
     imu_msg.linear_acceleration_covariance = linear_acceleration_cov;
@@ -288,6 +323,62 @@ private:
     imu_raw_pub->publish(imu_msg);
   }
 
+  //! Drop collected samples, keeps allocated storage
+  void reset_batch()
+  {
+    imu_batch.time_offset_ns.clear();
+    imu_batch.angular_velocity.clear();
+    imu_batch.linear_acceleration.clear();
+  }
+
+  void publish_batch()
+  {
+    imu_batch.angular_velocity_covariance = angular_velocity_cov;
+    imu_batch.linear_acceleration_covariance = linear_acceleration_cov;
+
+    imu_batch_pub->publish(imu_batch);
+    reset_batch();
+  }
+
+  /**
+   * @brief Add raw sample to the batch, publish batch when it is full
+   *
+   * Batch is also started anew if sample time goes back or frame changes.
+   */
+  void add_imu_batch_sample(
+    const std_msgs::msg::Header & header, const Eigen::Vector3d & gyro_flu,
+    const Eigen::Vector3d & accel_flu)
+  {
+    std::lock_guard<std::mutex> lock(batch_mutex);
+
+    int64_t offset = 0;
+    if (!imu_batch.time_offset_ns.empty()) {
+      offset = (rclcpp::Time(header.stamp) - rclcpp::Time(imu_batch.header.stamp)).nanoseconds();
+
+      if (offset < 0 || offset > UINT32_MAX || header.frame_id != imu_batch.header.frame_id) {
+        publish_batch();
+        offset = 0;
+      }
+    }
+
+    if (imu_batch.time_offset_ns.empty()) {
+      imu_batch.header = header;
+      imu_batch.time_offset_ns.reserve(batch_size);
+      imu_batch.angular_velocity.reserve(batch_size);
+      imu_batch.linear_acceleration.reserve(batch_size);
+    }
+
+    imu_batch.time_offset_ns.push_back(offset);
+    imu_batch.angular_velocity.emplace_back();
+    imu_batch.linear_acceleration.emplace_back();
+    tf2::toMsg(gyro_flu, imu_batch.angular_velocity.back());
+    tf2::toMsg(accel_flu, imu_batch.linear_acceleration.back());
+
+    if (imu_batch.time_offset_ns.size() >= batch_size || offset >= batch_period_ns) {
+      publish_batch();
+    }
+  }
+
   /**
    * @brief Publish magnetic field data
    * @param header	Message frame_id and timestamp
@@ -638,6 +729,9 @@ private:
     has_raw_imu = false;
     has_scaled_imu = false;
     has_att_quat = false;
+
+    std::lock_guard<std::mutex> lock(batch_mutex);
+    reset_batch();
   }
 };
 
@@ -163,6 +163,15 @@ private:
     odom.header = uas->synchronized_header(frame_id, pos_ned.time_boot_ms);
     odom.child_frame_id = tf_child_frame_id;
 
+    uas->data.update_snapshot(
+      [&](uas::VehicleSnapshot & vs) {
+        vs.local_stamp_ns = rclcpp::Time(odom.header.stamp).nanoseconds();
+        for (int i = 0; i < 3; i++) {
+          vs.local_position[i] = enu_position[i];
+          vs.local_velocity[i] = enu_velocity[i];
+        }
+      });
+
     odom.pose.pose.position = tf2::toMsg(enu_position);
     odom.pose.pose.orientation = enu_orientation_msg;
     tf2::toMsg(baselink_linear, odom.twist.twist.linear);
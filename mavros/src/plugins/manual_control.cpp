@@ -15,6 +15,12 @@
  * @{
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+
 #include <rcpputils/asserts.hpp>
 #include <mavros/mavros_uas.hpp>
 #include <mavros/plugin.hpp>
@@ -31,13 +37,65 @@ using namespace std::placeholders;      // NOLINT
 /**
  * @brief Manual Control plugin
  * @plugin manual_control
+ *
+ * With send_rate > 0 joystick input is resampled: latest value is sent
+ * at send_rate if it changed, immediately if it changed more than deadband
+ * (or buttons changed), and at keep_alive_rate otherwise.
+ * Sending stops if no input received for input_timeout.
  */
 class ManualControlPlugin : public plugin::Plugin
 {
 public:
+  using steady_clock = std::chrono::steady_clock;
+
   explicit ManualControlPlugin(plugin::UASPtr uas_)
-  : Plugin(uas_, "manual_control")
+  : Plugin(uas_, "manual_control"),
+    ctl_msg{},
+    sent_msg{},
+    has_input(false),
+    has_sent(false),
+    deadband(0),
+    keep_alive(std::chrono::milliseconds(200)),
+    input_timeout(std::chrono::milliseconds(500))
   {
+    enable_node_watch_parameters();
+
+    node_declate_and_watch_parameter(
+      "send_rate", 0.0, [&](const rclcpp::Parameter & p) {
+        auto rate_d = p.as_double();
+
+        lock_guard lock(mutex);
+        if (rate_d <= 0.0) {
+          if (send_timer) {
+            send_timer->cancel();
+            send_timer.reset();
+          }
+        } else {
+          rclcpp::WallRate rate(rate_d);
+
+          send_timer = node->create_wall_timer(
+            rate.period(), std::bind(&ManualControlPlugin::send_timer_cb, this));
+        }
+      });
+
+    node_declate_and_watch_parameter(
+      "deadband", 50, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(mutex);
+        deadband = std::max<int64_t>(p.as_int(), 0);
+      });
+
+    node_declate_and_watch_parameter(
+      "keep_alive_rate", 5.0, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(mutex);
+        keep_alive = to_steady(1.0 / std::max(p.as_double(), 0.1));
+      });
+
+    node_declate_and_watch_parameter(
+      "input_timeout", 0.5, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(mutex);
+        input_timeout = to_steady(p.as_double());
+      });
+
     control_pub = node->create_publisher<mavros_msgs::msg::ManualControl>("~/control", 10);
     send_sub =
       node->create_subscription<mavros_msgs::msg::ManualControl>(
@@ -53,8 +111,31 @@ public:
   }
 
 private:
+  using lock_guard = std::lock_guard<std::mutex>;
+  std::mutex mutex;
+
   rclcpp::Publisher<mavros_msgs::msg::ManualControl>::SharedPtr control_pub;
   rclcpp::Subscription<mavros_msgs::msg::ManualControl>::SharedPtr send_sub;
+  rclcpp::TimerBase::SharedPtr send_timer;
+
+  //! latest input, also used as a send template
+  mavlink::common::msg::MANUAL_CONTROL ctl_msg;
+  //! last sent values
+  mavlink::common::msg::MANUAL_CONTROL sent_msg;
+
+  bool has_input;
+  bool has_sent;
+  int64_t deadband;
+  steady_clock::duration keep_alive;
+  steady_clock::duration input_timeout;
+  steady_clock::time_point last_input;
+  steady_clock::time_point last_send;
+
+  static steady_clock::duration to_steady(double seconds)
+  {
+    return std::chrono::duration_cast<steady_clock::duration>(
+      std::chrono::duration<double>(seconds));
+  }
 
   /* -*- rx handlers -*- */
 
@@ -77,17 +158,67 @@ private:
 
   /* -*- callbacks -*- */
 
+  /**
+   * Largest axis change since last sent message, INT32_MAX if buttons changed
+   */
+  int32_t change_since_sent()
+  {
+    if (!has_sent || ctl_msg.buttons != sent_msg.buttons) {
+      return INT32_MAX;
+    }
+
+    return std::max(
+      {
+        std::abs(ctl_msg.x - sent_msg.x),
+        std::abs(ctl_msg.y - sent_msg.y),
+        std::abs(ctl_msg.z - sent_msg.z),
+        std::abs(ctl_msg.r - sent_msg.r),
+      });
+  }
+
+  //! Send latest input, called under mutex
+  void send_latest(steady_clock::time_point now)
+  {
+    ctl_msg.target = uas->get_tgt_system();
+    uas->send_message(ctl_msg);
+
+    sent_msg = ctl_msg;
+    has_sent = true;
+    last_send = now;
+  }
+
   void send_cb(const mavros_msgs::msg::ManualControl::SharedPtr req)
   {
-    mavlink::common::msg::MANUAL_CONTROL msg = {};
-    msg.target = uas->get_tgt_system();
-    msg.x = req->x;
-    msg.y = req->y;
-    msg.z = req->z;
-    msg.r = req->r;
-    msg.buttons = req->buttons;
-
-    uas->send_message(msg);
+    lock_guard lock(mutex);
+    auto now = steady_clock::now();
+
+    ctl_msg.x = req->x;
+    ctl_msg.y = req->y;
+    ctl_msg.z = req->z;
+    ctl_msg.r = req->r;
+    ctl_msg.buttons = req->buttons;
+    has_input = true;
+    last_input = now;
+
+    // pass-through mode, or significant change
+    if (!send_timer || change_since_sent() > deadband) {
+      send_latest(now);
+    }
+  }
+
+  void send_timer_cb()
+  {
+    lock_guard lock(mutex);
+    auto now = steady_clock::now();
+
+    // do not keep stale sticks alive if joystick driver died
+    if (!has_input || now - last_input > input_timeout) {
+      return;
+    }
+
+    if (change_since_sent() > 0 || now - last_send >= keep_alive) {
+      send_latest(now);
+    }
   }
 };
 
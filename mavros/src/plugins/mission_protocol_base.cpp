@@ -47,6 +47,7 @@ void MissionBase::handle_mission_item(
     }
 
     auto it = waypoints.emplace(waypoints.end(), wpi);
+    metric_items_received->inc();
     RCLCPP_INFO_STREAM(get_logger(), log_prefix << ": item " << *it);
 
     if (++wp_cur_id < wp_count) {
@@ -86,6 +87,7 @@ void MissionBase::handle_mission_item_int(
     }
 
     auto it = waypoints.emplace(waypoints.end(), wpi);
+    metric_items_received->inc();
     RCLCPP_INFO_STREAM(get_logger(), log_prefix << ": item " << *it);
 
     if (++wp_cur_id < wp_count) {
@@ -393,6 +395,7 @@ void MissionBase::timeout_cb()
 
   // run once
   timeout_timer->cancel();
+  metric_timeouts->inc();
 
   if (wp_retries > 0) {
     wp_retries--;
@@ -25,6 +25,7 @@
 
 #include "rcpputils/asserts.hpp"
 #include "mavros/mavros_uas.hpp"
+#include "mavros/metrics.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/plugin_filter.hpp"
 
@@ -476,6 +477,15 @@ public:
       node->create_wall_timer(PARAM_TIMEOUT, std::bind(&ParamPlugin::timeout_cb, this));
     timeout_timer->cancel();
 
+    auto & registry = metrics::Registry::global();
+    const metrics::Labels labels{{"uas", uas->get_fully_qualified_name()}};
+    metric_received = registry.counter(
+      "mavros_param_received", "PARAM_VALUE messages received", labels);
+    metric_sent = registry.counter(
+      "mavros_param_sent", "PARAM_SET messages sent", labels);
+    metric_timeouts = registry.counter(
+      "mavros_param_timeouts", "Parameter transfer timeouts", labels);
+
     enable_connection_cb();
   }
 
@@ -534,6 +544,10 @@ private:
 
   size_t param_rx_retries;
   bool is_timedout;
+
+  metrics::Counter::SharedPtr metric_received;
+  metrics::Counter::SharedPtr metric_sent;
+  metrics::Counter::SharedPtr metric_timeouts;
   std::mutex list_cond_mutex;
   std::condition_variable list_receiving;
 
@@ -545,6 +559,7 @@ private:
     plugin::filter::SystemAndOk filter [[maybe_unused]])
   {
     lock_guard lock(mutex);
+    metric_received->inc();
 
     auto lg = get_logger();
     auto param_id = mavlink::to_string(pmsg.param_id);
@@ -698,6 +713,7 @@ private:
   void param_set(const Parameter & param)
   {
     RCLCPP_DEBUG_STREAM(get_logger(), "PR:m: set param " << param.to_string());
+    metric_sent->inc();
 
     // GCC 4.8 can't type out lambda return
     auto ps = ([this, &param]() -> mavlink::common::msg::PARAM_SET {
@@ -770,6 +786,7 @@ private:
   {
     lock_guard lock(mutex);
     timeout_timer->cancel();
+    metric_timeouts->inc();
 
     auto lg = get_logger();
 
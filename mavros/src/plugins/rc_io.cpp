@@ -14,6 +14,10 @@
  * @{
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
 #include <vector>
 
 #include "rcpputils/asserts.hpp"
@@ -31,19 +35,143 @@ namespace std_plugins
 {
 using namespace std::placeholders;      // NOLINT
 
+/**
+ * @brief Fixed capacity channel storage with change detection
+ *
+ * Channels are kept in std::array, so incoming messages never reallocate.
+ * Last published values are remembered to suppress duplicates.
+ */
+template<size_t N>
+class ChannelBuffer
+{
+public:
+  using steady_clock = std::chrono::steady_clock;
+
+  static constexpr size_t capacity = N;
+
+  ChannelBuffer()
+  : values{}, count(0), sent_values{}, sent_count(0), has_sent(false), sent_stamp()
+  {}
+
+  void clear()
+  {
+    count = 0;
+    sent_count = 0;
+    has_sent = false;
+  }
+
+  //! Make sure that at least n channels are present, new ones are zeroed
+  void grow(size_t n)
+  {
+    n = std::min(n, N);
+    if (n > count) {
+      std::fill(values.begin() + count, values.begin() + n, 0);
+      count = n;
+    }
+  }
+
+  //! Set exact channel count, e.g. from RC_CHANNELS.chancount
+  void resize(size_t n)
+  {
+    grow(n);
+    count = std::min(n, N);
+  }
+
+  inline uint16_t & operator[](size_t idx)
+  {
+    return values[idx];
+  }
+
+  inline size_t size() const
+  {
+    return count;
+  }
+
+  /**
+   * Decide if current values should be published.
+   *
+   * @param[in] on_change  if false, always publish
+   * @param[in] deadband   minimal change of any channel which counts as a change
+   * @param[in] keep_alive publish unchanged values not less often than that, zero disables
+   */
+  bool should_publish(bool on_change, uint16_t deadband, steady_clock::duration keep_alive)
+  {
+    auto now = steady_clock::now();
+    bool changed = !on_change || !has_sent || count != sent_count;
+
+    for (size_t i = 0; !changed && i < count; i++) {
+      changed = std::abs(int(values[i]) - int(sent_values[i])) > deadband;
+    }
+
+    if (!changed && keep_alive > steady_clock::duration::zero()) {
+      changed = now - sent_stamp >= keep_alive;
+    }
+
+    if (changed) {
+      std::copy_n(values.begin(), count, sent_values.begin());
+      sent_count = count;
+      sent_stamp = now;
+      has_sent = true;
+    }
+
+    return changed;
+  }
+
+  //! Copy to message field, vector capacity is reused
+  void fill(std::vector<uint16_t> & out) const
+  {
+    out.assign(values.begin(), values.begin() + count);
+  }
+
+private:
+  std::array<uint16_t, N> values;
+  size_t count;
+
+  std::array<uint16_t, N> sent_values;
+  size_t sent_count;
+  bool has_sent;
+  steady_clock::time_point sent_stamp;
+};
+
 /**
  * @brief RC IO plugin
  * @plugin rc_io
+ *
+ * With publish_on_change set, RC in and out are published only if some channel
+ * changes more than deadband, or at keep_alive_rate otherwise.
  */
 class RCIOPlugin : public plugin::Plugin
 {
 public:
   explicit RCIOPlugin(plugin::UASPtr uas_)
   : Plugin(uas_, "rc"),
-    raw_rc_in(0),
-    raw_rc_out(0),
-    has_rc_channels_msg(false)
+    has_rc_channels_msg(false),
+    publish_on_change(false),
+    deadband(0),
+    keep_alive(std::chrono::seconds(1))
   {
+    enable_node_watch_parameters();
+
+    node_declate_and_watch_parameter(
+      "publish_on_change", false, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(mutex);
+        publish_on_change = p.as_bool();
+      });
+    node_declate_and_watch_parameter(
+      "deadband", 0, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(mutex);
+        deadband = std::clamp<int64_t>(p.as_int(), 0, UINT16_MAX);
+      });
+    node_declate_and_watch_parameter(
+      "keep_alive_rate", 1.0, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(mutex);
+        auto rate = p.as_double();
+        keep_alive = (rate > 0.0) ?
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / rate)) :
+        std::chrono::steady_clock::duration::zero();
+      });
+
     rc_in_pub = node->create_publisher<mavros_msgs::msg::RCIn>("~/in", 10);
     rc_out_pub = node->create_publisher<mavros_msgs::msg::RCOut>("~/out", 10);
     override_sub = node->create_subscription<mavros_msgs::msg::OverrideRCIn>(
@@ -67,10 +195,19 @@ private:
   using lock_guard = std::lock_guard<std::mutex>;
   std::mutex mutex;
 
-  std::vector<uint16_t> raw_rc_in;
-  std::vector<uint16_t> raw_rc_out;
+  //! RC_CHANNELS has 18, RC_CHANNELS_RAW ports 0..3 have 8 each
+  ChannelBuffer<32> raw_rc_in;
+  //! SERVO_OUTPUT_RAW ports MAIN and AUX, 16 each in MAVLink v2
+  ChannelBuffer<32> raw_rc_out;
   std::atomic<bool> has_rc_channels_msg;
 
+  bool publish_on_change;
+  uint16_t deadband;
+  std::chrono::steady_clock::duration keep_alive;
+
+  mavros_msgs::msg::RCIn rcin_msg;
+  mavros_msgs::msg::RCOut rcout_msg;
+
   rclcpp::Publisher<mavros_msgs::msg::RCIn>::SharedPtr rc_in_pub;
   rclcpp::Publisher<mavros_msgs::msg::RCOut>::SharedPtr rc_out_pub;
   rclcpp::Subscription<mavros_msgs::msg::OverrideRCIn>::SharedPtr override_sub;
@@ -90,10 +227,16 @@ private:
     lock_guard lock(mutex);
 
     size_t offset = port.port * 8;
-    if (raw_rc_in.size() < offset + 8) {
-      raw_rc_in.resize(offset + 8);
+    if (offset + 8 > raw_rc_in.capacity) {
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), *get_clock(), 60000,
+        "RC_CHANNELS_RAW port %u is out of range, max %zu channels supported",
+        port.port, raw_rc_in.capacity);
+      return;
     }
 
+    raw_rc_in.grow(offset + 8);
+
     // [[[cog:
     // for i in range(1, 9):
     //     cog.outl(f"raw_rc_in[offset + {i - 1}] = port.chan{i}_raw;")
@@ -108,10 +251,13 @@ private:
     raw_rc_in[offset + 7] = port.chan8_raw;
     // [[[end]]] (checksum: 7ae5a061d1f05239433e9a78b4b1887a)
 
-    auto rcin_msg = mavros_msgs::msg::RCIn();
+    if (!raw_rc_in.should_publish(publish_on_change, deadband, keep_alive)) {
+      return;
+    }
+
     rcin_msg.header.stamp = uas->synchronise_stamp(port.time_boot_ms);
     rcin_msg.rssi = port.rssi;
-    rcin_msg.channels = raw_rc_in;
+    raw_rc_in.fill(rcin_msg.channels);
 
     rc_in_pub->publish(rcin_msg);
   }
@@ -167,11 +313,13 @@ private:
       case 0: break;
     }
 
-    auto rcin_msg = mavros_msgs::msg::RCIn();
+    if (!raw_rc_in.should_publish(publish_on_change, deadband, keep_alive)) {
+      return;
+    }
 
     rcin_msg.header.stamp = uas->synchronise_stamp(channels.time_boot_ms);
     rcin_msg.rssi = channels.rssi;
-    rcin_msg.channels = raw_rc_in;
+    raw_rc_in.fill(rcin_msg.channels);
 
     rc_in_pub->publish(rcin_msg);
   }
@@ -194,10 +342,16 @@ private:
     }
 
     size_t offset = port.port * num_channels;
-    if (raw_rc_out.size() < offset + num_channels) {
-      raw_rc_out.resize(offset + num_channels);
+    if (offset + num_channels > raw_rc_out.capacity) {
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), *get_clock(), 60000,
+        "SERVO_OUTPUT_RAW port %u is out of range, max %zu channels supported",
+        port.port, raw_rc_out.capacity);
+      return;
     }
 
+    raw_rc_out.grow(offset + num_channels);
+
     // [[[cog:
     // for i in range(1, 9):
     //     cog.outl(f"raw_rc_out[offset + {i - 1}] = port.servo{i}_raw;")
@@ -227,13 +381,15 @@ private:
       // [[[end]]] (checksum: c008714176d3c498f792098d65557830)
     }
 
-    auto rcout_msg = mavros_msgs::msg::RCOut();
+    if (!raw_rc_out.should_publish(publish_on_change, deadband, keep_alive)) {
+      return;
+    }
 
     // XXX: Why time_usec is 32 bit? We should test that.
     uint64_t time_usec = port.time_usec;
 
     rcout_msg.header.stamp = uas->synchronise_stamp(time_usec);
-    rcout_msg.channels = raw_rc_out;
+    raw_rc_out.fill(rcout_msg.channels);
 
     rc_out_pub->publish(rcout_msg);
   }
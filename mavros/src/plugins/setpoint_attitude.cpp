@@ -21,12 +21,17 @@
 #include <message_filters/synchronizer.h>
 #include <message_filters/sync_policies/approximate_time.h>
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <string>
 
 #include "rcpputils/asserts.hpp"
 #include "mavros/mavros_uas.hpp"
+#include "mavros/metrics.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/plugin_filter.hpp"
+#include "mavros/seqlock.hpp"
 #include "mavros/setpoint_mixin.hpp"
 
 #include "geometry_msgs/msg/pose_stamped.hpp"
@@ -51,6 +56,12 @@ using SyncTwistThrust = message_filters::Synchronizer<SyncTwistThrustPolicy>;
  * @plugin setpoint_attitude
  *
  * Send setpoint attitude/orientation/thrust to FCU controller.
+ *
+ * Attitude and thrust come from different topics and are combined either by
+ * ApproximateTime synchronizer (combiner: sync), or by sending on each attitude
+ * message with the latest thrust, if it is not older than thrust_timeout
+ * (combiner: latest). The latter does not wait for a matching pair,
+ * so it has lower latency and does not drop setpoints when rates differ.
  */
 class SetpointAttitudePlugin : public plugin::Plugin,
   private plugin::SetAttitudeTargetMixin<SetpointAttitudePlugin>
@@ -58,11 +69,25 @@ class SetpointAttitudePlugin : public plugin::Plugin,
 public:
   explicit SetpointAttitudePlugin(plugin::UASPtr uas_)
   : Plugin(uas_, "setpoint_attitude"),
-    reverse_thrust(false)
+    reverse_thrust(false),
+    use_quaternion(false),
+    use_latest(false),
+    thrust_timeout_ns(100000000)
   {
     enable_node_watch_parameters();
 
-    auto qos = rclcpp::QoS(10);
+    init_metrics(sync_metrics, "sync");
+    init_metrics(latest_metrics, "latest");
+
+    // count synchronizer input to get its drop rate
+    pose_sub.registerCallback(
+      [this](const geometry_msgs::msg::PoseStamped::ConstSharedPtr &) {
+        sync_metrics.received->inc();
+      });
+    twist_sub.registerCallback(
+      [this](const geometry_msgs::msg::TwistStamped::ConstSharedPtr &) {
+        sync_metrics.received->inc();
+      });
 
     node_declate_and_watch_parameter(
       "reverse_thrust", false, [&](const rclcpp::Parameter & p) {
@@ -70,34 +95,27 @@ public:
       });
 
     node_declate_and_watch_parameter(
-      "use_quaternion", false, [&](const rclcpp::Parameter & p) {
-        auto use_quaternion = p.as_bool();
-
-        pose_sub.unsubscribe();
-        twist_sub.unsubscribe();
-        sync_pose.reset();
-        sync_twist.reset();
-
-        if (use_quaternion) {
-          /**
-           * @brief Use message_filters to sync attitude and thrust msg coming from different topics
-           */
-          pose_sub.subscribe(node, "~/attitude", qos.get_rmw_qos_profile());
-
-          sync_pose = std::make_unique<SyncPoseThrust>(SyncPoseThrustPolicy(10), pose_sub, th_sub);
-          sync_pose->registerCallback(&SetpointAttitudePlugin::attitude_pose_cb, this);
+      "thrust_timeout", 0.1, [&](const rclcpp::Parameter & p) {
+        thrust_timeout_ns = static_cast<int64_t>(p.as_double() * 1e9);
+      });
 
-        } else {
-          twist_sub.subscribe(node, "~/cmd_vel", qos.get_rmw_qos_profile());
+    node_declate_and_watch_parameter(
+      "combiner", "sync", [&](const rclcpp::Parameter & p) {
+        auto combiner = p.as_string();
 
-          sync_twist =
-          std::make_unique<SyncTwistThrust>(SyncTwistThrustPolicy(10), twist_sub, th_sub);
-          sync_twist->registerCallback(&SetpointAttitudePlugin::attitude_twist_cb, this);
+        if (combiner != "sync" && combiner != "latest") {
+          RCLCPP_ERROR(get_logger(), "SPA: unknown combiner '%s', using sync", combiner.c_str());
         }
+
+        use_latest = combiner == "latest";
+        setup_subscriptions();
       });
 
-    // thrust msg subscriber to sync
-    th_sub.subscribe(node, "~/thrust", qos.get_rmw_qos_profile());
+    node_declate_and_watch_parameter(
+      "use_quaternion", false, [&](const rclcpp::Parameter & p) {
+        use_quaternion = p.as_bool();
+        setup_subscriptions();
+      });
   }
 
   Subscriptions get_subscriptions() override
@@ -115,9 +133,110 @@ private:
   std::unique_ptr<SyncPoseThrust> sync_pose;
   std::unique_ptr<SyncTwistThrust> sync_twist;
 
+  rclcpp::Subscription<mavros_msgs::msg::Thrust>::SharedPtr latest_th_sub;
+  rclcpp::Subscription<geometry_msgs::msg::PoseStamped>::SharedPtr latest_pose_sub;
+  rclcpp::Subscription<geometry_msgs::msg::TwistStamped>::SharedPtr latest_twist_sub;
+
+  //! Last thrust for latest combiner
+  struct ThrustSample
+  {
+    float thrust;
+    int64_t received_ns;        //!< steady clock, zero if not received yet
+  };
+
+  utils::SeqLock<ThrustSample> latest_thrust;
+
+  struct CombinerMetrics
+  {
+    metrics::Counter::SharedPtr received;
+    metrics::Counter::SharedPtr sent;
+    metrics::Counter::SharedPtr stale;
+    metrics::Histogram::SharedPtr latency;
+  };
+
+  CombinerMetrics sync_metrics;
+  CombinerMetrics latest_metrics;
+
   bool reverse_thrust;
+  bool use_quaternion;
+  bool use_latest;
+  std::atomic<int64_t> thrust_timeout_ns;
   float normalized_thrust;
 
+  void init_metrics(CombinerMetrics & m, const std::string & combiner)
+  {
+    auto & registry = metrics::Registry::global();
+    const metrics::Labels labels{
+      {"uas", uas->get_fully_qualified_name()},
+      {"combiner", combiner}};
+
+    m.received = registry.counter(
+      "mavros_setpoint_attitude_received", "Attitude setpoints received", labels);
+    m.sent = registry.counter(
+      "mavros_setpoint_attitude_sent", "Attitude setpoints sent to FCU", labels);
+    m.stale = registry.counter(
+      "mavros_setpoint_attitude_stale_thrust",
+      "Attitude setpoints dropped because thrust was missing or too old", labels);
+    m.latency = registry.histogram(
+      "mavros_setpoint_attitude_latency_seconds",
+      "Time from attitude setpoint stamp to sending it to FCU",
+      metrics::Histogram::latency_bounds(), labels);
+  }
+
+  /**
+   * @brief (Re)create subscriptions for selected setpoint type and combiner
+   */
+  void setup_subscriptions()
+  {
+    auto qos = rclcpp::QoS(10);
+
+    pose_sub.unsubscribe();
+    twist_sub.unsubscribe();
+    th_sub.unsubscribe();
+    sync_pose.reset();
+    sync_twist.reset();
+
+    latest_pose_sub.reset();
+    latest_twist_sub.reset();
+    latest_th_sub.reset();
+    latest_thrust.store(ThrustSample{0.0f, 0});
+
+    if (use_latest) {
+      latest_th_sub = node->create_subscription<mavros_msgs::msg::Thrust>(
+        "~/thrust", qos, std::bind(&SetpointAttitudePlugin::latest_thrust_cb, this, _1));
+
+      if (use_quaternion) {
+        latest_pose_sub = node->create_subscription<geometry_msgs::msg::PoseStamped>(
+          "~/attitude", qos, std::bind(&SetpointAttitudePlugin::latest_pose_cb, this, _1));
+      } else {
+        latest_twist_sub = node->create_subscription<geometry_msgs::msg::TwistStamped>(
+          "~/cmd_vel", qos, std::bind(&SetpointAttitudePlugin::latest_twist_cb, this, _1));
+      }
+
+      return;
+    }
+
+    if (use_quaternion) {
+      /**
+       * @brief Use message_filters to sync attitude and thrust msg coming from different topics
+       */
+      pose_sub.subscribe(node, "~/attitude", qos.get_rmw_qos_profile());
+
+      sync_pose = std::make_unique<SyncPoseThrust>(SyncPoseThrustPolicy(10), pose_sub, th_sub);
+      sync_pose->registerCallback(&SetpointAttitudePlugin::attitude_pose_cb, this);
+
+    } else {
+      twist_sub.subscribe(node, "~/cmd_vel", qos.get_rmw_qos_profile());
+
+      sync_twist =
+        std::make_unique<SyncTwistThrust>(SyncTwistThrustPolicy(10), twist_sub, th_sub);
+      sync_twist->registerCallback(&SetpointAttitudePlugin::attitude_twist_cb, this);
+    }
+
+    // thrust msg subscriber to sync
+    th_sub.subscribe(node, "~/thrust", qos.get_rmw_qos_profile());
+  }
+
   /**
    * @brief Function to verify if the thrust values are normalized;
    * considers also the reversed trust values
@@ -193,30 +312,118 @@ private:
       thrust);
   }
 
+  void handle_pose(
+    const geometry_msgs::msg::PoseStamped & pose_msg, float thrust,
+    const CombinerMetrics & m)
+  {
+    Eigen::Affine3d tr;
+    tf2::fromMsg(pose_msg.pose, tr);
+
+    if (is_normalized(thrust)) {
+      send_attitude_quaternion(pose_msg.header.stamp, tr, thrust);
+      count_sent(m, pose_msg.header.stamp);
+    }
+  }
+
+  void handle_twist(
+    const geometry_msgs::msg::TwistStamped & req, float thrust,
+    const CombinerMetrics & m)
+  {
+    Eigen::Vector3d ang_vel;
+    tf2::fromMsg(req.twist.angular, ang_vel);
+
+    if (is_normalized(thrust)) {
+      send_attitude_ang_velocity(req.header.stamp, ang_vel, thrust);
+      count_sent(m, req.header.stamp);
+    }
+  }
+
+  void count_sent(const CombinerMetrics & m, const rclcpp::Time & stamp)
+  {
+    m.sent->inc();
+
+    // unstamped setpoints tell nothing about latency
+    if (stamp.nanoseconds() > 0) {
+      auto latency = (node->now() - stamp).seconds();
+      if (latency >= 0.0) {
+        m.latency->observe(latency);
+      }
+    }
+  }
+
+  /**
+   * @brief Get latest thrust for latest combiner
+   * @return false if thrust is missing or older than thrust_timeout
+   */
+  bool get_latest_thrust(float & thrust)
+  {
+    auto sample = latest_thrust.load();
+    if (sample.received_ns == 0) {
+      return false;
+    }
+
+    auto now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now_ns - sample.received_ns > thrust_timeout_ns) {
+      return false;
+    }
+
+    thrust = sample.thrust;
+    return true;
+  }
+
   /* -*- callbacks -*- */
 
   void attitude_pose_cb(
     const geometry_msgs::msg::PoseStamped::SharedPtr pose_msg,
     const mavros_msgs::msg::Thrust::SharedPtr thrust_msg)
   {
-    Eigen::Affine3d tr;
-    tf2::fromMsg(pose_msg->pose, tr);
-
-    if (is_normalized(thrust_msg->thrust)) {
-      send_attitude_quaternion(pose_msg->header.stamp, tr, thrust_msg->thrust);
-    }
+    handle_pose(*pose_msg, thrust_msg->thrust, sync_metrics);
   }
 
   void attitude_twist_cb(
     const geometry_msgs::msg::TwistStamped::SharedPtr req,
     const mavros_msgs::msg::Thrust::SharedPtr thrust_msg)
   {
-    Eigen::Vector3d ang_vel;
-    tf2::fromMsg(req->twist.angular, ang_vel);
+    handle_twist(*req, thrust_msg->thrust, sync_metrics);
+  }
 
-    if (is_normalized(thrust_msg->thrust)) {
-      send_attitude_ang_velocity(req->header.stamp, ang_vel, thrust_msg->thrust);
+  void latest_thrust_cb(const mavros_msgs::msg::Thrust::SharedPtr thrust_msg)
+  {
+    auto now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    latest_thrust.store(ThrustSample{thrust_msg->thrust, now_ns});
+  }
+
+  void latest_pose_cb(const geometry_msgs::msg::PoseStamped::SharedPtr pose_msg)
+  {
+    latest_metrics.received->inc();
+
+    float thrust;
+    if (!get_latest_thrust(thrust)) {
+      latest_metrics.stale->inc();
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), *get_clock(), 5000, "SPA: no fresh thrust, setpoint dropped");
+      return;
     }
+
+    handle_pose(*pose_msg, thrust, latest_metrics);
+  }
+
+  void latest_twist_cb(const geometry_msgs::msg::TwistStamped::SharedPtr req)
+  {
+    latest_metrics.received->inc();
+
+    float thrust;
+    if (!get_latest_thrust(thrust)) {
+      latest_metrics.stale->inc();
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), *get_clock(), 5000, "SPA: no fresh thrust, setpoint dropped");
+      return;
+    }
+
+    handle_twist(*req, thrust, latest_metrics);
   }
 };
 
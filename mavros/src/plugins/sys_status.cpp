@@ -14,6 +14,9 @@
  * @{
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -23,6 +26,7 @@
 #include "mavros/mavros_uas.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/plugin_filter.hpp"
+#include "mavros/statustext.hpp"
 
 #include "mavros_msgs/msg/state.hpp"
 #include "mavros_msgs/msg/estimator_status.hpp"
@@ -44,6 +48,8 @@ using mavlink::minimal::MAV_TYPE;
 using mavlink::minimal::MAV_AUTOPILOT;
 using mavlink::minimal::MAV_STATE;
 using utils::enum_value;
+using utils::StatusTextAssembler;
+using utils::StatusTextFilter;
 using BatteryMsg = sensor_msgs::msg::BatteryState;
 
 using namespace std::placeholders;      // NOLINT
@@ -57,8 +63,9 @@ using namespace std::chrono_literals;   // NOLINT
 class HeartbeatStatus : public diagnostic_updater::DiagnosticTask
 {
 public:
-  HeartbeatStatus(const std::string & name, size_t win_size)
+  HeartbeatStatus(const std::string & name, size_t win_size, plugin::UASPtr uas_)
   : diagnostic_updater::DiagnosticTask(name),
+    uas(uas_),
     times_(win_size),
     seq_nums_(win_size),
     window_size_(win_size),
@@ -67,6 +74,8 @@ public:
     tolerance_(0.1),
     autopilot(MAV_AUTOPILOT::GENERIC),
     type(MAV_TYPE::GENERIC),
+    base_mode(0),
+    custom_mode(0),
     system_status(MAV_STATE::UNINIT)
   {
     clear();
@@ -86,16 +95,18 @@ public:
     hist_indx_ = 0;
   }
 
+  //! Store raw values, strings are built only in run()
   void tick(
     uint8_t type_, uint8_t autopilot_,
-    std::string & mode_, uint8_t system_status_)
+    uint8_t base_mode_, uint32_t custom_mode_, uint8_t system_status_)
   {
     std::lock_guard<std::mutex> lock(mutex);
     count_++;
 
     type = static_cast<MAV_TYPE>(type_);
     autopilot = static_cast<MAV_AUTOPILOT>(autopilot_);
-    mode = mode_;
+    base_mode = base_mode_;
+    custom_mode = custom_mode_;
     system_status = static_cast<MAV_STATE>(system_status_);
   }
 
@@ -126,11 +137,12 @@ public:
     stat.addf("Frequency (Hz)", "%f", freq);
     stat.add("Vehicle type", utils::to_string(type));
     stat.add("Autopilot type", utils::to_string(autopilot));
-    stat.add("Mode", mode);
+    stat.add("Mode", uas->str_mode_v10(base_mode, custom_mode));
     stat.add("System status", utils::to_string(system_status));
   }
 
 private:
+  plugin::UASPtr uas;
   rclcpp::Clock clock;
   int count_;
   std::vector<rclcpp::Time> times_;
@@ -144,7 +156,8 @@ private:
 
   MAV_AUTOPILOT autopilot;
   MAV_TYPE type;
-  std::string mode;
+  uint8_t base_mode;
+  uint32_t custom_mode;
   MAV_STATE system_status;
 };
 
@@ -409,13 +422,16 @@ private:
  * @plugin sys_status
  *
  * Required by all plugins.
+ *
+ * Chunked STATUSTEXT are reassembled and published once,
+ * rosout output is deduplicated and rate limited (statustext.* parameters).
  */
 class SystemStatusPlugin : public plugin::Plugin
 {
 public:
   explicit SystemStatusPlugin(plugin::UASPtr uas_)
   : Plugin(uas_, "sys"),
-    hb_diag("Heartbeat", 10),
+    hb_diag("Heartbeat", 10, uas_),
     mem_diag("APM Memory"),
     hwst_diag("APM Hardware"),
     sys_diag("System"),
@@ -460,6 +476,63 @@ public:
         }
       });
 
+    node_declate_and_watch_parameter(
+      "statustext.chunk_timeout", 1.0, [&](const rclcpp::Parameter & p) {
+        auto chunk_timeout = to_steady(p.as_double());
+
+        {
+          lock_guard lock(statustext_mutex);
+          statustext_assembler.set_timeout(chunk_timeout);
+        }
+
+        // incomplete text is emitted within 1.5 timeout, even if FCU goes silent
+        statustext_timer =
+        node->create_wall_timer(
+          std::max<std::chrono::steady_clock::duration>(chunk_timeout / 2, 10ms),
+          std::bind(&SystemStatusPlugin::statustext_timer_cb, this));
+      });
+
+    node_declate_and_watch_parameter(
+      "statustext.dedup_window", 2.0, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(statustext_mutex);
+        statustext_filter.set_dedup_window(to_steady(p.as_double()));
+      });
+
+    // [[[cog:
+    // for lvl, rate in (('error', 10.0), ('warn', 5.0), ('info', 5.0), ('debug', 2.0)):
+    //     cog.outl(f"node_declate_and_watch_parameter(")
+    //     cog.outl(f"  \"statustext.rate_limit.{lvl}\", {rate}, [&](const rclcpp::Parameter & p) {{")
+    //     cog.outl(f"    lock_guard lock(statustext_mutex);")
+    //     cog.outl(f"    statustext_filter.set_rate_limit(")
+    //     cog.outl(f"      StatusTextFilter::Level::{lvl}, p.as_double());")
+    //     cog.outl(f"  }});")
+    // ]]]
+    node_declate_and_watch_parameter(
+      "statustext.rate_limit.error", 10.0, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(statustext_mutex);
+        statustext_filter.set_rate_limit(
+          StatusTextFilter::Level::error, p.as_double());
+      });
+    node_declate_and_watch_parameter(
+      "statustext.rate_limit.warn", 5.0, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(statustext_mutex);
+        statustext_filter.set_rate_limit(
+          StatusTextFilter::Level::warn, p.as_double());
+      });
+    node_declate_and_watch_parameter(
+      "statustext.rate_limit.info", 5.0, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(statustext_mutex);
+        statustext_filter.set_rate_limit(
+          StatusTextFilter::Level::info, p.as_double());
+      });
+    node_declate_and_watch_parameter(
+      "statustext.rate_limit.debug", 2.0, [&](const rclcpp::Parameter & p) {
+        lock_guard lock(statustext_mutex);
+        statustext_filter.set_rate_limit(
+          StatusTextFilter::Level::debug, p.as_double());
+      });
+    // [[[end]]] (checksum: c824df0d6c85fc0c0f037aa6adb6ebd9)
+
     node_declate_and_watch_parameter(
       "heartbeat_mav_type", utils::enum_to_name(
         conn_heartbeat_mav_type), [&](const rclcpp::Parameter & p) {
@@ -555,6 +628,7 @@ private:
   rclcpp::TimerBase::SharedPtr timeout_timer;
   rclcpp::TimerBase::SharedPtr heartbeat_timer;
   rclcpp::TimerBase::SharedPtr autopilot_version_timer;
+  rclcpp::TimerBase::SharedPtr statustext_timer;
 
   rclcpp::Publisher<mavros_msgs::msg::State>::SharedPtr state_pub;
   rclcpp::Publisher<mavros_msgs::msg::ExtendedState>::SharedPtr extended_state_pub;
@@ -576,6 +650,12 @@ private:
   bool has_battery_status;
   float battery_voltage;
 
+  using lock_guard = std::lock_guard<std::mutex>;
+  std::mutex statustext_mutex;
+  StatusTextAssembler statustext_assembler;
+  StatusTextFilter statustext_filter;
+  std::vector<StatusTextAssembler::Text> statustext_queue;
+
   using M_VehicleInfo = std::unordered_map<uint16_t, mavros_msgs::msg::VehicleInfo>;
   M_VehicleInfo vehicles;
 
@@ -608,6 +688,12 @@ private:
     return ret;
   }
 
+  static std::chrono::steady_clock::duration to_steady(double seconds)
+  {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(seconds));
+  }
+
   /**
    * Sent STATUSTEXT message to rosout
    *
@@ -617,6 +703,18 @@ private:
   {
     using mavlink::common::MAV_SEVERITY;
 
+    size_t repeated, limited;
+    if (!statustext_filter.check(severity, text, repeated, limited)) {
+      return;
+    }
+
+    if (limited > 0) {
+      RCLCPP_WARN(node->get_logger(), "FCU: %zu texts dropped by rate limit", limited);
+    }
+    if (repeated > 0) {
+      RCLCPP_INFO(node->get_logger(), "FCU: next text was repeated %zu times", repeated);
+    }
+
     switch (severity) {
       // [[[cog:
       // for l1, l2 in (
@@ -627,32 +725,51 @@ private:
       //     ):
       //     for v in l1:
       //         cog.outl(f"case enum_value(MAV_SEVERITY::{v}):")
-      //     cog.outl(f"  RCLCPP_{l2}_STREAM(node->get_logger(), \"FCU: \" << text);")
+      //     cog.outl(f"  RCLCPP_{l2}(node->get_logger(), \"FCU: %s\", text.c_str());")
       //     cog.outl(f"  break;")
       // ]]]
       case enum_value(MAV_SEVERITY::EMERGENCY):
       case enum_value(MAV_SEVERITY::ALERT):
       case enum_value(MAV_SEVERITY::CRITICAL):
       case enum_value(MAV_SEVERITY::ERROR):
-        RCLCPP_ERROR_STREAM(node->get_logger(), "FCU: " << text);
+        RCLCPP_ERROR(node->get_logger(), "FCU: %s", text.c_str());
         break;
       case enum_value(MAV_SEVERITY::WARNING):
       case enum_value(MAV_SEVERITY::NOTICE):
-        RCLCPP_WARN_STREAM(node->get_logger(), "FCU: " << text);
+        RCLCPP_WARN(node->get_logger(), "FCU: %s", text.c_str());
         break;
       case enum_value(MAV_SEVERITY::INFO):
-        RCLCPP_INFO_STREAM(node->get_logger(), "FCU: " << text);
+        RCLCPP_INFO(node->get_logger(), "FCU: %s", text.c_str());
         break;
       case enum_value(MAV_SEVERITY::DEBUG):
-        RCLCPP_DEBUG_STREAM(node->get_logger(), "FCU: " << text);
+        RCLCPP_DEBUG(node->get_logger(), "FCU: %s", text.c_str());
         break;
-      // [[[end]]] (checksum: d05760afbeece46673c8f73f89b63f3d)
+      // [[[end]]] (checksum: f3825bd47fa148084331e3db077575ca)
       default:
-        RCLCPP_WARN_STREAM(node->get_logger(), "FCU: UNK(" << +severity << "): " << text);
+        RCLCPP_WARN(node->get_logger(), "FCU: UNK(%u): %s", severity, text.c_str());
         break;
     }
   }
 
+  /**
+   * Log and publish texts collected in statustext_queue
+   *
+   * @note statustext_mutex should be locked
+   */
+  void publish_statustext_queue()
+  {
+    for (auto & st : statustext_queue) {
+      process_statustext_normal(st.severity, st.text);
+
+      auto st_msg = mavros_msgs::msg::StatusText();
+      st_msg.header.stamp = node->now();
+      st_msg.severity = st.severity;
+      st_msg.text = std::move(st.text);
+
+      statustext_pub->publish(st_msg);
+    }
+  }
+
   static std::string custom_version_to_hex_string(const std::array<uint8_t, 8> & array)
   {
     // should be little-endian
@@ -730,6 +847,18 @@ private:
     state_msg.mode = "";
     state_msg.system_status = enum_value(MAV_STATE::UNINIT);
 
+    uas->data.update_snapshot(
+      [&](uas::VehicleSnapshot & vs) {
+        vs.state_stamp_ns = rclcpp::Time(state_msg.header.stamp).nanoseconds();
+        vs.connected = false;
+        vs.armed = false;
+        vs.guided = false;
+        vs.manual_input = false;
+        vs.base_mode = 0;
+        vs.custom_mode = 0;
+        vs.system_status = state_msg.system_status;
+      });
+
     state_pub->publish(state_msg);
   }
 
@@ -786,8 +915,20 @@ private:
     state_msg.mode = vehicle_mode;
     state_msg.system_status = hb.system_status;
 
+    uas->data.update_snapshot(
+      [&](uas::VehicleSnapshot & vs) {
+        vs.state_stamp_ns = stamp.nanoseconds();
+        vs.connected = true;
+        vs.armed = state_msg.armed;
+        vs.guided = state_msg.guided;
+        vs.manual_input = state_msg.manual_input;
+        vs.base_mode = hb.base_mode;
+        vs.custom_mode = hb.custom_mode;
+        vs.system_status = hb.system_status;
+      });
+
     state_pub->publish(state_msg);
-    hb_diag.tick(hb.type, hb.autopilot, state_msg.mode, hb.system_status);
+    hb_diag.tick(hb.type, hb.autopilot, hb.base_mode, hb.custom_mode, hb.system_status);
   }
 
   void handle_extended_sys_state(
@@ -800,6 +941,13 @@ private:
     state_msg.vtol_state = state.vtol_state;
     state_msg.landed_state = state.landed_state;
 
+    uas->data.update_snapshot(
+      [&](uas::VehicleSnapshot & vs) {
+        vs.extended_state_stamp_ns = rclcpp::Time(state_msg.header.stamp).nanoseconds();
+        vs.vtol_state = state.vtol_state;
+        vs.landed_state = state.landed_state;
+      });
+
     extended_state_pub->publish(state_msg);
   }
 
@@ -822,6 +970,14 @@ private:
 
     auto batt_msg = BatteryMsg();
     batt_msg.header.stamp = node->now();
+
+    uas->data.update_snapshot(
+      [&](uas::VehicleSnapshot & vs) {
+        vs.battery_stamp_ns = rclcpp::Time(batt_msg.header.stamp).nanoseconds();
+        vs.battery_voltage = volt;
+        vs.battery_current = (curr < 0.0f) ? NAN : curr;
+        vs.battery_percentage = (rem < 0.0f) ? NAN : rem;
+      });
     batt_msg.voltage = volt;
     batt_msg.current = -curr;
     batt_msg.charge = NAN;
@@ -844,15 +1000,16 @@ private:
     mavlink::common::msg::STATUSTEXT & textm,
     plugin::filter::SystemAndOk filter [[maybe_unused]])
   {
-    auto text = mavlink::to_string(textm.text);
-    process_statustext_normal(textm.severity, text);
+    lock_guard lock(statustext_mutex);
 
-    auto st_msg = mavros_msgs::msg::StatusText();
-    st_msg.header.stamp = node->now();
-    st_msg.severity = textm.severity;
-    st_msg.text = text;
+    auto chunk = mavlink::to_string(textm.text);
+    const bool is_last = chunk.size() < textm.text.size();
 
-    statustext_pub->publish(st_msg);
+    statustext_queue.clear();
+    statustext_assembler.push(
+      msg->sysid, msg->compid, textm.severity, textm.id, textm.chunk_seq,
+      std::move(chunk), is_last, statustext_queue);
+    publish_statustext_queue();
   }
 
   void handle_meminfo(
@@ -980,6 +1137,17 @@ private:
     batt_msg.location = utils::format("id%u", bs.id);
     batt_msg.serial_number = "";
 
+    // aggregated state tracks the first battery only
+    if (bs.id == 0) {
+      uas->data.update_snapshot(
+        [&](uas::VehicleSnapshot & vs) {
+          vs.battery_stamp_ns = rclcpp::Time(batt_msg.header.stamp).nanoseconds();
+          vs.battery_voltage = battery_voltage;
+          vs.battery_current = (bs.current_battery < 0) ? NAN : bs.current_battery / 100.0f;
+          vs.battery_percentage = (bs.battery_remaining < 0) ? NAN : bs.battery_remaining / 100.0f;
+        });
+    }
+
     batt_pub->publish(batt_msg);
   }
 
@@ -1030,6 +1198,12 @@ private:
     est_status_msg.accel_error_status_flag = check_flag(ESF::ACCEL_ERROR);
     // [[[end]]] (checksum: fc30da81f9490dede61a58e82c8a2d53)
 
+    uas->data.update_snapshot(
+      [&](uas::VehicleSnapshot & vs) {
+        vs.estimator_stamp_ns = rclcpp::Time(est_status_msg.header.stamp).nanoseconds();
+        vs.estimator_flags = status.flags;
+      });
+
     estimator_status_pub->publish(est_status_msg);
   }
 
@@ -1040,6 +1214,15 @@ private:
     uas->update_connection_status(false);
   }
 
+  void statustext_timer_cb()
+  {
+    lock_guard lock(statustext_mutex);
+
+    statustext_queue.clear();
+    statustext_assembler.expire(std::chrono::steady_clock::now(), statustext_queue);
+    publish_statustext_queue();
+  }
+
   void heartbeat_cb()
   {
     using mavlink::common::MAV_MODE;
@@ -1107,6 +1290,11 @@ private:
   {
     has_battery_status = false;
 
+    {
+      lock_guard lock(statustext_mutex);
+      statustext_assembler.clear();
+    }
+
     // if connection changes, start delayed version request
     version_retries = RETRIES_COUNT;
     if (connected) {
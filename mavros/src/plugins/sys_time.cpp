@@ -169,7 +169,7 @@ public:
       "timesync_mode", "MAVLINK", [&](const rclcpp::Parameter & p) {
         auto ts_mode = utils::timesync_mode_from_str(p.as_string());
         uas->set_timesync_mode(ts_mode);
-        RCLCPP_INFO_STREAM(get_logger(), "TM: Timesync mode: " << utils::to_string(ts_mode));
+        RCLCPP_INFO_STREAM(get_logger(), "TM: Timesync mode: " << utils::to_string_view(ts_mode));
       });
 
     node_declate_and_watch_parameter(
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief VehicleSnapshot plugin
+ * @file vehicle_snapshot.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup plugin
+ * @{
+ */
+
+#include <memory>
+
+#include "mavros/mavros_uas.hpp"
+#include "mavros/plugin.hpp"
+
+#include "mavros_msgs/msg/vehicle_snapshot.hpp"
+#include "mavros_msgs/srv/vehicle_snapshot_get.hpp"
+
+namespace mavros
+{
+namespace std_plugins
+{
+using namespace std::placeholders;      // NOLINT
+
+/**
+ * @brief Vehicle snapshot plugin.
+ * @plugin vehicle_snapshot
+ *
+ * Publishes aggregated vehicle state collected by other plugins
+ * at low rate and on request.
+ */
+class VehicleSnapshotPlugin : public plugin::Plugin
+{
+public:
+  explicit VehicleSnapshotPlugin(plugin::UASPtr uas_)
+  : Plugin(uas_, "vehicle_snapshot"),
+    last_version(0)
+  {
+    enable_node_watch_parameters();
+
+    node_declate_and_watch_parameter(
+      "rate", 1.0, [&](const rclcpp::Parameter & p) {
+        auto rate = p.as_double();
+
+        if (rate > 0.0) {
+          publish_timer = node->create_wall_timer(
+            rclcpp::WallRate(rate).period(),
+            std::bind(&VehicleSnapshotPlugin::publish_cb, this));
+        } else {
+          publish_timer.reset();
+        }
+      });
+
+    snapshot_pub = node->create_publisher<mavros_msgs::msg::VehicleSnapshot>(
+      "~/state", rclcpp::QoS(1).transient_local());
+    get_srv = node->create_service<mavros_msgs::srv::VehicleSnapshotGet>(
+      "~/get", std::bind(&VehicleSnapshotPlugin::get_cb, this, _1, _2));
+  }
+
+  Subscriptions get_subscriptions() override
+  {
+    return {};
+  }
+
+private:
+  rclcpp::Publisher<mavros_msgs::msg::VehicleSnapshot>::SharedPtr snapshot_pub;
+  rclcpp::Service<mavros_msgs::srv::VehicleSnapshotGet>::SharedPtr get_srv;
+  rclcpp::TimerBase::SharedPtr publish_timer;
+
+  uint64_t last_version;
+
+  static builtin_interfaces::msg::Time to_stamp(int64_t ns)
+  {
+    return rclcpp::Time(ns, RCL_ROS_TIME);
+  }
+
+  void fill_msg(const uas::VehicleSnapshot & vs, mavros_msgs::msg::VehicleSnapshot & msg)
+  {
+    msg.header.stamp = node->now();
+
+    msg.state_stamp = to_stamp(vs.state_stamp_ns);
+    msg.connected = vs.connected;
+    msg.armed = vs.armed;
+    msg.guided = vs.guided;
+    msg.manual_input = vs.manual_input;
+    msg.mode = vs.connected ? uas->str_mode_v10(vs.base_mode, vs.custom_mode) : "";
+    msg.system_status = vs.system_status;
+
+    msg.extended_state_stamp = to_stamp(vs.extended_state_stamp_ns);
+    msg.vtol_state = vs.vtol_state;
+    msg.landed_state = vs.landed_state;
+
+    msg.battery_stamp = to_stamp(vs.battery_stamp_ns);
+    msg.battery_voltage = vs.battery_voltage;
+    msg.battery_current = vs.battery_current;
+    msg.battery_percentage = vs.battery_percentage;
+
+    msg.estimator_stamp = to_stamp(vs.estimator_stamp_ns);
+    msg.estimator_flags = vs.estimator_flags;
+
+    msg.global_stamp = to_stamp(vs.global_stamp_ns);
+    msg.global_position.latitude = vs.latitude;
+    msg.global_position.longitude = vs.longitude;
+    msg.global_position.altitude = vs.altitude;
+    msg.relative_altitude = vs.relative_altitude;
+    msg.heading = vs.heading;
+
+    msg.local_stamp = to_stamp(vs.local_stamp_ns);
+    msg.local_position.x = vs.local_position[0];
+    msg.local_position.y = vs.local_position[1];
+    msg.local_position.z = vs.local_position[2];
+    msg.local_velocity.x = vs.local_velocity[0];
+    msg.local_velocity.y = vs.local_velocity[1];
+    msg.local_velocity.z = vs.local_velocity[2];
+
+    msg.home_stamp = to_stamp(vs.home_stamp_ns);
+    msg.home_position.latitude = vs.home_latitude;
+    msg.home_position.longitude = vs.home_longitude;
+    msg.home_position.altitude = vs.home_altitude;
+  }
+
+  /* -*- callbacks -*- */
+
+  void publish_cb()
+  {
+    uint64_t version;
+    auto vs = uas->data.get_snapshot(version);
+
+    // nothing new since last publish
+    if (version == last_version) {
+      return;
+    }
+
+    last_version = version;
+
+    auto msg = mavros_msgs::msg::VehicleSnapshot();
+    fill_msg(vs, msg);
+    snapshot_pub->publish(msg);
+  }
+
+  void get_cb(
+    const mavros_msgs::srv::VehicleSnapshotGet::Request::SharedPtr req [[maybe_unused]],
+    mavros_msgs::srv::VehicleSnapshotGet::Response::SharedPtr res)
+  {
+    fill_msg(uas->data.get_snapshot(), res->snapshot);
+    res->success = true;
+  }
+};
+
+}       // namespace std_plugins
+}       // namespace mavros
+
+#include <mavros/mavros_plugin_register_macro.hpp>  // NOLINT
+MAVROS_PLUGIN_REGISTER(mavros::std_plugins::VehicleSnapshotPlugin)
@@ -0,0 +1,148 @@
+//
+// mavros
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * Test buffered asynchronous file writer
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mavros/async_file_writer.hpp"
+
+using mavros::utils::AsyncFileWriter;
+using namespace std::chrono_literals;  // NOLINT
+
+static std::vector<uint8_t> read_file(const std::string & path)
+{
+  std::vector<uint8_t> data;
+  FILE * f = std::fopen(path.c_str(), "rb");
+  if (f == nullptr) {
+    return data;
+  }
+
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) {
+    data.insert(data.end(), buf, buf + n);
+  }
+
+  std::fclose(f);
+  return data;
+}
+
+static std::string temp_path(const char * name)
+{
+  return ::testing::TempDir() + name;
+}
+
+TEST(AsyncFileWriter, write_close)
+{
+  auto path = temp_path("mavros_async_writer_1.bin");
+  AsyncFileWriter writer(4096);
+
+  EXPECT_FALSE(writer.write("x", 1));
+  ASSERT_TRUE(writer.open(path));
+  EXPECT_TRUE(writer.is_open());
+
+  // bursts of LOGGING_DATA size records, each burst fills the buffer
+  std::vector<uint8_t> expected;
+  for (size_t burst = 0; burst < 4; burst++) {
+    const size_t batches = writer.get_stats().batches;
+
+    for (size_t i = burst * 250; i < (burst + 1) * 250; i++) {
+      std::vector<uint8_t> rec(249);
+      for (size_t k = 0; k < rec.size(); k++) {
+        rec[k] = (i * 7 + k) & 0xff;
+      }
+
+      EXPECT_TRUE(writer.write(rec.data(), rec.size()));
+      expected.insert(expected.end(), rec.begin(), rec.end());
+    }
+
+    // full buffer wakes the writer, next burst goes to another batch
+    for (int i = 0; i < 1000 && writer.get_stats().batches == batches; i++) {
+      std::this_thread::sleep_for(1ms);
+    }
+  }
+
+  writer.close();
+  EXPECT_FALSE(writer.is_open());
+
+  auto st = writer.get_stats();
+  EXPECT_EQ(st.bytes_written, expected.size());
+  EXPECT_EQ(st.bytes_dropped, 0u);
+  EXPECT_GE(st.batches, 4u);
+  EXPECT_EQ(read_file(path), expected);
+
+  std::remove(path.c_str());
+}
+
+TEST(AsyncFileWriter, periodic_flush)
+{
+  auto path = temp_path("mavros_async_writer_2.bin");
+  AsyncFileWriter writer(1 << 20, 64 << 20, 20ms);
+
+  ASSERT_TRUE(writer.open(path));
+  ASSERT_TRUE(writer.write("ULog", 4));
+
+  // small write lands on disk without waiting for buffer to fill
+  std::vector<uint8_t> data;
+  for (int i = 0; i < 100 && data.size() < 4; i++) {
+    std::this_thread::sleep_for(5ms);
+    data = read_file(path);
+  }
+
+  EXPECT_EQ(data.size(), 4u);
+  writer.close();
+}
+
+TEST(AsyncFileWriter, overflow_drops_whole_writes)
+{
+  auto path = temp_path("mavros_async_writer_3.bin");
+  // writer wakes only on period, so queue limit is hit
+  AsyncFileWriter writer(1 << 20, 1000, 1000ms);
+
+  ASSERT_TRUE(writer.open(path));
+
+  std::vector<uint8_t> rec(300, 0xaa);
+  size_t accepted = 0;
+  for (int i = 0; i < 10; i++) {
+    accepted += writer.write(rec.data(), rec.size());
+  }
+
+  writer.close();
+
+  auto st = writer.get_stats();
+  EXPECT_EQ(accepted, 3u);
+  EXPECT_EQ(st.bytes_written, 900u);
+  EXPECT_EQ(st.bytes_dropped, 2100u);
+  EXPECT_EQ(read_file(path).size(), 900u);
+
+  std::remove(path.c_str());
+}
+
+TEST(AsyncFileWriter, open_failure)
+{
+  AsyncFileWriter writer;
+
+  EXPECT_FALSE(writer.open("/nonexistent-dir/file.ulg"));
+  EXPECT_FALSE(writer.is_open());
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,150 @@
+//
+// mavros
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * Test optical flow integrator
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "mavros/flow_integrator.hpp"
+
+using mavros::utils::FlowIntegrator;
+using OPTICAL_FLOW_RAD = FlowIntegrator::OPTICAL_FLOW_RAD;
+
+//! 100 Hz sensor with constant flow and gyro rates
+static OPTICAL_FLOW_RAD make_sample(uint64_t t_us, uint8_t quality = 200, float distance = 1.5f)
+{
+  OPTICAL_FLOW_RAD s = {};
+  s.time_usec = t_us;
+  s.sensor_id = 3;
+  s.integration_time_us = 10000;
+  s.integrated_x = 0.01f;       // 1 rad/s
+  s.integrated_y = -0.02f;
+  s.integrated_xgyro = 0.005f;
+  s.integrated_ygyro = 0.0f;
+  s.integrated_zgyro = 0.001f;
+  s.temperature = 2500;
+  s.quality = quality;
+  s.distance = distance;
+  s.time_delta_distance_us = 2000;
+  return s;
+}
+
+TEST(FlowIntegrator, sums_window)
+{
+  FlowIntegrator integ(50000);
+  OPTICAL_FLOW_RAD out;
+  std::vector<OPTICAL_FLOW_RAD> outs;
+
+  for (uint64_t t = 10000; t <= 200000; t += 10000) {
+    if (integ.add(make_sample(t), out)) {
+      outs.push_back(out);
+    }
+  }
+
+  ASSERT_EQ(outs.size(), 4u);
+  for (size_t i = 0; i < outs.size(); i++) {
+    auto & o = outs[i];
+    EXPECT_EQ(o.time_usec, 50000u * (i + 1));
+    EXPECT_EQ(o.integration_time_us, 50000u);
+    EXPECT_NEAR(o.integrated_x, 0.05f, 1e-6);
+    EXPECT_NEAR(o.integrated_y, -0.10f, 1e-6);
+    EXPECT_NEAR(o.integrated_xgyro, 0.025f, 1e-6);
+    EXPECT_NEAR(o.integrated_zgyro, 0.005f, 1e-6);
+    EXPECT_EQ(o.quality, 200);
+    EXPECT_EQ(o.sensor_id, 3);
+    EXPECT_EQ(o.temperature, 2500);
+    EXPECT_FLOAT_EQ(o.distance, 1.5f);
+    EXPECT_EQ(o.time_delta_distance_us, 2000u);
+  }
+}
+
+TEST(FlowIntegrator, jittery_intervals)
+{
+  FlowIntegrator integ(50000);
+  OPTICAL_FLOW_RAD out;
+
+  // intervals slightly shorter than nominal must not stretch the window by a sample
+  uint64_t t = 0;
+  int n = 0;
+  bool done = false;
+  while (!done) {
+    auto s = make_sample(t += 9900);
+    s.integration_time_us = 9900;
+    done = integ.add(s, out);
+    n++;
+  }
+
+  EXPECT_EQ(n, 5);
+  EXPECT_EQ(out.integration_time_us, 49500u);
+}
+
+TEST(FlowIntegrator, quality_weighting)
+{
+  FlowIntegrator integ(50000);
+  OPTICAL_FLOW_RAD out;
+
+  // 2 of 5 samples rejected
+  ASSERT_FALSE(integ.add(make_sample(10000, 100), out));
+  ASSERT_FALSE(integ.add(make_sample(20000, 0), out));
+  ASSERT_FALSE(integ.add(make_sample(30000, 200), out));
+  ASSERT_FALSE(integ.add(make_sample(40000, 0), out));
+  ASSERT_TRUE(integ.add(make_sample(50000, 150), out));
+
+  // flow and gyro only over valid time
+  EXPECT_EQ(out.integration_time_us, 30000u);
+  EXPECT_NEAR(out.integrated_x, 0.03f, 1e-6);
+  EXPECT_NEAR(out.integrated_xgyro, 0.015f, 1e-6);
+  // (100 + 200 + 150) * 10ms / 50ms
+  EXPECT_EQ(out.quality, 90);
+}
+
+TEST(FlowIntegrator, all_rejected)
+{
+  FlowIntegrator integ(30000);
+  OPTICAL_FLOW_RAD out;
+
+  ASSERT_FALSE(integ.add(make_sample(10000, 0), out));
+  ASSERT_FALSE(integ.add(make_sample(20000, 0), out));
+  ASSERT_TRUE(integ.add(make_sample(30000, 0), out));
+
+  EXPECT_EQ(out.quality, 0);
+  EXPECT_EQ(out.integration_time_us, 30000u);
+  EXPECT_FLOAT_EQ(out.integrated_x, 0.0f);
+  EXPECT_NEAR(out.integrated_xgyro, 0.015f, 1e-6);
+}
+
+TEST(FlowIntegrator, distance_age)
+{
+  FlowIntegrator integ(30000);
+  OPTICAL_FLOW_RAD out;
+
+  ASSERT_FALSE(integ.add(make_sample(10000, 200, 2.0f), out));
+  ASSERT_FALSE(integ.add(make_sample(20000, 200, -1.0f), out));
+  ASSERT_TRUE(integ.add(make_sample(30000, 200, -1.0f), out));
+
+  // measured at 8 ms, output at 30 ms
+  EXPECT_FLOAT_EQ(out.distance, 2.0f);
+  EXPECT_EQ(out.time_delta_distance_us, 22000u);
+
+  // no distance in the window
+  ASSERT_FALSE(integ.add(make_sample(40000, 200, -1.0f), out));
+  ASSERT_FALSE(integ.add(make_sample(50000, 200, -1.0f), out));
+  ASSERT_TRUE(integ.add(make_sample(60000, 200, -1.0f), out));
+  EXPECT_LT(out.distance, 0.0f);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,164 @@
+//
+// mavros
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * Test mavros metrics registry and exporter
+ */
+
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "mavros/metrics.hpp"
+#include "rclcpp/logging.hpp"
+
+using namespace mavros::metrics; // NOLINT
+
+static bool contains(const std::string & text, const std::string & line)
+{
+  return text.find(line + "\n") != std::string::npos;
+}
+
+TEST(Metrics, counter_gauge)
+{
+  Registry reg;
+
+  auto c = reg.counter("test_events", "Test events", {{"ep", "a"}});
+  c->inc();
+  c->inc(2);
+  reg.counter("test_events", "Test events", {{"ep", "b"}})->inc(5);
+
+  // same name and labels return same object
+  EXPECT_EQ(c, reg.counter("test_events", "Test events", {{"ep", "a"}}));
+  EXPECT_THROW(reg.gauge("test_events", "wrong type"), std::invalid_argument);
+
+  auto g = reg.gauge("test_speed", "Test speed");
+  g->set(1.5);
+  g->add(1.0);
+
+  auto text = reg.serialize();
+  EXPECT_TRUE(contains(text, "# TYPE test_events counter"));
+  EXPECT_TRUE(contains(text, "test_events_total{ep=\"a\"} 3"));
+  EXPECT_TRUE(contains(text, "test_events_total{ep=\"b\"} 5"));
+  EXPECT_TRUE(contains(text, "# TYPE test_speed gauge"));
+  EXPECT_TRUE(contains(text, "test_speed 2.5"));
+  EXPECT_TRUE(contains(text, "# EOF"));
+
+  reg.remove("test_events", {{"ep", "b"}});
+  EXPECT_FALSE(contains(reg.serialize(), "test_events_total{ep=\"b\"} 5"));
+}
+
+TEST(Metrics, histogram)
+{
+  Registry reg;
+
+  auto h = reg.histogram("test_latency_seconds", "Test latency", {0.1, 1.0});
+  h->observe(0.05);
+  h->observe(0.5);
+  h->observe(0.5);
+  h->observe(std::chrono::seconds(5));
+
+  EXPECT_EQ(uint64_t(4), h->get_count());
+  EXPECT_DOUBLE_EQ(6.05, h->get_sum());
+
+  auto text = reg.serialize();
+  EXPECT_TRUE(contains(text, "test_latency_seconds_bucket{le=\"0.1\"} 1"));
+  EXPECT_TRUE(contains(text, "test_latency_seconds_bucket{le=\"1\"} 3"));
+  EXPECT_TRUE(contains(text, "test_latency_seconds_bucket{le=\"+Inf\"} 4"));
+  EXPECT_TRUE(contains(text, "test_latency_seconds_count 4"));
+}
+
+TEST(Metrics, collector)
+{
+  Registry reg;
+  int calls = 0;
+
+  auto id = reg.add_collector(
+    [&calls](Registry & r) {
+      r.gauge("test_collected", "Collected value")->set(++calls);
+    });
+
+  EXPECT_TRUE(contains(reg.serialize(), "test_collected 1"));
+  EXPECT_TRUE(contains(reg.serialize(), "test_collected 2"));
+
+  reg.remove_collector(id);
+  reg.serialize();
+  EXPECT_EQ(2, calls);
+}
+
+TEST(Metrics, remove_collector_waits)
+{
+  Registry reg;
+  std::atomic<bool> running{false};
+  std::atomic<bool> done{false};
+
+  auto id = reg.add_collector(
+    [&](Registry & r) {
+      running = true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      r.gauge("test_slow", "Slow collector")->set(1);
+      done = true;
+    });
+
+  std::thread scrape([&reg]() {reg.serialize();});
+  while (!running) {
+    std::this_thread::yield();
+  }
+
+  // owner of the collector may be destroyed right after that
+  reg.remove_collector(id);
+  EXPECT_TRUE(done);
+
+  scrape.join();
+}
+
+TEST(Metrics, exporter)
+{
+  Registry reg;
+  reg.counter("test_scraped", "Scraped value")->inc(42);
+
+  Exporter exporter(reg, 0, "127.0.0.1", rclcpp::get_logger("test_metrics"));
+  ASSERT_NE(0, exporter.get_port());
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(exporter.get_port());
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(0, connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)));
+
+  const std::string req = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ASSERT_EQ(ssize_t(req.size()), send(fd, req.data(), req.size(), 0));
+
+  std::string resp;
+  char buf[1024];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+    resp.append(buf, n);
+  }
+  close(fd);
+
+  EXPECT_EQ(0u, resp.rfind("HTTP/1.1 200 OK\r\n", 0));
+  EXPECT_TRUE(contains(resp, "test_scraped_total 42"));
+}
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,113 @@
+//
+// mavros
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * Test polygon simplification used for geofence upload
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "mavros/polygon_simplify.hpp"
+
+using mavros::utils::point_segment_distance;
+using mavros::utils::simplify_polygon;
+
+//! max distance of original vertices to simplified outline
+static double max_deviation(
+  const std::vector<Eigen::Vector2d> & points,
+  const std::vector<size_t> & kept)
+{
+  double max_d = 0.0;
+  for (auto & p : points) {
+    double d = INFINITY;
+    for (size_t i = 0; i < kept.size(); i++) {
+      d = std::min(
+        d, point_segment_distance(
+          p, points[kept[i]],
+          points[kept[(i + 1) % kept.size()]]));
+    }
+    max_d = std::max(max_d, d);
+  }
+  return max_d;
+}
+
+//! operational area outline densely sampled along its edges, like a fence drawn from a map
+static std::vector<Eigen::Vector2d> make_area_fence(size_t points_per_edge, double noise)
+{
+  const std::vector<Eigen::Vector2d> corners{
+    {0, 0}, {800, -50}, {1200, 300}, {1100, 900}, {600, 1100}, {200, 800}, {-100, 400}};
+
+  std::mt19937 gen(1);
+  std::normal_distribution<double> nd(0.0, noise);
+  std::vector<Eigen::Vector2d> points;
+
+  for (size_t c = 0; c < corners.size(); c++) {
+    auto & a = corners[c];
+    auto & b = corners[(c + 1) % corners.size()];
+    for (size_t i = 0; i < points_per_edge; i++) {
+      double t = double(i) / points_per_edge;
+      points.push_back(a + t * (b - a) + Eigen::Vector2d(nd(gen), nd(gen)));
+    }
+  }
+
+  return points;
+}
+
+TEST(PolygonSimplify, disabled_or_small)
+{
+  std::vector<Eigen::Vector2d> tri{{0, 0}, {1, 0}, {0, 1}};
+  EXPECT_EQ(simplify_polygon(tri, 10.0).size(), 3u);
+
+  auto fence = make_area_fence(10, 0.0);
+  EXPECT_EQ(simplify_polygon(fence, 0.0).size(), fence.size());
+}
+
+TEST(PolygonSimplify, collinear_points_removed)
+{
+  std::vector<Eigen::Vector2d> square{
+    {0, 0}, {5, 0}, {10, 0}, {10, 5}, {10, 10}, {5, 10}, {0, 10}, {0, 5}};
+
+  auto kept = simplify_polygon(square, 0.01);
+  EXPECT_EQ(kept, (std::vector<size_t>{0, 2, 4, 6}));
+}
+
+TEST(PolygonSimplify, area_fence_within_tolerance)
+{
+  const double tolerance = 1.0;
+  auto fence = make_area_fence(60, 0.2);     // 420 vertices
+
+  auto kept = simplify_polygon(fence, tolerance);
+
+  RecordProperty("vertices_in", fence.size());
+  RecordProperty("vertices_out", kept.size());
+
+  EXPECT_TRUE(std::is_sorted(kept.begin(), kept.end()));
+  EXPECT_LE(max_deviation(fence, kept), tolerance);
+  // 7 corners plus a few noise outliers, far less than one item per input vertex
+  EXPECT_GE(kept.size(), 7u);
+  EXPECT_LT(kept.size(), fence.size() / 10);
+}
+
+TEST(PolygonSimplify, degenerate_keeps_three)
+{
+  std::vector<Eigen::Vector2d> flat{{0, 0}, {1, 0.001}, {2, 0}, {3, 0.002}, {4, 0}};
+
+  auto kept = simplify_polygon(flat, 1.0);
+  EXPECT_EQ(kept.size(), 3u);
+  EXPECT_TRUE(std::is_sorted(kept.begin(), kept.end()));
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
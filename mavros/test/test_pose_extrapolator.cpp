@@ -0,0 +1,150 @@
+//
+// mavros
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * Test pose extrapolator with synthetic detection streams
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "mavros/pose_extrapolator.hpp"
+
+using mavros::utils::PoseExtrapolator;
+
+static rclcpp::Time t_sec(double t)
+{
+  return rclcpp::Time(static_cast<int64_t>(t * 1e9), RCL_ROS_TIME);
+}
+
+static Eigen::Vector3d target_at(double t)
+{
+  // slow drift relative to camera while descending
+  return Eigen::Vector3d(0.5 + 0.4 * t, -0.2 - 0.3 * t, 10.0 - 1.0 * t);
+}
+
+TEST(PoseExtrapolator, no_detection)
+{
+  PoseExtrapolator ex;
+  Eigen::Vector3d pos;
+  Eigen::Quaterniond q;
+
+  EXPECT_FALSE(ex.predict(t_sec(1.0), pos, q));
+}
+
+TEST(PoseExtrapolator, bursty_stream_50hz)
+{
+  PoseExtrapolator ex;
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> interval(1.0 / 30.0, 1.0 / 5.0);
+  std::normal_distribution<double> noise(0.0, 0.01);
+
+  const auto q_in = Eigen::Quaterniond(Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitZ()));
+
+  double next_detection = 0.0;
+  double max_error = 0.0;
+  size_t n_predicted = 0;
+
+  // 50 Hz output loop, detections arrive at random 5-30 Hz
+  for (double t = 0.0; t < 5.0; t += 0.02) {
+    while (next_detection <= t) {
+      Eigen::Vector3d meas = target_at(next_detection) +
+        Eigen::Vector3d(noise(gen), noise(gen), noise(gen));
+      EXPECT_TRUE(ex.update(t_sec(next_detection), meas, q_in));
+      next_detection += interval(gen);
+    }
+
+    Eigen::Vector3d pos;
+    Eigen::Quaterniond q;
+    ASSERT_TRUE(ex.predict(t_sec(t), pos, q));
+    EXPECT_TRUE(q.isApprox(q_in));
+
+    if (t > 1.0) {                  // after convergence
+      max_error = std::max(max_error, (pos - target_at(t)).norm());
+      n_predicted++;
+    }
+  }
+
+  EXPECT_GT(n_predicted, 190u);
+  EXPECT_LT(max_error, 0.1);
+  EXPECT_NEAR(ex.get_velocity().x(), 0.4, 0.1);
+  EXPECT_NEAR(ex.get_velocity().z(), -1.0, 0.1);
+}
+
+TEST(PoseExtrapolator, stale_cutoff)
+{
+  PoseExtrapolator::Config config;
+  config.timeout = 0.3;
+
+  PoseExtrapolator ex(config);
+  auto q_in = Eigen::Quaterniond::Identity();
+
+  ex.update(t_sec(0.0), target_at(0.0), q_in);
+  ex.update(t_sec(0.1), target_at(0.1), q_in);
+
+  Eigen::Vector3d pos;
+  Eigen::Quaterniond q;
+  ASSERT_TRUE(ex.predict(t_sec(0.3), pos, q));
+  EXPECT_TRUE(pos.isApprox(target_at(0.3), 1e-6));
+
+  ASSERT_TRUE(ex.predict(t_sec(0.35), pos, q));
+  EXPECT_FALSE(ex.predict(t_sec(0.45), pos, q));
+}
+
+TEST(PoseExtrapolator, ignore_old_and_restart_after_gap)
+{
+  PoseExtrapolator::Config config;
+  config.timeout = 0.5;
+
+  PoseExtrapolator ex(config);
+  auto q_in = Eigen::Quaterniond::Identity();
+
+  EXPECT_TRUE(ex.update(t_sec(1.0), target_at(1.0), q_in));
+  EXPECT_TRUE(ex.update(t_sec(1.1), target_at(1.1), q_in));
+  EXPECT_FALSE(ex.update(t_sec(1.1), target_at(1.1), q_in));
+  EXPECT_FALSE(ex.update(t_sec(1.05), target_at(1.05), q_in));
+
+  // track lost, target jumped: new track must not inherit old velocity
+  const Eigen::Vector3d jumped(3.0, 3.0, 5.0);
+  EXPECT_TRUE(ex.update(t_sec(3.0), jumped, q_in));
+  EXPECT_TRUE(ex.get_velocity().isZero());
+
+  Eigen::Vector3d pos;
+  Eigen::Quaterniond q;
+  ASSERT_TRUE(ex.predict(t_sec(3.2), pos, q));
+  EXPECT_TRUE(pos.isApprox(jumped));
+}
+
+TEST(PoseExtrapolator, clock_type_change)
+{
+  PoseExtrapolator ex;
+  auto q_in = Eigen::Quaterniond::Identity();
+
+  EXPECT_TRUE(ex.update(t_sec(1.0), target_at(1.0), q_in));
+  EXPECT_TRUE(ex.update(t_sec(1.1), target_at(1.1), q_in));
+
+  // source switched clock: restart instead of throwing on stamp difference
+  const rclcpp::Time t_steady(5000000000, RCL_STEADY_TIME);
+  EXPECT_TRUE(ex.update(t_steady, target_at(1.2), q_in));
+  EXPECT_TRUE(ex.get_velocity().isZero());
+  EXPECT_EQ(ex.get_stamp().get_clock_type(), RCL_STEADY_TIME);
+
+  Eigen::Vector3d pos;
+  Eigen::Quaterniond q;
+  EXPECT_FALSE(ex.predict(t_sec(5.1), pos, q));
+  ASSERT_TRUE(ex.predict(rclcpp::Time(5100000000, RCL_STEADY_TIME), pos, q));
+  EXPECT_TRUE(pos.isApprox(target_at(1.2)));
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,119 @@
+//
+// mavros
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * Test sequence lock used for vehicle snapshot
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "mavros/seqlock.hpp"
+
+using mavros::utils::SeqLock;
+
+//! odd size to cover partial last word
+struct Sample
+{
+  uint64_t a;
+  double b;
+  uint32_t c;
+  uint8_t d[13];
+};
+
+TEST(SeqLock, store_load)
+{
+  SeqLock<Sample> lock;
+
+  auto v = lock.load();
+  EXPECT_EQ(v.a, 0u);
+  EXPECT_EQ(lock.version(), 0u);
+
+  lock.update([](Sample & s) {s.a = 1; s.d[12] = 42;});
+  lock.update([](Sample & s) {s.b = 2.5;});
+
+  uint64_t version;
+  v = lock.load(version);
+  EXPECT_EQ(version, 2u);
+  EXPECT_EQ(v.a, 1u);
+  EXPECT_EQ(v.b, 2.5);
+  EXPECT_EQ(v.d[12], 42);
+
+  lock.store(Sample{7, 0.0, 3, {}});
+  v = lock.load();
+  EXPECT_EQ(v.a, 7u);
+  EXPECT_EQ(v.c, 3u);
+  EXPECT_EQ(v.d[12], 0);
+}
+
+TEST(SeqLock, concurrent_consistent)
+{
+  SeqLock<Sample> lock;
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> torn{0};
+  std::atomic<size_t> reads{0};
+
+  // every update writes the same counter into all fields
+  auto writer = [&]() {
+      for (uint32_t i = 1; i <= 200000; i++) {
+        lock.update(
+          [i](Sample & s) {
+            s.a = i;
+            s.b = i;
+            s.c = i;
+            for (auto & d : s.d) {
+              d = i & 0xff;
+            }
+          });
+      }
+    };
+
+  auto reader = [&]() {
+      uint64_t last_version = 0;
+      while (!stop) {
+        uint64_t version;
+        auto s = lock.load(version);
+        bool ok = s.b == double(s.a) && s.c == s.a && version >= last_version;
+        for (auto d : s.d) {
+          ok &= d == (s.a & 0xff);
+        }
+        if (!ok) {
+          torn++;
+        }
+        last_version = version;
+        reads++;
+      }
+    };
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; i++) {
+    readers.emplace_back(reader);
+  }
+
+  std::thread w1(writer), w2(writer);
+  w1.join();
+  w2.join();
+  stop = true;
+  for (auto & t : readers) {
+    t.join();
+  }
+
+  EXPECT_EQ(torn, 0u);
+  EXPECT_GT(reads, 0u);
+  EXPECT_EQ(lock.version(), 400000u);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
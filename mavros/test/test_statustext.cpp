@@ -0,0 +1,258 @@
+//
+// mavros
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * Test STATUSTEXT reassembly and filtering
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "mavros/statustext.hpp"
+
+using mavros::utils::StatusTextAssembler;
+using mavros::utils::StatusTextFilter;
+using namespace std::chrono_literals;  // NOLINT
+
+using Texts = std::vector<StatusTextAssembler::Text>;
+
+static const auto t0 = std::chrono::steady_clock::time_point(100s);
+
+TEST(StatusTextAssembler, not_chunked)
+{
+  StatusTextAssembler asm_;
+  Texts out;
+
+  asm_.push(1, 1, 6, 0, 0, "hello", true, out, t0);
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].severity, 6);
+  EXPECT_EQ(out[0].text, "hello");
+}
+
+TEST(StatusTextAssembler, reassembly)
+{
+  StatusTextAssembler asm_;
+  Texts out;
+
+  const std::string c0(50, 'a'), c1(50, 'b');
+  asm_.push(1, 1, 4, 7, 0, c0, false, out, t0);
+  asm_.push(1, 1, 4, 7, 1, c1, false, out, t0 + 10ms);
+  EXPECT_TRUE(out.empty());
+
+  // duplicate chunk is ignored
+  asm_.push(1, 1, 4, 7, 1, c1, false, out, t0 + 20ms);
+  asm_.push(1, 1, 4, 7, 2, "end", true, out, t0 + 30ms);
+
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].severity, 4);
+  EXPECT_EQ(out[0].text, c0 + c1 + "end");
+}
+
+TEST(StatusTextAssembler, lost_chunk)
+{
+  StatusTextAssembler asm_;
+  Texts out;
+
+  asm_.push(1, 1, 4, 7, 0, "first ", false, out, t0);
+  asm_.push(1, 1, 4, 7, 2, " last", true, out, t0);
+
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].text, "first ... last");
+}
+
+TEST(StatusTextAssembler, interleaved_ids)
+{
+  StatusTextAssembler asm_;
+  Texts out;
+
+  // same id from other component is a different text
+  asm_.push(1, 1, 3, 1, 0, "A0", false, out, t0);
+  asm_.push(1, 1, 6, 2, 0, "B0", false, out, t0);
+  asm_.push(1, 2, 4, 1, 0, "C0", false, out, t0);
+  asm_.push(1, 1, 6, 2, 1, "B1", true, out, t0);
+  asm_.push(1, 2, 4, 1, 1, "C1", true, out, t0);
+  asm_.push(1, 1, 3, 1, 1, "A1", true, out, t0);
+
+  ASSERT_EQ(out.size(), 3u);
+  EXPECT_EQ(out[0].text, "B0B1");
+  EXPECT_EQ(out[0].severity, 6);
+  EXPECT_EQ(out[1].text, "C0C1");
+  EXPECT_EQ(out[1].severity, 4);
+  EXPECT_EQ(out[2].text, "A0A1");
+  EXPECT_EQ(out[2].severity, 3);
+}
+
+TEST(StatusTextAssembler, ring_eviction)
+{
+  StatusTextAssembler asm_;
+  Texts out;
+
+  for (uint16_t id = 1; id <= 5; id++) {
+    asm_.push(1, 1, 6, id, 0, "t" + std::to_string(id), false, out, t0);
+  }
+
+  // oldest incomplete text is pushed out
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].text, "t1...");
+}
+
+TEST(StatusTextAssembler, free_slot_reused)
+{
+  StatusTextAssembler asm_;
+  Texts out;
+
+  // slots freed by completed texts are taken before evicting in-progress one
+  asm_.push(1, 1, 6, 1, 0, "long ", false, out, t0);
+  for (uint16_t id = 2; id <= 6; id++) {
+    asm_.push(1, 1, 6, id, 0, "s" + std::to_string(id), false, out, t0 + 10ms);
+    asm_.push(1, 1, 6, id, 1, "!", true, out, t0 + 10ms);
+  }
+  asm_.push(1, 1, 6, 1, 1, "text", true, out, t0 + 20ms);
+
+  ASSERT_EQ(out.size(), 6u);
+  EXPECT_EQ(out[5].text, "long text");
+
+  // all slots in use: least recently updated is evicted
+  out.clear();
+  asm_.push(1, 1, 6, 10, 0, "a", false, out, t0 + 30ms);
+  asm_.push(1, 1, 6, 11, 0, "b", false, out, t0 + 40ms);
+  asm_.push(1, 1, 6, 12, 0, "c", false, out, t0 + 50ms);
+  asm_.push(1, 1, 6, 13, 0, "d", false, out, t0 + 60ms);
+  asm_.push(1, 1, 6, 10, 1, "a", false, out, t0 + 70ms);
+  asm_.push(1, 1, 6, 14, 0, "e", false, out, t0 + 80ms);
+
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].text, "b...");
+}
+
+TEST(StatusTextAssembler, timeout)
+{
+  StatusTextAssembler asm_;
+  Texts out;
+
+  asm_.set_timeout(1s);
+  asm_.push(1, 1, 2, 9, 0, "partial", false, out, t0);
+
+  asm_.expire(t0 + 500ms, out);
+  EXPECT_TRUE(out.empty());
+
+  asm_.expire(t0 + 1500ms, out);
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].severity, 2);
+  EXPECT_EQ(out[0].text, "partial...");
+
+  // emitted only once
+  asm_.expire(t0 + 3s, out);
+  EXPECT_EQ(out.size(), 1u);
+
+  // next message also flushes expired texts
+  out.clear();
+  asm_.push(1, 1, 2, 10, 0, "other", false, out, t0 + 4s);
+  asm_.push(1, 1, 6, 0, 0, "plain", true, out, t0 + 6s);
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].text, "other...");
+  EXPECT_EQ(out[1].text, "plain");
+}
+
+TEST(StatusTextAssembler, clear)
+{
+  StatusTextAssembler asm_;
+  Texts out;
+
+  asm_.push(1, 1, 6, 3, 0, "lost", false, out, t0);
+  asm_.clear();
+  asm_.expire(t0 + 10s, out);
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(StatusTextFilter, level)
+{
+  EXPECT_EQ(StatusTextFilter::level(0), StatusTextFilter::Level::error);
+  EXPECT_EQ(StatusTextFilter::level(3), StatusTextFilter::Level::error);
+  EXPECT_EQ(StatusTextFilter::level(4), StatusTextFilter::Level::warn);
+  EXPECT_EQ(StatusTextFilter::level(5), StatusTextFilter::Level::warn);
+  EXPECT_EQ(StatusTextFilter::level(6), StatusTextFilter::Level::info);
+  EXPECT_EQ(StatusTextFilter::level(7), StatusTextFilter::Level::debug);
+}
+
+TEST(StatusTextFilter, dedup_window)
+{
+  StatusTextFilter filter;
+  size_t repeated, limited;
+
+  filter.set_dedup_window(2s);
+
+  EXPECT_TRUE(filter.check(4, "Low battery", repeated, limited, t0));
+  EXPECT_EQ(repeated, 0u);
+
+  for (int i = 1; i <= 5; i++) {
+    EXPECT_FALSE(filter.check(4, "Low battery", repeated, limited, t0 + i * 100ms));
+  }
+
+  // other text and same text of other severity pass
+  EXPECT_TRUE(filter.check(4, "GPS lost", repeated, limited, t0 + 600ms));
+  EXPECT_TRUE(filter.check(3, "Low battery", repeated, limited, t0 + 600ms));
+
+  // window is counted from the last logged copy
+  EXPECT_TRUE(filter.check(4, "Low battery", repeated, limited, t0 + 2100ms));
+  EXPECT_EQ(repeated, 5u);
+  EXPECT_FALSE(filter.check(4, "Low battery", repeated, limited, t0 + 3s));
+  EXPECT_TRUE(filter.check(4, "Low battery", repeated, limited, t0 + 4200ms));
+  EXPECT_EQ(repeated, 1u);
+}
+
+TEST(StatusTextFilter, dedup_disabled)
+{
+  StatusTextFilter filter;
+  size_t repeated, limited;
+
+  filter.set_dedup_window(0s);
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(filter.check(6, "same", repeated, limited, t0));
+    EXPECT_EQ(repeated, 0u);
+  }
+}
+
+TEST(StatusTextFilter, per_level_buckets)
+{
+  StatusTextFilter filter;
+  size_t repeated, limited;
+
+  filter.set_dedup_window(0s);
+  filter.set_rate_limit(StatusTextFilter::Level::info, 2.0, t0);
+  filter.set_rate_limit(StatusTextFilter::Level::warn, 0.0, t0);
+
+  // burst up to bucket size, then dropped
+  EXPECT_TRUE(filter.check(6, "i0", repeated, limited, t0));
+  EXPECT_TRUE(filter.check(6, "i1", repeated, limited, t0));
+  EXPECT_FALSE(filter.check(6, "i2", repeated, limited, t0));
+  EXPECT_FALSE(filter.check(6, "i3", repeated, limited, t0));
+
+  // other level is not affected, 0 is unlimited
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(filter.check(4, "w", repeated, limited, t0));
+    EXPECT_EQ(limited, 0u);
+  }
+
+  // refill at rate, dropped count reported with next passed text
+  EXPECT_FALSE(filter.check(6, "i4", repeated, limited, t0 + 200ms));
+  EXPECT_TRUE(filter.check(6, "i5", repeated, limited, t0 + 600ms));
+  EXPECT_EQ(limited, 3u);
+  EXPECT_TRUE(filter.check(6, "i6", repeated, limited, t0 + 1100ms));
+  EXPECT_EQ(limited, 0u);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
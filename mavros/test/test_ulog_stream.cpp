@@ -0,0 +1,386 @@
+//
+// mavros
+// Copyright 2021 Vladimir Ermakov, All rights reserved.
+//
+// This file is part of the mavros package and subject to the license terms
+// in the top-level LICENSE file of the mavros repository.
+// https://github.com/mavlink/mavros/tree/master/LICENSE.md
+//
+
+/**
+ * Test ULog stream reassembly used by log streaming plugin
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mavros/async_file_writer.hpp"
+#include "mavros/ulog_stream.hpp"
+
+using mavros::utils::AsyncFileWriter;
+using mavros::utils::ULogStreamAssembler;
+
+//! LOGGING_DATA payload
+struct Packet
+{
+  uint16_t sequence;
+  uint8_t first_message_offset;
+  std::vector<uint8_t> data;
+};
+
+//! ULog file: header, then messages carrying their index and a fill pattern
+static std::vector<uint8_t> make_ulog(size_t n_messages, std::vector<size_t> & starts)
+{
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<size_t> size_dist(4, 600);
+
+  std::vector<uint8_t> file(ULogStreamAssembler::MAGIC.begin(), ULogStreamAssembler::MAGIC.end());
+  file.resize(ULogStreamAssembler::HEADER_SIZE, 0);
+  starts = {0};
+
+  for (uint32_t i = 0; i < n_messages; i++) {
+    const size_t size = size_dist(gen);
+    starts.push_back(file.size());
+
+    file.push_back(size & 0xff);
+    file.push_back(size >> 8);
+    file.push_back('D');
+    for (size_t k = 0; k < size; k++) {
+      file.push_back(k < 4 ? (i >> (8 * k)) & 0xff : (i + k) & 0xff);
+    }
+  }
+
+  return file;
+}
+
+//! split file into packets the way FCU does, marking first message start in each
+static std::vector<Packet> packetize(
+  const std::vector<uint8_t> & file, const std::vector<size_t> & starts,
+  uint16_t first_seq, size_t packet_size = 249)
+{
+  std::vector<Packet> packets;
+  auto it = starts.begin();
+
+  for (size_t pos = 0; pos < file.size(); pos += packet_size) {
+    const size_t len = std::min(packet_size, file.size() - pos);
+    while (it != starts.end() && *it < pos) {
+      ++it;
+    }
+
+    Packet p;
+    p.sequence = first_seq + packets.size();
+    p.first_message_offset = (it != starts.end() && *it < pos + len) ? *it - pos : 255;
+    p.data.assign(file.begin() + pos, file.begin() + pos + len);
+    packets.push_back(std::move(p));
+  }
+
+  return packets;
+}
+
+struct Result
+{
+  std::vector<uint32_t> indices;    //!< indices of intact messages
+  size_t dropouts = 0;
+  bool valid = true;
+};
+
+//! parse reassembled file and check every message
+static Result parse_ulog(const std::vector<uint8_t> & out)
+{
+  Result r;
+
+  if (out.size() < ULogStreamAssembler::HEADER_SIZE ||
+    !std::equal(
+      ULogStreamAssembler::MAGIC.begin(), ULogStreamAssembler::MAGIC.end(),
+      out.begin()))
+  {
+    r.valid = false;
+    return r;
+  }
+
+  size_t pos = ULogStreamAssembler::HEADER_SIZE;
+  while (pos < out.size()) {
+    if (out.size() - pos < 3) {
+      r.valid = false;
+      break;
+    }
+
+    const size_t size = out[pos] | (out[pos + 1] << 8);
+    const uint8_t type = out[pos + 2];
+    const uint8_t * payload = out.data() + pos + 3;
+    if (out.size() - pos - 3 < size) {
+      r.valid = false;
+      break;
+    }
+
+    if (type == ULogStreamAssembler::MSG_TYPE_DROPOUT) {
+      r.dropouts++;
+      r.valid &= size == 2;
+    } else {
+      uint32_t idx = payload[0] | (payload[1] << 8) | (payload[2] << 16) | (payload[3] << 24);
+      for (size_t k = 4; k < size; k++) {
+        r.valid &= payload[k] == ((idx + k) & 0xff);
+      }
+      r.valid &= type == 'D';
+      r.indices.push_back(idx);
+    }
+
+    pos += 3 + size;
+  }
+
+  return r;
+}
+
+static std::vector<uint8_t> run_assembler(
+  ULogStreamAssembler & asm_, const std::vector<Packet> & packets,
+  const std::set<size_t> & lost = {})
+{
+  std::vector<uint8_t> out;
+  auto sink = [&](const uint8_t * data, size_t len) {
+      out.insert(out.end(), data, data + len);
+    };
+
+  for (size_t i = 0; i < packets.size(); i++) {
+    if (lost.count(i)) {
+      continue;
+    }
+
+    auto & p = packets[i];
+    asm_.push(p.sequence, p.data.data(), p.data.size(), p.first_message_offset, i * 2, sink);
+  }
+
+  return out;
+}
+
+TEST(ULogStream, lossless_identical)
+{
+  std::vector<size_t> starts;
+  auto file = make_ulog(2000, starts);
+
+  for (size_t packet_size : {249, 100, 17}) {
+    ULogStreamAssembler asm_;
+    auto out = run_assembler(asm_, packetize(file, starts, 0, packet_size));
+
+    EXPECT_EQ(out, file) << "packet size " << packet_size;
+    EXPECT_TRUE(asm_.has_header());
+    EXPECT_EQ(asm_.get_stats().gaps, 0u);
+    EXPECT_EQ(asm_.get_stats().bytes_out, file.size());
+  }
+}
+
+TEST(ULogStream, gaps_keep_messages_intact)
+{
+  std::vector<size_t> starts;
+  auto file = make_ulog(3000, starts);
+  auto packets = packetize(file, starts, 0);
+
+  std::mt19937 gen(2);
+  std::uniform_int_distribution<size_t> dist(5, packets.size() - 1);
+  std::set<size_t> lost;
+  while (lost.size() < packets.size() / 50) {
+    lost.insert(dist(gen));
+  }
+  lost.insert(packets.size() - 1);    // tail is never completed
+
+  ULogStreamAssembler asm_;
+  auto out = run_assembler(asm_, packets, lost);
+  auto r = parse_ulog(out);
+  auto & st = asm_.get_stats();
+
+  EXPECT_TRUE(r.valid);
+  EXPECT_EQ(st.lost_packets, lost.size() - 1);
+  // a gap hit while already resyncing does not add one more dropout
+  EXPECT_GT(r.dropouts, 0u);
+  EXPECT_LE(r.dropouts, st.gaps);
+  EXPECT_TRUE(std::is_sorted(r.indices.begin(), r.indices.end()));
+  EXPECT_EQ(std::set<uint32_t>(r.indices.begin(), r.indices.end()).size(), r.indices.size());
+  // lost packets cost only messages touching them
+  EXPECT_GT(r.indices.size(), 3000u * 9 / 10);
+  EXPECT_LT(r.indices.size(), 3000u);
+}
+
+TEST(ULogStream, long_message_across_gap)
+{
+  std::vector<size_t> starts;
+  auto file = make_ulog(200, starts);
+  auto packets = packetize(file, starts, 0, 17);
+
+  // drop a packet in the middle of a message and all packets until next start
+  size_t lost = 0;
+  for (size_t i = 20; i < packets.size(); i++) {
+    if (packets[i].first_message_offset == 255) {
+      lost = i;
+      break;
+    }
+  }
+  ASSERT_NE(lost, 0u);
+
+  ULogStreamAssembler asm_;
+  auto r = parse_ulog(run_assembler(asm_, packets, {lost}));
+
+  EXPECT_TRUE(r.valid);
+  EXPECT_EQ(r.dropouts, 1u);
+  EXPECT_EQ(r.indices.size(), 199u);
+  EXPECT_GT(asm_.get_stats().bytes_dropped, 0u);
+}
+
+TEST(ULogStream, duplicates_and_wraparound)
+{
+  std::vector<size_t> starts;
+  auto file = make_ulog(500, starts);
+  auto packets = packetize(file, starts, 65500);
+
+  // acked packets are retransmitted if ack got lost
+  std::vector<Packet> with_dups;
+  for (size_t i = 0; i < packets.size(); i++) {
+    with_dups.push_back(packets[i]);
+    if (i % 7 == 0) {
+      with_dups.push_back(packets[i]);
+    }
+  }
+
+  ULogStreamAssembler asm_;
+  auto out = run_assembler(asm_, with_dups);
+
+  EXPECT_EQ(out, file);
+  EXPECT_EQ(asm_.get_stats().gaps, 0u);
+  EXPECT_GT(asm_.get_stats().duplicates, 0u);
+  EXPECT_LT(packets.back().sequence, 65500u);
+}
+
+TEST(ULogStream, wait_for_header)
+{
+  std::vector<size_t> starts;
+  auto file = make_ulog(100, starts);
+  auto packets = packetize(file, starts, 0);
+
+  // joined mid-stream: nothing but valid file may be written
+  packets.erase(packets.begin(), packets.begin() + 3);
+
+  ULogStreamAssembler asm_;
+  auto out = run_assembler(asm_, packets);
+
+  EXPECT_TRUE(out.empty());
+  EXPECT_FALSE(asm_.has_header());
+
+  asm_.reset();
+  out = run_assembler(asm_, packetize(file, starts, 0));
+  EXPECT_EQ(out, file);
+}
+
+static std::vector<uint8_t> read_file(const std::string & path)
+{
+  std::vector<uint8_t> data;
+  FILE * f = std::fopen(path.c_str(), "rb");
+  if (f == nullptr) {
+    return data;
+  }
+
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) {
+    data.insert(data.end(), buf, buf + n);
+  }
+
+  std::fclose(f);
+  return data;
+}
+
+TEST(ULogStream, link_rate_to_file)
+{
+  using clock = std::chrono::steady_clock;
+
+  constexpr size_t N_MESSAGES = 4000;
+  std::vector<size_t> starts;
+  auto file = make_ulog(N_MESSAGES, starts);
+  auto packets = packetize(file, starts, 0);
+
+  // second half of the stream has lost packets
+  const size_t first_lost = packets.size() / 2;
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<size_t> dist(first_lost, packets.size() - 2);
+  std::set<size_t> lost{first_lost};
+  while (lost.size() < packets.size() / 100) {
+    lost.insert(dist(gen));
+  }
+
+  auto path = ::testing::TempDir() + "mavros_ulog_stream_link.ulg";
+  AsyncFileWriter writer(64 << 10);
+  ASSERT_TRUE(writer.open(path));
+
+  ULogStreamAssembler asm_;
+  size_t sink_failures = 0;
+  auto sink = [&](const uint8_t * data, size_t len) {
+      sink_failures += !writer.write(data, len);
+    };
+
+  // LOGGING_DATA at 4000 packets/s (~1 MB/s), paced in 10 packet bursts like a link would
+  constexpr size_t RATE = 4000, BURST = 10;
+  const auto period = std::chrono::microseconds(1000000 * BURST / RATE);
+  const auto start = clock::now();
+  size_t lossless_bytes = 0;
+
+  for (size_t i = 0; i < packets.size(); i++) {
+    if (i % BURST == 0) {
+      std::this_thread::sleep_until(start + period * (i / BURST));
+    }
+    if (i == first_lost) {
+      lossless_bytes = asm_.get_stats().bytes_out;
+    }
+    if (lost.count(i)) {
+      continue;
+    }
+
+    auto & p = packets[i];
+    const uint64_t stamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      clock::now() - start).count();
+    asm_.push(p.sequence, p.data.data(), p.data.size(), p.first_message_offset, stamp_ms, sink);
+  }
+
+  const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  writer.close();
+
+  auto out = read_file(path);
+  auto r = parse_ulog(out);
+  auto & st = asm_.get_stats();
+  auto ws = writer.get_stats();
+
+  // writer kept up with the link: nothing dropped, producer was never held back
+  const double planned = double(packets.size()) / RATE;
+  RecordProperty("throughput_Bps", std::to_string(int(st.bytes_in / elapsed)));
+  EXPECT_EQ(sink_failures, 0u);
+  EXPECT_EQ(ws.bytes_dropped, 0u);
+  EXPECT_EQ(ws.bytes_written, st.bytes_out);
+  EXPECT_LT(elapsed, planned * 1.5 + 0.5);
+  EXPECT_GT(st.bytes_in / elapsed, 0.5 * RATE * 249);
+
+  // byte exact until the first gap
+  ASSERT_EQ(out.size(), st.bytes_out);
+  ASSERT_GT(lossless_bytes, file.size() / 3);
+  EXPECT_TRUE(std::equal(out.begin(), out.begin() + lossless_bytes, file.begin()));
+
+  // then intact messages with dropout records in place of lost data
+  EXPECT_TRUE(r.valid);
+  EXPECT_EQ(st.lost_packets, lost.size());
+  EXPECT_GT(r.dropouts, 0u);
+  EXPECT_LE(r.dropouts, st.gaps);
+  EXPECT_TRUE(std::is_sorted(r.indices.begin(), r.indices.end()));
+  EXPECT_GT(r.indices.size(), N_MESSAGES * 9 / 10);
+  EXPECT_LT(r.indices.size(), N_MESSAGES);
+
+  std::remove(path.c_str());
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -14,10 +14,12 @@
  * @{
  */
 
+#include <chrono>
 #include <memory>
 
 #include "rcpputils/asserts.hpp"
 #include "mavros/mavros_uas.hpp"
+#include "mavros/metrics.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/plugin_filter.hpp"
 
@@ -48,6 +50,15 @@ public:
 /**
  * @brief 3DR Radio plugin.
  * @plugin tdr_radio
+ *
+ * Optionally lowers FCU stream rates when radio reports its tx buffer
+ * filling up or rx error rate above threshold, SiK radios are TDM so downlink
+ * air time is freed for uplink. Rates are restored after link is good for hold_time.
+ * Uplink itself is shaped by the router (radio_shaping parameter).
+ *
+ * @note Stream shaping uses REQUEST_DATA_STREAM(ALL), which is ArduPilot only
+ *       (PX4 ignores it) and overrides per-stream SRx_* rates on the FCU.
+ *       Both stream_rate_low and stream_rate_normal must be set to enable it.
  */
 class TDRRadioPlugin : public plugin::Plugin
 {
@@ -56,7 +67,15 @@ public:
   : Plugin(uas_, "tdr_radio"),
     has_radio_status(false),
     diag_added(false),
-    low_rssi(0)
+    low_rssi(0),
+    txbuf_low(40),
+    stream_rate_low(0),
+    stream_rate_normal(0),
+    rx_error_rate(1.0),
+    hold_time(std::chrono::seconds(10)),
+    streams_reduced(false),
+    last_rxerrors(0),
+    reduce_count(0)
   {
     enable_node_watch_parameters();
 
@@ -65,6 +84,38 @@ public:
         low_rssi = p.as_int();
       });
 
+    // stream shaping (ArduPilot only), disabled if stream_rate_low or stream_rate_normal == 0
+    node_declate_and_watch_parameter(
+      "shaping.txbuf_low", 40, [&](const rclcpp::Parameter & p) {
+        txbuf_low = p.as_int();
+      });
+    node_declate_and_watch_parameter(
+      "shaping.stream_rate_low", 0, [&](const rclcpp::Parameter & p) {
+        stream_rate_low = p.as_int();
+      });
+    node_declate_and_watch_parameter(
+      "shaping.stream_rate_normal", 0, [&](const rclcpp::Parameter & p) {
+        stream_rate_normal = p.as_int();
+      });
+    node_declate_and_watch_parameter(
+      "shaping.rx_error_rate", 1.0, [&](const rclcpp::Parameter & p) {
+        rx_error_rate = p.as_double();
+      });
+    node_declate_and_watch_parameter(
+      "shaping.hold_time", 10.0, [&](const rclcpp::Parameter & p) {
+        hold_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double>(p.as_double()));
+      });
+
+    auto & registry = metrics::Registry::global();
+    const metrics::Labels labels{{"uas", uas->get_fully_qualified_name()}};
+    metric_txbuf = registry.gauge("mavros_radio_txbuf", "Radio free tx buffer [%]", labels);
+    metric_rssi = registry.gauge("mavros_radio_rssi_dbm", "Radio local RSSI [dBm]", labels);
+    metric_remrssi = registry.gauge("mavros_radio_remrssi_dbm", "Radio remote RSSI [dBm]", labels);
+    metric_rxerrors = registry.counter("mavros_radio_rxerrors", "Radio rx errors", labels);
+    metric_reductions = registry.counter(
+      "mavros_radio_stream_reductions", "FCU stream rate reductions", labels);
+
     auto sensor_qos = rclcpp::SensorDataQoS();
 
     status_pub = node->create_publisher<mavros_msgs::msg::RadioStatus>("radio_status", sensor_qos);
@@ -85,6 +136,22 @@ private:
   bool diag_added;
   int low_rssi;
 
+  int txbuf_low;
+  int stream_rate_low;
+  int stream_rate_normal;
+  double rx_error_rate;
+  std::chrono::nanoseconds hold_time;
+  bool streams_reduced;
+  uint16_t last_rxerrors;
+  size_t reduce_count;
+  rclcpp::Time last_congestion;
+
+  metrics::Gauge::SharedPtr metric_txbuf;
+  metrics::Gauge::SharedPtr metric_rssi;
+  metrics::Gauge::SharedPtr metric_remrssi;
+  metrics::Counter::SharedPtr metric_rxerrors;
+  metrics::Counter::SharedPtr metric_reductions;
+
   rclcpp::Publisher<mavros_msgs::msg::RadioStatus>::SharedPtr status_pub;
 
   std::mutex diag_mutex;
@@ -143,15 +210,92 @@ private:
       diag_added = true;
     }
 
+    metric_txbuf->set(msg->txbuf);
+    metric_rssi->set(msg->rssi_dbm);
+    metric_remrssi->set(msg->remrssi_dbm);
+    metric_rxerrors->set(msg->rxerrors);
+
     // store last status for diag
     {
       std::lock_guard<std::mutex> lock(diag_mutex);
+      shape_streams(*msg);
       last_status = msg;
     }
 
     status_pub->publish(*msg);
   }
 
+  /**
+   * Lower FCU stream rates on congestion, restore after hold_time without it.
+   * Called under diag_mutex.
+   */
+  void shape_streams(const mavros_msgs::msg::RadioStatus & rst)
+  {
+    // rxerrors is 16-bit counter which could wrap
+    const uint16_t new_errors = last_status ? uint16_t(rst.rxerrors - last_rxerrors) : 0;
+    last_rxerrors = rst.rxerrors;
+
+    if (!shaping_enabled()) {
+      if (stream_rate_low > 0) {
+        RCLCPP_WARN_THROTTLE(
+          get_logger(), *get_clock(), 60000,
+          "3DR: shaping.stream_rate_low set without shaping.stream_rate_normal, "
+          "stream shaping disabled");
+      }
+      return;
+    }
+
+    // single error is normal on SiK links, react on error rate only
+    double error_rate = 0.0;
+    if (last_status) {
+      const double dt = (rclcpp::Time(rst.header.stamp) -
+        rclcpp::Time(last_status->header.stamp)).seconds();
+      if (dt > 0.0) {
+        error_rate = new_errors / dt;
+      }
+    }
+
+    auto now = node->now();
+    const bool congested = rst.txbuf < txbuf_low || error_rate > rx_error_rate;
+
+    if (congested) {
+      last_congestion = now;
+      if (!streams_reduced) {
+        RCLCPP_WARN(
+          get_logger(), "3DR: link congested (txbuf %u%%, %.1f errors/s), streams -> %d Hz",
+          rst.txbuf, error_rate, stream_rate_low);
+        request_streams(stream_rate_low);
+        streams_reduced = true;
+        reduce_count++;
+        metric_reductions->inc();
+      }
+    } else if (streams_reduced && (now - last_congestion).nanoseconds() > hold_time.count()) {
+      RCLCPP_INFO(get_logger(), "3DR: link recovered, streams -> %d Hz", stream_rate_normal);
+      request_streams(stream_rate_normal);
+      streams_reduced = false;
+    }
+  }
+
+  bool shaping_enabled() const
+  {
+    return stream_rate_low > 0 && stream_rate_normal > 0;
+  }
+
+  /**
+   * REQUEST_DATA_STREAM(ALL): ArduPilot only, sets every SRx_* stream to @a rate.
+   */
+  void request_streams(int rate)
+  {
+    mavlink::common::msg::REQUEST_DATA_STREAM rq = {};
+
+    uas->msg_set_target(rq);
+    rq.req_stream_id = utils::enum_value(mavlink::common::MAV_DATA_STREAM::ALL);
+    rq.req_message_rate = rate;
+    rq.start_stop = 1;
+
+    uas->send_message(rq);
+  }
+
 
   void diag_run(diagnostic_updater::DiagnosticStatusWrapper & stat)
   {
@@ -177,6 +321,11 @@ private:
     stat.addf("Remote noice level", "%u", last_status->remnoise);
     stat.addf("Rx errors", "%u", last_status->rxerrors);
     stat.addf("Fixed", "%u", last_status->fixed);
+
+    if (shaping_enabled()) {
+      stat.add("Streams reduced", streams_reduced ? "yes" : "no");
+      stat.addf("Stream reductions", "%zu", reduce_count);
+    }
   }
 
   void connection_cb(bool connected [[maybe_unused]]) override
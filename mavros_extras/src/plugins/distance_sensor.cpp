@@ -18,18 +18,22 @@
 #include <yaml-cpp/yaml.h>
 #include <tf2_eigen/tf2_eigen.h>
 
-#include <unordered_map>
+#include <array>
+#include <chrono>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <shared_mutex>     // NOLINT cpplint, that is almost 4 years since standard release!
 
 #include "rcpputils/asserts.hpp"
 #include "mavros/mavros_uas.hpp"
+#include "mavros/metrics.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/plugin_filter.hpp"
 
 #include "sensor_msgs/msg/range.hpp"
+#include "mavros_msgs/msg/range_array.hpp"
 
 namespace mavros
 {
@@ -38,6 +42,7 @@ namespace extra_plugins
 using namespace std::placeholders;      // NOLINT
 using utils::enum_value;
 using sensor_msgs::msg::Range;
+using mavros_msgs::msg::RangeArray;
 
 class DistanceSensorPlugin;
 
@@ -69,11 +74,13 @@ private:
   double vertical_fov_ratio;        //!< vertical fov ratio for ROS messages
   Eigen::Quaternionf quaternion;    //!< Orientation in vehicle body frame for ROTATION_CUSTOM
 
-  // topic handle
+  // topic handle, not used in array mode
   rclcpp::Publisher<Range>::SharedPtr pub;
   rclcpp::Subscription<Range>::SharedPtr sub;
   std::string topic_name;
 
+  size_t array_index;                   //!< index in published RangeArray
+
   DistanceSensorPlugin * owner;
 
   std::vector<float> data;              //!< array allocation for measurements
@@ -126,6 +133,9 @@ private:
 
   //! sensor_msgs/Range subscription callback
   void range_cb(const Range::SharedPtr msg);
+
+  //! Convert and send range to the FCU
+  void send_range(const Range & msg);
 };
 
 
@@ -135,55 +145,55 @@ private:
  *
  * This plugin allows publishing distance sensor data, which is connected to
  * an offboard/companion computer through USB/Serial, to the FCU or vice-versa.
+ *
+ * In array mode (array.enable) configured sensors do not get their own topics.
+ * Ranges from the FCU are collected into one mavros_msgs/RangeArray,
+ * published on ~/ranges at array.rate, and ranges for the FCU are taken
+ * from one RangeArray on ~/set_ranges.
  */
 class DistanceSensorPlugin : public plugin::Plugin
 {
 public:
   explicit DistanceSensorPlugin(plugin::UASPtr uas_)
-  : plugin::Plugin(uas_, "distance_sensor")
+  : plugin::Plugin(uas_, "distance_sensor"),
+    array_enable(false),
+    array_rate(20.0),
+    array_mode(false),
+    array_updated(false)
   {
     enable_node_watch_parameters();
 
+    sensor_slot.fill(-1);
+
+    init_metrics(single_metrics, "single");
+    init_metrics(array_metrics, "array");
+    metric_samples = metrics::Registry::global().counter(
+      "mavros_distance_sensor_samples", "DISTANCE_SENSOR messages received",
+      {{"uas", uas->get_fully_qualified_name()}});
+
     node_declate_and_watch_parameter(
       "base_frame_id", "base_link", [&](const rclcpp::Parameter & p) {
         base_frame_id = p.as_string();
       });
     node_declate_and_watch_parameter(
-      "config", "", [&](const rclcpp::Parameter & p) {
-        std::unique_lock lock(mutex);
-
-        sensor_map.clear();
-
-        auto lg = get_logger();
-        YAML::Node root_node;
-
-        try {
-          root_node = YAML::Load(p.as_string());
-        } catch (const YAML::ParserException & ex) {
-          RCLCPP_ERROR_STREAM(lg, "DS: Failed to parse config: " << ex.what());
-          return;
-        }
-
-        if (root_node.IsNull()) {
-          RCLCPP_INFO(lg, "DS: Plugin not configured!");
-          return;
-        } else if (!root_node.IsMap()) {
-          RCLCPP_ERROR(lg, "DS: Config must be a map.");
-          return;
+      "array.enable", false, [&](const rclcpp::Parameter & p) {
+        array_enable = p.as_bool();
+        if (!config_str.empty()) {
+          load_config();
         }
-
-        for (auto it = root_node.begin(); it != root_node.end(); ++it) {
-          auto key_s = it->first.as<std::string>();
-          RCLCPP_INFO_STREAM(lg, "DS: " << key_s << ": Loading config: " << it->second);
-
-          try {
-            auto item = std::make_shared<DistanceSensorItem>(this, key_s, it->second);
-            sensor_map[item->sensor_id] = item;
-          } catch (const std::exception & ex) {
-            RCLCPP_ERROR_STREAM(lg, "DS: " << key_s << ": Failed to load mapping: " << ex.what());
-          }
+      });
+    node_declate_and_watch_parameter(
+      "array.rate", 20.0, [&](const rclcpp::Parameter & p) {
+        array_rate = p.as_double();
+        if (!config_str.empty()) {
+          load_config();
         }
       });
+    node_declate_and_watch_parameter(
+      "config", "", [&](const rclcpp::Parameter & p) {
+        config_str = p.as_string();
+        load_config();
+      });
   }
 
   Subscriptions get_subscriptions() override
@@ -198,9 +208,147 @@ private:
   using ItemPtr = std::shared_ptr<DistanceSensorItem>;
 
   std::string base_frame_id;
+  std::string config_str;
+  bool array_enable;                            //!< parameter value, applied by load_config()
+  double array_rate;
 
   std::shared_mutex mutex;
-  std::unordered_map<uint8_t, ItemPtr> sensor_map;
+  bool array_mode;                              //!< mode of current sensor items
+  std::vector<ItemPtr> sensors;                 //!< in config order
+  std::array<int16_t, 256> sensor_slot;         //!< sensor id -> index in sensors, -1 if none
+
+  // array mode
+  rclcpp::Publisher<RangeArray>::SharedPtr ranges_pub;
+  rclcpp::Subscription<RangeArray>::SharedPtr ranges_sub;
+  rclcpp::TimerBase::SharedPtr array_timer;
+
+  std::mutex array_mutex;
+  RangeArray array_msg;                         //!< latest range of each FCU sensor
+  bool array_updated;
+
+  struct ModeMetrics
+  {
+    metrics::Counter::SharedPtr published;
+    metrics::Histogram::SharedPtr publish_time;
+  };
+
+  ModeMetrics single_metrics;
+  ModeMetrics array_metrics;
+  metrics::Counter::SharedPtr metric_samples;
+
+  void init_metrics(ModeMetrics & m, const std::string & mode)
+  {
+    auto & registry = metrics::Registry::global();
+    const metrics::Labels labels{
+      {"uas", uas->get_fully_qualified_name()},
+      {"mode", mode}};
+
+    m.published = registry.counter(
+      "mavros_distance_sensor_published", "Range messages published", labels);
+    m.publish_time = registry.histogram(
+      "mavros_distance_sensor_publish_seconds", "Time spent in publish calls",
+      metrics::Histogram::latency_bounds(), labels);
+  }
+
+  /**
+   * @brief (Re)create sensor items from config
+   */
+  void load_config()
+  {
+    std::unique_lock lock(mutex);
+
+    sensors.clear();
+    sensor_slot.fill(-1);
+    array_timer.reset();
+    ranges_pub.reset();
+    ranges_sub.reset();
+
+    // items and topics are built for this mode, handlers see both under the lock
+    array_mode = array_enable;
+
+    auto lg = get_logger();
+    YAML::Node root_node;
+
+    try {
+      root_node = YAML::Load(config_str);
+    } catch (const YAML::ParserException & ex) {
+      RCLCPP_ERROR_STREAM(lg, "DS: Failed to parse config: " << ex.what());
+      return;
+    }
+
+    if (root_node.IsNull()) {
+      RCLCPP_INFO(lg, "DS: Plugin not configured!");
+      return;
+    } else if (!root_node.IsMap()) {
+      RCLCPP_ERROR(lg, "DS: Config must be a map.");
+      return;
+    }
+
+    for (auto it = root_node.begin(); it != root_node.end(); ++it) {
+      auto key_s = it->first.as<std::string>();
+      RCLCPP_INFO_STREAM(lg, "DS: " << key_s << ": Loading config: " << it->second);
+
+      try {
+        auto item = std::make_shared<DistanceSensorItem>(this, key_s, it->second);
+
+        // same id again replaces previous item
+        auto & slot = sensor_slot[item->sensor_id];
+        if (slot < 0) {
+          slot = sensors.size();
+          sensors.push_back(item);
+        } else {
+          sensors[slot] = item;
+        }
+      } catch (const std::exception & ex) {
+        RCLCPP_ERROR_STREAM(lg, "DS: " << key_s << ": Failed to load mapping: " << ex.what());
+      }
+    }
+
+    if (array_mode) {
+      setup_array();
+    }
+  }
+
+  /**
+   * @brief Prepare RangeArray with a slot for each FCU sensor, create array topics
+   */
+  void setup_array()
+  {
+    std::lock_guard<std::mutex> lock(array_mutex);
+
+    array_msg = RangeArray();
+    array_updated = false;
+
+    for (auto & item : sensors) {
+      if (item->is_subscriber) {
+        continue;
+      }
+
+      item->array_index = array_msg.ranges.size();
+
+      auto range = Range();
+      range.header.frame_id = item->frame_id;
+      range.field_of_view = item->field_of_view;
+      range.min_range = NAN;
+      range.max_range = NAN;
+      range.range = NAN;
+
+      array_msg.sensor_ids.push_back(item->sensor_id);
+      array_msg.ranges.push_back(range);
+    }
+
+    auto sensor_qos = rclcpp::SensorDataQoS();
+
+    ranges_pub = node->create_publisher<RangeArray>("~/ranges", sensor_qos);
+    ranges_sub = node->create_subscription<RangeArray>(
+      "~/set_ranges", sensor_qos, std::bind(&DistanceSensorPlugin::ranges_cb, this, _1));
+
+    if (!array_msg.ranges.empty() && array_rate > 0.0) {
+      array_timer = node->create_wall_timer(
+        rclcpp::WallRate(array_rate).period(),
+        std::bind(&DistanceSensorPlugin::array_timer_cb, this));
+    }
+  }
 
   /* -*- low-level send -*- */
   void distance_sensor(
@@ -263,9 +411,10 @@ private:
     std::shared_lock lock(mutex);
 
     auto lg = get_logger();
+    metric_samples->inc();
 
-    auto it = sensor_map.find(dist_sen.id);
-    if (it == sensor_map.end()) {
+    auto slot = sensor_slot[dist_sen.id];
+    if (slot < 0) {
       RCLCPP_ERROR(
         lg,
         "DS: no mapping for sensor id: %d, type: %d, orientation: %d",
@@ -273,7 +422,7 @@ private:
       return;
     }
 
-    auto sensor = it->second;
+    auto & sensor = sensors[slot];
     if (sensor->is_subscriber) {
       RCLCPP_ERROR(
         lg,
@@ -284,12 +433,14 @@ private:
     }
 
     if (sensor->orientation >= 0 && dist_sen.orientation != sensor->orientation) {
-      RCLCPP_ERROR(
-        lg,
-        "DS: %s: received sensor data has different orientation (%s) than in config (%s)!",
+      RCLCPP_ERROR_THROTTLE(
+        lg, *get_clock(), 10000,
+        "DS: %s: received sensor data has different orientation (%s/%d) than in config (%s/%d)!",
         sensor->topic_name.c_str(),
-        utils::to_string_enum<MAV_SENSOR_ORIENTATION>(dist_sen.orientation).c_str(),
-        utils::to_string_enum<MAV_SENSOR_ORIENTATION>(sensor->orientation).c_str());
+        utils::to_string_view_enum<MAV_SENSOR_ORIENTATION>(dist_sen.orientation).data(),
+        dist_sen.orientation,
+        utils::to_string_view_enum<MAV_SENSOR_ORIENTATION>(sensor->orientation).data(),
+        sensor->orientation);
       return;
     }
 
@@ -344,7 +495,71 @@ private:
       uas->tf2_broadcaster.sendTransform(transform);
     }
 
+    if (array_mode) {
+      std::lock_guard<std::mutex> alock(array_mutex);
+      array_msg.ranges[sensor->array_index] = range;
+      array_updated = true;
+      return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
     sensor->pub->publish(range);
+    single_metrics.publish_time->observe(std::chrono::steady_clock::now() - start);
+    single_metrics.published->inc();
+  }
+
+  /* -*- array mode callbacks -*- */
+
+  void array_timer_cb()
+  {
+    std::shared_lock lock(mutex);
+    RangeArray msg;
+
+    if (!ranges_pub) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> alock(array_mutex);
+      if (!array_updated) {
+        return;
+      }
+
+      array_updated = false;
+      msg = array_msg;
+    }
+
+    msg.header.stamp = node->now();
+    msg.header.frame_id = base_frame_id;
+
+    auto start = std::chrono::steady_clock::now();
+    ranges_pub->publish(msg);
+    array_metrics.publish_time->observe(std::chrono::steady_clock::now() - start);
+    array_metrics.published->inc();
+  }
+
+  void ranges_cb(const RangeArray::SharedPtr msg)
+  {
+    std::shared_lock lock(mutex);
+
+    if (msg->sensor_ids.size() != msg->ranges.size()) {
+      RCLCPP_ERROR(
+        get_logger(), "DS: RangeArray sizes differ: %zu ids, %zu ranges",
+        msg->sensor_ids.size(), msg->ranges.size());
+      return;
+    }
+
+    for (size_t i = 0; i < msg->ranges.size(); i++) {
+      auto slot = sensor_slot[msg->sensor_ids[i]];
+      if (slot < 0 || !sensors[slot]->is_subscriber) {
+        RCLCPP_ERROR_THROTTLE(
+          get_logger(), *get_clock(), 10000,
+          "DS: no subscriber mapping for sensor id: %d", msg->sensor_ids[i]);
+        continue;
+      }
+
+      sensors[slot]->send_range(msg->ranges[i]);
+    }
   }
 };
 
@@ -362,6 +577,7 @@ DistanceSensorItem::DistanceSensorItem(
   vertical_fov_ratio(1.0),
   quaternion(0.f, 0.f, 0.f, 0.f),
   topic_name(topic_name_),
+  array_index(0),
   owner(owner_),
   data{},
   data_index(0)
@@ -444,7 +660,11 @@ DistanceSensorItem::DistanceSensorItem(
     }
   }
 
-  // create topic handles
+  // create topic handles, in array mode plugin has common ones
+  if (owner->array_mode) {
+    return;
+  }
+
   auto sensor_qos = rclcpp::SensorDataQoS();
   if (!is_subscriber) {
     pub = owner->node->create_publisher<Range>(topic_name, sensor_qos);
@@ -457,6 +677,11 @@ DistanceSensorItem::DistanceSensorItem(
 }
 
 void DistanceSensorItem::range_cb(const Range::SharedPtr msg)
+{
+  send_range(*msg);
+}
+
+void DistanceSensorItem::send_range(const Range & msg)
 {
   using mavlink::common::MAV_DISTANCE_SENSOR;
 
@@ -466,13 +691,13 @@ void DistanceSensorItem::range_cb(const Range::SharedPtr msg)
   if (covariance > 0) {
     covariance_ = covariance;
   } else {
-    covariance_ = uint8_t(calculate_variance(msg->range) * 1E2);    // in cm
+    covariance_ = uint8_t(calculate_variance(msg.range) * 1E2);    // in cm
   }
 
   // current mapping, may change later
-  if (msg->radiation_type == Range::INFRARED) {
+  if (msg.radiation_type == Range::INFRARED) {
     type = enum_value(MAV_DISTANCE_SENSOR::LASER);
-  } else if (msg->radiation_type == Range::ULTRASOUND) {
+  } else if (msg.radiation_type == Range::ULTRASOUND) {
     type = enum_value(MAV_DISTANCE_SENSOR::ULTRASOUND);
   }
 
@@ -480,16 +705,16 @@ void DistanceSensorItem::range_cb(const Range::SharedPtr msg)
   ftf::quaternion_to_mavlink(quaternion, q);
 
   owner->distance_sensor(
-    get_time_boot_ms(msg->header.stamp),
-    msg->min_range / 1E-2,
-    msg->max_range / 1E-2,
-    msg->range / 1E-2,
+    get_time_boot_ms(msg.header.stamp),
+    msg.min_range / 1E-2,
+    msg.max_range / 1E-2,
+    msg.range / 1E-2,
     type,
     sensor_id,
     orientation,
     covariance_,
-    msg->field_of_view * horizontal_fov_ratio,
-    msg->field_of_view * vertical_fov_ratio,
+    msg.field_of_view * horizontal_fov_ratio,
+    msg.field_of_view * vertical_fov_ratio,
     q,
     0);
 }
@@ -14,6 +14,14 @@
  * @{
  */
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #include "rcpputils/asserts.hpp"
 #include "mavros/mavros_uas.hpp"
 #include "mavros/plugin.hpp"
@@ -34,12 +42,19 @@ using mavlink::common::GPS_INPUT_IGNORE_FLAGS;
  * @plugin gps_input
  *
  * Sends <a href="https://mavlink.io/en/messages/common.html#GPS_INPUT">GPS_INPUT MAVLink messages</a>
+ *
+ * If blend.inputs is set, each named input gets its own topic (~/blend/<name>),
+ * and a single blended GPS_INPUT is sent at gps_rate.
+ * Inputs are propagated to the send time using their velocity,
+ * then weighted by reported accuracy.
  */
 class GpsInputPlugin : public plugin::Plugin
 {
 public:
   explicit GpsInputPlugin(plugin::UASPtr uas_)
-  : Plugin(uas_, "gps_input")
+  : Plugin(uas_, "gps_input"),
+    blend_window(0.2),
+    blend_gps_id(0)
   {
     enable_node_watch_parameters();
 
@@ -47,7 +62,50 @@ public:
       "gps_rate", 5.0, [&](const rclcpp::Parameter & p) {
         rclcpp::Rate rate(p.as_double());
 
+        std::lock_guard<std::mutex> lock(blend_mutex);
         rate_period = rate.period();
+        restart_blend_timer();
+      });
+
+    node_declate_and_watch_parameter(
+      "blend.window", 0.2, [&](const rclcpp::Parameter & p) {
+        std::lock_guard<std::mutex> lock(blend_mutex);
+        blend_window = p.as_double();
+      });
+
+    node_declate_and_watch_parameter(
+      "blend.gps_id", 0, [&](const rclcpp::Parameter & p) {
+        std::lock_guard<std::mutex> lock(blend_mutex);
+        blend_gps_id = p.as_int();
+      });
+
+    node_declate_and_watch_parameter(
+      "blend.inputs", std::vector<std::string>(), [&](const rclcpp::Parameter & p) {
+        auto names = p.as_string_array();
+        if (names.size() > MAX_BLEND_INPUTS) {
+          RCLCPP_ERROR(
+            get_logger(), "GPS_INPUT: %zu blend inputs, only first %zu are used",
+            names.size(), MAX_BLEND_INPUTS);
+          names.resize(MAX_BLEND_INPUTS);
+        }
+
+        std::lock_guard<std::mutex> lock(blend_mutex);
+        blend_inputs.clear();
+        for (auto & name : names) {
+          auto input = std::make_shared<BlendInput>();
+          std::weak_ptr<BlendInput> weak_input = input;
+
+          input->name = name;
+          input->sub = node->create_subscription<mavros_msgs::msg::GPSINPUT>(
+            "~/blend/" + name, rclcpp::SensorDataQoS(),
+            [this, weak_input](const mavros_msgs::msg::GPSINPUT::SharedPtr msg) {
+              blend_input_cb(weak_input, msg);
+            });
+
+          blend_inputs.emplace_back(std::move(input));
+        }
+
+        restart_blend_timer();
       });
 
     gps_input_sub = node->create_subscription<mavros_msgs::msg::GPSINPUT>(
@@ -62,13 +120,306 @@ public:
   }
 
 private:
+  //! Input fields used for blending
+  struct Sample
+  {
+    rclcpp::Time stamp;
+    uint8_t fix_type;
+    uint16_t ignore_flags;
+    uint32_t time_week_ms;
+    uint16_t time_week;
+    double lat, lon;            //!< [deg]
+    float alt;
+    float hdop, vdop;
+    float vn, ve, vd;
+    float speed_accuracy, horiz_accuracy, vert_accuracy;
+    uint8_t satellites_visible;
+    uint16_t yaw;
+  };
+
+  //! One receiver, keeps few last samples in a ring
+  struct BlendInput
+  {
+    std::string name;
+    rclcpp::Subscription<mavros_msgs::msg::GPSINPUT>::SharedPtr sub;
+    std::array<Sample, 8> ring;
+    size_t head = 0;
+    size_t count = 0;
+
+    void push(const Sample & s)
+    {
+      ring[head] = s;
+      head = (head + 1) % ring.size();
+      count = std::min(count + 1, ring.size());
+    }
+
+    const Sample & latest() const
+    {
+      return ring[(head + ring.size() - 1) % ring.size()];
+    }
+
+    const Sample & nearest(const rclcpp::Time & t) const
+    {
+      const Sample * best = &latest();
+      for (size_t i = 0; i < count; i++) {
+        auto & s = ring[i];
+        if (std::abs((s.stamp - t).seconds()) < std::abs((best->stamp - t).seconds())) {
+          best = &s;
+        }
+      }
+      return *best;
+    }
+  };
+
   rclcpp::Subscription<mavros_msgs::msg::GPSINPUT>::SharedPtr gps_input_sub;
 
   std::chrono::nanoseconds rate_period;
   rclcpp::Time last_pos_time;
 
+  std::mutex blend_mutex;
+  std::vector<std::shared_ptr<BlendInput>> blend_inputs;
+  rclcpp::TimerBase::SharedPtr blend_timer;
+  double blend_window;          //!< [s] max age and misalignment of used samples
+  uint8_t blend_gps_id;
+
+  static constexpr double EARTH_RADIUS = 6378137.0;     //!< [m] WGS84 equatorial
+  static constexpr uint8_t MIN_FIX_TYPE = mavros_msgs::msg::GPSINPUT::GPS_FIX_TYPE_3D_FIX;
+  static constexpr float DEFAULT_ACCURACY = 5.0f;       //!< [m], [m/s] if receiver does not report it
+  static constexpr size_t MAX_BLEND_INPUTS = 8;
+
+  void restart_blend_timer()
+  {
+    blend_timer.reset();
+    if (blend_inputs.empty()) {
+      return;
+    }
+
+    blend_timer = node->create_wall_timer(
+      rate_period,
+      std::bind(&GpsInputPlugin::blend_timer_cb, this));
+  }
+
+  static float sigma(uint16_t ignore_flags, GPS_INPUT_IGNORE_FLAGS flag, float accuracy)
+  {
+    if ((ignore_flags & utils::enum_value(flag)) || !(accuracy > 0.0f)) {
+      return DEFAULT_ACCURACY;
+    }
+    return accuracy;
+  }
+
+  static bool has(uint16_t ignore_flags, GPS_INPUT_IGNORE_FLAGS flag)
+  {
+    return !(ignore_flags & utils::enum_value(flag));
+  }
+
+  /**
+   * @brief Blend aligned inputs and send one GPS_INPUT
+   */
+  void blend_timer_cb()
+  {
+    std::array<const Sample *, MAX_BLEND_INPUTS> used;
+    size_t n_used = 0;
+
+    std::unique_lock<std::mutex> lock(blend_mutex);
+
+    // reference time is the send time, so output keeps gps_rate
+    // instead of following the slowest receiver
+    const rclcpp::Time t_ref = node->now();
+    for (auto & in : blend_inputs) {
+      if (in->count == 0 || n_used == used.size()) {
+        continue;
+      }
+
+      auto & s = in->nearest(t_ref);
+      if (std::abs((t_ref - s.stamp).seconds()) > blend_window || s.fix_type < MIN_FIX_TYPE) {
+        continue;
+      }
+
+      used[n_used++] = &s;
+    }
+
+    if (n_used == 0) {
+      lock.unlock();
+      RCLCPP_DEBUG_THROTTLE(get_logger(), *get_clock(), 5000, "GPS_INPUT: no fresh inputs to blend");
+      return;
+    }
+
+    using GIF = GPS_INPUT_IGNORE_FLAGS;
+
+    // positions are blended as north/east offsets from first sample
+    const double lat0 = used[0]->lat, lon0 = used[0]->lon;
+    const double cos_lat0 = std::cos(lat0 * M_PI / 180.0);
+
+    double sum_wh = 0.0, sum_wv = 0.0, sum_wsh = 0.0, sum_wsv = 0.0;
+    double n = 0.0, e = 0.0, alt = 0.0, vn = 0.0, ve = 0.0, vd = 0.0;
+    const Sample * best = used[0];
+    float best_sigma = 1e9f;
+
+    mavlink::common::msg::GPS_INPUT gps_input {};
+    float hdop = INFINITY, vdop = INFINITY;
+    bool satellites_known = false;
+
+    for (size_t i = 0; i < n_used; i++) {
+      auto & s = *used[i];
+      const double dt = (t_ref - s.stamp).seconds();
+      const bool vel_h = has(s.ignore_flags, GIF::FLAG_VEL_HORIZ);
+      const bool vel_v = has(s.ignore_flags, GIF::FLAG_VEL_VERT);
+
+      // propagate to reference time
+      double sn = (s.lat - lat0) * M_PI / 180.0 * EARTH_RADIUS;
+      double se = (s.lon - lon0) * M_PI / 180.0 * EARTH_RADIUS * cos_lat0;
+      double salt = s.alt;
+      if (vel_h) {
+        sn += s.vn * dt;
+        se += s.ve * dt;
+      }
+      if (vel_v) {
+        salt -= s.vd * dt;
+      }
+
+      const double sh = sigma(s.ignore_flags, GIF::FLAG_HORIZONTAL_ACCURACY, s.horiz_accuracy);
+      const double wh = 1.0 / (sh * sh);
+      sum_wh += wh;
+      n += wh * sn;
+      e += wh * se;
+
+      if (has(s.ignore_flags, GIF::FLAG_ALT)) {
+        const double sv = sigma(s.ignore_flags, GIF::FLAG_VERTICAL_ACCURACY, s.vert_accuracy);
+        const double wv = 1.0 / (sv * sv);
+        sum_wv += wv;
+        alt += wv * salt;
+      }
+
+      const double ss = sigma(s.ignore_flags, GIF::FLAG_SPEED_ACCURACY, s.speed_accuracy);
+      const double ws = 1.0 / (ss * ss);
+      if (vel_h) {
+        sum_wsh += ws;
+        vn += ws * s.vn;
+        ve += ws * s.ve;
+      }
+      if (vel_v) {
+        sum_wsv += ws;
+        vd += ws * s.vd;
+      }
+
+      if (has(s.ignore_flags, GIF::FLAG_HDOP)) {
+        hdop = std::min(hdop, s.hdop);
+      }
+      if (has(s.ignore_flags, GIF::FLAG_VDOP)) {
+        vdop = std::min(vdop, s.vdop);
+      }
+      gps_input.fix_type = std::max(gps_input.fix_type, s.fix_type);
+      if (s.satellites_visible != UINT8_MAX) {
+        gps_input.satellites_visible = std::max(
+          gps_input.satellites_visible, s.satellites_visible);
+        satellites_known = true;
+      }
+
+      if (sh < best_sigma) {
+        best_sigma = sh;
+        best = &s;
+      }
+    }
+
+    gps_input.gps_id = blend_gps_id;
+    if (!satellites_known) {
+      gps_input.satellites_visible = UINT8_MAX;       // unknown
+    }
+
+    uint16_t ignore_flags = 0;
+    auto set_ignore = [&](GIF flag) {ignore_flags |= utils::enum_value(flag);};
+
+    gps_input.lat = std::lround((lat0 + n / sum_wh / EARTH_RADIUS * 180.0 / M_PI) * 1e7);
+    gps_input.lon =
+      std::lround((lon0 + e / sum_wh / (EARTH_RADIUS * cos_lat0) * 180.0 / M_PI) * 1e7);
+    gps_input.horiz_accuracy = 1.0 / std::sqrt(sum_wh);
+
+    if (sum_wv > 0.0) {
+      gps_input.alt = alt / sum_wv;
+      gps_input.vert_accuracy = 1.0 / std::sqrt(sum_wv);
+    } else {
+      set_ignore(GIF::FLAG_ALT);
+      set_ignore(GIF::FLAG_VERTICAL_ACCURACY);
+    }
+
+    if (sum_wsh > 0.0) {
+      gps_input.vn = vn / sum_wsh;
+      gps_input.ve = ve / sum_wsh;
+      gps_input.speed_accuracy = 1.0 / std::sqrt(sum_wsh);
+    } else {
+      set_ignore(GIF::FLAG_VEL_HORIZ);
+    }
+
+    if (sum_wsv > 0.0) {
+      gps_input.vd = vd / sum_wsv;
+    } else {
+      set_ignore(GIF::FLAG_VEL_VERT);
+    }
+
+    if (sum_wsh == 0.0 && sum_wsv == 0.0) {
+      set_ignore(GIF::FLAG_SPEED_ACCURACY);
+    }
+    if (std::isfinite(hdop)) {
+      gps_input.hdop = hdop;
+    } else {
+      set_ignore(GIF::FLAG_HDOP);
+    }
+    if (std::isfinite(vdop)) {
+      gps_input.vdop = vdop;
+    } else {
+      set_ignore(GIF::FLAG_VDOP);
+    }
+
+    // GPS time and yaw come from the most accurate receiver, shifted to reference time
+    constexpr int64_t WEEK_MS = 7 * 24 * 3600 * 1000LL;
+    int64_t week_ms = best->time_week_ms + std::llround((t_ref - best->stamp).seconds() * 1e3);
+    gps_input.time_week = best->time_week + (week_ms >= WEEK_MS) - (week_ms < 0);
+    gps_input.time_week_ms = (week_ms % WEEK_MS + WEEK_MS) % WEEK_MS;
+    gps_input.yaw = best->yaw;
+
+    gps_input.ignore_flags = ignore_flags;
+    gps_input.time_usec = get_time_usec(t_ref);
+    lock.unlock();
+
+    uas->send_message(gps_input);
+  }
+
   /* -*- callbacks -*- */
 
+  /**
+   * @brief Store blending input sample, cost does not depend on number of inputs
+   */
+  void blend_input_cb(
+    std::weak_ptr<BlendInput> weak_input,
+    const mavros_msgs::msg::GPSINPUT::SharedPtr ros_msg)
+  {
+    Sample s;
+
+    s.stamp = ros_msg->header.stamp;
+    s.fix_type = ros_msg->fix_type;
+    s.ignore_flags = ros_msg->ignore_flags;
+    s.time_week_ms = ros_msg->time_week_ms;
+    s.time_week = ros_msg->time_week;
+    s.lat = ros_msg->lat / 1e7;
+    s.lon = ros_msg->lon / 1e7;
+    s.alt = ros_msg->alt;
+    s.hdop = ros_msg->hdop;
+    s.vdop = ros_msg->vdop;
+    s.vn = ros_msg->vn;
+    s.ve = ros_msg->ve;
+    s.vd = ros_msg->vd;
+    s.speed_accuracy = ros_msg->speed_accuracy;
+    s.horiz_accuracy = ros_msg->horiz_accuracy;
+    s.vert_accuracy = ros_msg->vert_accuracy;
+    s.satellites_visible = ros_msg->satellites_visible;
+    s.yaw = ros_msg->yaw;
+
+    std::lock_guard<std::mutex> lock(blend_mutex);
+    if (auto in = weak_input.lock()) {
+      in->push(s);
+    }
+  }
+
   /**
    * @brief Send GPS coordinates through GPS_INPUT Mavlink message
    */
@@ -17,6 +17,7 @@
 #include <tf2_eigen/tf2_eigen.h>
 
 #include <algorithm>
+#include <mutex>
 #include <string>
 
 #include "rcpputils/asserts.hpp"
@@ -24,6 +25,7 @@
 #include "mavros/utils.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/plugin_filter.hpp"
+#include "mavros/pose_extrapolator.hpp"
 #include "mavros/setpoint_mixin.hpp"
 
 #include "geometry_msgs/msg/pose_stamped.hpp"
@@ -44,6 +46,9 @@ using mavlink::common::LANDING_TARGET_TYPE;
  *
  * This plugin is intended to publish the location of a landing area captured from a downward facing camera
  * to the FCU and/or receive landing target tracking data coming from the FCU.
+ *
+ * With extrapolation.rate > 0 detections only update a constant velocity tracker,
+ * and target is sent at that fixed rate until detection gets older than extrapolation.timeout.
  */
 class LandingTargetPlugin : public plugin::Plugin,
   private plugin::TF2ListenerMixin<LandingTargetPlugin>
@@ -64,7 +69,10 @@ public:
     image_width(640),
     image_height(480),
     mav_frame("LOCAL_NED"),
-    land_target_type("VISION_FIDUCIAL")
+    land_target_type("VISION_FIDUCIAL"),
+    target_num(0),
+    use_fov_angles(false),
+    size_rad_fov(Eigen::Vector2f::Zero())
   {
     enable_node_watch_parameters();
 
@@ -72,6 +80,7 @@ public:
     node_declate_and_watch_parameter(
       "frame_id", "landing_target_1", [&](const rclcpp::Parameter & p) {
         frame_id = p.as_string();
+        update_target_params();
       });
 
     node_declate_and_watch_parameter(
@@ -100,17 +109,20 @@ public:
         land_target_type = p.as_string();
         type = utils::landing_target_type_from_str(land_target_type);
         // LANDING_TARGET_TYPE index based on given type name (If unknown, defaults to LIGHT_BEACON)
+        update_target_params();
       });
 
     // target size
     node_declate_and_watch_parameter(
       "target_size.x", 1.0, [&](const rclcpp::Parameter & p) {
         target_size_x = p.as_double();  // [meters]
+        update_target_params();
       });
 
     node_declate_and_watch_parameter(
       "target_size.y", 1.0, [&](const rclcpp::Parameter & p) {
         target_size_y = p.as_double();
+        update_target_params();
       });
 
     // image size
@@ -139,6 +151,47 @@ public:
     node_declate_and_watch_parameter(
       "camera.focal_length", 2.8, [&](const rclcpp::Parameter & p) {
         focal_length = p.as_double();   // ex: OpenMV Cam M7: 2.8 [mm]
+        update_target_params();
+      });
+
+    // extrapolation subsection
+    node_declate_and_watch_parameter(
+      "extrapolation.rate", 0.0, [&](const rclcpp::Parameter & p) {
+        auto rate = p.as_double();
+
+        std::lock_guard<std::mutex> lock(extrapolator_mutex);
+        extrapolation_timer.reset();
+        extrapolator.reset();
+
+        if (rate > 0.0) {
+          extrapolation_timer = node->create_wall_timer(
+            rclcpp::WallRate(rate).period(),
+            std::bind(&LandingTargetPlugin::extrapolation_cb, this));
+        }
+      });
+
+    node_declate_and_watch_parameter(
+      "extrapolation.timeout", 0.5, [&](const rclcpp::Parameter & p) {
+        std::lock_guard<std::mutex> lock(extrapolator_mutex);
+        auto config = extrapolator.get_config();
+        config.timeout = p.as_double();
+        extrapolator.set_config(config);
+      });
+
+    node_declate_and_watch_parameter(
+      "extrapolation.alpha", 0.85, [&](const rclcpp::Parameter & p) {
+        std::lock_guard<std::mutex> lock(extrapolator_mutex);
+        auto config = extrapolator.get_config();
+        config.alpha = p.as_double();
+        extrapolator.set_config(config);
+      });
+
+    node_declate_and_watch_parameter(
+      "extrapolation.beta", 0.3, [&](const rclcpp::Parameter & p) {
+        std::lock_guard<std::mutex> lock(extrapolator_mutex);
+        auto config = extrapolator.get_config();
+        config.beta = p.as_double();
+        extrapolator.set_config(config);
       });
 
     // tf subsection
@@ -215,6 +268,10 @@ private:
   rclcpp::Publisher<geometry_msgs::msg::Vector3Stamped>::SharedPtr lt_marker_pub;
   rclcpp::Subscription<geometry_msgs::msg::PoseStamped>::SharedPtr pose_sub;
   rclcpp::Subscription<mavros_msgs::msg::LandingTarget>::SharedPtr land_target_sub;
+  rclcpp::TimerBase::SharedPtr extrapolation_timer;
+
+  std::mutex extrapolator_mutex;         //!< tf listener runs in its own thread
+  utils::PoseExtrapolator extrapolator;
 
   double target_size_x, target_size_y;
   double fov_x, fov_y;
@@ -227,6 +284,32 @@ private:
   LANDING_TARGET_TYPE type;
   std::string land_target_type;
 
+  // derived from params, see update_target_params()
+  uint8_t target_num;
+  bool use_fov_angles;
+  Eigen::Vector2f size_rad_fov;
+
+  /**
+   * @brief Precompute values which depend only on parameters
+   */
+  void update_target_params()
+  {
+    // the last char of frame_id is considered the number of the target
+    target_num = frame_id.empty() ? 0 : static_cast<uint8_t>(frame_id.back());
+
+    // NOTE: true when type name does not start with VISION, same as before caching
+    use_fov_angles = land_target_type.find("VISION") != 0;
+
+    /**
+     * @brief Angular diameter:
+     * δ = 2 * atan(d / (2 * D))
+     * where,	d = actual diameter; D = distance to the object (or focal length of a camera)
+     */
+    size_rad_fov = {
+      static_cast<float>(2 * (M_PI / 180.0) * atan(target_size_x / (2 * focal_length))),
+      static_cast<float>(2 * (M_PI / 180.0) * atan(target_size_y / (2 * focal_length)))};
+  }
+
   /* -*- low-level send -*- */
   void landing_target(
     uint64_t time_usec,
@@ -299,7 +382,7 @@ private:
   }
 
   /**
-   * @brief Send landing target transform to FCU
+   * @brief Convert landing target transform and send it or feed extrapolator
    */
   void send_landing_target(const rclcpp::Time & stamp, const Eigen::Affine3d & tr)
   {
@@ -314,30 +397,51 @@ private:
     auto q = ftf::transform_orientation_enu_ned(
       ftf::transform_orientation_baselink_aircraft(Eigen::Quaterniond(tr.rotation())));
 
+    std::unique_lock<std::mutex> lock(extrapolator_mutex);
+    if (extrapolation_timer) {
+      if (!extrapolator.update(stamp, pos, q)) {
+        RCLCPP_DEBUG_THROTTLE(
+          get_logger(),
+          *get_clock(), 10, "LT: Transform not newer than last one, dropped.");
+      }
+      return;
+    }
+    lock.unlock();
+
+    if (last_transform_stamp == stamp) {
+      RCLCPP_DEBUG_THROTTLE(
+        get_logger(),
+        *get_clock(), 10, "LT: Same transform as last one, dropped.");
+      return;
+    }
+    last_transform_stamp = stamp;
+
+    send_target(stamp, pos, q);
+  }
+
+  /**
+   * @brief Send landing target position (NED, WRT camera) to FCU
+   */
+  void send_target(
+    const rclcpp::Time & stamp, const Eigen::Vector3d & pos,
+    const Eigen::Quaterniond & q)
+  {
     Eigen::Vector2f angle;
     Eigen::Vector2f size_rad;
-    Eigen::Vector2f fov;
 
     // the norm of the position vector is considered the distance to the landing target
     float distance = pos.norm();
 
-    // if the landing target type is a vision type, compute the angular offsets
-    if (land_target_type.find("VISION")) {
+    if (use_fov_angles) {
       /**
        * @brief: the camera angular offsets can be computed by knowing the position
        * of the target center relative to the camera center, the field-of-view of
        * the camera and the image resolution being considered.
        * The target size is computed by the angle of view formula (similar to angular diameter).
        */
-      angle.x() = (pos.x() - image_width / 2.0) * fov.x() / image_width;
-      angle.y() = (pos.y() - image_height / 2.0) * fov.y() / image_height;
-      /**
-       * @brief Angular diameter:
-       * δ = 2 * atan(d / (2 * D))
-       * where,	d = actual diameter; D = distance to the object (or focal length of a camera)
-       */
-      size_rad = {2 * (M_PI / 180.0) * atan(target_size_x / (2 * focal_length)),
-        2 * (M_PI / 180.0) * atan(target_size_y / (2 * focal_length))};
+      angle.x() = (pos.x() - image_width / 2.0) * fov_x / image_width;
+      angle.y() = (pos.y() - image_height / 2.0) * fov_y / image_height;
+      size_rad = size_rad_fov;
     } else {
       // else, the same values are computed considering the displacement
       // relative to X and Y axes of the camera frame reference
@@ -346,21 +450,9 @@ private:
         2 * (M_PI / 180.0) * atan(target_size_y / (2 * distance))};
     }
 
-    if (last_transform_stamp == stamp) {
-      RCLCPP_DEBUG_THROTTLE(
-        get_logger(),
-        *get_clock(), 10, "LT: Same transform as last one, dropped.");
-      return;
-    }
-    last_transform_stamp = stamp;
-
-
-    // the last char of frame_id is considered the number of the target
-    uint8_t id = static_cast<uint8_t>(frame_id.back());
-
     landing_target(
       stamp.nanoseconds() / 1000,
-      id,
+      target_num,
       utils::enum_value(frame),         // by default, in LOCAL_NED
       angle,
       distance,
@@ -431,6 +523,27 @@ private:
   }
 
   /* -*- callbacks -*- */
+  /**
+   * @brief fixed rate sender, predicts target position at current time
+   */
+  void extrapolation_cb()
+  {
+    Eigen::Vector3d pos;
+    Eigen::Quaterniond q;
+    auto now = node->now();
+
+    std::unique_lock<std::mutex> lock(extrapolator_mutex);
+    if (!extrapolator.predict(now, pos, q)) {
+      RCLCPP_DEBUG_THROTTLE(
+        get_logger(),
+        *get_clock(), 10, "LT: No fresh detection, target not sent.");
+      return;
+    }
+    lock.unlock();
+
+    send_target(now, pos, q);
+  }
+
   /**
    * @brief callback for TF2 listener
    */
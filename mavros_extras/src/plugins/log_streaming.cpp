@@ -0,0 +1,324 @@
+/*
+ * Copyright 2021 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+/**
+ * @brief Log streaming plugin
+ * @file log_streaming.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup plugin
+ * @{
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "mavros/async_file_writer.hpp"
+#include "mavros/mavros_uas.hpp"
+#include "mavros/metrics.hpp"
+#include "mavros/plugin.hpp"
+#include "mavros/plugin_filter.hpp"
+#include "mavros/ulog_stream.hpp"
+
+#include "mavros_msgs/srv/command_long.hpp"
+#include "std_srvs/srv/trigger.hpp"
+
+namespace mavros
+{
+namespace extra_plugins
+{
+using namespace std::placeholders;      // NOLINT
+using mavlink::common::MAV_CMD;
+using utils::enum_value;
+
+/**
+ * @brief Log streaming plugin
+ * @plugin log_streaming
+ *
+ * Records ULog file streamed by PX4 logger (LOGGING_DATA, LOGGING_DATA_ACKED)
+ * on the companion computer. Messages are reassembled on the receive thread
+ * and written by a background thread, so disk never stalls the link.
+ */
+class LogStreamingPlugin : public plugin::Plugin
+{
+public:
+  explicit LogStreamingPlugin(plugin::UASPtr uas_)
+  : Plugin(uas_, "log_streaming"),
+    buffer_size(1 << 20),
+    streaming(false)
+  {
+    enable_node_watch_parameters();
+
+    node_declate_and_watch_parameter(
+      "directory", "", [&](const rclcpp::Parameter & p) {
+        directory = p.as_string();
+      });
+    node_declate_and_watch_parameter(
+      "buffer_size", 1 << 20, [&](const rclcpp::Parameter & p) {
+        buffer_size = std::max<int64_t>(p.as_int(), 4096);
+      });
+
+    auto & registry = metrics::Registry::global();
+    const metrics::Labels labels{{"uas", uas->get_fully_qualified_name()}};
+
+    metric_packets = registry.counter(
+      "mavros_log_streaming_packets", "LOGGING_DATA(_ACKED) packets received", labels);
+    metric_bytes = registry.counter(
+      "mavros_log_streaming_bytes", "Log bytes received", labels);
+    metric_lost = registry.counter(
+      "mavros_log_streaming_lost_packets", "Packets missing in sequence", labels);
+    metric_dropped = registry.counter(
+      "mavros_log_streaming_dropped_bytes", "Bytes of partial messages not written", labels);
+
+    start_srv = node->create_service<std_srvs::srv::Trigger>(
+      "~/start", std::bind(&LogStreamingPlugin::start_cb, this, _1, _2));
+    stop_srv = node->create_service<std_srvs::srv::Trigger>(
+      "~/stop", std::bind(&LogStreamingPlugin::stop_cb, this, _1, _2));
+
+    enable_connection_cb();
+  }
+
+  Subscriptions get_subscriptions() override
+  {
+    return {
+      make_handler(&LogStreamingPlugin::handle_logging_data),
+      make_handler(&LogStreamingPlugin::handle_logging_data_acked),
+    };
+  }
+
+private:
+  rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr start_srv;
+  rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr stop_srv;
+
+  std::string directory;
+  size_t buffer_size;
+
+  std::mutex stream_mutex;
+  bool streaming;
+  utils::ULogStreamAssembler assembler;
+  std::unique_ptr<utils::AsyncFileWriter> writer;
+
+  metrics::Counter::SharedPtr metric_packets;
+  metrics::Counter::SharedPtr metric_bytes;
+  metrics::Counter::SharedPtr metric_lost;
+  metrics::Counter::SharedPtr metric_dropped;
+
+  std::string make_file_name()
+  {
+    char stamp[32];
+    auto now = std::time(nullptr);
+    std::tm tm;
+    localtime_r(&now, &tm);
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d_%H-%M-%S", &tm);
+
+    std::string path = directory;
+    if (!path.empty() && path.back() != '/') {
+      path += '/';
+    }
+
+    return path + "log_" + stamp + ".ulg";
+  }
+
+  bool send_logging_command(MAV_CMD command)
+  {
+    try {
+      auto client = node->create_client<mavros_msgs::srv::CommandLong>("cmd/command");
+
+      auto cmdrq = std::make_shared<mavros_msgs::srv::CommandLong::Request>();
+      cmdrq->broadcast = false;
+      cmdrq->command = enum_value(command);
+      cmdrq->confirmation = false;
+      cmdrq->param1 = 0;          // ULog format
+
+      auto future = client->async_send_request(cmdrq);
+      auto response = future.get();
+      return response->success;
+    } catch (std::exception & ex) {
+      RCLCPP_ERROR(get_logger(), "LS: %s", ex.what());
+    }
+
+    return false;
+  }
+
+  /**
+   * @brief Stop recording, queued data is written out before return
+   * @return false if nothing was recorded
+   */
+  bool close_stream()
+  {
+    std::unique_ptr<utils::AsyncFileWriter> w;
+    utils::ULogStreamAssembler::Stats as;
+
+    {
+      std::lock_guard<std::mutex> lock(stream_mutex);
+      streaming = false;
+      w = std::move(writer);
+      as = assembler.get_stats();
+    }
+
+    if (!w) {
+      return false;
+    }
+
+    w->close();
+
+    auto ws = w->get_stats();
+    RCLCPP_INFO(
+      get_logger(), "LS: %s: %zu bytes written, %zu packets lost, %zu bytes dropped",
+      w->get_file_name().c_str(), ws.bytes_written, as.lost_packets,
+      as.bytes_dropped + ws.bytes_dropped);
+    RCLCPP_WARN_EXPRESSION(
+      get_logger(), ws.errors > 0, "LS: %zu write errors", ws.errors);
+    return true;
+  }
+
+  void process_packet(
+    uint16_t sequence, const uint8_t * data, size_t length,
+    uint8_t first_message_offset)
+  {
+    std::lock_guard<std::mutex> lock(stream_mutex);
+    if (!streaming) {
+      return;
+    }
+
+    const auto stamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+    const auto before = assembler.get_stats();
+
+    assembler.push(
+      sequence, data, length, first_message_offset, stamp_ms,
+      [this](const uint8_t * buf, size_t len) {
+        if (!writer->write(buf, len)) {
+          metric_dropped->inc(len);
+        }
+      });
+
+    const auto & after = assembler.get_stats();
+    metric_packets->inc();
+    metric_bytes->inc(length);
+
+    if (after.gaps != before.gaps) {
+      metric_lost->inc(after.lost_packets - before.lost_packets);
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), *get_clock(), 5000, "LS: %zu packets lost",
+        after.lost_packets);
+    }
+    if (after.bytes_dropped != before.bytes_dropped) {
+      metric_dropped->inc(after.bytes_dropped - before.bytes_dropped);
+    }
+  }
+
+  /* -*- rx handlers -*- */
+
+  void handle_logging_data(
+    const mavlink::mavlink_message_t * msg [[maybe_unused]],
+    mavlink::common::msg::LOGGING_DATA & ld,
+    plugin::filter::SystemAndOk filter [[maybe_unused]])
+  {
+    process_packet(
+      ld.sequence, ld.data.data(), std::min<size_t>(ld.length, ld.data.size()),
+      ld.first_message_offset);
+  }
+
+  void handle_logging_data_acked(
+    const mavlink::mavlink_message_t * msg [[maybe_unused]],
+    mavlink::common::msg::LOGGING_DATA_ACKED & ld,
+    plugin::filter::SystemAndOk filter [[maybe_unused]])
+  {
+    {
+      std::lock_guard<std::mutex> lock(stream_mutex);
+      if (!streaming) {
+        return;
+      }
+    }
+
+    // ack retransmitted packets too, our previous ack may have been lost
+    mavlink::common::msg::LOGGING_ACK ack{};
+    uas->msg_set_target(ack);
+    ack.sequence = ld.sequence;
+    uas->send_message(ack);
+
+    process_packet(
+      ld.sequence, ld.data.data(), std::min<size_t>(ld.length, ld.data.size()),
+      ld.first_message_offset);
+  }
+
+  /* -*- callbacks -*- */
+
+  void connection_cb(bool connected) override
+  {
+    if (!connected && close_stream()) {
+      RCLCPP_WARN(get_logger(), "LS: FCU lost, log closed");
+    }
+  }
+
+  void start_cb(
+    const std_srvs::srv::Trigger::Request::SharedPtr req [[maybe_unused]],
+    std_srvs::srv::Trigger::Response::SharedPtr res)
+  {
+    {
+      std::lock_guard<std::mutex> lock(stream_mutex);
+      if (writer) {
+        res->success = false;
+        res->message = "already streaming to " + writer->get_file_name();
+        return;
+      }
+    }
+
+    auto path = make_file_name();
+    auto w = std::make_unique<utils::AsyncFileWriter>(buffer_size);
+    if (!w->open(path)) {
+      res->success = false;
+      res->message = "can not create " + path;
+      RCLCPP_ERROR(get_logger(), "LS: %s", res->message.c_str());
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(stream_mutex);
+      writer = std::move(w);
+      assembler.reset();
+      streaming = true;
+    }
+
+    if (!send_logging_command(MAV_CMD::LOGGING_START)) {
+      close_stream();
+      res->success = false;
+      res->message = "LOGGING_START rejected";
+      RCLCPP_ERROR(get_logger(), "LS: %s", res->message.c_str());
+      return;
+    }
+
+    RCLCPP_INFO(get_logger(), "LS: streaming to %s", path.c_str());
+    res->success = true;
+    res->message = path;
+  }
+
+  void stop_cb(
+    const std_srvs::srv::Trigger::Request::SharedPtr req [[maybe_unused]],
+    std_srvs::srv::Trigger::Response::SharedPtr res)
+  {
+    res->success = send_logging_command(MAV_CMD::LOGGING_STOP);
+
+    {
+      std::lock_guard<std::mutex> lock(stream_mutex);
+      res->message = writer ? writer->get_file_name() : "";
+    }
+
+    close_stream();
+  }
+};
+
+}       // namespace extra_plugins
+}       // namespace mavros
+
+#include <mavros/mavros_plugin_register_macro.hpp>  // NOLINT
+MAVROS_PLUGIN_REGISTER(mavros::extra_plugins::LogStreamingPlugin)
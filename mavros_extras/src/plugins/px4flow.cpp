@@ -16,9 +16,11 @@
  * @{
  */
 
+#include <mutex>
 #include <string>
 
 #include "rcpputils/asserts.hpp"
+#include "mavros/flow_integrator.hpp"
 #include "mavros/mavros_uas.hpp"
 #include "mavros/plugin.hpp"
 #include "mavros/plugin_filter.hpp"
@@ -38,6 +40,8 @@ using namespace std::placeholders;      // NOLINT
  * @plugin px4flow
  *
  * This plugin can publish data from PX4Flow camera to ROS
+ *
+ * Flow sent from ROS may be integrated to send.rate before sending to FCU.
  */
 class PX4FlowPlugin : public plugin::Plugin
 {
@@ -46,7 +50,8 @@ public:
   : Plugin(uas_, "px4flow"),
     ranger_fov(0.0),
     ranger_min_range(0.3),
-    ranger_max_range(5.0)
+    ranger_max_range(5.0),
+    send_integrate(false)
   {
     enable_node_watch_parameters();
 
@@ -76,6 +81,22 @@ public:
         ranger_max_range = p.as_double();
       });
 
+    node_declate_and_watch_parameter(
+      "send.rate", 0.0, [&](const rclcpp::Parameter & p) {
+        auto rate = p.as_double();
+
+        std::lock_guard<std::mutex> lock(integrator_mutex);
+        send_integrate = rate > 0.0;
+        integrator.set_window(send_integrate ? static_cast<uint32_t>(1e6 / rate) : 0);
+        integrator.reset();
+      });
+
+    node_declate_and_watch_parameter(
+      "send.min_quality", 1, [&](const rclcpp::Parameter & p) {
+        std::lock_guard<std::mutex> lock(integrator_mutex);
+        integrator.set_min_quality(p.as_int());
+      });
+
     flow_rad_pub = node->create_publisher<mavros_msgs::msg::OpticalFlowRad>(
       "~/raw/optical_flow_rad", 10);
     range_pub = node->create_publisher<sensor_msgs::msg::Range>("~/ground_distance", 10);
@@ -106,6 +127,10 @@ private:
   rclcpp::Publisher<sensor_msgs::msg::Temperature>::SharedPtr temp_pub;
   rclcpp::Subscription<mavros_msgs::msg::OpticalFlowRad>::SharedPtr flow_rad_sub;
 
+  std::mutex integrator_mutex;
+  bool send_integrate;
+  utils::FlowIntegrator integrator;
+
   void handle_optical_flow_rad(
     const mavlink::mavlink_message_t * msg [[maybe_unused]],
     mavlink::common::msg::OPTICAL_FLOW_RAD & flow_rad,
@@ -207,6 +232,16 @@ private:
     flow_rad_msg.time_delta_distance_us = msg->time_delta_distance_us;
     flow_rad_msg.distance = msg->distance;
 
+    {
+      std::lock_guard<std::mutex> lock(integrator_mutex);
+      if (send_integrate) {
+        auto sample = flow_rad_msg;
+        if (!integrator.add(sample, flow_rad_msg)) {
+          return;
+        }
+      }
+    }
+
     uas->send_message(flow_rad_msg);
   }
 };
@@ -15,6 +15,8 @@
  */
 
 #include <algorithm>
+#include <mutex>
+#include <vector>
 
 #include "rcpputils/asserts.hpp"
 #include "mavros/mavros_uas.hpp"
@@ -45,14 +47,44 @@ using RosPoints = mavros_msgs::msg::PositionTarget;
  * send back to the FCU a corrected path (collision free, smoothed)
  * @plugin trajectory
  *
+ * With path.stream_rate > 0 a long nav_msgs/Path is kept whole and streamed
+ * as a rolling horizon: the next NUM_POINTS poses ahead of the vehicle
+ * are sent at that rate, so planners may publish paths of any length.
+ *
  * @see trajectory_cb()
  */
 class TrajectoryPlugin : public plugin::Plugin
 {
 public:
   explicit TrajectoryPlugin(plugin::UASPtr uas_)
-  : Plugin(uas_, "trajectory")
+  : Plugin(uas_, "trajectory"),
+    acceptance_radius(0.5),
+    path_progress(0),
+    path_progress_init(false)
   {
+    enable_node_watch_parameters();
+
+    node_declate_and_watch_parameter(
+      "path.stream_rate", 0.0, [&](const rclcpp::Parameter & p) {
+        auto rate = p.as_double();
+
+        std::lock_guard<std::mutex> lock(path_mutex);
+        stream_timer.reset();
+        path_points.clear();
+
+        if (rate > 0.0) {
+          stream_timer = node->create_wall_timer(
+            rclcpp::WallRate(rate).period(),
+            std::bind(&TrajectoryPlugin::stream_cb, this));
+        }
+      });
+
+    node_declate_and_watch_parameter(
+      "path.acceptance_radius", 0.5, [&](const rclcpp::Parameter & p) {
+        std::lock_guard<std::mutex> lock(path_mutex);
+        acceptance_radius = p.as_double();
+      });
+
     trajectory_generated_sub = node->create_subscription<mavros_msgs::msg::Trajectory>(
       "~/generated", 10, std::bind(
         &TrajectoryPlugin::trajectory_cb, this, _1));
@@ -76,6 +108,21 @@ private:
 
   rclcpp::Publisher<mavros_msgs::msg::Trajectory>::SharedPtr trajectory_desired_pub;
 
+  rclcpp::TimerBase::SharedPtr stream_timer;
+
+  //! Path pose already converted to FCU frame
+  struct PathPoint
+  {
+    Eigen::Vector3d position;   //!< [NED]
+    float yaw;                  //!< as sent in pos_yaw
+  };
+
+  std::mutex path_mutex;
+  std::vector<PathPoint> path_points;
+  double acceptance_radius;     //!< distance at which the point counts as passed [m]
+  size_t path_progress;         //!< index of the first point not passed yet
+  bool path_progress_init;      //!< progress is not yet matched to vehicle position
+
   // [[[cog:
   // def outl_fill_points_ned_vector(x, y, z, vec_name, vec_type, point_xyz):
   //     cog.outl(
@@ -145,13 +192,18 @@ private:
   void fill_points_yaw_q(
     MavPoints & y, const geometry_msgs::msg::Quaternion & orientation,
     const size_t i)
+  {
+    y[i] = yaw_q_to_wp(orientation);
+  }
+
+  float yaw_q_to_wp(const geometry_msgs::msg::Quaternion & orientation)
   {
     auto q_wp = ftf::transform_orientation_enu_ned(
       ftf::transform_orientation_baselink_aircraft(
         ftf::to_eigen(orientation)));
     auto yaw_wp = ftf::quaternion_get_yaw(q_wp);
 
-    y[i] = wrap_pi(-yaw_wp + (M_PI / 2.0f));
+    return wrap_pi(-yaw_wp + (M_PI / 2.0f));
   }
 
   void fill_points_delta(MavPoints & y, const double time_horizon, const size_t i)
@@ -340,6 +392,17 @@ private:
    */
   void path_cb(const nav_msgs::msg::Path::SharedPtr req)
   {
+    bool streaming;
+    {
+      std::lock_guard<std::mutex> lock(path_mutex);
+      streaming = static_cast<bool>(stream_timer);
+    }
+
+    if (streaming) {
+      store_path(*req);
+      return;
+    }
+
     mavlink::common::msg::TRAJECTORY_REPRESENTATION_WAYPOINTS trajectory {};
 
     trajectory.time_usec = get_time_usec(req->header.stamp);        //!< [milisecs]
@@ -373,6 +436,109 @@ private:
     uas->send_message(trajectory);
   }
 
+  /**
+   * @brief Keep whole path for streaming
+   *
+   * All poses are converted to FCU frame once here,
+   * stream_cb() only copies the current horizon.
+   */
+  void store_path(const nav_msgs::msg::Path & path)
+  {
+    std::vector<PathPoint> points;
+    points.reserve(path.poses.size());
+
+    for (auto & ps : path.poses) {
+      points.push_back(
+        PathPoint{
+          ftf::transform_frame_enu_ned(ftf::to_eigen(ps.pose.position)),
+          yaw_q_to_wp(ps.pose.orientation)});
+    }
+
+    std::lock_guard<std::mutex> lock(path_mutex);
+    path_points = std::move(points);
+    path_progress = 0;
+    path_progress_init = true;
+  }
+
+  /**
+   * @brief Advance path progress to the vehicle position
+   *
+   * After new path the whole path is searched for the nearest point,
+   * then progress only moves forward while next point is not farther
+   * than the current one, or current one is within acceptance radius.
+   */
+  void update_progress(const Eigen::Vector3d & vehicle_ned)
+  {
+    auto dist = [&](size_t i) {
+        return (path_points[i].position - vehicle_ned).norm();
+      };
+
+    if (path_progress_init) {
+      path_progress_init = false;
+
+      double best = dist(0);
+      for (size_t i = 1; i < path_points.size(); i++) {
+        auto d = dist(i);
+        if (d < best) {
+          best = d;
+          path_progress = i;
+        }
+      }
+    }
+
+    while (path_progress + 1 < path_points.size() &&
+      (dist(path_progress) < acceptance_radius ||
+      dist(path_progress + 1) <= dist(path_progress)))
+    {
+      path_progress++;
+    }
+  }
+
+  //! Send next NUM_POINTS of stored path
+  void stream_cb()
+  {
+    std::lock_guard<std::mutex> lock(path_mutex);
+
+    if (path_points.empty()) {
+      return;
+    }
+
+    // vehicle position comes from aggregated state, filled by local_position plugin
+    auto vs = uas->data.get_snapshot();
+    if (vs.local_stamp_ns != 0) {
+      update_progress(
+        ftf::transform_frame_enu_ned(
+          Eigen::Vector3d(vs.local_position[0], vs.local_position[1], vs.local_position[2])));
+    } else {
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), *get_clock(), 5000,
+        "TR: no local position, path progress not updated (is local_position plugin loaded?)");
+    }
+
+    mavlink::common::msg::TRAJECTORY_REPRESENTATION_WAYPOINTS trajectory {};
+
+    trajectory.time_usec = get_time_usec();
+    trajectory.valid_points = std::min(NUM_POINTS, path_points.size() - path_progress);
+
+    for (size_t i = 0; i < NUM_POINTS; i++) {
+      trajectory.command[i] = UINT16_MAX;
+
+      if (i < trajectory.valid_points) {
+        auto & pt = path_points[path_progress + i];
+
+        trajectory.pos_x[i] = pt.position.x();
+        trajectory.pos_y[i] = pt.position.y();
+        trajectory.pos_z[i] = pt.position.z();
+        trajectory.pos_yaw[i] = pt.yaw;
+        fill_points_unused_path(trajectory, i);
+      } else {
+        fill_points_all_unused(trajectory, i);
+      }
+    }
+
+    uas->send_message(trajectory);
+  }
+
   void handle_trajectory(
     const mavlink::mavlink_message_t * msg [[maybe_unused]],
     mavlink::common::msg::TRAJECTORY_REPRESENTATION_WAYPOINTS & trajectory,